@@ -0,0 +1,71 @@
+#include "BackBuffer.h"
+
+namespace {
+    // Marge des sections, en pixels
+    const int Granularity = 256;
+
+    int RoundUp(int value) {
+        return (value + Granularity - 1) / Granularity * Granularity;
+    }
+}
+
+BackBuffer::~BackBuffer() {
+    Release();
+}
+
+bool BackBuffer::Reserve(HDC reference, int width, int height) {
+    if (width <= 0 || height <= 0) return false;
+    if (m_bits && width <= m_capacityWidth && height <= m_capacityHeight) {
+        m_width = width;
+        m_height = height;
+        return true;
+    }
+    Release();
+
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = RoundUp(width);
+    info.bmiHeader.biHeight = -RoundUp(height);
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    void* bits = nullptr;
+    HBITMAP bitmap = CreateDIBSection(reference, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!bitmap) return false;
+    HDC dc = CreateCompatibleDC(reference);
+    if (!dc) {
+        DeleteObject(bitmap);
+        return false;
+    }
+    m_dc = dc;
+    m_bitmap = bitmap;
+    m_previous = SelectObject(m_dc, m_bitmap);
+    m_bits = (uint8_t*)bits;
+    m_capacityWidth = RoundUp(width);
+    m_capacityHeight = RoundUp(height);
+    m_width = width;
+    m_height = height;
+    return true;
+}
+
+void BackBuffer::Release() {
+    if (m_dc) {
+        SelectObject(m_dc, m_previous);
+        DeleteDC(m_dc);
+    }
+    if (m_bitmap) DeleteObject(m_bitmap);
+    m_dc = nullptr;
+    m_bitmap = nullptr;
+    m_previous = nullptr;
+    m_bits = nullptr;
+    m_capacityWidth = m_capacityHeight = 0;
+    m_width = m_height = 0;
+}
+
+ImageView BackBuffer::View() const {
+    return ImageView{ m_bits, m_width, m_height, (ptrdiff_t)m_capacityWidth * 4 };
+}
+
+ConstImageView BackBuffer::ConstView() const {
+    return ConstImageView(m_bits, m_width, m_height, (ptrdiff_t)m_capacityWidth * 4);
+}
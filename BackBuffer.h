@@ -0,0 +1,39 @@
+#pragma once
+
+#include <windows.h>
+
+#include "FrameCompositor.h"
+
+// Bitmap 32 bits hors ecran (section DIB, lignes de haut en bas) selectionne dans un DC
+// memoire : GDI et GDI+ y dessinent par Dc(), FrameCompositor lit et ecrit ses pixels par
+// View(). La section garde une marge pour qu'un redimensionnement continu de la fenetre ne
+// la recree pas a chaque pixel.
+class BackBuffer {
+public:
+    BackBuffer() = default;
+    ~BackBuffer();
+
+    BackBuffer(const BackBuffer&) = delete;
+    BackBuffer& operator=(const BackBuffer&) = delete;
+
+    // Au moins width x height ; false si la section n'a pas pu etre creee
+    bool Reserve(HDC reference, int width, int height);
+    void Release();
+
+    HDC Dc() const { return m_dc; }
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    // Pixels utiles (taille demandee a Reserve)
+    ImageView View() const;
+    ConstImageView ConstView() const;
+
+private:
+    HDC m_dc = nullptr;
+    HBITMAP m_bitmap = nullptr;
+    HGDIOBJ m_previous = nullptr;
+    uint8_t* m_bits = nullptr;
+    int m_capacityWidth = 0;
+    int m_capacityHeight = 0;
+    int m_width = 0;
+    int m_height = 0;
+};
@@ -0,0 +1,354 @@
+#include "ChangeWatcher.h"
+
+#include "ImageScanner.h"
+#include "PathString.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // "C:\photos\" et "C:\photos" designent le meme dossier ; les racines gardent leur separateur
+    std::wstring TrimSeparators(std::wstring path) {
+        while (path.size() > 1 && IsPathSeparator(path.back()) && path[path.size() - 2] != L':') {
+            path.pop_back();
+        }
+        return path;
+    }
+
+    // `path` est `directory` ou un de ses descendants
+    bool IsUnder(const std::wstring& path, const std::wstring& directory) {
+        if (path.size() < directory.size() || path.compare(0, directory.size(), directory) != 0) return false;
+        return path.size() == directory.size() || IsPathSeparator(path[directory.size()]) ||
+            (!directory.empty() && IsPathSeparator(directory.back()));
+    }
+
+    std::wstring ParentOf(const std::wstring& path) {
+        return PathToWide(WideToPath(path).parent_path());
+    }
+
+    int64_t FileTimeTicks(const fs::file_time_type& time) {
+        return (int64_t)time.time_since_epoch().count();
+    }
+}
+
+size_t ApplyFileChanges(ImageCatalog& catalog, const std::vector<FileChange>& changes) {
+    size_t changed = 0;
+
+    // Images de chaque dossier, construit seulement si un dossier entier change
+    std::vector<std::vector<ImageId>> byDirectory;
+    bool indexed = false;
+    auto indexDirectories = [&]() {
+        if (!indexed) {
+            byDirectory.assign(catalog.DirectoryCount(), {});
+            for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) byDirectory[catalog.DirectoryOf(id)].push_back(id);
+            indexed = true;
+        }
+        byDirectory.resize(catalog.DirectoryCount());
+    };
+    auto added = [&](ImageId id, size_t previousSize, uint64_t previousVersion) {
+        if (catalog.Size() > previousSize) {
+            ++changed;
+            if (indexed) {
+                byDirectory.resize(catalog.DirectoryCount());
+                byDirectory[catalog.DirectoryOf(id)].push_back(id);
+            }
+        }
+        else if (catalog.IsExcluded(id)) {
+            catalog.Restore(id);
+            ++changed;
+        }
+        else if (catalog.Version() != previousVersion) {
+            // Fichier modifie sur place : nouvelles date, taille ou dimensions
+            ++changed;
+        }
+    };
+    auto exclude = [&](ImageId id) {
+        if (!catalog.IsExcluded(id)) {
+            catalog.Exclude(id);
+            ++changed;
+        }
+    };
+
+    for (const FileChange& change : changes) {
+        switch (change.kind) {
+        case FileChangeKind::Added: {
+            size_t previousSize = catalog.Size();
+            uint64_t previousVersion = catalog.Version();
+            ImageId id = catalog.Add(change.path, change.mtime, change.size, change.width, change.height);
+            added(id, previousSize, previousVersion);
+            break;
+        }
+        case FileChangeKind::Removed: {
+            ImageId id = catalog.Find(change.path);
+            if (id != InvalidImageId) exclude(id);
+            break;
+        }
+        case FileChangeKind::DirectoryListed: {
+            indexDirectories();
+            std::unordered_set<std::wstring_view> present;
+            for (const auto& file : change.files) {
+                if (!file.rejected) present.insert(file.name);
+            }
+
+            uint32_t directory = catalog.FindDirectory(change.path);
+            if (directory != UINT32_MAX) {
+                for (ImageId id : byDirectory[directory]) {
+                    if (present.find(catalog.FileName(id)) == present.end()) exclude(id);
+                }
+            }
+            else if (!present.empty()) {
+                directory = catalog.AddDirectory(change.path);
+            }
+            for (const auto& file : change.files) {
+                if (file.rejected) continue;
+                size_t previousSize = catalog.Size();
+                uint64_t previousVersion = catalog.Version();
+                ImageId id = catalog.Add(directory, file.name, file.mtime, file.size, file.width, file.height);
+                added(id, previousSize, previousVersion);
+            }
+            break;
+        }
+        case FileChangeKind::DirectoryRemoved:
+            indexDirectories();
+            for (uint32_t directory = 0; directory < (uint32_t)catalog.DirectoryCount(); ++directory) {
+                if (!IsUnder(catalog.DirectoryPath(directory), change.path)) continue;
+                for (ImageId id : byDirectory[directory]) exclude(id);
+            }
+            break;
+        }
+    }
+    return changed;
+}
+
+#if !defined(_WIN32) && !defined(__linux__)
+std::unique_ptr<ChangeBackend> CreateChangeBackend() {
+    return nullptr;
+}
+#endif
+
+ChangeWatcher::~ChangeWatcher() {
+    Stop();
+}
+
+void ChangeWatcher::Start(const std::wstring& root, NotifyFn notify) {
+    Stop();
+
+    m_backend = CreateChangeBackend();
+    if (!m_backend) return;
+    m_stop = false;
+    m_notifyPending = false;
+    m_notify = std::move(notify);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.clear();
+    }
+    m_running = true;
+    m_thread = std::thread(&ChangeWatcher::Run, this, TrimSeparators(root));
+}
+
+void ChangeWatcher::Stop() {
+    if (m_thread.joinable()) {
+        m_stop = true;
+        m_backend->Interrupt();
+        m_thread.join();
+    }
+    m_running = false;
+    m_backend.reset();
+    m_directories.clear();
+    m_settling.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+}
+
+bool ChangeWatcher::TakeChanges(std::vector<FileChange>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notifyPending = false;
+    if (m_pending.empty()) return false;
+    out.insert(out.end(), std::make_move_iterator(m_pending.begin()), std::make_move_iterator(m_pending.end()));
+    m_pending.clear();
+    return true;
+}
+
+void ChangeWatcher::Publish(std::vector<FileChange>&& changes) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.insert(m_pending.end(), std::make_move_iterator(changes.begin()), std::make_move_iterator(changes.end()));
+    }
+    if (!m_notifyPending.exchange(true) && m_notify) m_notify();
+}
+
+void ChangeWatcher::Run(std::wstring root) {
+    if (!m_backend->Open(root)) {
+        m_running = false;
+        return;
+    }
+    // Premier passage : releve des dossiers seulement, le catalogue vient du scanner
+    ScanTree(root, false, nullptr);
+    std::vector<FileChange> changes;
+
+    std::vector<RawFileChange> raw;
+    while (!m_stop) {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::milliseconds timeout{ 60000 };
+        for (const auto& settling : m_settling) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(settling.second - now);
+            timeout = std::min(timeout, std::max(remaining, std::chrono::milliseconds(0)));
+        }
+
+        raw.clear();
+        if (!m_backend->Wait(timeout, raw)) break;
+        for (const auto& change : raw) HandleRawChange(change, changes);
+
+        // Images sans nouvelle ecriture depuis settleDelay
+        now = std::chrono::steady_clock::now();
+        for (auto it = m_settling.begin(); it != m_settling.end();) {
+            if (it->second > now) {
+                ++it;
+                continue;
+            }
+            std::error_code ec;
+            fs::path path = WideToPath(it->first);
+            ImageProbe probe;
+            if (fs::is_regular_file(path, ec) && (!probeImages || ProbeImageFile(it->first, probe))) {
+                FileChange change{ FileChangeKind::Added, it->first };
+                fs::file_time_type mtime = fs::last_write_time(path, ec);
+                if (!ec) change.mtime = FileTimeTicks(mtime);
+                uint64_t size = fs::file_size(path, ec);
+                if (!ec) change.size = size;
+                change.width = probe.width;
+                change.height = probe.height;
+                changes.push_back(std::move(change));
+            }
+            it = m_settling.erase(it);
+        }
+
+        if (!changes.empty()) {
+            Publish(std::move(changes));
+            changes.clear();
+        }
+    }
+    m_running = false;
+}
+
+void ChangeWatcher::HandleRawChange(const RawFileChange& change, std::vector<FileChange>& out) {
+    std::wstring path = TrimSeparators(change.path);
+    switch (change.kind) {
+    case RawFileChange::Overflow:
+        // Les evenements perdus sont retrouves par la date des dossiers : seuls ceux qui ont
+        // change depuis le releve precedent sont relus
+        ScanTree(path, true, &out);
+        break;
+
+    case RawFileChange::Removed:
+        m_settling.erase(path);
+        if (m_directories.count(path)) {
+            ForgetTree(path);
+            out.push_back(FileChange{ FileChangeKind::DirectoryRemoved, path });
+        }
+        else if (IsImagePath(WideToPath(path))) {
+            out.push_back(FileChange{ FileChangeKind::Removed, path });
+        }
+        break;
+
+    case RawFileChange::Touched: {
+        std::error_code ec;
+        fs::path fsPath = WideToPath(path);
+        if (fs::is_directory(fsPath, ec) && !fs::is_symlink(fsPath, ec)) {
+            if (!m_directories.count(path)) ScanTree(path, false, &out);
+        }
+        else if (IsImagePath(fsPath)) {
+            m_settling[path] = std::chrono::steady_clock::now() + settleDelay;
+        }
+        break;
+    }
+    }
+}
+
+void ChangeWatcher::ScanTree(const std::wstring& directory, bool reuse, std::vector<FileChange>* out) {
+    WalkOptions options;
+    options.threadCount = 2;
+    options.cancel = &m_stop;
+    options.collectDetails = true;
+    options.collectPaths = false;
+    if (!out) options.accept = [](const fs::path&) { return false; };
+    // Lecture seule de m_directories pendant le parcours
+    options.reuseDirectory = [this, reuse](WalkDirectoryInfo& info, std::vector<std::wstring>& subdirectories) {
+        auto it = m_directories.find(info.path);
+        if (it == m_directories.end()) {
+            // Surveille avant de lire : un fichier cree entre-temps est vu deux fois, pas zero
+            m_backend->Watch(info.path);
+            return false;
+        }
+        if (!reuse || it->second.mtime != info.mtime) return false;
+        subdirectories = it->second.subdirectories;
+        return true;
+    };
+    WalkResult result = WalkDirectoryTreeDetailed(directory, options);
+    if (m_stop) return;
+
+    // Dossiers disparus depuis le releve precedent
+    std::unordered_set<std::wstring> visited;
+    for (const auto& info : result.directories) visited.insert(info.path);
+    std::vector<std::wstring> removed;
+    for (const auto& known : m_directories) {
+        if (IsUnder(known.first, directory) && !visited.count(known.first)) removed.push_back(known.first);
+    }
+    for (const auto& path : removed) {
+        if (!m_directories.count(path)) continue;
+        ForgetTree(path);
+        if (out) out->push_back(FileChange{ FileChangeKind::DirectoryRemoved, path });
+    }
+
+    // Nouveau releve de la partie parcourue
+    for (const auto& info : result.directories) {
+        DirectoryState& state = m_directories[info.path];
+        state.mtime = info.mtime;
+        state.subdirectories.clear();
+    }
+    for (const auto& info : result.directories) {
+        if (info.path == directory) continue;
+        auto parent = m_directories.find(ParentOf(info.path));
+        if (parent != m_directories.end()) parent->second.subdirectories.push_back(info.path);
+    }
+    if (visited.count(directory)) {
+        auto parent = m_directories.find(ParentOf(directory));
+        if (parent != m_directories.end()) {
+            auto& siblings = parent->second.subdirectories;
+            if (std::find(siblings.begin(), siblings.end(), directory) == siblings.end()) siblings.push_back(directory);
+        }
+    }
+
+    if (!out) return;
+    // Les dossiers repris n'ont pas de fichiers : seuls les dossiers lus sont sondes
+    if (probeImages) {
+        ProbeListings(result.directories, 2, &m_stop);
+        if (m_stop) return;
+    }
+    for (auto& info : result.directories) {
+        if (info.reused) continue;
+        FileChange change{ FileChangeKind::DirectoryListed, info.path };
+        change.files = std::move(info.files);
+        out->push_back(std::move(change));
+    }
+}
+
+void ChangeWatcher::ForgetTree(const std::wstring& directory) {
+    for (auto it = m_directories.begin(); it != m_directories.end();) {
+        if (IsUnder(it->first, directory)) it = m_directories.erase(it);
+        else ++it;
+    }
+    for (auto it = m_settling.begin(); it != m_settling.end();) {
+        if (IsUnder(it->first, directory)) it = m_settling.erase(it);
+        else ++it;
+    }
+    auto parent = m_directories.find(ParentOf(directory));
+    if (parent != m_directories.end()) {
+        auto& siblings = parent->second.subdirectories;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), directory), siblings.end());
+    }
+    m_backend->Unwatch(directory);
+}
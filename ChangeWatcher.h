@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "DirectoryWalker.h"
+#include "ImageCatalog.h"
+#include "ImageProbe.h"
+
+// Modification du dossier surveille, prete a etre appliquee au catalogue
+enum class FileChangeKind {
+    // Image creee, ou renommee vers le dossier
+    Added,
+    // Image supprimee, ou renommee hors du dossier
+    Removed,
+    // `files` est le contenu complet du dossier `path` (sans ses sous-dossiers) : dossier
+    // nouveau, ou relu apres un debordement de la file d'evenements
+    DirectoryListed,
+    // Dossier `path` supprime avec tous ses sous-dossiers
+    DirectoryRemoved,
+};
+
+struct FileChange {
+    FileChange() = default;
+    FileChange(FileChangeKind changeKind, std::wstring changePath) : kind(changeKind), path(std::move(changePath)) {}
+
+    FileChangeKind kind = FileChangeKind::Added;
+    std::wstring path;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    // Added : dimensions lues par ProbeImageFile, 0 si inconnues
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<WalkFileInfo> files;
+};
+
+// Applique les changements dans l'ordre. Les images supprimees sont exclues du tirage
+// (leurs index restent valides pour l'historique) ; une image qui revient est restauree.
+// Retourne le nombre d'images ajoutees, exclues ou restaurees.
+size_t ApplyFileChanges(ImageCatalog& catalog, const std::vector<FileChange>& changes);
+
+// Evenement brut d'un backend. Le backend ne distingue pas les dossiers des fichiers :
+// ChangeWatcher s'en charge avec sa liste des dossiers connus.
+struct RawFileChange {
+    enum Kind {
+        // Creation, modification ou renommage vers ce chemin
+        Touched,
+        // Suppression ou renommage depuis ce chemin
+        Removed,
+        // Des evenements ont ete perdus sous `path`
+        Overflow,
+    };
+    Kind kind;
+    std::wstring path;
+};
+
+// Source d'evenements du systeme : inotify sous Linux (ChangeWatcherInotify.cpp),
+// ReadDirectoryChangesW sous Windows (ChangeWatcherWin32.cpp)
+class ChangeBackend {
+public:
+    virtual ~ChangeBackend() = default;
+
+    virtual bool Open(const std::wstring& root) = 0;
+    // Backends qui surveillent chaque dossier separement (inotify). Appelables depuis les
+    // threads de parcours.
+    virtual void Watch(const std::wstring& directory) { (void)directory; }
+    // Oublie `directory` et tous ses sous-dossiers
+    virtual void Unwatch(const std::wstring& directory) { (void)directory; }
+
+    // Attend des evenements au plus `timeout` ; false apres Interrupt ou en cas d'erreur
+    virtual bool Wait(std::chrono::milliseconds timeout, std::vector<RawFileChange>& out) = 0;
+    // Reveille Wait depuis un autre thread
+    virtual void Interrupt() = 0;
+};
+
+std::unique_ptr<ChangeBackend> CreateChangeBackend();
+
+// Surveillance d'un dossier et de ses sous-dossiers sur un thread de fond. Les changements
+// sont regroupes : le thread appelle `notify` et le thread UI les recupere avec TakeChanges.
+// Une image creee n'est annoncee qu'apres `settleDelay` sans nouvelle ecriture, pour ne
+// pas decoder un fichier en cours de copie.
+class ChangeWatcher {
+public:
+    using NotifyFn = std::function<void()>;
+
+    ChangeWatcher() = default;
+    ~ChangeWatcher();
+
+    ChangeWatcher(const ChangeWatcher&) = delete;
+    ChangeWatcher& operator=(const ChangeWatcher&) = delete;
+
+    // Arrete la surveillance precedente puis surveille `root`
+    void Start(const std::wstring& root, NotifyFn notify);
+    void Stop();
+    bool IsRunning() const { return m_running.load(); }
+
+    // Ajoute a `out` les changements publies depuis le dernier appel
+    bool TakeChanges(std::vector<FileChange>& out);
+
+    std::chrono::milliseconds settleDelay{ 500 };
+    // Sonde les images avant de les annoncer (ProbeImageFile) : un fichier tronque ou qui
+    // n'est pas une image est ignore jusqu'a sa prochaine modification
+    bool probeImages = true;
+
+private:
+    struct DirectoryState {
+        int64_t mtime = 0;
+        std::vector<std::wstring> subdirectories;
+    };
+    using Snapshot = std::unordered_map<std::wstring, DirectoryState>;
+
+    void Run(std::wstring root);
+    void HandleRawChange(const RawFileChange& change, std::vector<FileChange>& out);
+    // Parcourt `directory` : avec `reuse`, les dossiers dont la date n'a pas change depuis
+    // le dernier passage ne sont pas relus. Les dossiers lus sont ajoutes a `out`
+    // (DirectoryListed) ; sans `out`, seul le releve des dossiers est mis a jour.
+    void ScanTree(const std::wstring& directory, bool reuse, std::vector<FileChange>* out);
+    void ForgetTree(const std::wstring& directory);
+    void Publish(std::vector<FileChange>&& changes);
+
+    std::unique_ptr<ChangeBackend> m_backend;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{ false };
+    std::atomic<bool> m_running{ false };
+    std::atomic<bool> m_notifyPending{ false };
+    NotifyFn m_notify;
+
+    // Thread de surveillance seulement
+    Snapshot m_directories;
+    std::unordered_map<std::wstring, std::chrono::steady_clock::time_point> m_settling;
+
+    std::mutex m_mutex;
+    std::vector<FileChange> m_pending;
+};
@@ -0,0 +1,132 @@
+#include "ChangeWatcher.h"
+
+#if defined(__linux__)
+
+#include "PathString.h"
+
+#include <cerrno>
+#include <filesystem>
+#include <mutex>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    // inotify ne suit pas les sous-dossiers : chaque dossier a sa propre surveillance,
+    // ajoutee par ChangeWatcher au fil des parcours
+    class InotifyBackend : public ChangeBackend {
+    public:
+        ~InotifyBackend() override {
+            if (m_fd >= 0) close(m_fd);
+            if (m_wake >= 0) close(m_wake);
+        }
+
+        bool Open(const std::wstring& root) override {
+            m_root = root;
+            m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            return m_fd >= 0 && m_wake >= 0;
+        }
+
+        void Watch(const std::wstring& directory) override {
+            const uint32_t mask = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                IN_ONLYDIR | IN_EXCL_UNLINK;
+            // Echec possible si la limite fs.inotify.max_user_watches est atteinte : le dossier
+            // n'est alors vu qu'apres un debordement
+            int wd = inotify_add_watch(m_fd, WideToPath(directory).c_str(), mask);
+            if (wd < 0) return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_paths[wd] = directory;
+        }
+
+        void Unwatch(const std::wstring& directory) override {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_paths.begin(); it != m_paths.end();) {
+                const std::wstring& path = it->second;
+                bool under = path.compare(0, directory.size(), directory) == 0 &&
+                    (path.size() == directory.size() || IsPathSeparator(path[directory.size()]));
+                if (under) {
+                    inotify_rm_watch(m_fd, it->first);
+                    it = m_paths.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+
+        bool Wait(std::chrono::milliseconds timeout, std::vector<RawFileChange>& out) override {
+            pollfd fds[2] = { { m_fd, POLLIN, 0 }, { m_wake, POLLIN, 0 } };
+            int ready = poll(fds, 2, (int)timeout.count());
+            if (ready < 0) return errno == EINTR;
+            if (fds[1].revents) return false;
+            if (!(fds[0].revents & POLLIN)) return true;
+
+            alignas(inotify_event) char buffer[64 * 1024];
+            for (;;) {
+                ssize_t length = read(m_fd, buffer, sizeof(buffer));
+                if (length <= 0) break;
+                for (char* position = buffer; position < buffer + length;) {
+                    const inotify_event* event = (const inotify_event*)position;
+                    position += sizeof(inotify_event) + event->len;
+                    Translate(*event, out);
+                }
+            }
+            return true;
+        }
+
+        void Interrupt() override {
+            uint64_t one = 1;
+            (void)!write(m_wake, &one, sizeof(one));
+        }
+
+    private:
+        void Translate(const inotify_event& event, std::vector<RawFileChange>& out) {
+            if (event.mask & IN_Q_OVERFLOW) {
+                // La file du noyau est commune a tous les dossiers : on ne sait pas ou
+                out.push_back(RawFileChange{ RawFileChange::Overflow, m_root });
+                return;
+            }
+
+            std::wstring directory;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_paths.find(event.wd);
+                if (it == m_paths.end()) return;
+                if (event.mask & IN_IGNORED) {
+                    m_paths.erase(it);
+                    return;
+                }
+                directory = it->second;
+            }
+            if (event.len == 0) return;
+
+            std::wstring path;
+            try {
+                path = JoinPath(directory, PathToWide(std::filesystem::path(event.name)));
+            }
+            catch (const std::exception&) {
+                return;
+            }
+            if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+                out.push_back(RawFileChange{ RawFileChange::Removed, std::move(path) });
+            }
+            else if (event.mask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                out.push_back(RawFileChange{ RawFileChange::Touched, std::move(path) });
+            }
+        }
+
+        std::wstring m_root;
+        int m_fd = -1;
+        int m_wake = -1;
+        std::mutex m_mutex;
+        std::unordered_map<int, std::wstring> m_paths;
+    };
+}
+
+std::unique_ptr<ChangeBackend> CreateChangeBackend() {
+    return std::make_unique<InotifyBackend>();
+}
+
+#endif
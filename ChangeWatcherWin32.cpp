@@ -0,0 +1,109 @@
+#include "ChangeWatcher.h"
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+namespace {
+    // Une seule surveillance recursive sur la racine (ReadDirectoryChangesW, bWatchSubtree)
+    class Win32ChangeBackend : public ChangeBackend {
+    public:
+        ~Win32ChangeBackend() override {
+            if (m_pending) {
+                CancelIoEx(m_directory, &m_overlapped);
+                DWORD bytes;
+                GetOverlappedResult(m_directory, &m_overlapped, &bytes, TRUE);
+            }
+            if (m_directory != INVALID_HANDLE_VALUE) CloseHandle(m_directory);
+            if (m_event) CloseHandle(m_event);
+            if (m_wake) CloseHandle(m_wake);
+        }
+
+        bool Open(const std::wstring& root) override {
+            m_root = root;
+            m_directory = CreateFileW(root.c_str(), FILE_LIST_DIRECTORY,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+            m_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            m_wake = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            return m_directory != INVALID_HANDLE_VALUE && m_event && m_wake && Issue();
+        }
+
+        bool Wait(std::chrono::milliseconds timeout, std::vector<RawFileChange>& out) override {
+            if (!m_pending && !Issue()) return false;
+
+            HANDLE handles[2] = { m_event, m_wake };
+            DWORD result = WaitForMultipleObjects(2, handles, FALSE, (DWORD)timeout.count());
+            if (result == WAIT_TIMEOUT) return true;
+            if (result != WAIT_OBJECT_0) return false;
+
+            DWORD bytes = 0;
+            m_pending = false;
+            if (!GetOverlappedResult(m_directory, &m_overlapped, &bytes, FALSE)) {
+                if (GetLastError() != ERROR_NOTIFY_ENUM_DIR) return false;
+                bytes = 0;
+            }
+            // Tampon deborde : le systeme n'a garde aucun evenement
+            if (bytes == 0) {
+                out.push_back(RawFileChange{ RawFileChange::Overflow, m_root });
+            }
+            else {
+                Parse(out);
+            }
+            return Issue();
+        }
+
+        void Interrupt() override {
+            SetEvent(m_wake);
+        }
+
+    private:
+        bool Issue() {
+            ResetEvent(m_event);
+            ZeroMemory(&m_overlapped, sizeof(m_overlapped));
+            m_overlapped.hEvent = m_event;
+            const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE;
+            m_pending = ReadDirectoryChangesW(m_directory, m_buffer, sizeof(m_buffer), TRUE, filter,
+                nullptr, &m_overlapped, nullptr) != FALSE;
+            return m_pending;
+        }
+
+        void Parse(std::vector<RawFileChange>& out) {
+            const BYTE* position = (const BYTE*)m_buffer;
+            for (;;) {
+                const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)position;
+                std::wstring path = JoinPath(m_root,
+                    std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+                switch (info->Action) {
+                case FILE_ACTION_ADDED:
+                case FILE_ACTION_MODIFIED:
+                case FILE_ACTION_RENAMED_NEW_NAME:
+                    out.push_back(RawFileChange{ RawFileChange::Touched, std::move(path) });
+                    break;
+                case FILE_ACTION_REMOVED:
+                case FILE_ACTION_RENAMED_OLD_NAME:
+                    out.push_back(RawFileChange{ RawFileChange::Removed, std::move(path) });
+                    break;
+                }
+                if (info->NextEntryOffset == 0) break;
+                position += info->NextEntryOffset;
+            }
+        }
+
+        std::wstring m_root;
+        HANDLE m_directory = INVALID_HANDLE_VALUE;
+        HANDLE m_event = nullptr;
+        HANDLE m_wake = nullptr;
+        OVERLAPPED m_overlapped{};
+        bool m_pending = false;
+        // Aligne sur un DWORD comme l'exige ReadDirectoryChangesW ; 64 Ko au plus pour les
+        // partages reseau
+        DWORD m_buffer[16 * 1024];
+    };
+}
+
+std::unique_ptr<ChangeBackend> CreateChangeBackend() {
+    return std::make_unique<Win32ChangeBackend>();
+}
+
+#endif
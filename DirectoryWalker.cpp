@@ -0,0 +1,231 @@
+#include "DirectoryWalker.h"
+
+#include "ImageScanner.h"
+#include "PathString.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Resultats propres a un thread : aucun verrou pendant le parcours
+    struct alignas(64) WorkerResults {
+        std::vector<std::wstring> files;
+        std::vector<std::wstring> batch;
+        std::vector<WalkDirectoryInfo> directories;
+    };
+
+    struct WalkContext {
+        ThreadPool& pool;
+        const WalkOptions& options;
+        WalkCounters& counters;
+        std::vector<WorkerResults>& results;
+    };
+
+    bool IsCancelled(const WalkContext& ctx) {
+        return ctx.options.cancel && ctx.options.cancel->load(std::memory_order_relaxed);
+    }
+
+    int64_t FileTimeTicks(const fs::file_time_type& time) {
+        return (int64_t)time.time_since_epoch().count();
+    }
+
+    void AddFile(WalkContext& ctx, WorkerResults& local, std::wstring path) {
+        ctx.counters.files.fetch_add(1, std::memory_order_relaxed);
+        if (ctx.options.onBatch) {
+            local.batch.push_back(path);
+            if (local.batch.size() >= ctx.options.batchSize) {
+                ctx.options.onBatch(std::move(local.batch));
+                local.batch.clear();
+            }
+        }
+        if (ctx.options.collectPaths) {
+            local.files.push_back(std::move(path));
+        }
+    }
+
+    void VisitDirectory(WalkContext& ctx, const fs::path& directory);
+
+    void SubmitDirectory(WalkContext& ctx, fs::path directory) {
+        ctx.pool.Submit([&ctx, directory]() { VisitDirectory(ctx, directory); });
+    }
+
+    void VisitDirectory(WalkContext& ctx, const fs::path& directory) {
+        if (IsCancelled(ctx)) return;
+        ctx.counters.directories.fetch_add(1, std::memory_order_relaxed);
+
+        WorkerResults& local = ctx.results[ctx.pool.CurrentWorkerIndex()];
+        WalkDirectoryInfo info;
+        std::error_code ec;
+
+        if (ctx.options.collectDetails) {
+            try {
+                info.path = PathToWide(directory);
+            }
+            catch (const std::exception&) {
+                ctx.counters.errors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            info.mtime = FileTimeTicks(fs::last_write_time(directory, ec));
+            if (ec) {
+                ctx.counters.errors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            std::vector<std::wstring> subdirectories;
+            if (ctx.options.reuseDirectory && ctx.options.reuseDirectory(info, subdirectories)) {
+                ctx.counters.reused.fetch_add(1, std::memory_order_relaxed);
+                info.reused = true;
+                for (auto& file : info.files) {
+                    std::wstring path = JoinPath(info.path, file.name);
+                    if (ctx.options.inspectFile && file.width == 0 && !file.rejected) {
+                        file.rejected = !ctx.options.inspectFile(path, file);
+                    }
+                    if (!file.rejected) AddFile(ctx, local, std::move(path));
+                }
+                for (const auto& subdirectory : subdirectories) {
+                    SubmitDirectory(ctx, WideToPath(subdirectory));
+                }
+                local.directories.push_back(std::move(info));
+                return;
+            }
+        }
+
+        fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            ctx.counters.errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        for (; it != fs::directory_iterator(); it.increment(ec)) {
+            if (IsCancelled(ctx)) return;
+            ctx.counters.entries.fetch_add(1, std::memory_order_relaxed);
+
+            try {
+                const fs::directory_entry& entry = *it;
+                std::error_code entryEc;
+                if (entry.is_directory(entryEc) && !entry.is_symlink(entryEc)) {
+                    SubmitDirectory(ctx, entry.path());
+                }
+                else if (entry.is_regular_file(entryEc) &&
+                    (ctx.options.accept ? ctx.options.accept(entry.path()) : IsImagePath(entry.path()))) {
+                    std::wstring path = PathToWide(entry.path());
+
+                    if (ctx.options.collectDetails) {
+                        WalkFileInfo file;
+                        file.name = path.substr(FindLastSeparator(path) + 1);
+                        file.size = entry.file_size(entryEc);
+                        if (entryEc) file.size = 0;
+                        file.mtime = FileTimeTicks(entry.last_write_time(entryEc));
+                        if (entryEc) file.mtime = 0;
+                        file.rejected = ctx.options.inspectFile && !ctx.options.inspectFile(path, file);
+                        bool rejected = file.rejected;
+                        info.files.push_back(std::move(file));
+                        if (rejected) continue;
+                    }
+                    AddFile(ctx, local, std::move(path));
+                }
+            }
+            catch (const std::exception&) {
+                // Nom non convertible ou entree disparue : on passe a la suivante
+                ctx.counters.errors.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (ec) {
+            ctx.counters.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (ctx.options.collectDetails) {
+            local.directories.push_back(std::move(info));
+        }
+    }
+}
+
+std::wstring JoinPath(const std::wstring& directory, const std::wstring& name) {
+    if (directory.empty()) return name;
+    std::wstring path;
+    path.reserve(directory.size() + 1 + name.size());
+    path = directory;
+    if (!IsPathSeparator(directory.back())) {
+        path += (wchar_t)fs::path::preferred_separator;
+    }
+    path += name;
+    return path;
+}
+
+size_t DefaultWalkerThreadCount() {
+    size_t cores = std::thread::hardware_concurrency();
+    return std::clamp<size_t>(cores * 2, 4, 32);
+}
+
+std::vector<std::wstring> WalkDirectoryTree(const std::wstring& root, const WalkOptions& options,
+    WalkCounters* counters) {
+    return WalkDirectoryTreeDetailed(root, options, counters).files;
+}
+
+WalkResult WalkDirectoryTreeDetailed(const std::wstring& root, const WalkOptions& options,
+    WalkCounters* counters) {
+    WalkCounters localCounters;
+    if (!counters) counters = &localCounters;
+
+    ThreadPool pool(options.threadCount ? options.threadCount : DefaultWalkerThreadCount());
+    std::vector<WorkerResults> results(pool.ThreadCount());
+    WalkContext ctx{ pool, options, *counters, results };
+
+    SubmitDirectory(ctx, WideToPath(root));
+    pool.WaitIdle();
+
+    WalkResult result;
+    if (IsCancelled(ctx)) return result;
+
+    for (auto& local : results) {
+        result.directories.insert(result.directories.end(),
+            std::make_move_iterator(local.directories.begin()), std::make_move_iterator(local.directories.end()));
+        local.directories.clear();
+    }
+
+    if (options.onBatch) {
+        for (auto& local : results) {
+            if (!local.batch.empty()) {
+                options.onBatch(std::move(local.batch));
+                local.batch.clear();
+            }
+        }
+    }
+
+    std::vector<std::vector<std::wstring>> parts;
+    for (auto& local : results) {
+        if (!local.files.empty()) parts.push_back(std::move(local.files));
+    }
+    if (parts.empty()) return result;
+
+    // Tri de chaque partie puis fusion deux a deux, en parallele
+    for (auto& part : parts) {
+        pool.Submit([&part]() { std::sort(part.begin(), part.end()); });
+    }
+    pool.WaitIdle();
+
+    while (parts.size() > 1) {
+        std::vector<std::vector<std::wstring>> merged((parts.size() + 1) / 2);
+        for (size_t i = 0; i + 1 < parts.size(); i += 2) {
+            pool.Submit([&parts, &merged, i]() {
+                auto& left = parts[i];
+                auto& right = parts[i + 1];
+                auto& out = merged[i / 2];
+                out.reserve(left.size() + right.size());
+                std::merge(std::make_move_iterator(left.begin()), std::make_move_iterator(left.end()),
+                    std::make_move_iterator(right.begin()), std::make_move_iterator(right.end()),
+                    std::back_inserter(out));
+            });
+        }
+        if (parts.size() % 2 == 1) {
+            merged.back() = std::move(parts.back());
+        }
+        pool.WaitIdle();
+        parts = std::move(merged);
+    }
+    result.files = std::move(parts.front());
+    return result;
+}
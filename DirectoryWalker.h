@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Compteurs mis a jour pendant le parcours (lisibles depuis un autre thread)
+struct WalkCounters {
+    std::atomic<size_t> directories{ 0 };
+    std::atomic<size_t> entries{ 0 };
+    std::atomic<size_t> files{ 0 };
+    std::atomic<size_t> errors{ 0 };
+    // Dossiers repris tels quels d'un scan precedent (WalkOptions::reuseDirectory)
+    std::atomic<size_t> reused{ 0 };
+};
+
+// Fichier retenu dans un dossier ; les dates sont en ticks de fs::file_time_type.
+// Les dimensions ne sont connues qu'apres une sonde (ProbeListings), 0 sinon.
+struct WalkFileInfo {
+    std::wstring name;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Refuse par la sonde (tronque, pas une image) : garde dans les listings et l'index
+    // pour n'etre ressonde que s'il change, jamais dans les lots ni le catalogue
+    bool rejected = false;
+};
+
+struct WalkDirectoryInfo {
+    std::wstring path;
+    int64_t mtime = 0;
+    bool reused = false;
+    std::vector<WalkFileInfo> files;
+};
+
+struct WalkOptions {
+    // 0 : valeur par defaut (DefaultWalkerThreadCount)
+    size_t threadCount = 0;
+    size_t batchSize = 512;
+    const std::atomic<bool>* cancel = nullptr;
+    // Fichiers a retenir ; par defaut les extensions d'image
+    std::function<bool(const std::filesystem::path&)> accept;
+    // Appele depuis les threads de parcours avec chaque lot de fichiers retenus
+    std::function<void(std::vector<std::wstring>&&)> onBatch;
+    // Releve la date de chaque dossier et la taille/date des fichiers (WalkResult::directories)
+    bool collectDetails = false;
+    // Remplit WalkResult::files ; inutile quand les listings par dossier suffisent
+    bool collectPaths = true;
+    // Avec collectDetails, appele depuis les threads de parcours avant de lire un dossier
+    // (info.path et info.mtime remplis). Si le dossier est connu et n'a pas change, remplit
+    // info.files et `subdirectories` et retourne true : le dossier n'est alors pas relu.
+    std::function<bool(WalkDirectoryInfo& info, std::vector<std::wstring>& subdirectories)> reuseDirectory;
+    // Avec collectDetails, appele depuis les threads de parcours pour chaque fichier retenu
+    // sans dimensions (`path` complet), avant de le mettre dans un lot : peut remplir ses
+    // dimensions ; false le marque refuse (WalkFileInfo::rejected) et l'ecarte des lots
+    std::function<bool(const std::wstring& path, WalkFileInfo& file)> inspectFile;
+};
+
+struct WalkResult {
+    // Chemins complets, tries (si collectPaths)
+    std::vector<std::wstring> files;
+    // Rempli seulement avec collectDetails, sans ordre particulier
+    std::vector<WalkDirectoryInfo> directories;
+};
+
+// Le parcours est limite par la latence de chaque dossier plus que par le CPU,
+// on prend donc plus de threads que de coeurs
+size_t DefaultWalkerThreadCount();
+
+// Parcours recursif multi-thread de `root`. Chaque sous-dossier est une tache du
+// pool a vol de taches ; un dossier illisible est compte dans `errors` et ignore.
+// Le resultat est trie comme celui de ScanDirectoryRecursive.
+WalkResult WalkDirectoryTreeDetailed(const std::wstring& root, const WalkOptions& options,
+    WalkCounters* counters = nullptr);
+std::vector<std::wstring> WalkDirectoryTree(const std::wstring& root, const WalkOptions& options,
+    WalkCounters* counters = nullptr);
+
+// Concatene un dossier et un nom de fichier avec le separateur natif
+std::wstring JoinPath(const std::wstring& directory, const std::wstring& name);
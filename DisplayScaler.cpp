@@ -0,0 +1,62 @@
+#include "DisplayScaler.h"
+
+DisplayScaler::~DisplayScaler() {
+    Cancel();
+}
+
+void DisplayScaler::Request(const std::wstring& path, SIZE clientSize, NotifyFn notify) {
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        generation = ++m_generation;
+        m_ready = false;
+        m_result = ScaledImage();
+    }
+    m_requestedPath = path;
+    m_requestedSize = clientSize;
+
+    m_pool.Submit([this, path, clientSize, notify, generation]() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (generation != m_generation) return;
+        }
+
+        std::shared_ptr<Gdiplus::Bitmap> source = LoadDecodedImage(m_cache, path, clientSize);
+        ScaledImage scaled;
+        if (!source || !ScaleToClient(*source, path, clientSize, scaled)) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (generation != m_generation) return;
+            m_result = std::move(scaled);
+            m_ready = true;
+        }
+        notify();
+    });
+}
+
+bool DisplayScaler::IsRequested(const std::wstring& path, SIZE clientSize) const {
+    return m_requestedPath == path &&
+        m_requestedSize.cx == clientSize.cx && m_requestedSize.cy == clientSize.cy;
+}
+
+bool DisplayScaler::Take(ScaledImage& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ready) return false;
+    out = std::move(m_result);
+    m_result = ScaledImage();
+    m_ready = false;
+    return true;
+}
+
+void DisplayScaler::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;
+        m_ready = false;
+        m_result = ScaledImage();
+    }
+    m_requestedPath.clear();
+    m_requestedSize = SIZE{ 0, 0 };
+    m_pool.WaitIdle();
+}
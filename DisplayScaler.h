@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "ImageLoader.h"
+#include "ThreadPool.h"
+
+// Mise a l'echelle haute qualite de l'image affichee sur un thread de fond, une fois le
+// redimensionnement de la fenetre termine. Seule la derniere demande est traitee ; les
+// methodes publiques sont reservees au thread UI.
+class DisplayScaler {
+public:
+    using NotifyFn = std::function<void()>;
+
+    explicit DisplayScaler(DecodedImageCache& cache) : m_cache(cache) {}
+    ~DisplayScaler();
+
+    DisplayScaler(const DisplayScaler&) = delete;
+    DisplayScaler& operator=(const DisplayScaler&) = delete;
+
+    // Demande `path` a la taille `clientSize` ; `notify` est appele depuis le thread de
+    // fond quand le resultat est disponible pour Take
+    void Request(const std::wstring& path, SIZE clientSize, NotifyFn notify);
+    bool IsRequested(const std::wstring& path, SIZE clientSize) const;
+    bool Take(ScaledImage& out);
+    // Abandonne la demande en cours et attend le thread de fond : a appeler avant
+    // d'utiliser une image du cache sur le thread UI
+    void Cancel();
+
+private:
+    DecodedImageCache& m_cache;
+    ThreadPool m_pool{ 1 };
+    std::wstring m_requestedPath;
+    SIZE m_requestedSize{ 0, 0 };
+
+    mutable std::mutex m_mutex;
+    uint64_t m_generation = 0;
+    ScaledImage m_result;
+    bool m_ready = false;
+};
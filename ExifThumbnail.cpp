@@ -0,0 +1,121 @@
+#include "ExifThumbnail.h"
+
+#include "MappedFile.h"
+
+#include <cstring>
+
+namespace {
+    // Lecture des valeurs TIFF dans l'ordre des octets du bloc EXIF ("II" ou "MM")
+    class TiffReader {
+    public:
+        TiffReader(const uint8_t* data, size_t size, bool bigEndian)
+            : m_data(data), m_size(size), m_bigEndian(bigEndian) {}
+
+        bool Read16(size_t offset, uint16_t& value) const {
+            if (offset > m_size || m_size - offset < 2) return false;
+            const uint8_t* p = m_data + offset;
+            value = m_bigEndian ? (uint16_t)((p[0] << 8) | p[1]) : (uint16_t)(p[0] | (p[1] << 8));
+            return true;
+        }
+
+        bool Read32(size_t offset, uint32_t& value) const {
+            if (offset > m_size || m_size - offset < 4) return false;
+            const uint8_t* p = m_data + offset;
+            value = m_bigEndian
+                ? ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]
+                : (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+            return true;
+        }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        bool m_bigEndian;
+    };
+
+    constexpr uint16_t TagThumbnailOffset = 0x0201;
+    constexpr uint16_t TagThumbnailLength = 0x0202;
+
+    // Bloc TIFF d'un segment APP1 "Exif" : la miniature est decrite dans IFD1, qui suit IFD0
+    bool ParseTiff(const uint8_t* tiff, size_t size, size_t& offset, size_t& length) {
+        if (size < 8) return false;
+        bool bigEndian;
+        if (tiff[0] == 'I' && tiff[1] == 'I') bigEndian = false;
+        else if (tiff[0] == 'M' && tiff[1] == 'M') bigEndian = true;
+        else return false;
+
+        TiffReader reader(tiff, size, bigEndian);
+        uint16_t magic;
+        uint32_t ifd0;
+        if (!reader.Read16(2, magic) || magic != 42 || !reader.Read32(4, ifd0)) return false;
+
+        uint16_t count;
+        uint32_t ifd1;
+        if (!reader.Read16(ifd0, count) || !reader.Read32(ifd0 + 2 + (size_t)count * 12, ifd1) || ifd1 == 0) {
+            return false;
+        }
+        if (!reader.Read16(ifd1, count)) return false;
+
+        uint32_t thumbnailOffset = 0, thumbnailLength = 0;
+        for (uint16_t i = 0; i < count; ++i) {
+            size_t entry = ifd1 + 2 + (size_t)i * 12;
+            uint16_t tag;
+            uint32_t value;
+            if (!reader.Read16(entry, tag) || !reader.Read32(entry + 8, value)) return false;
+            if (tag == TagThumbnailOffset) thumbnailOffset = value;
+            else if (tag == TagThumbnailLength) thumbnailLength = value;
+        }
+
+        if (thumbnailOffset == 0 || thumbnailLength < 4 ||
+            thumbnailOffset > size || size - thumbnailOffset < thumbnailLength) {
+            return false;
+        }
+        if (tiff[thumbnailOffset] != 0xFF || tiff[thumbnailOffset + 1] != 0xD8) return false;
+        offset = thumbnailOffset;
+        length = thumbnailLength;
+        return true;
+    }
+}
+
+bool FindExifThumbnail(const uint8_t* data, size_t size, ExifThumbnail& out) {
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+
+    // Parcours des segments jusqu'au debut des donnees compressees (SOS)
+    size_t position = 2;
+    while (position + 4 <= size) {
+        if (data[position] != 0xFF) return false;
+        uint8_t marker = data[position + 1];
+        if (marker == 0xFF) {
+            ++position;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) return false;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            position += 2;
+            continue;
+        }
+
+        size_t length = ((size_t)data[position + 2] << 8) | data[position + 3];
+        if (length < 2 || size - position - 2 < length) return false;
+        if (marker == 0xE1 && length >= 8 && std::memcmp(data + position + 4, "Exif\0\0", 6) == 0) {
+            size_t tiffStart = position + 10;
+            size_t offset, thumbnailLength;
+            if (ParseTiff(data + tiffStart, length - 8, offset, thumbnailLength)) {
+                out.offset = tiffStart + offset;
+                out.length = thumbnailLength;
+                return true;
+            }
+        }
+        position += 2 + length;
+    }
+    return false;
+}
+
+bool DecodeExifThumbnail(const std::wstring& path, DecodedImage& out) {
+    MappedFile file;
+    if (!file.Open(path)) return false;
+
+    ExifThumbnail thumbnail;
+    if (!FindExifThumbnail(file.Data(), file.Size(), thumbnail)) return false;
+    return DecodeImageMemory(file.Data() + thumbnail.offset, thumbnail.length, 0, 0, out);
+}
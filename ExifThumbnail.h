@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ImageDecoder.h"
+
+// Miniature JPEG embarquee dans l'en-tete EXIF (APP1) des photos d'appareil. Seuls les
+// segments qui precedent les donnees de l'image sont lus.
+struct ExifThumbnail {
+    // Position et taille du JPEG de la miniature dans le fichier
+    size_t offset = 0;
+    size_t length = 0;
+};
+
+bool FindExifThumbnail(const uint8_t* data, size_t size, ExifThumbnail& out);
+
+// Miniature decodee d'un fichier JPEG ; false si le fichier n'en contient pas
+bool DecodeExifThumbnail(const std::wstring& path, DecodedImage& out);
@@ -0,0 +1,289 @@
+#include "FileReader.h"
+
+#include "PathString.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/vfs.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t PageSize = 4096;
+}
+
+StorageKind DetectStorageKind(const std::wstring& path) {
+#ifdef _WIN32
+    std::wstring_view rest = path;
+    if (rest.rfind(L"\\\\?\\UNC\\", 0) == 0) return StorageKind::Network;
+    if (rest.rfind(L"\\\\?\\", 0) == 0) rest.remove_prefix(4);
+    else if (rest.rfind(L"\\\\", 0) == 0) return StorageKind::Network;
+    if (rest.size() < 2 || rest[1] != L':') return StorageKind::Local;
+
+    wchar_t root[] = { rest[0], L':', L'\\', 0 };
+    switch (GetDriveTypeW(root)) {
+    case DRIVE_REMOTE: return StorageKind::Network;
+    case DRIVE_REMOVABLE:
+    case DRIVE_CDROM: return StorageKind::Removable;
+    default: return StorageKind::Local;
+    }
+#elif defined(__linux__)
+    struct statfs info;
+    if (statfs(WideToPath(path).c_str(), &info) != 0) return StorageKind::Local;
+    switch ((uint32_t)info.f_type) {
+    case 0x6969:        // nfs
+    case 0x517B:        // smb
+    case 0xFF534D42:    // cifs
+    case 0xFE534D42:    // smb2
+    case 0x65735546:    // fuse (sshfs...)
+    case 0x01021997:    // 9p
+    case 0x00C36400:    // ceph
+        return StorageKind::Network;
+    case 0x9660:        // iso9660
+    case 0x15013346:    // udf
+    case 0x4D44:        // fat (cartes, cles USB)
+    case 0x2011BAB0:    // exfat
+        return StorageKind::Removable;
+    default:
+        return StorageKind::Local;
+    }
+#else
+    (void)path;
+    return StorageKind::Local;
+#endif
+}
+
+const char* StorageKindName(StorageKind kind) {
+    switch (kind) {
+    case StorageKind::Network: return "network";
+    case StorageKind::Removable: return "removable";
+    default: return "local";
+    }
+}
+
+bool FileData::Open(const std::wstring& path, FileReadMode mode) {
+    Close();
+    if (mode == FileReadMode::Auto) {
+        mode = DetectStorageKind(path) == StorageKind::Local ? FileReadMode::Map : FileReadMode::Stream;
+    }
+    if (mode == FileReadMode::Map) return m_mapped.Open(path);
+    return ReadBlocks(path);
+}
+
+void FileData::Close() {
+    m_mapped.Close();
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+}
+
+void FileData::Prefault() const {
+    if (!IsMapped()) return;
+    const uint8_t* data = m_mapped.Data();
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < m_mapped.Size(); offset += PageSize) sink = sink ^ data[offset];
+}
+
+bool FileData::ReadBlocks(const std::wstring& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || (uint64_t)size.QuadPart > SIZE_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+    m_buffer.resize((size_t)size.QuadPart);
+
+    size_t done = 0;
+    while (done < m_buffer.size()) {
+        DWORD count = 0;
+        DWORD block = (DWORD)std::min(ReadBlockSize, m_buffer.size() - done);
+        if (!ReadFile(file, m_buffer.data() + done, block, &count, NULL) || count == 0) break;
+        done += count;
+    }
+    CloseHandle(file);
+#else
+    int fd = open(WideToPath(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    m_buffer.resize((size_t)st.st_size);
+
+    size_t done = 0;
+    while (done < m_buffer.size()) {
+        ssize_t count = read(fd, m_buffer.data() + done, std::min(ReadBlockSize, m_buffer.size() - done));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        done += (size_t)count;
+    }
+    close(fd);
+#endif
+    // Fichier raccourci pendant la lecture : on garde ce qui a ete lu
+    m_buffer.resize(done);
+    return done > 0;
+}
+
+ReadAhead::ReadAhead(size_t threadCount, uint64_t maxBytes)
+    : m_maxBytes(maxBytes), m_threadCount(std::max<size_t>(1, threadCount)), m_pool(m_threadCount) {
+}
+
+ReadAhead::~ReadAhead() {
+    Cancel();
+}
+
+void ReadAhead::Request(std::vector<std::wstring> paths) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    m_queued.clear();
+
+    // Les contenus lus qui ne sont plus demandes liberent leur place
+    std::unordered_set<std::wstring> wanted(paths.begin(), paths.end());
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!it->second.reading && !wanted.count(it->first)) {
+            m_bytes -= it->second.bytes;
+            it = m_entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (auto& path : paths) {
+        if (m_entries.count(path)) continue;
+        if (m_queued.insert(path).second) m_queue.push_back(std::move(path));
+    }
+    Pump();
+}
+
+bool ReadAhead::Take(const std::wstring& path, FileData& out) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queued.erase(path);
+
+    auto it = m_entries.find(path);
+    if (it != m_entries.end()) {
+        bool waited = it->second.reading;
+        it->second.claimed = true;
+        m_changed.wait(lock, [&]() {
+            it = m_entries.find(path);
+            return it == m_entries.end() || !it->second.reading;
+        });
+        if (it != m_entries.end()) {
+            if (waited) ++m_stats.waits;
+            else ++m_stats.hits;
+            bool read = !it->second.failed;
+            if (read) out = std::move(it->second.data);
+            m_bytes -= it->second.bytes;
+            m_entries.erase(it);
+            Pump();
+            return read;
+        }
+    }
+
+    ++m_stats.misses;
+    lock.unlock();
+    return out.Open(path, mode);
+}
+
+void ReadAhead::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancel = true;
+        m_queue.clear();
+        m_queued.clear();
+    }
+    m_pool.WaitIdle();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_bytes = 0;
+    m_cancel = false;
+    m_changed.notify_all();
+}
+
+ReadAhead::Stats ReadAhead::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ReadAhead::Pump() {
+    while (!m_cancel && m_workers < m_threadCount && m_workers < m_queued.size()) {
+        ++m_workers;
+        m_pool.Submit([this]() { Work(); });
+    }
+}
+
+void ReadAhead::Work() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cancel) {
+        // Prochaine demande encore voulue
+        std::wstring path;
+        bool found = false;
+        while (!m_queue.empty() && !found) {
+            path = std::move(m_queue.front());
+            m_queue.pop_front();
+            found = m_queued.erase(path) != 0;
+        }
+        if (!found) break;
+        if (!m_entries.emplace(path, Entry()).second) continue;
+
+        lock.unlock();
+        std::error_code ec;
+        uint64_t size = fs::file_size(WideToPath(path), ec);
+        if (ec) size = 0;
+        lock.lock();
+
+        // Entree retiree seulement par Cancel, apres la fin des lectures
+        auto it = m_entries.find(path);
+        if (m_cancel || (m_bytes > 0 && m_bytes + size > m_maxBytes)) {
+            // Reprise par Take ou Pump quand de la place se libere
+            bool claimed = it->second.claimed;
+            m_entries.erase(it);
+            if (!m_cancel && !claimed && m_queued.insert(path).second) m_queue.push_front(std::move(path));
+            m_changed.notify_all();
+            break;
+        }
+        m_bytes += size;
+        it->second.bytes = size;
+        m_stats.peakBytes = std::max(m_stats.peakBytes, m_bytes);
+        lock.unlock();
+
+        FileData data;
+        bool read = data.Open(path, mode);
+        if (read) data.Prefault();
+
+        lock.lock();
+        it = m_entries.find(path);
+        // La taille lue remplace celle annoncee
+        m_bytes = m_bytes - size + data.Size();
+        m_stats.peakBytes = std::max(m_stats.peakBytes, m_bytes);
+        if (read) {
+            m_stats.bytesRead += data.Size();
+            ++m_stats.filesRead;
+        }
+        it->second.bytes = data.Size();
+        it->second.data = std::move(data);
+        it->second.failed = !read;
+        it->second.reading = false;
+        m_changed.notify_all();
+    }
+    --m_workers;
+}
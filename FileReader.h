@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// Support d'un fichier, d'apres son volume : sur un partage reseau ou un support amovible,
+// une projection lit le fichier page par page au rythme des defauts de page
+enum class StorageKind {
+    Local,
+    Network,
+    Removable,
+};
+
+StorageKind DetectStorageKind(const std::wstring& path);
+const char* StorageKindName(StorageKind kind);
+
+enum class FileReadMode {
+    // Projection sur un disque local, lecture par blocs sinon
+    Auto,
+    Map,
+    Stream,
+};
+
+// Taille des lectures en mode Stream
+constexpr size_t ReadBlockSize = 1 << 20;
+// Octets lus d'avance et pas encore consommes, par defaut (ReadAhead)
+constexpr uint64_t DefaultReadAheadBytes = 64ull << 20;
+
+// Contenu complet d'un fichier, consomme sans copie par les decodeurs : projection en
+// memoire ou tampon rempli par grands blocs sequentiels
+class FileData {
+public:
+    FileData() = default;
+
+    FileData(const FileData&) = delete;
+    FileData& operator=(const FileData&) = delete;
+    FileData(FileData&&) noexcept = default;
+    FileData& operator=(FileData&&) noexcept = default;
+
+    bool Open(const std::wstring& path, FileReadMode mode = FileReadMode::Auto);
+    void Close();
+
+    bool IsOpen() const { return Data() != nullptr; }
+    bool IsMapped() const { return m_mapped.IsOpen(); }
+    const uint8_t* Data() const { return IsMapped() ? m_mapped.Data() : (m_buffer.empty() ? nullptr : m_buffer.data()); }
+    size_t Size() const { return IsMapped() ? m_mapped.Size() : m_buffer.size(); }
+
+    // Touche chaque page d'une projection : la lecture a lieu ici plutot que pendant le decodage
+    void Prefault() const;
+
+private:
+    bool ReadBlocks(const std::wstring& path);
+
+    MappedFile m_mapped;
+    std::vector<uint8_t> m_buffer;
+};
+
+// Lecture d'avance des fichiers qu'un consommateur va decoder dans l'ordre donne. Des
+// threads dedies lisent les fichiers demandes tant que les octets lus et pas encore pris
+// restent sous `maxBytes` (un fichier plus gros passe seul). Take rend le contenu lu,
+// attend la fin d'une lecture en cours, ou lit le fichier directement s'il n'a pas ete
+// commence. Toutes les methodes peuvent etre appelees depuis plusieurs threads.
+class ReadAhead {
+public:
+    struct Stats {
+        uint64_t bytesRead = 0;
+        size_t filesRead = 0;
+        // Contenu pret au moment de Take
+        size_t hits = 0;
+        // Lecture en cours : Take a attendu
+        size_t waits = 0;
+        // Pas encore commence : lu par l'appelant
+        size_t misses = 0;
+        // Plus grand nombre d'octets lus d'avance en meme temps
+        uint64_t peakBytes = 0;
+    };
+
+    explicit ReadAhead(size_t threadCount = 2, uint64_t maxBytes = DefaultReadAheadBytes);
+    ~ReadAhead();
+
+    ReadAhead(const ReadAhead&) = delete;
+    ReadAhead& operator=(const ReadAhead&) = delete;
+
+    // Remplace les lectures pas encore commencees ; les premieres sont lues d'abord
+    void Request(std::vector<std::wstring> paths);
+    bool Take(const std::wstring& path, FileData& out);
+    // Oublie les demandes et les contenus lus, attend les lectures en cours
+    void Cancel();
+
+    Stats GetStats() const;
+
+    FileReadMode mode = FileReadMode::Auto;
+
+private:
+    struct Entry {
+        bool reading = true;
+        bool failed = false;
+        // Attendue par Take : pas remise dans la file si la place manque
+        bool claimed = false;
+        uint64_t bytes = 0;
+        FileData data;
+    };
+
+    // Appele avec m_mutex pris
+    void Pump();
+    void Work();
+
+    const uint64_t m_maxBytes;
+    const size_t m_threadCount;
+    ThreadPool m_pool;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<std::wstring> m_queue;
+    // Chemins de m_queue encore voulus : Take et Request retirent un chemin sans parcourir la file
+    std::unordered_set<std::wstring> m_queued;
+    std::unordered_map<std::wstring, Entry> m_entries;
+    uint64_t m_bytes = 0;
+    size_t m_workers = 0;
+    bool m_cancel = false;
+    Stats m_stats;
+};
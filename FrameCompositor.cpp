@@ -0,0 +1,187 @@
+#include "FrameCompositor.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Au-dela, les zones sales sont remplacees par leur enveloppe
+    const size_t MaxDirtyRects = 16;
+
+    bool Overlaps(const PixelRect& a, const PixelRect& b) {
+        return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+    }
+
+    // d * (255 - a) / 255 + s sur les quatre canaux, deux par deux (rouge et bleu, puis
+    // alpha et vert), arrondi comme une division exacte
+    uint32_t BlendPremultiplied(uint32_t destination, uint32_t source) {
+        uint32_t inverse = 255 - (source >> 24);
+        uint32_t redBlue = (destination & 0x00FF00FF) * inverse + 0x00800080;
+        redBlue = ((redBlue + ((redBlue >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+        uint32_t alphaGreen = ((destination >> 8) & 0x00FF00FF) * inverse + 0x00800080;
+        alphaGreen = (alphaGreen + ((alphaGreen >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+        return (redBlue | alphaGreen) + source;
+    }
+}
+
+PixelRect IntersectRects(const PixelRect& a, const PixelRect& b) {
+    PixelRect result{ std::max(a.left, b.left), std::max(a.top, b.top), std::min(a.right, b.right), std::min(a.bottom, b.bottom) };
+    return result.IsEmpty() ? PixelRect() : result;
+}
+
+PixelRect UnionRects(const PixelRect& a, const PixelRect& b) {
+    if (a.IsEmpty()) return b;
+    if (b.IsEmpty()) return a;
+    return PixelRect{ std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right), std::max(a.bottom, b.bottom) };
+}
+
+void FrameCompositor::Resize(int width, int height) {
+    width = std::max(0, width);
+    height = std::max(0, height);
+    if (width == m_width && height == m_height) return;
+    m_width = width;
+    m_height = height;
+    InvalidateAll();
+}
+
+bool FrameCompositor::SetBase(const ImageView& base, uint64_t key) {
+    m_base = base;
+    if (m_hasBase && key == m_baseKey) return false;
+    m_hasBase = true;
+    m_baseKey = key;
+    InvalidateAll();
+    return true;
+}
+
+FrameCompositor::Overlay& FrameCompositor::OverlayAt(size_t index) {
+    if (index >= m_overlays.size()) m_overlays.resize(index + 1);
+    return m_overlays[index];
+}
+
+bool FrameCompositor::SetOverlay(size_t index, uint64_t key, const PixelRect& bounds) {
+    Overlay& overlay = OverlayAt(index);
+    bool resized = overlay.bounds.Width() != bounds.Width() || overlay.bounds.Height() != bounds.Height();
+    bool redraw = !overlay.hasPixels || key != overlay.key || resized;
+    if (!overlay.visible || redraw || bounds != overlay.bounds) {
+        if (overlay.visible) AddDirty(overlay.bounds);
+        AddDirty(bounds);
+    }
+    overlay.key = key;
+    overlay.bounds = bounds;
+    overlay.visible = true;
+    if (redraw) overlay.hasPixels = false;
+    return redraw;
+}
+
+void FrameCompositor::SetOverlayPixels(size_t index, const ConstImageView& pixels, OverlayPixels kind) {
+    Overlay& overlay = OverlayAt(index);
+    int width = std::max(0, overlay.bounds.Width()), height = std::max(0, overlay.bounds.Height());
+    overlay.pixels.assign((size_t)width * height, 0);
+    overlay.opaque = kind == OverlayPixels::Opaque;
+    overlay.hasPixels = true;
+    int rows = std::min(height, pixels.height), columns = std::min(width, pixels.width);
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* source = pixels.data + y * pixels.stride;
+        uint32_t* destination = overlay.pixels.data() + (size_t)y * width;
+        for (int x = 0; x < columns; ++x, source += 4) {
+            if (overlay.opaque) {
+                destination[x] = 0xFF000000u | ((uint32_t)source[2] << 16) | ((uint32_t)source[1] << 8) | source[0];
+            }
+            else {
+                uint32_t coverage = 255 - ((uint32_t)source[0] + source[1] + source[2]) / 3;
+                destination[x] = coverage << 24;
+            }
+        }
+    }
+    AddDirty(overlay.bounds);
+}
+
+void FrameCompositor::HideOverlay(size_t index) {
+    if (index >= m_overlays.size() || !m_overlays[index].visible) return;
+    m_overlays[index].visible = false;
+    AddDirty(m_overlays[index].bounds);
+}
+
+void FrameCompositor::Invalidate(const PixelRect& rect) {
+    AddDirty(rect);
+}
+
+void FrameCompositor::InvalidateAll() {
+    m_dirty.clear();
+    if (m_width > 0 && m_height > 0) m_dirty.push_back(PixelRect{ 0, 0, m_width, m_height });
+}
+
+void FrameCompositor::AddDirty(PixelRect rect) {
+    rect = IntersectRects(rect, PixelRect{ 0, 0, m_width, m_height });
+    if (rect.IsEmpty()) return;
+    // Une zone qui en chevauche d'autres les absorbe : les zones restent disjointes
+    for (size_t i = 0; i < m_dirty.size();) {
+        if (Overlaps(m_dirty[i], rect)) {
+            rect = UnionRects(rect, m_dirty[i]);
+            m_dirty.erase(m_dirty.begin() + i);
+            i = 0;
+        }
+        else {
+            ++i;
+        }
+    }
+    if (m_dirty.size() >= MaxDirtyRects) {
+        for (const PixelRect& dirty : m_dirty) rect = UnionRects(rect, dirty);
+        m_dirty.clear();
+    }
+    m_dirty.push_back(rect);
+}
+
+void FrameCompositor::ComposeRect(const PixelRect& rect, const ImageView& target) const {
+    size_t rowBytes = (size_t)rect.Width() * 4;
+    for (int y = rect.top; y < rect.bottom; ++y) {
+        uint8_t* destination = target.data + y * target.stride + (size_t)rect.left * 4;
+        if (m_hasBase && m_base.data && y < m_base.height && rect.right <= m_base.width) {
+            std::memcpy(destination, m_base.data + y * m_base.stride + (size_t)rect.left * 4, rowBytes);
+        }
+        else {
+            std::memset(destination, 0, rowBytes);
+        }
+    }
+
+    for (const Overlay& overlay : m_overlays) {
+        if (!overlay.visible || !overlay.hasPixels) continue;
+        PixelRect area = IntersectRects(rect, overlay.bounds);
+        if (area.IsEmpty()) continue;
+        int width = overlay.bounds.Width();
+        for (int y = area.top; y < area.bottom; ++y) {
+            const uint32_t* source = overlay.pixels.data() + (size_t)(y - overlay.bounds.top) * width + (area.left - overlay.bounds.left);
+            uint32_t* destination = (uint32_t*)(target.data + y * target.stride) + area.left;
+            if (overlay.opaque) {
+                std::memcpy(destination, source, (size_t)area.Width() * 4);
+                continue;
+            }
+            // Sans branche (alpha 0 rend la destination exacte) : la boucle se vectorise
+            for (int x = 0; x < area.Width(); ++x) destination[x] = BlendPremultiplied(destination[x], source[x]);
+        }
+    }
+}
+
+const std::vector<PixelRect>& FrameCompositor::Compose(const ImageView& target) {
+    m_composed.clear();
+    ++m_stats.frames;
+    if (!target.data || target.width < m_width || target.height < m_height) {
+        m_dirty.clear();
+        return m_composed;
+    }
+    if (m_dirty.empty()) ++m_stats.unchangedFrames;
+    else if (m_dirty.size() == 1 && m_dirty[0] == PixelRect{ 0, 0, m_width, m_height }) ++m_stats.fullFrames;
+
+    for (const PixelRect& rect : m_dirty) {
+        ComposeRect(rect, target);
+        m_stats.composedPixels += (uint64_t)rect.Area();
+    }
+    m_composed.swap(m_dirty);
+    m_dirty.clear();
+    return m_composed;
+}
+
+size_t FrameCompositor::MemoryUsage() const {
+    size_t bytes = m_overlays.capacity() * sizeof(Overlay);
+    for (const Overlay& overlay : m_overlays) bytes += overlay.pixels.capacity() * sizeof(uint32_t);
+    return bytes;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Resampler.h"
+
+// Rectangle en pixels de la fenetre, [left, right) x [top, bottom)
+struct PixelRect {
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+
+    bool IsEmpty() const { return right <= left || bottom <= top; }
+    int Width() const { return right - left; }
+    int Height() const { return bottom - top; }
+    int64_t Area() const { return IsEmpty() ? 0 : (int64_t)Width() * Height(); }
+    bool operator==(const PixelRect& other) const {
+        return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+    }
+    bool operator!=(const PixelRect& other) const { return !(*this == other); }
+};
+
+PixelRect IntersectRects(const PixelRect& a, const PixelRect& b);
+// Plus petit rectangle contenant les deux
+PixelRect UnionRects(const PixelRect& a, const PixelRect& b);
+
+// Pixels d'une couche de texte dessinee par GDI (BGRX, alpha non renseigne)
+enum class OverlayPixels {
+    // Copies telles quelles, couche opaque (encadre des temps)
+    Opaque,
+    // Texte noir sur fond blanc : la couverture de chaque pixel devient son alpha, le fond
+    // devient transparent (nom du fichier, historique)
+    BlackText,
+};
+
+// Rendu d'une fenetre par couches dans un tampon hors ecran : une couche de fond (l'image,
+// de la taille de la fenetre) et des couches de texte au-dessus, chacune avec une cle de son
+// contenu. Une couche n'est a redessiner que si sa cle change ; seules les zones couvertes
+// par les couches modifiees (ancienne et nouvelle position) sont recomposees, depuis le fond
+// et les couches en cache. Un affichage sans changement (fenetre decouverte) n'est qu'une
+// copie du tampon. Pixels BGRA 32 bits, alpha premultiplie. Thread UI seulement.
+class FrameCompositor {
+public:
+    struct Stats {
+        uint64_t frames = 0;
+        // Fond modifie ou fenetre redimensionnee : tout est recompose
+        uint64_t fullFrames = 0;
+        // Rien a recomposer
+        uint64_t unchangedFrames = 0;
+        uint64_t composedPixels = 0;
+    };
+
+    // Taille de la fenetre ; tout est a recomposer si elle change
+    void Resize(int width, int height);
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+
+    // Fond de la taille de la fenetre, lu par Compose. true si la cle a change : l'appelant
+    // redessine le fond avant Compose, qui recompose tout
+    bool SetBase(const ImageView& base, uint64_t key);
+
+    // Couche `index` (dessinee dans l'ordre des index) a `bounds`. true si son contenu est a
+    // fournir par SetOverlayPixels (cle ou taille changee) ; un simple deplacement ne redessine
+    // que les zones quittee et couverte
+    bool SetOverlay(size_t index, uint64_t key, const PixelRect& bounds);
+    void SetOverlayPixels(size_t index, const ConstImageView& pixels, OverlayPixels kind);
+    // Couche absente de cette image (texte masque)
+    void HideOverlay(size_t index);
+    size_t OverlayCount() const { return m_overlays.size(); }
+
+    // Zone a recomposer meme si aucune couche n'a change
+    void Invalidate(const PixelRect& rect);
+    void InvalidateAll();
+
+    // Recompose les zones sales dans `target` (taille de la fenetre). Renvoie ces zones,
+    // a copier a l'ecran ; vide si rien n'a change.
+    const std::vector<PixelRect>& Compose(const ImageView& target);
+
+    Stats GetStats() const { return m_stats; }
+    // Memoire des couches de texte
+    size_t MemoryUsage() const;
+
+private:
+    struct Overlay {
+        uint64_t key = 0;
+        PixelRect bounds;
+        bool visible = false;
+        bool hasPixels = false;
+        bool opaque = false;
+        // BGRA premultiplie, bounds.Width() pixels par ligne
+        std::vector<uint32_t> pixels;
+    };
+
+    Overlay& OverlayAt(size_t index);
+    void AddDirty(PixelRect rect);
+    void ComposeRect(const PixelRect& rect, const ImageView& target) const;
+
+    int m_width = 0;
+    int m_height = 0;
+    ImageView m_base;
+    uint64_t m_baseKey = 0;
+    bool m_hasBase = false;
+    std::vector<Overlay> m_overlays;
+    // Zones sales, disjointes ou presque : au-dela de MaxDirtyRects, leur enveloppe
+    std::vector<PixelRect> m_dirty;
+    std::vector<PixelRect> m_composed;
+    Stats m_stats;
+};
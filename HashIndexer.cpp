@@ -0,0 +1,323 @@
+#include "HashIndexer.h"
+
+#include "LibraryIndex.h"
+#include "MappedFile.h"
+#include "PathString.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char StoreMagic[8] = { 'R', 'P', 'H', 'A', 'S', 'H', '\0', '\0' };
+    constexpr uint32_t StoreVersion = 1;
+    // Fichiers decodes par tache du pool : assez pour amortir la publication des resultats
+    constexpr size_t HashBatchSize = 16;
+
+    struct StoreHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t count;
+    };
+
+    struct StoreRecord {
+        uint64_t key;
+        uint64_t hash;
+    };
+}
+
+std::wstring HashStore::PathFor(const std::wstring& root) {
+    fs::path path = WideToPath(LibraryIndexPath(root));
+    path.replace_extension(".rphash");
+    return PathToWide(path);
+}
+
+bool HashStore::Load(const std::wstring& path) {
+    m_hashes.clear();
+    MappedFile file;
+    if (!file.Open(path) || file.Size() < sizeof(StoreHeader)) return false;
+
+    const auto* header = (const StoreHeader*)file.Data();
+    if (std::memcmp(header->magic, StoreMagic, sizeof(StoreMagic)) != 0 || header->version != StoreVersion ||
+        header->count > (file.Size() - sizeof(StoreHeader)) / sizeof(StoreRecord)) {
+        return false;
+    }
+    const auto* records = (const StoreRecord*)(file.Data() + sizeof(StoreHeader));
+    m_hashes.reserve((size_t)header->count);
+    for (uint64_t i = 0; i < header->count; ++i) m_hashes[records[i].key] = records[i].hash;
+    return true;
+}
+
+bool HashStore::Save(const std::wstring& path) const {
+    StoreHeader header = {};
+    std::memcpy(header.magic, StoreMagic, sizeof(StoreMagic));
+    header.version = StoreVersion;
+    header.count = m_hashes.size();
+
+    std::vector<StoreRecord> records;
+    records.reserve(m_hashes.size());
+    for (const auto& entry : m_hashes) records.push_back(StoreRecord{ entry.first, entry.second });
+
+    fs::path target = WideToPath(path);
+    fs::path temporary = target;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)records.data(), (std::streamsize)(records.size() * sizeof(StoreRecord)));
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(temporary, target, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
+
+bool HashStore::Find(const std::wstring& fullPath, int64_t mtime, PerceptualHash& hash) const {
+    auto it = m_hashes.find(FileKey(fullPath, mtime));
+    if (it == m_hashes.end()) return false;
+    hash = it->second;
+    return true;
+}
+
+void HashStore::Set(const std::wstring& fullPath, int64_t mtime, PerceptualHash hash) {
+    m_hashes[FileKey(fullPath, mtime)] = hash;
+}
+
+HashIndexer::~HashIndexer() {
+    Cancel();
+}
+
+void HashIndexer::Start(const std::wstring& root, ImageCatalog catalog, NotifyFn notify) {
+    Cancel();
+
+    m_cancel = false;
+    m_notifyPending = false;
+    m_notify = std::move(notify);
+    m_catalog = std::move(catalog);
+    m_total = 0;
+    m_done = 0;
+    m_computed = 0;
+    m_failed = 0;
+    m_threads = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.clear();
+        m_groups.Clear();
+        m_groupsChanged = false;
+        m_computeStart = std::chrono::steady_clock::now();
+        m_lastNotify = m_computeStart;
+        m_lastBuild = {};
+    }
+    m_running = true;
+    m_thread = std::thread(&HashIndexer::Run, this, root);
+}
+
+void HashIndexer::Cancel() {
+    if (m_thread.joinable()) {
+        m_cancel = true;
+        m_thread.join();
+    }
+    m_running = false;
+    m_catalog.Clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_groups.Clear();
+    m_groupsChanged = false;
+}
+
+HashIndexer::Progress HashIndexer::GetProgress() const {
+    Progress progress;
+    progress.total = m_total.load();
+    progress.done = m_done.load();
+    progress.computed = m_computed.load();
+    progress.failed = m_failed.load();
+    progress.threads = m_threads.load();
+    progress.running = m_running.load();
+
+    std::chrono::steady_clock::time_point start;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        start = m_computeStart;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (progress.computed > 0 && elapsed.count() > 0.0) progress.imagesPerSecond = progress.computed / elapsed.count();
+    return progress;
+}
+
+bool HashIndexer::TakeResults(std::vector<Result>& results, DuplicateGroups& groups) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notifyPending = false;
+    if (m_pending.empty() && !m_groupsChanged) return false;
+    results.insert(results.end(), m_pending.begin(), m_pending.end());
+    m_pending.clear();
+    if (m_groupsChanged) {
+        groups = std::move(m_groups);
+        m_groups.Clear();
+        m_groupsChanged = false;
+    }
+    return true;
+}
+
+void HashIndexer::Publish(std::vector<Result>&& results, bool force) {
+    // Les groupes sont recalcules sur tout le catalogue : pas plus d'une fois par intervalle,
+    // et jamais plus d'un quart du temps sur un tres gros catalogue
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto interval = std::max<std::chrono::steady_clock::duration>(notifyInterval, m_lastBuild * 4);
+        if (!force && now - m_lastNotify < interval) {
+            m_pending.insert(m_pending.end(), results.begin(), results.end());
+            return;
+        }
+        m_lastNotify = now;
+    }
+
+    DuplicateGroups groups;
+    groups.Build(m_catalog);
+    bool shouldNotify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lastBuild = std::chrono::steady_clock::now() - now;
+        m_pending.insert(m_pending.end(), results.begin(), results.end());
+        m_groups = std::move(groups);
+        m_groupsChanged = true;
+        shouldNotify = !m_notifyPending.exchange(true);
+    }
+    if (shouldNotify && m_notify) m_notify();
+}
+
+void HashIndexer::Run(std::wstring root) {
+    std::wstring storePath = HashStore::PathFor(root);
+    HashStore previous;
+    previous.Load(storePath);
+
+    // Empreintes connues d'une session precedente ; le nouveau HashStore ne garde que les
+    // fichiers du catalogue
+    struct Job {
+        ImageId id;
+        std::wstring path;
+        int64_t mtime;
+    };
+    HashStore current;
+    std::vector<Job> jobs;
+    std::vector<Result> known;
+    for (ImageId id = 0; id < (ImageId)m_catalog.Size(); ++id) {
+        if (m_cancel) {
+            m_running = false;
+            return;
+        }
+        if (m_catalog.IsExcluded(id)) continue;
+        ++m_total;
+        std::wstring path = m_catalog.FullPath(id);
+        int64_t mtime = m_catalog.ModifiedTime(id);
+        PerceptualHash hash = m_catalog.ImageHash(id);
+        if (hash != 0 || previous.Find(path, mtime, hash)) {
+            current.Set(path, mtime, hash);
+            if (hash != 0) {
+                m_catalog.SetImageHash(id, hash);
+                known.push_back(Result{ id, hash });
+            }
+            ++m_done;
+        }
+        else {
+            jobs.push_back(Job{ id, std::move(path), mtime });
+        }
+    }
+    previous = HashStore();
+    Publish(std::move(known), true);
+
+    // Decodage en basse resolution : surtout du calcul, un thread par coeur attribue
+    size_t threads = threadCount ? threadCount : std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    m_threads = threads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_computeStart = std::chrono::steady_clock::now();
+    }
+    if (!jobs.empty()) {
+        // Les fichiers sont lus dans l'ordre des lots par des threads a part : sur un disque
+        // lent ou un partage, la lecture du suivant recouvre le decodage du precedent
+        std::unique_ptr<ReadAhead> readAhead;
+        if (readAheadBytes > 0) {
+            readAhead = std::make_unique<ReadAhead>(2, readAheadBytes);
+            std::vector<std::wstring> paths;
+            paths.reserve(jobs.size());
+            for (const Job& job : jobs) paths.push_back(job.path);
+            readAhead->Request(std::move(paths));
+        }
+
+        // Protege `current` et les empreintes de m_catalog (lues par DuplicateGroups::Build)
+        std::mutex resultsMutex;
+        auto hashBatch = [&](size_t batch) {
+            std::vector<Result> results;
+            std::vector<bool> decoded;
+            size_t begin = batch * HashBatchSize;
+            size_t end = std::min(jobs.size(), begin + HashBatchSize);
+            for (size_t i = begin; i < end && !m_cancel; ++i) {
+                PerceptualHash hash = 0;
+                TraceSpan span(TraceStage::Hash);
+                if (readAhead) {
+                    FileData file;
+                    decoded.push_back(readAhead->Take(jobs[i].path, file) && HashImageMemory(file.Data(), file.Size(), hash));
+                }
+                else {
+                    decoded.push_back(HashImageFile(jobs[i].path, hash));
+                }
+                results.push_back(Result{ jobs[i].id, hash });
+            }
+            if (results.empty()) return;
+
+            std::vector<Result> found;
+            {
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                for (size_t i = 0; i < results.size(); ++i) {
+                    const Job& job = jobs[begin + i];
+                    current.Set(job.path, job.mtime, results[i].hash);
+                    if (!decoded[i]) ++m_failed;
+                    if (results[i].hash == 0) continue;
+                    m_catalog.SetImageHash(job.id, results[i].hash);
+                    found.push_back(results[i]);
+                }
+                m_computed += results.size();
+                m_done += results.size();
+                Publish(std::move(found), false);
+            }
+        };
+
+        // ParallelFor fait aussi travailler l'appelant
+        size_t batches = (jobs.size() + HashBatchSize - 1) / HashBatchSize;
+        if (threads > 1) {
+            ThreadPool pool(threads - 1);
+            pool.ParallelFor(batches, hashBatch);
+        }
+        else {
+            for (size_t batch = 0; batch < batches; ++batch) hashBatch(batch);
+        }
+    }
+
+    if (!current.Save(storePath)) {
+#ifdef _WIN32
+        OutputDebugStringW((L"Empreintes : impossible d'ecrire " + storePath + L"\n").c_str());
+#endif
+    }
+    if (m_cancel) return;
+    m_running = false;
+    Publish({}, true);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "FileReader.h"
+#include "ImageCatalog.h"
+#include "PerceptualHash.h"
+
+// Empreintes deja calculees pour un dossier racine, enregistrees dans le dossier de cache a
+// cote de l'index (.rphash). Une empreinte est retrouvee par le chemin et la date du
+// fichier ; un fichier qui ne se decode pas est enregistre avec l'empreinte 0 pour ne pas
+// etre retente a chaque session.
+class HashStore {
+public:
+    static std::wstring PathFor(const std::wstring& root);
+
+    bool Load(const std::wstring& path);
+    // Ecrit a cote puis renomme, comme SaveLibraryIndex
+    bool Save(const std::wstring& path) const;
+
+    bool Find(const std::wstring& fullPath, int64_t mtime, PerceptualHash& hash) const;
+    void Set(const std::wstring& fullPath, int64_t mtime, PerceptualHash hash);
+    size_t Size() const { return m_hashes.size(); }
+
+private:
+    // Cle FileKey du fichier
+    std::unordered_map<uint64_t, PerceptualHash> m_hashes;
+};
+
+// Calcul des empreintes de tout un catalogue sur un pool de threads, en arriere-plan.
+// Les empreintes deja connues (HashStore) sont reprises, les autres sont calculees par
+// lots ; les threads appellent `notify` et le thread UI recupere les empreintes et les
+// groupes de doublons avec TakeResults.
+class HashIndexer {
+public:
+    using NotifyFn = std::function<void()>;
+
+    struct Result {
+        ImageId id;
+        PerceptualHash hash;
+    };
+
+    struct Progress {
+        size_t total = 0;
+        size_t done = 0;
+        // Fichiers decodes pendant cette session (les autres viennent du HashStore)
+        size_t computed = 0;
+        size_t failed = 0;
+        size_t threads = 0;
+        // Debit des decodages, tous threads confondus
+        double imagesPerSecond = 0.0;
+        bool running = false;
+    };
+
+    HashIndexer() = default;
+    ~HashIndexer();
+
+    HashIndexer(const HashIndexer&) = delete;
+    HashIndexer& operator=(const HashIndexer&) = delete;
+
+    // Annule le calcul precedent puis indexe une copie de `catalog` (les index des resultats
+    // sont ceux de ce catalogue, les images ajoutees ensuite n'en font pas partie)
+    void Start(const std::wstring& root, ImageCatalog catalog, NotifyFn notify);
+    // Les empreintes deja calculees sont enregistrees
+    void Cancel();
+
+    bool IsRunning() const { return m_running.load(); }
+    Progress GetProgress() const;
+
+    // Ajoute a `results` les empreintes publiees depuis le dernier appel et remplace
+    // `groups` par les derniers groupes calcules. false si rien n'a change.
+    bool TakeResults(std::vector<Result>& results, DuplicateGroups& groups);
+
+    // 0 : la moitie des coeurs, pour laisser de la place a l'affichage et au prefetch
+    size_t threadCount = 0;
+    // Intervalle minimal entre deux publications (les groupes sont recalcules a chacune)
+    std::chrono::milliseconds notifyInterval{ 2000 };
+    // Octets lus d'avance pendant que les threads decodent (ReadAhead), 0 pour lire chaque
+    // fichier au moment de le decoder
+    uint64_t readAheadBytes = DefaultReadAheadBytes;
+
+private:
+    void Run(std::wstring root);
+    void Publish(std::vector<Result>&& results, bool force);
+
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{ false };
+    std::atomic<bool> m_running{ false };
+    std::atomic<bool> m_notifyPending{ false };
+    NotifyFn m_notify;
+
+    // Thread d'indexation seulement
+    ImageCatalog m_catalog;
+
+    std::atomic<size_t> m_total{ 0 };
+    std::atomic<size_t> m_done{ 0 };
+    std::atomic<size_t> m_computed{ 0 };
+    std::atomic<size_t> m_failed{ 0 };
+    std::atomic<size_t> m_threads{ 0 };
+    std::chrono::steady_clock::time_point m_computeStart;
+
+    mutable std::mutex m_mutex;
+    std::vector<Result> m_pending;
+    DuplicateGroups m_groups;
+    bool m_groupsChanged = false;
+    std::chrono::steady_clock::time_point m_lastNotify;
+    std::chrono::steady_clock::duration m_lastBuild{};
+};
@@ -0,0 +1,48 @@
+#include "HistoryRing.h"
+
+#include <algorithm>
+
+HistoryRing::HistoryRing(size_t capacity) : m_items(std::max<size_t>(1, capacity), InvalidImageId) {}
+
+void HistoryRing::SetCapacity(size_t capacity) {
+    capacity = std::max<size_t>(1, capacity);
+    size_t kept = std::min(m_size, capacity);
+    size_t dropped = m_size - kept;
+
+    std::vector<ImageId> items(capacity, InvalidImageId);
+    for (size_t i = 0; i < kept; ++i) items[i] = (*this)[dropped + i];
+    m_items = std::move(items);
+    m_start = 0;
+    m_size = kept;
+    m_cursor = m_cursor > dropped ? m_cursor - dropped : 0;
+}
+
+void HistoryRing::Clear() {
+    m_start = 0;
+    m_size = 0;
+    m_cursor = 0;
+}
+
+void HistoryRing::Push(ImageId id) {
+    if (m_size < m_items.size()) {
+        ++m_size;
+    }
+    else {
+        // Plein : la plus ancienne entree est ecrasee
+        m_start = Slot(1);
+    }
+    (*this)[m_size - 1] = id;
+    m_cursor = m_size - 1;
+}
+
+bool HistoryRing::Back() {
+    if (m_cursor == 0 || m_size == 0) return false;
+    --m_cursor;
+    return true;
+}
+
+bool HistoryRing::Forward() {
+    if (m_cursor + 1 >= m_size) return false;
+    ++m_cursor;
+    return true;
+}
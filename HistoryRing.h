@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "ImageCatalog.h"
+
+// Historique des images affichees, limite a `capacity` entrees : une fois plein, chaque
+// nouvelle image remplace la plus ancienne. On ne garde que les index du catalogue.
+// Les positions vont de 0 (la plus ancienne) a Size() - 1 (la plus recente).
+class HistoryRing {
+public:
+    explicit HistoryRing(size_t capacity = 1000);
+
+    size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+    size_t Capacity() const { return m_items.size(); }
+    // Garde les entrees les plus recentes qui tiennent dans la nouvelle taille
+    void SetCapacity(size_t capacity);
+    void Clear();
+
+    // Ajoute l'image a la fin et y place la position courante
+    void Push(ImageId id);
+
+    ImageId& operator[](size_t position) { return m_items[Slot(position)]; }
+    ImageId operator[](size_t position) const { return m_items[Slot(position)]; }
+
+    // Position courante (navigation gauche/droite)
+    size_t Cursor() const { return m_cursor; }
+    ImageId Current() const { return m_size ? (*this)[m_cursor] : InvalidImageId; }
+    bool Back();
+    bool Forward();
+
+private:
+    size_t Slot(size_t position) const {
+        size_t slot = m_start + position;
+        return slot < m_items.size() ? slot : slot - m_items.size();
+    }
+
+    std::vector<ImageId> m_items;
+    size_t m_start = 0;
+    size_t m_size = 0;
+    size_t m_cursor = 0;
+};
@@ -0,0 +1,279 @@
+#include "ImageCatalog.h"
+
+#include "PathString.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    // Retire le separateur final sauf pour une racine ("/", "C:\")
+    std::wstring NormalizeDirectory(std::wstring directory) {
+        while (directory.size() > 1 && IsPathSeparator(directory.back()) &&
+            directory[directory.size() - 2] != L':') {
+            directory.pop_back();
+        }
+        return directory;
+    }
+}
+
+void ImageCatalog::Clear() {
+    m_directories.clear();
+    m_directoryIds.clear();
+    m_names.clear();
+    m_entries.clear();
+    m_mtimes.clear();
+    m_sizes.clear();
+    m_dimensions.clear();
+    m_hashes.clear();
+    m_table.clear();
+    m_sorted.clear();
+    m_sortedValid = true;
+    m_excludedCount = 0;
+    ++m_version;
+    ++m_changeVersion;
+}
+
+void ImageCatalog::Reserve(size_t files, size_t nameChars) {
+    m_entries.reserve(files);
+    m_mtimes.reserve(files);
+    m_sizes.reserve(files);
+    m_dimensions.reserve(files);
+    m_hashes.reserve(files);
+    m_names.reserve(nameChars);
+    while (m_table.size() < files * 2) GrowTable();
+}
+
+uint32_t ImageCatalog::AddDirectory(const std::wstring& directory) {
+    std::wstring normalized = NormalizeDirectory(directory);
+    auto it = m_directoryIds.find(normalized);
+    if (it != m_directoryIds.end()) return it->second;
+
+    uint32_t id = (uint32_t)m_directories.size();
+    m_directories.push_back(normalized);
+    m_directoryIds.emplace(std::move(normalized), id);
+    return id;
+}
+
+size_t ImageCatalog::SplitPath(const std::wstring& fullPath) {
+    size_t pos = FindLastSeparator(fullPath);
+    return pos == std::wstring::npos ? 0 : pos;
+}
+
+ImageId ImageCatalog::Add(const std::wstring& fullPath, int64_t mtime, uint64_t size, uint32_t width, uint32_t height) {
+    size_t pos = SplitPath(fullPath);
+    if (pos == 0 && (fullPath.empty() || !IsPathSeparator(fullPath[0]))) {
+        return Add(AddDirectory(L""), fullPath, mtime, size, width, height);
+    }
+    // Garde le separateur pour une racine ("/a.jpg", "C:\a.jpg")
+    size_t dirLength = (pos == 0 || fullPath[pos - 1] == L':') ? pos + 1 : pos;
+    return Add(AddDirectory(fullPath.substr(0, dirLength)), std::wstring_view(fullPath).substr(pos + 1), mtime, size, width, height);
+}
+
+ImageId ImageCatalog::Add(uint32_t directory, std::wstring_view name, int64_t mtime, uint64_t size, uint32_t width,
+    uint32_t height) {
+    ImageId existing = Find(directory, name);
+    if (existing != InvalidImageId) {
+        if ((mtime != 0 || size != 0) && (m_mtimes[existing] != mtime || m_sizes[existing] != size)) {
+            // Fichier modifie sur place : ses dimensions et son empreinte sont a recalculer
+            if (m_mtimes[existing] != 0 || m_sizes[existing] != 0) {
+                m_dimensions[existing] = Dimensions{ 0, 0 };
+                m_hashes[existing] = 0;
+            }
+            m_mtimes[existing] = mtime;
+            m_sizes[existing] = size;
+            ++m_version;
+            ++m_changeVersion;
+        }
+        if (width != 0) SetDimensions(existing, width, height);
+        return existing;
+    }
+
+    Entry entry;
+    entry.directory = directory;
+    entry.nameOffset = (uint32_t)m_names.size();
+    entry.nameLength = (uint32_t)name.size();
+    entry.excluded = 0;
+    m_names.insert(m_names.end(), name.begin(), name.end());
+
+    ImageId id = (ImageId)m_entries.size();
+    m_entries.push_back(entry);
+    m_mtimes.push_back(mtime);
+    m_sizes.push_back(size);
+    m_dimensions.push_back(Dimensions{ width, height });
+    m_hashes.push_back(0);
+    if ((m_entries.size() * 2) > m_table.size()) GrowTable();
+    else InsertInTable(id);
+
+    m_sortedValid = false;
+    ++m_version;
+    return id;
+}
+
+void ImageCatalog::Exclude(ImageId id) {
+    if (!m_entries[id].excluded) {
+        m_entries[id].excluded = 1;
+        ++m_excludedCount;
+        ++m_version;
+        ++m_changeVersion;
+    }
+}
+
+void ImageCatalog::Restore(ImageId id) {
+    if (m_entries[id].excluded) {
+        m_entries[id].excluded = 0;
+        --m_excludedCount;
+        ++m_version;
+        ++m_changeVersion;
+    }
+}
+
+void ImageCatalog::SetDimensions(ImageId id, uint32_t width, uint32_t height) {
+    if (m_dimensions[id].width == width && m_dimensions[id].height == height) return;
+    m_dimensions[id] = Dimensions{ width, height };
+    ++m_version;
+    ++m_changeVersion;
+}
+
+uint32_t ImageCatalog::FindDirectory(const std::wstring& directory) const {
+    auto it = m_directoryIds.find(NormalizeDirectory(directory));
+    return it == m_directoryIds.end() ? UINT32_MAX : it->second;
+}
+
+void ImageCatalog::AddListing(const WalkDirectoryInfo& listing) {
+    uint32_t directory = UINT32_MAX;
+    for (const auto& file : listing.files) {
+        if (file.rejected) continue;
+        if (directory == UINT32_MAX) directory = AddDirectory(listing.path);
+        Add(directory, file.name, file.mtime, file.size, file.width, file.height);
+    }
+}
+
+size_t ImageCatalog::HashOf(uint32_t directory, std::wstring_view name) const {
+    // FNV-1a sur le nom, combine avec le dossier
+    uint64_t hash = 1469598103934665603ull ^ ((uint64_t)directory * 0x9E3779B97F4A7C15ull);
+    for (wchar_t c : name) {
+        hash ^= (uint64_t)c;
+        hash *= 1099511628211ull;
+    }
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+void ImageCatalog::InsertInTable(ImageId id) {
+    const Entry& entry = m_entries[id];
+    size_t mask = m_table.size() - 1;
+    size_t slot = HashOf(entry.directory, std::wstring_view(m_names.data() + entry.nameOffset, entry.nameLength)) & mask;
+    while (m_table[slot] != InvalidImageId) {
+        slot = (slot + 1) & mask;
+    }
+    m_table[slot] = id;
+}
+
+void ImageCatalog::GrowTable() {
+    size_t size = m_table.empty() ? 1024 : m_table.size() * 2;
+    m_table.assign(size, InvalidImageId);
+    for (ImageId id = 0; id < (ImageId)m_entries.size(); ++id) {
+        InsertInTable(id);
+    }
+}
+
+ImageId ImageCatalog::Find(uint32_t directory, std::wstring_view name) const {
+    if (m_table.empty()) return InvalidImageId;
+    size_t mask = m_table.size() - 1;
+    size_t slot = HashOf(directory, name) & mask;
+    while (m_table[slot] != InvalidImageId) {
+        ImageId id = m_table[slot];
+        const Entry& entry = m_entries[id];
+        if (entry.directory == directory &&
+            std::wstring_view(m_names.data() + entry.nameOffset, entry.nameLength) == name) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return InvalidImageId;
+}
+
+ImageId ImageCatalog::Find(const std::wstring& fullPath) const {
+    size_t pos = SplitPath(fullPath);
+    std::wstring directory;
+    std::wstring_view name = fullPath;
+    if (pos != 0 || (!fullPath.empty() && IsPathSeparator(fullPath[0]))) {
+        size_t dirLength = (pos == 0 || fullPath[pos - 1] == L':') ? pos + 1 : pos;
+        directory = fullPath.substr(0, dirLength);
+        name = name.substr(pos + 1);
+    }
+    auto it = m_directoryIds.find(NormalizeDirectory(directory));
+    if (it == m_directoryIds.end()) return InvalidImageId;
+    return Find(it->second, name);
+}
+
+std::wstring_view ImageCatalog::FileName(ImageId id) const {
+    const Entry& entry = m_entries[id];
+    return std::wstring_view(m_names.data() + entry.nameOffset, entry.nameLength);
+}
+
+std::wstring ImageCatalog::FullPath(ImageId id) const {
+    return JoinPath(m_directories[m_entries[id].directory], std::wstring(FileName(id)));
+}
+
+void ImageCatalog::Sort() {
+    // Rang de chaque dossier dans l'ordre alphabetique, puis tri des index par (rang, nom)
+    std::vector<uint32_t> directoryOrder(m_directories.size());
+    std::iota(directoryOrder.begin(), directoryOrder.end(), 0);
+    std::sort(directoryOrder.begin(), directoryOrder.end(),
+        [this](uint32_t a, uint32_t b) { return m_directories[a] < m_directories[b]; });
+    std::vector<uint32_t> rank(m_directories.size());
+    for (uint32_t i = 0; i < (uint32_t)directoryOrder.size(); ++i) {
+        rank[directoryOrder[i]] = i;
+    }
+
+    m_sorted.resize(m_entries.size());
+    std::iota(m_sorted.begin(), m_sorted.end(), 0);
+    std::sort(m_sorted.begin(), m_sorted.end(), [this, &rank](ImageId a, ImageId b) {
+        uint32_t rankA = rank[m_entries[a].directory];
+        uint32_t rankB = rank[m_entries[b].directory];
+        if (rankA != rankB) return rankA < rankB;
+        return FileName(a) < FileName(b);
+    });
+    m_sortedValid = true;
+}
+
+const std::vector<ImageId>& ImageCatalog::SortedOrder() {
+    if (!m_sortedValid) Sort();
+    return m_sorted;
+}
+
+size_t ImageCatalog::MemoryUsage() const {
+    size_t bytes = m_names.capacity() * sizeof(wchar_t)
+        + m_entries.capacity() * sizeof(Entry)
+        + m_mtimes.capacity() * sizeof(int64_t)
+        + m_sizes.capacity() * sizeof(uint64_t)
+        + m_dimensions.capacity() * sizeof(Dimensions)
+        + m_hashes.capacity() * sizeof(uint64_t)
+        + m_table.capacity() * sizeof(ImageId)
+        + m_sorted.capacity() * sizeof(ImageId);
+    for (const auto& directory : m_directories) {
+        bytes += (directory.capacity() + 1) * sizeof(wchar_t) * 2;
+    }
+    return bytes;
+}
+
+ImageCatalog BuildCatalog(std::vector<WalkDirectoryInfo>& directories) {
+    std::sort(directories.begin(), directories.end(),
+        [](const WalkDirectoryInfo& a, const WalkDirectoryInfo& b) { return a.path < b.path; });
+
+    size_t files = 0;
+    size_t nameChars = 0;
+    for (const auto& listing : directories) {
+        files += listing.files.size();
+        for (const auto& file : listing.files) nameChars += file.name.size();
+    }
+
+    ImageCatalog catalog;
+    catalog.Reserve(files, nameChars);
+    for (auto& listing : directories) {
+        std::sort(listing.files.begin(), listing.files.end(),
+            [](const WalkFileInfo& a, const WalkFileInfo& b) { return a.name < b.name; });
+        catalog.AddListing(listing);
+    }
+    return catalog;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "DirectoryWalker.h"
+
+using ImageId = uint32_t;
+constexpr ImageId InvalidImageId = UINT32_MAX;
+
+// Catalogue compact des images : chaque dossier est stocke une seule fois, les noms de
+// fichiers sont ranges bout a bout dans une seule zone et chaque image est designee par
+// un index 32 bits stable. Le chemin complet n'est construit qu'a la demande.
+class ImageCatalog {
+public:
+    ImageCatalog() = default;
+
+    size_t Size() const { return m_entries.size(); }
+    bool Empty() const { return m_entries.empty(); }
+    size_t DirectoryCount() const { return m_directories.size(); }
+    void Clear();
+    void Reserve(size_t files, size_t nameChars);
+
+    uint32_t AddDirectory(const std::wstring& directory);
+    // Ajoute l'image si elle n'est pas deja presente et retourne son index ; une image deja
+    // presente recoit la date et la taille si elles sont connues et differentes (lot du scan,
+    // fichier modifie sur place : ses dimensions et son empreinte sont alors effacees
+    // jusqu'a la prochaine mesure). `mtime` (ticks de
+    // fs::file_time_type, 0 si inconnue) sert au tirage favorisant les fichiers recents ;
+    // `size` (octets, 0 si inconnue) et `mtime` servent aux filtres (ImageFilter.h).
+    // `width` et `height` : dimensions deja sondees (0 si inconnues), enregistrees avec
+    // l'ajout plutot que par SetDimensions, qui compte comme un changement (ChangeVersion).
+    ImageId Add(uint32_t directory, std::wstring_view name, int64_t mtime = 0, uint64_t size = 0, uint32_t width = 0,
+        uint32_t height = 0);
+    ImageId Add(const std::wstring& fullPath, int64_t mtime = 0, uint64_t size = 0, uint32_t width = 0, uint32_t height = 0);
+    // Ajoute tous les fichiers d'un dossier (resultat de WalkDirectoryTreeDetailed)
+    void AddListing(const WalkDirectoryInfo& listing);
+
+    // Une image exclue reste adressable (historique) mais n'est plus proposee au tirage
+    void Exclude(ImageId id);
+    // Annule Exclude (fichier revenu dans le dossier)
+    void Restore(ImageId id);
+    bool IsExcluded(ImageId id) const { return m_entries[id].excluded != 0; }
+    size_t ExcludedCount() const { return m_excludedCount; }
+
+    ImageId Find(uint32_t directory, std::wstring_view name) const;
+    ImageId Find(const std::wstring& fullPath) const;
+    // Index du dossier, ou UINT32_MAX s'il n'a pas d'image
+    uint32_t FindDirectory(const std::wstring& directory) const;
+
+    std::wstring FullPath(ImageId id) const;
+    std::wstring_view FileName(ImageId id) const;
+    uint32_t DirectoryOf(ImageId id) const { return m_entries[id].directory; }
+    int64_t ModifiedTime(ImageId id) const { return m_mtimes[id]; }
+    uint64_t FileSize(ImageId id) const { return m_sizes[id]; }
+    // Dimensions lues par ProbeImageFile pendant le scan, 0 si l'image n'a pas ete sondee
+    uint32_t Width(ImageId id) const { return m_dimensions[id].width; }
+    uint32_t Height(ImageId id) const { return m_dimensions[id].height; }
+    void SetDimensions(ImageId id, uint32_t width, uint32_t height);
+    // Empreinte perceptuelle (PerceptualHash.h), 0 si elle n'est pas encore calculee
+    uint64_t ImageHash(ImageId id) const { return m_hashes[id]; }
+    void SetImageHash(ImageId id, uint64_t hash) { m_hashes[id] = hash; }
+    const std::wstring& DirectoryPath(uint32_t directory) const { return m_directories[directory]; }
+
+    // Ordre (dossier, nom) des images, recalcule par Sort() seulement si le catalogue a change
+    const std::vector<ImageId>& SortedOrder();
+    void Sort();
+
+    size_t MemoryUsage() const;
+
+    // Change a chaque ajout, exclusion, restauration ou nouvelles dimensions : permet de savoir si des donnees
+    // calculees sur le catalogue (poids du tirage) sont a jour
+    uint64_t Version() const { return m_version; }
+    // Comme Version, sauf pour l'ajout d'une nouvelle image : tant qu'il ne change pas, des
+    // donnees calculees image par image (CatalogFilter) n'ont qu'a traiter les images ajoutees
+    uint64_t ChangeVersion() const { return m_changeVersion; }
+
+private:
+    struct Entry {
+        uint32_t directory;
+        uint32_t nameOffset;
+        uint32_t nameLength : 31;
+        uint32_t excluded : 1;
+    };
+
+    static size_t SplitPath(const std::wstring& fullPath);
+    size_t HashOf(uint32_t directory, std::wstring_view name) const;
+    void InsertInTable(ImageId id);
+    void GrowTable();
+
+    std::vector<std::wstring> m_directories;
+    std::unordered_map<std::wstring, uint32_t> m_directoryIds;
+    std::vector<wchar_t> m_names;
+    std::vector<Entry> m_entries;
+    struct Dimensions {
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // A part pour garder Entry sur 12 octets
+    std::vector<int64_t> m_mtimes;
+    std::vector<uint64_t> m_sizes;
+    std::vector<Dimensions> m_dimensions;
+    std::vector<uint64_t> m_hashes;
+
+    // Table de hachage a adressage ouvert (dossier, nom) -> index, sans allocation par fichier
+    std::vector<ImageId> m_table;
+
+    std::vector<ImageId> m_sorted;
+    bool m_sortedValid = true;
+    size_t m_excludedCount = 0;
+    uint64_t m_version = 0;
+    uint64_t m_changeVersion = 0;
+};
+
+// Construit un catalogue deja dans l'ordre (dossier, nom) a partir des listings d'un parcours
+ImageCatalog BuildCatalog(std::vector<WalkDirectoryInfo>& directories);
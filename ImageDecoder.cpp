@@ -0,0 +1,267 @@
+#include "ImageDecoder.h"
+
+#include "FileReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    uint16_t ReadLe16(const uint8_t* data) {
+        return (uint16_t)(data[0] | (data[1] << 8));
+    }
+
+    uint32_t ReadLe32(const uint8_t* data) {
+        return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+
+    inline void StorePremultiplied(uint8_t* pixel, uint8_t b, uint8_t g, uint8_t r, uint8_t a) {
+        if (a == 255) {
+            pixel[0] = b;
+            pixel[1] = g;
+            pixel[2] = r;
+        }
+        else {
+            pixel[0] = (uint8_t)((b * a + 127) / 255);
+            pixel[1] = (uint8_t)((g * a + 127) / 255);
+            pixel[2] = (uint8_t)((r * a + 127) / 255);
+        }
+        pixel[3] = a;
+    }
+}
+
+void DecodedImage::Allocate(int imageWidth, int imageHeight) {
+    width = imageWidth;
+    height = imageHeight;
+    stride = (ptrdiff_t)imageWidth * 4;
+    pixels.assign((size_t)stride * imageHeight, 0);
+}
+
+void PremultiplyRow(uint8_t* row, int width) {
+    for (int x = 0; x < width; ++x, row += 4) {
+        if (row[3] != 255) StorePremultiplied(row, row[0], row[1], row[2], row[3]);
+    }
+}
+
+ImageFormat DetectImageFormat(const uint8_t* data, size_t size) {
+    static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) return ImageFormat::Jpeg;
+    if (size >= 8 && std::memcmp(data, pngSignature, 8) == 0) return ImageFormat::Png;
+    if (size >= 2 && data[0] == 'B' && data[1] == 'M') return ImageFormat::Bmp;
+    return ImageFormat::Unknown;
+}
+
+int ChooseReduction(int sourceWidth, int sourceHeight, int targetWidth, int targetHeight) {
+    if (targetWidth <= 0 || targetHeight <= 0 || sourceWidth <= 0 || sourceHeight <= 0) return 1;
+
+    double scale = std::min((double)targetWidth / sourceWidth, (double)targetHeight / sourceHeight);
+    if (scale >= 1.0) return 1;
+    int fitWidth = std::max(1, (int)(sourceWidth * scale));
+    int fitHeight = std::max(1, (int)(sourceHeight * scale));
+
+    for (int reduction = 8; reduction > 1; reduction /= 2) {
+        if ((sourceWidth + reduction - 1) / reduction >= fitWidth &&
+            (sourceHeight + reduction - 1) / reduction >= fitHeight) {
+            return reduction;
+        }
+    }
+    return 1;
+}
+
+DecodeRequest DecodeRequest::Fit(int targetWidth, int targetHeight) {
+    DecodeRequest request;
+    request.targetWidth = targetWidth;
+    request.targetHeight = targetHeight;
+    return request;
+}
+
+DecodeRequest DecodeRequest::Region(int level, const ImageRegion& region) {
+    DecodeRequest request;
+    request.level = std::min(std::max(level, 0), 30);
+    request.region = region;
+    return request;
+}
+
+int DecodeRequest::Reduction(int sourceWidth, int sourceHeight) const {
+    if (IsRegion()) return 1 << level;
+    return ChooseReduction(sourceWidth, sourceHeight, targetWidth, targetHeight);
+}
+
+ImageRegion DecodeRequest::Area(int sourceWidth, int sourceHeight) const {
+    int reduction = Reduction(sourceWidth, sourceHeight);
+    int width = (int)(((int64_t)sourceWidth + reduction - 1) / reduction);
+    int height = (int)(((int64_t)sourceHeight + reduction - 1) / reduction);
+    if (!IsRegion()) return ImageRegion{ 0, 0, width, height };
+
+    int left = std::max(0, region.x), top = std::max(0, region.y);
+    int right = (int)std::min<int64_t>(width, (int64_t)region.x + region.width);
+    int bottom = (int)std::min<int64_t>(height, (int64_t)region.y + region.height);
+    if (right <= left || bottom <= top) return ImageRegion{ left, top, 0, 0 };
+    return ImageRegion{ left, top, right - left, bottom - top };
+}
+
+RowReducer::RowReducer(DecodedImage& out, int sourceWidth, int sourceHeight, int reduction)
+    : RowReducer(out, sourceWidth, sourceHeight, reduction,
+        ImageRegion{ 0, 0, (sourceWidth + reduction - 1) / reduction, (sourceHeight + reduction - 1) / reduction }) {
+}
+
+RowReducer::RowReducer(DecodedImage& out, int sourceWidth, int sourceHeight, int reduction, const ImageRegion& area)
+    : m_out(out), m_reduction(reduction), m_left(area.x * reduction),
+    m_right((int)std::min<int64_t>(sourceWidth, ((int64_t)area.x + area.width) * reduction)),
+    m_top(area.y * reduction),
+    m_bottom((int)std::min<int64_t>(sourceHeight, ((int64_t)area.y + area.height) * reduction)),
+    m_areaTop(area.y) {
+    out.sourceWidth = sourceWidth;
+    out.sourceHeight = sourceHeight;
+    out.reduction = reduction;
+    out.Allocate(area.width, area.height);
+    if (reduction > 1) m_sums.assign((size_t)out.width * 4, 0);
+}
+
+void RowReducer::PushRow(int y, const uint8_t* row, int rowLeft) {
+    if (y < m_top || y >= m_bottom) return;
+    const uint8_t* pixels = row + (ptrdiff_t)(m_left - rowLeft) * 4;
+    if (m_reduction == 1) {
+        std::memcpy(m_out.Row(y - m_top), pixels, (size_t)(m_right - m_left) * 4);
+        return;
+    }
+
+    uint32_t* sum = m_sums.data();
+    for (int x = m_left; x < m_right; x += m_reduction, sum += 4) {
+        int columns = std::min(m_reduction, m_right - x);
+        for (int i = 0; i < columns; ++i, pixels += 4) {
+            sum[0] += pixels[0];
+            sum[1] += pixels[1];
+            sum[2] += pixels[2];
+            sum[3] += pixels[3];
+        }
+    }
+
+    int blockRow = y % m_reduction;
+    if (blockRow == m_reduction - 1 || y == m_bottom - 1) {
+        FlushRow(y / m_reduction - m_areaTop, blockRow + 1);
+    }
+}
+
+void RowReducer::FlushRow(int outputRow, int rows) {
+    uint8_t* output = m_out.Row(outputRow);
+    for (int x = 0; x < m_out.width; ++x) {
+        // Le dernier bloc de la ligne peut etre plus etroit
+        int columns = std::min(m_reduction, m_right - (m_left + x * m_reduction));
+        uint32_t count = (uint32_t)(columns * rows);
+        uint32_t* sum = &m_sums[(size_t)x * 4];
+        for (int c = 0; c < 4; ++c) {
+            output[x * 4 + c] = (uint8_t)((sum[c] + count / 2) / count);
+            sum[c] = 0;
+        }
+    }
+}
+
+// BMP non compresse 8, 24 et 32 bits ; les autres variantes sont laissees au decodeur
+// du systeme
+bool DecodeBmp(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out) {
+    if (size < 54 || DetectImageFormat(data, size) != ImageFormat::Bmp) return false;
+
+    uint32_t pixelOffset = ReadLe32(data + 10);
+    uint32_t headerSize = ReadLe32(data + 14);
+    if (headerSize < 40 || 14 + (size_t)headerSize > size) return false;
+
+    int32_t width = (int32_t)ReadLe32(data + 18);
+    int32_t height = (int32_t)ReadLe32(data + 22);
+    uint16_t bitsPerPixel = ReadLe16(data + 28);
+    uint32_t compression = ReadLe32(data + 30);
+    uint32_t paletteSize = ReadLe32(data + 46);
+
+    bool topDown = height < 0;
+    if (topDown) height = -height;
+    if (width <= 0 || height <= 0 || width > 65535 || height > 65535) return false;
+
+    // Canal alpha : masques BITFIELDS standards (BGRA) en 32 bits, sinon image opaque
+    bool hasAlpha = false;
+    if (compression == 3 && bitsPerPixel == 32) {
+        if (14 + 40 + 12 > size) return false;
+        uint32_t red = ReadLe32(data + 54), green = ReadLe32(data + 58), blue = ReadLe32(data + 62);
+        if (red != 0x00FF0000 || green != 0x0000FF00 || blue != 0x000000FF) return false;
+        hasAlpha = headerSize >= 56 && ReadLe32(data + 66) == 0xFF000000u;
+    }
+    else if (compression != 0) {
+        return false;
+    }
+    if (bitsPerPixel != 8 && bitsPerPixel != 24 && bitsPerPixel != 32) return false;
+
+    const uint8_t* palette = data + 14 + headerSize;
+    if (bitsPerPixel == 8) {
+        if (paletteSize == 0 || paletteSize > 256) paletteSize = 256;
+        if ((size_t)(palette - data) + paletteSize * 4 > size) return false;
+    }
+
+    size_t rowBytes = (((size_t)width * bitsPerPixel + 31) / 32) * 4;
+    if (pixelOffset > size || rowBytes * height > size - pixelOffset) return false;
+
+    // Acces direct aux lignes : seules celles de la zone sont converties
+    ImageRegion area = request.Area(width, height);
+    if (area.width == 0 || area.height == 0) return false;
+    RowReducer reducer(out, width, height, request.Reduction(width, height), area);
+    int left = reducer.SourceLeft(), right = reducer.SourceRight();
+    std::vector<uint8_t> row((size_t)(right - left) * 4);
+    for (int y = reducer.SourceTop(); y < reducer.SourceBottom(); ++y) {
+        const uint8_t* source = data + pixelOffset + rowBytes * (topDown ? y : height - 1 - y);
+        uint8_t* pixel = row.data();
+        for (int x = left; x < right; ++x, pixel += 4) {
+            if (bitsPerPixel == 8) {
+                uint32_t index = std::min<uint32_t>(source[x], paletteSize - 1);
+                const uint8_t* color = palette + index * 4;
+                StorePremultiplied(pixel, color[0], color[1], color[2], 255);
+            }
+            else if (bitsPerPixel == 24) {
+                StorePremultiplied(pixel, source[x * 3], source[x * 3 + 1], source[x * 3 + 2], 255);
+            }
+            else {
+                const uint8_t* color = source + x * 4;
+                StorePremultiplied(pixel, color[0], color[1], color[2], hasAlpha ? color[3] : 255);
+            }
+        }
+        reducer.PushRow(y, row.data(), left);
+    }
+    return true;
+}
+
+bool DecodeImageMemory(const uint8_t* data, size_t size, int targetWidth, int targetHeight, DecodedImage& out) {
+    return DecodeImageMemory(data, size, DecodeRequest::Fit(targetWidth, targetHeight), out);
+}
+
+bool DecodeImageMemory(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out) {
+    ImageFormat format = DetectImageFormat(data, size);
+    switch (format) {
+    case ImageFormat::Jpeg:
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+        return DecodeJpegLibjpeg(data, size, request, out);
+#elif defined(_WIN32)
+        return DecodeWic(data, size, format, request, out);
+#else
+        return false;
+#endif
+    case ImageFormat::Png:
+#if defined(RANDOMPICTURE_HAVE_LIBPNG)
+        return DecodePngLibpng(data, size, request, out);
+#elif defined(_WIN32)
+        return DecodeWic(data, size, format, request, out);
+#else
+        return false;
+#endif
+    case ImageFormat::Bmp:
+        if (DecodeBmp(data, size, request, out)) return true;
+#if defined(_WIN32)
+        return DecodeWic(data, size, format, request, out);
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+bool DecodeImageFile(const std::wstring& path, int targetWidth, int targetHeight, DecodedImage& out) {
+    FileData file;
+    if (!file.Open(path)) return false;
+    return DecodeImageMemory(file.Data(), file.Size(), targetWidth, targetHeight, out);
+}
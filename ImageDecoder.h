@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Resampler.h"
+
+// Decodage des images a la resolution necessaire pour l'affichage. Une image bien plus
+// grande que la fenetre est reduite pendant le decodage (1/2, 1/4 ou 1/8) : mise a
+// l'echelle dans le domaine DCT pour le JPEG, moyenne des lignes lues au fil de l'eau
+// pour le BMP. L'image complete n'est jamais en memoire dans ce cas. Le PNG, limite par
+// l'inflate, est decode a pleine resolution (sauf zones de la pyramide).
+enum class ImageFormat {
+    Unknown,
+    Jpeg,
+    Png,
+    Bmp,
+};
+
+// Pixels BGRA 8 bits, alpha premultiplie, lignes de haut en bas
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    ptrdiff_t stride = 0;
+    std::vector<uint8_t> pixels;
+    // Taille de l'image dans le fichier et facteur de reduction applique
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    int reduction = 1;
+
+    void Allocate(int imageWidth, int imageHeight);
+    uint8_t* Row(int y) { return pixels.data() + (ptrdiff_t)y * stride; }
+    ImageView View() { return ImageView{ pixels.data(), width, height, stride }; }
+};
+
+// Zone d'une image, en pixels
+struct ImageRegion {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Ce que le decodeur produit : l'image entiere ajustee a targetWidth x targetHeight
+// (reduction choisie par ChooseReduction), ou seulement `region` du niveau `level` de la
+// pyramide, c'est-a-dire de l'image reduite de 2^level (ImagePyramid). Dans ce cas les
+// lignes au-dessous de la zone ne sont pas decodees et seule la zone est en memoire.
+struct DecodeRequest {
+    int targetWidth = 0;
+    int targetHeight = 0;
+    int level = -1;
+    ImageRegion region;
+
+    static DecodeRequest Fit(int targetWidth, int targetHeight);
+    static DecodeRequest Region(int level, const ImageRegion& region);
+
+    bool IsRegion() const { return level >= 0; }
+    int Reduction(int sourceWidth, int sourceHeight) const;
+    // Zone de sortie dans l'image reduite, limitee a l'image ; vide si elle est en dehors
+    ImageRegion Area(int sourceWidth, int sourceHeight) const;
+};
+
+// Format d'apres les premiers octets du fichier
+ImageFormat DetectImageFormat(const uint8_t* data, size_t size);
+
+// Plus forte reduction (1, 2, 4 ou 8) qui laisse au moins autant de pixels que l'image
+// ajustee a la zone cible. Une cible vide (0) demande la pleine resolution.
+int ChooseReduction(int sourceWidth, int sourceHeight, int targetWidth, int targetHeight);
+
+// Decode le fichier pour un affichage dans targetWidth x targetHeight (0 : pleine taille)
+bool DecodeImageFile(const std::wstring& path, int targetWidth, int targetHeight, DecodedImage& out);
+bool DecodeImageMemory(const uint8_t* data, size_t size, int targetWidth, int targetHeight, DecodedImage& out);
+bool DecodeImageMemory(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out);
+
+// Moyenne de blocs reduction x reduction, ligne par ligne : le decodeur pousse chaque
+// ligne BGRA premultipliee de l'image d'origine et seule l'image reduite est gardee. Avec
+// une zone (coordonnees de l'image reduite), seule la zone est gardee.
+class RowReducer {
+public:
+    RowReducer(DecodedImage& out, int sourceWidth, int sourceHeight, int reduction);
+    RowReducer(DecodedImage& out, int sourceWidth, int sourceHeight, int reduction, const ImageRegion& area);
+
+    // Ligne `y` de l'image d'origine, appelee dans l'ordre. Le premier pixel de `row` est
+    // la colonne `rowLeft` ; la ligne couvre au moins les colonnes de la zone.
+    void PushRow(int y, const uint8_t* row, int rowLeft = 0);
+
+    // Colonnes et lignes de l'image d'origine utiles a la zone
+    int SourceLeft() const { return m_left; }
+    int SourceRight() const { return m_right; }
+    int SourceTop() const { return m_top; }
+    int SourceBottom() const { return m_bottom; }
+
+private:
+    void FlushRow(int outputRow, int rows);
+
+    DecodedImage& m_out;
+    int m_reduction;
+    int m_left;
+    int m_right;
+    int m_top;
+    int m_bottom;
+    int m_areaTop;
+    std::vector<uint32_t> m_sums;
+};
+
+// Premultiplie une ligne BGRA non premultipliee
+void PremultiplyRow(uint8_t* row, int width);
+
+// Decodeurs par format (ImageDecoderJpeg.cpp, ImageDecoderPng.cpp, ImageDecoderWic.cpp)
+bool DecodeBmp(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out);
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+bool DecodeJpegLibjpeg(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out);
+#endif
+#if defined(RANDOMPICTURE_HAVE_LIBPNG)
+bool DecodePngLibpng(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out);
+#endif
+#if defined(_WIN32)
+bool DecodeWic(const uint8_t* data, size_t size, ImageFormat format, const DecodeRequest& request, DecodedImage& out);
+#endif
@@ -0,0 +1,162 @@
+#include "ImageDecoder.h"
+
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <memory>
+#include <jpeglib.h>
+
+namespace {
+    struct JpegErrorManager {
+        jpeg_error_mgr base;
+        jmp_buf jump;
+    };
+
+    void OnJpegError(j_common_ptr info) {
+        longjmp(((JpegErrorManager*)info->err)->jump, 1);
+    }
+
+    void OnJpegMessage(j_common_ptr) {
+    }
+
+    // Ligne de sortie de libjpeg vers BGRA
+    void ConvertRow(const uint8_t* source, uint8_t* row, int width, bool cmyk) {
+        for (int x = 0; x < width; ++x, row += 4) {
+            if (cmyk) {
+                // Les JPEG CMJN d'Adobe sont stockes inverses : la valeur est deja 255 - encre
+                const uint8_t* ink = source + x * 4;
+                row[0] = (uint8_t)((ink[2] * ink[3] + 127) / 255);
+                row[1] = (uint8_t)((ink[1] * ink[3] + 127) / 255);
+                row[2] = (uint8_t)((ink[0] * ink[3] + 127) / 255);
+            }
+            else {
+                const uint8_t* rgb = source + x * 3;
+                row[0] = rgb[2];
+                row[1] = rgb[1];
+                row[2] = rgb[0];
+            }
+            row[3] = 255;
+        }
+    }
+}
+
+// Mise a l'echelle DCT de libjpeg : a 1/8, seul le coefficient continu de chaque bloc
+// est calcule, ce qui reduit a la fois le temps d'IDCT et la memoire de sortie. Au-dela de
+// 1/8 (niveaux de la pyramide), les lignes a 1/8 sont moyennees par RowReducer. Pour une
+// zone, libjpeg-turbo ne decode que ses colonnes (jpeg_crop_scanline) et saute les
+// lignes au-dessus sans IDCT (jpeg_skip_scanlines) ; le decodage s'arrete a sa derniere
+// ligne.
+bool DecodeJpegLibjpeg(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out) {
+    jpeg_decompress_struct info;
+    JpegErrorManager error;
+    info.err = jpeg_std_error(&error.base);
+    error.base.error_exit = OnJpegError;
+    error.base.output_message = OnJpegMessage;
+
+    // Declares avant setjmp : aucun destructeur n'est saute par longjmp
+    std::vector<uint8_t> sourceRow;
+    std::vector<uint8_t> bgraRow;
+    std::unique_ptr<RowReducer> reducer;
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&info);
+        return false;
+    }
+
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, data, (unsigned long)size);
+    jpeg_read_header(&info, TRUE);
+
+    int width = (int)info.image_width, height = (int)info.image_height;
+    int reduction = request.Reduction(width, height);
+    ImageRegion area = request.Area(width, height);
+    if (area.width == 0 || area.height == 0) {
+        jpeg_destroy_decompress(&info);
+        return false;
+    }
+    int dctReduction = std::min(reduction, 8);
+    info.scale_num = 1;
+    info.scale_denom = (unsigned int)dctReduction;
+    if (reduction > 1) {
+        // L'image est de toute facon redimensionnee ensuite : les options rapides ne se
+        // voient pas et evitent le lissage des blocs et le sur-echantillonnage de la chroma
+        info.dct_method = JDCT_IFAST;
+        info.do_fancy_upsampling = FALSE;
+        info.do_block_smoothing = FALSE;
+    }
+    else if (request.IsRegion()) {
+        // Le sur-echantillonnage lisse lit les pixels voisins, au-dela des bords de la
+        // zone : une tuile ne serait pas identique selon la passe qui l'a decodee
+        info.do_fancy_upsampling = FALSE;
+    }
+
+    bool cmyk = info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK;
+    if (cmyk) {
+        info.out_color_space = JCS_CMYK;
+    }
+    else {
+#ifdef JCS_EXTENSIONS
+        info.out_color_space = JCS_EXT_BGRA;
+#else
+        info.out_color_space = JCS_RGB;
+#endif
+    }
+
+    jpeg_start_decompress(&info);
+    bool bgra = false;
+#ifdef JCS_EXTENSIONS
+    bgra = !cmyk;
+#endif
+
+    // Image entiere a la reduction DCT : les lignes sont ecrites directement dans `out`
+    if (reduction == dctReduction && !request.IsRegion()) {
+        out.sourceWidth = width;
+        out.sourceHeight = height;
+        out.reduction = reduction;
+        out.Allocate((int)info.output_width, (int)info.output_height);
+        if (!bgra) sourceRow.resize((size_t)info.output_width * info.output_components);
+        while (info.output_scanline < info.output_height) {
+            uint8_t* row = out.Row((int)info.output_scanline);
+            JSAMPROW target = bgra ? row : sourceRow.data();
+            jpeg_read_scanlines(&info, &target, 1);
+            if (!bgra) ConvertRow(sourceRow.data(), row, out.width, cmyk);
+        }
+        jpeg_finish_decompress(&info);
+        jpeg_destroy_decompress(&info);
+        return true;
+    }
+
+    // Zone ou reduction au-dela de 1/8 : RowReducer travaille sur l'image reduite par la DCT
+    int scaledWidth = (int)info.output_width, scaledHeight = (int)info.output_height;
+    reducer = std::make_unique<RowReducer>(out, scaledWidth, scaledHeight, reduction / dctReduction, area);
+    JDIMENSION left = (JDIMENSION)reducer->SourceLeft();
+    JDIMENSION columns = (JDIMENSION)(reducer->SourceRight() - reducer->SourceLeft());
+#ifdef LIBJPEG_TURBO_VERSION
+    // Aligne sur les blocs : `left` peut reculer et `columns` grandir
+    if (columns < info.output_width) jpeg_crop_scanline(&info, &left, &columns);
+    if (reducer->SourceTop() > 0) jpeg_skip_scanlines(&info, (JDIMENSION)reducer->SourceTop());
+#else
+    left = 0;
+    columns = info.output_width;
+#endif
+
+    if (!bgra) sourceRow.resize((size_t)info.output_width * info.output_components);
+    bgraRow.resize((size_t)info.output_width * 4);
+    while ((int)info.output_scanline < reducer->SourceBottom()) {
+        int y = (int)info.output_scanline;
+        JSAMPROW target = bgra ? bgraRow.data() : sourceRow.data();
+        jpeg_read_scanlines(&info, &target, 1);
+        if (!bgra) ConvertRow(sourceRow.data(), bgraRow.data(), (int)columns, cmyk);
+        reducer->PushRow(y, bgraRow.data(), (int)left);
+    }
+    out.sourceWidth = width;
+    out.sourceHeight = height;
+    out.reduction = reduction;
+
+    // Lignes au-dessous de la zone jamais decodees : pas de jpeg_finish_decompress
+    jpeg_destroy_decompress(&info);
+    return true;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include "ImageDecoder.h"
+
+#if defined(RANDOMPICTURE_HAVE_LIBPNG)
+
+#include <cstring>
+#include <png.h>
+
+namespace {
+    struct PngReader {
+        const uint8_t* data;
+        size_t size;
+        size_t offset;
+    };
+
+    void ReadPngData(png_structp png, png_bytep buffer, png_size_t length) {
+        PngReader* reader = (PngReader*)png_get_io_ptr(png);
+        if (length > reader->size - reader->offset) {
+            png_error(png, "unexpected end of file");
+        }
+        std::memcpy(buffer, reader->data + reader->offset, length);
+        reader->offset += length;
+    }
+
+    void OnPngError(png_structp png, png_const_charp) {
+        png_longjmp(png, 1);
+    }
+
+    void OnPngWarning(png_structp, png_const_charp) {
+    }
+
+    constexpr uint64_t MaxInterlacedPixels = 64ull << 20;
+}
+
+// Le PNG n'a pas d'equivalent de la mise a l'echelle DCT : le temps reste celui de
+// l'inflate, quelle que soit la taille de sortie. L'image entiere est donc decodee a pleine
+// resolution, directement dans `out`, et reduite ensuite par l'appelant. Pour une zone de
+// la pyramide, les lignes sont moyennees par blocs (RowReducer) et le decodage s'arrete a
+// sa derniere ligne ; les images entrelacees (Adam7) doivent y etre decodees en entier et
+// sont refusees au-dela de MaxInterlacedPixels.
+bool DecodePngLibpng(const uint8_t* data, size_t size, const DecodeRequest& request, DecodedImage& out) {
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, OnPngError, OnPngWarning);
+    if (!png) return false;
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        png_destroy_read_struct(&png, nullptr, nullptr);
+        return false;
+    }
+
+    // Declares avant setjmp : aucun destructeur n'est saute par longjmp
+    PngReader reader{ data, size, 0 };
+    std::vector<uint8_t> row;
+    std::vector<uint8_t> image;
+    std::vector<png_bytep> rows;
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    png_set_read_fn(png, &reader, ReadPngData);
+    png_read_info(png, info);
+
+    // Tout en BGRA 8 bits
+    png_set_expand(png);
+    png_set_strip_16(png);
+    png_set_gray_to_rgb(png);
+    png_set_bgr(png);
+    png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
+    int passes = png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    int width = (int)png_get_image_width(png, info);
+    int height = (int)png_get_image_height(png, info);
+    if (png_get_rowbytes(png, info) != (size_t)width * 4) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    if (!request.IsRegion()) {
+        out.sourceWidth = width;
+        out.sourceHeight = height;
+        out.reduction = 1;
+        out.Allocate(width, height);
+        rows.resize(height);
+        for (int y = 0; y < height; ++y) rows[y] = out.Row(y);
+        png_read_image(png, rows.data());
+        for (int y = 0; y < height; ++y) PremultiplyRow(out.Row(y), width);
+        png_destroy_read_struct(&png, &info, nullptr);
+        return true;
+    }
+
+    ImageRegion area = request.Area(width, height);
+    if (area.width == 0 || area.height == 0 || (passes > 1 && (uint64_t)width * height > MaxInterlacedPixels)) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    RowReducer reducer(out, width, height, request.Reduction(width, height), area);
+    if (passes == 1) {
+        // Les lignes au-dessus de la zone sont decodees puis ignorees, aucune au-dessous
+        int left = reducer.SourceLeft();
+        row.resize((size_t)width * 4);
+        for (int y = 0; y < reducer.SourceBottom(); ++y) {
+            png_read_row(png, row.data(), nullptr);
+            if (y < reducer.SourceTop()) continue;
+            PremultiplyRow(row.data() + (size_t)left * 4, reducer.SourceRight() - left);
+            reducer.PushRow(y, row.data());
+        }
+    }
+    else {
+        image.resize((size_t)width * 4 * height);
+        rows.resize(height);
+        for (int y = 0; y < height; ++y) rows[y] = image.data() + (size_t)y * width * 4;
+        png_read_image(png, rows.data());
+        for (int y = reducer.SourceTop(); y < reducer.SourceBottom(); ++y) {
+            PremultiplyRow(rows[y], width);
+            reducer.PushRow(y, rows[y]);
+        }
+    }
+
+    png_destroy_read_struct(&png, &info, nullptr);
+    return true;
+}
+
+#endif
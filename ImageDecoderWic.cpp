@@ -0,0 +1,128 @@
+#include "ImageDecoder.h"
+
+#if defined(_WIN32)
+
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+    // COM doit etre initialise sur le thread appelant (threads de prefetch et de scan)
+    class ComScope {
+    public:
+        ComScope() : m_result(CoInitializeEx(nullptr, COINIT_MULTITHREADED)) {}
+        ~ComScope() {
+            if (SUCCEEDED(m_result)) CoUninitialize();
+        }
+
+    private:
+        HRESULT m_result;
+    };
+
+    // Decodage JPEG reduit dans le domaine DCT par le decodeur lui-meme
+    bool CopyWithSourceTransform(IWICBitmapFrameDecode* frame, UINT width, UINT height, DecodedImage& out) {
+        ComPtr<IWICBitmapSourceTransform> transform;
+        if (FAILED(frame->QueryInterface(IID_PPV_ARGS(&transform)))) return false;
+
+        UINT scaledWidth = width, scaledHeight = height;
+        if (FAILED(transform->GetClosestSize(&scaledWidth, &scaledHeight))) return false;
+
+        WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR;
+        if (FAILED(transform->GetClosestPixelFormat(&format))) return false;
+        UINT bytesPerPixel;
+        if (format == GUID_WICPixelFormat24bppBGR) bytesPerPixel = 3;
+        else if (format == GUID_WICPixelFormat32bppBGR) bytesPerPixel = 4;
+        else if (format == GUID_WICPixelFormat8bppGray) bytesPerPixel = 1;
+        else return false;
+
+        UINT stride = (scaledWidth * bytesPerPixel + 3) & ~3u;
+        std::vector<BYTE> buffer((size_t)stride * scaledHeight);
+        if (FAILED(transform->CopyPixels(nullptr, scaledWidth, scaledHeight, &format,
+            WICBitmapTransformRotate0, stride, (UINT)buffer.size(), buffer.data()))) {
+            return false;
+        }
+
+        out.Allocate((int)scaledWidth, (int)scaledHeight);
+        for (UINT y = 0; y < scaledHeight; ++y) {
+            const BYTE* source = buffer.data() + (size_t)y * stride;
+            uint8_t* row = out.Row((int)y);
+            for (UINT x = 0; x < scaledWidth; ++x, row += 4) {
+                const BYTE* pixel = source + x * bytesPerPixel;
+                row[0] = pixel[0];
+                row[1] = bytesPerPixel == 1 ? pixel[0] : pixel[1];
+                row[2] = bytesPerPixel == 1 ? pixel[0] : pixel[2];
+                row[3] = 255;
+            }
+        }
+        return true;
+    }
+}
+
+// Decodeur du systeme (WIC) : le JPEG est reduit par IWICBitmapSourceTransform, les autres
+// formats passent par un IWICBitmapScaler place directement sur le decodeur, qui lit
+// l'image ligne par ligne sans la garder entiere. Pour une zone, CopyPixels ne demande que
+// ses lignes a la chaine.
+bool DecodeWic(const uint8_t* data, size_t size, ImageFormat format, const DecodeRequest& request, DecodedImage& out) {
+    if (size > MAXDWORD) return false;
+    ComScope com;
+    ComPtr<IWICImagingFactory> factory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))) {
+        return false;
+    }
+
+    ComPtr<IWICStream> stream;
+    if (FAILED(factory->CreateStream(&stream)) ||
+        FAILED(stream->InitializeFromMemory(const_cast<BYTE*>(data), (DWORD)size))) {
+        return false;
+    }
+    ComPtr<IWICBitmapDecoder> decoder;
+    if (FAILED(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder))) {
+        return false;
+    }
+    ComPtr<IWICBitmapFrameDecode> frame;
+    UINT width = 0, height = 0;
+    if (FAILED(decoder->GetFrame(0, &frame)) || FAILED(frame->GetSize(&width, &height)) || width == 0 || height == 0) {
+        return false;
+    }
+
+    int reduction = request.Reduction((int)width, (int)height);
+    ImageRegion area = request.Area((int)width, (int)height);
+    if (area.width == 0 || area.height == 0) return false;
+    UINT outputWidth = (width + reduction - 1) / reduction;
+    UINT outputHeight = (height + reduction - 1) / reduction;
+    out.sourceWidth = (int)width;
+    out.sourceHeight = (int)height;
+    out.reduction = reduction;
+
+    if (format == ImageFormat::Jpeg && reduction > 1 && !request.IsRegion() &&
+        CopyWithSourceTransform(frame.Get(), outputWidth, outputHeight, out)) {
+        return true;
+    }
+
+    ComPtr<IWICFormatConverter> converter;
+    if (FAILED(factory->CreateFormatConverter(&converter)) ||
+        FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone,
+            nullptr, 0.0, WICBitmapPaletteTypeCustom))) {
+        return false;
+    }
+
+    ComPtr<IWICBitmapSource> source = converter;
+    if (reduction > 1) {
+        ComPtr<IWICBitmapScaler> scaler;
+        if (FAILED(factory->CreateBitmapScaler(&scaler)) ||
+            FAILED(scaler->Initialize(converter.Get(), outputWidth, outputHeight, WICBitmapInterpolationModeFant))) {
+            return false;
+        }
+        source = scaler;
+    }
+
+    out.Allocate(area.width, area.height);
+    WICRect rect{ area.x, area.y, area.width, area.height };
+    return SUCCEEDED(source->CopyPixels(&rect, (UINT)out.stride, (UINT)out.pixels.size(), out.pixels.data()));
+}
+
+#endif
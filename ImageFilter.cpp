@@ -0,0 +1,490 @@
+#include "ImageFilter.h"
+
+#include "PathString.h"
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <ctime>
+#include <cwchar>
+#include <cwctype>
+#include <filesystem>
+#include <limits>
+
+namespace fs = std::filesystem;
+
+namespace {
+    enum class Compare {
+        Equal,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+    };
+
+    std::wstring Lower(std::wstring_view text) {
+        std::wstring lower(text);
+        for (wchar_t& c : lower) c = (wchar_t)std::towlower(c);
+        return lower;
+    }
+
+    bool EqualsLower(std::wstring_view text, const std::wstring& lower) {
+        if (text.size() != lower.size()) return false;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if ((wchar_t)std::towlower(text[i]) != lower[i]) return false;
+        }
+        return true;
+    }
+
+    std::wstring_view ExtensionOf(std::wstring_view name) {
+        size_t dot = name.rfind(L'.');
+        return dot == std::wstring_view::npos ? std::wstring_view() : name.substr(dot + 1);
+    }
+
+    // Les guillemets groupent une valeur avec ses espaces
+    std::vector<std::wstring> SplitTerms(const std::wstring& text) {
+        std::vector<std::wstring> terms;
+        std::wstring term;
+        bool quoted = false;
+        for (wchar_t c : text) {
+            if (c == L'"') {
+                quoted = !quoted;
+            }
+            else if (!quoted && std::iswspace(c)) {
+                if (!term.empty()) terms.push_back(std::move(term));
+                term.clear();
+            }
+            else {
+                term += c;
+            }
+        }
+        if (!term.empty()) terms.push_back(std::move(term));
+        return terms;
+    }
+
+    bool SplitTerm(const std::wstring& term, std::wstring& key, Compare& compare, std::wstring& value) {
+        size_t pos = term.find_first_of(L"=<>");
+        if (pos == std::wstring::npos || pos == 0) return false;
+        key = Lower(std::wstring_view(term).substr(0, pos));
+        bool orEqual = pos + 1 < term.size() && term[pos + 1] == L'=';
+        if (term[pos] == L'=') compare = Compare::Equal;
+        else if (term[pos] == L'<') compare = orEqual ? Compare::LessEqual : Compare::Less;
+        else compare = orEqual ? Compare::GreaterEqual : Compare::Greater;
+        value = term.substr(pos + (term[pos] != L'=' && orEqual ? 2 : 1));
+        return !value.empty();
+    }
+
+    // Chiffres decimaux en tete de `text` ; `end` recoit la position du premier autre caractere
+    bool ParseDigits(const std::wstring& text, uint64_t& value, size_t& end) {
+        value = 0;
+        for (end = 0; end < text.size() && text[end] >= L'0' && text[end] <= L'9'; ++end) {
+            uint64_t digit = (uint64_t)(text[end] - L'0');
+            if (value > (UINT64_MAX - digit) / 10) return false;
+            value = value * 10 + digit;
+        }
+        return end > 0;
+    }
+
+    bool ParseDimension(const std::wstring& text, uint32_t& value) {
+        uint64_t number;
+        size_t end;
+        if (!ParseDigits(text, number, end) || end != text.size() || number > UINT32_MAX) return false;
+        value = (uint32_t)number;
+        return true;
+    }
+
+    bool ParseSize(const std::wstring& text, uint64_t& value) {
+        uint64_t number;
+        size_t end;
+        if (!ParseDigits(text, number, end)) return false;
+        std::wstring unit = Lower(std::wstring_view(text).substr(end));
+        int shift;
+        if (unit.empty() || unit == L"b") shift = 0;
+        else if (unit == L"k" || unit == L"kb") shift = 10;
+        else if (unit == L"m" || unit == L"mb") shift = 20;
+        else if (unit == L"g" || unit == L"gb") shift = 30;
+        else return false;
+        if (number > (UINT64_MAX >> shift)) return false;
+        value = number << shift;
+        return true;
+    }
+
+    // fs::file_time_type n'a pas de conversion depuis l'heure systeme avant C++20 : on passe
+    // par l'ecart actuel entre les deux horloges
+    int64_t FileTicks(std::time_t time) {
+        auto system = std::chrono::system_clock::from_time_t(time);
+        auto file = fs::file_time_type::clock::now() +
+            std::chrono::duration_cast<fs::file_time_type::duration>(system - std::chrono::system_clock::now());
+        return (int64_t)file.time_since_epoch().count();
+    }
+
+    // Minuit local du jour AAAA-MM-JJ et du lendemain
+    bool ParseDay(const std::wstring& text, int64_t& start, int64_t& next) {
+        int year, month, day;
+        wchar_t extra;
+        if (std::swscanf(text.c_str(), L"%d-%d-%d%lc", &year, &month, &day, &extra) != 3) return false;
+        if (year < 1970 || year > 9999 || month < 1 || month > 12 || day < 1 || day > 31) return false;
+        std::tm first{};
+        first.tm_year = year - 1900;
+        first.tm_mon = month - 1;
+        first.tm_mday = day;
+        first.tm_isdst = -1;
+        std::tm second = first;
+        ++second.tm_mday;
+        std::time_t firstTime = std::mktime(&first);
+        std::time_t secondTime = std::mktime(&second);
+        if (firstTime == (std::time_t)-1 || secondTime == (std::time_t)-1) return false;
+        start = FileTicks(firstTime);
+        next = FileTicks(secondTime);
+        return true;
+    }
+
+    // Reduit [minimum, maximum] aux valeurs qui se comparent a [low, high] (une valeur, ou un
+    // jour entier pour les dates)
+    template <typename T>
+    bool Restrict(Compare compare, T low, T high, T& minimum, T& maximum) {
+        switch (compare) {
+        case Compare::Equal:
+            minimum = std::max(minimum, low);
+            maximum = std::min(maximum, high);
+            return true;
+        case Compare::Less:
+            if (low == std::numeric_limits<T>::min()) return false;
+            maximum = std::min(maximum, (T)(low - 1));
+            return true;
+        case Compare::LessEqual:
+            maximum = std::min(maximum, high);
+            return true;
+        case Compare::Greater:
+            if (high == std::numeric_limits<T>::max()) return false;
+            minimum = std::max(minimum, (T)(high + 1));
+            return true;
+        case Compare::GreaterEqual:
+            minimum = std::max(minimum, low);
+            return true;
+        }
+        return false;
+    }
+
+    bool SameCharacter(wchar_t a, wchar_t b) {
+        if (IsPathSeparator(a) && IsPathSeparator(b)) return true;
+#ifdef _WIN32
+        return std::towlower(a) == std::towlower(b);
+#else
+        return a == b;
+#endif
+    }
+
+    bool IsAbsolute(const std::wstring& path) {
+        return (!path.empty() && IsPathSeparator(path[0])) || (path.size() > 1 && path[1] == L':');
+    }
+
+    // `directory` est `folder` ou un de ses sous-dossiers ; un `folder` relatif peut
+    // commencer a n'importe quel composant du chemin
+    bool InFolder(const std::wstring& directory, const std::wstring& folder) {
+        bool absolute = IsAbsolute(folder);
+        for (size_t start = 0; start + folder.size() <= directory.size(); ++start) {
+            if (start > 0 && absolute) break;
+            if (start > 0 && !IsPathSeparator(directory[start - 1])) continue;
+            size_t i = 0;
+            while (i < folder.size() && SameCharacter(directory[start + i], folder[i])) ++i;
+            if (i != folder.size()) continue;
+            size_t end = start + folder.size();
+            if (end == directory.size() || IsPathSeparator(directory[end]) || IsPathSeparator(folder.back())) return true;
+        }
+        return false;
+    }
+}
+
+bool ImageFilter::IsEmpty() const {
+    return folder.empty() && extensions.empty() && !HasDimensions() && !HasSize() && !HasTime();
+}
+
+bool ImageFilter::HasDimensions() const {
+    return minWidth != 0 || maxWidth != UINT32_MAX || minHeight != 0 || maxHeight != UINT32_MAX;
+}
+
+bool ParseImageFilter(const std::wstring& text, ImageFilter& filter, std::wstring* error) {
+    ImageFilter parsed;
+    for (const std::wstring& term : SplitTerms(text)) {
+        std::wstring key, value;
+        Compare compare;
+        bool ok = SplitTerm(term, key, compare, value);
+        if (ok && key == L"folder") {
+            ok = compare == Compare::Equal;
+            parsed.folder = value;
+            // Sans separateur final, sauf pour une racine
+            while (parsed.folder.size() > 1 && IsPathSeparator(parsed.folder.back()) &&
+                parsed.folder[parsed.folder.size() - 2] != L':') {
+                parsed.folder.pop_back();
+            }
+        }
+        else if (ok && key == L"ext") {
+            ok = compare == Compare::Equal;
+            size_t start = 0;
+            while (ok && start <= value.size()) {
+                size_t comma = std::min(value.find(L',', start), value.size());
+                std::wstring extension = Lower(std::wstring_view(value).substr(start, comma - start));
+                if (!extension.empty() && extension[0] == L'.') extension.erase(0, 1);
+                if (!extension.empty()) parsed.extensions.push_back(extension);
+                start = comma + 1;
+            }
+            ok = ok && !parsed.extensions.empty();
+        }
+        else if (ok && (key == L"width" || key == L"height")) {
+            uint32_t number;
+            ok = ParseDimension(value, number);
+            if (ok && key == L"width") ok = Restrict(compare, number, number, parsed.minWidth, parsed.maxWidth);
+            else if (ok) ok = Restrict(compare, number, number, parsed.minHeight, parsed.maxHeight);
+        }
+        else if (ok && (key == L"min" || key == L"max")) {
+            size_t x = value.find_first_of(L"xX");
+            uint32_t width, height;
+            ok = compare == Compare::Equal && x != std::wstring::npos &&
+                ParseDimension(value.substr(0, x), width) && ParseDimension(value.substr(x + 1), height);
+            if (ok) {
+                Compare bound = key == L"min" ? Compare::GreaterEqual : Compare::LessEqual;
+                Restrict(bound, width, width, parsed.minWidth, parsed.maxWidth);
+                Restrict(bound, height, height, parsed.minHeight, parsed.maxHeight);
+            }
+        }
+        else if (ok && key == L"size") {
+            uint64_t bytes;
+            ok = ParseSize(value, bytes) && Restrict(compare, bytes, bytes, parsed.minSize, parsed.maxSize);
+        }
+        else if (ok && key == L"date") {
+            int64_t start, next;
+            ok = ParseDay(value, start, next) && Restrict(compare, start, next - 1, parsed.minTime, parsed.maxTime);
+        }
+        else {
+            ok = false;
+        }
+
+        if (!ok) {
+            if (error) *error = term;
+            return false;
+        }
+    }
+    filter = std::move(parsed);
+    return true;
+}
+
+void ImageBitmap::Assign(size_t size, bool value) {
+    m_size = size;
+    m_words.assign((size + 63) / 64, value ? ~0ull : 0);
+    if (value && (size & 63) != 0) m_words.back() &= (1ull << (size & 63)) - 1;
+}
+
+void ImageBitmap::Resize(size_t size) {
+    // Les bits au-dela de l'ancienne taille sont deja a 0
+    m_words.resize((size + 63) / 64, 0);
+    m_size = size;
+}
+
+void ImageBitmap::SetRange(size_t first, size_t last) {
+    last = std::min(last, m_size);
+    if (first >= last) return;
+    size_t firstWord = first >> 6, lastWord = (last - 1) >> 6;
+    uint64_t firstMask = ~0ull << (first & 63);
+    uint64_t lastMask = ~0ull >> (63 - ((last - 1) & 63));
+    if (firstWord == lastWord) {
+        m_words[firstWord] |= firstMask & lastMask;
+        return;
+    }
+    m_words[firstWord] |= firstMask;
+    for (size_t w = firstWord + 1; w < lastWord; ++w) m_words[w] = ~0ull;
+    m_words[lastWord] |= lastMask;
+}
+
+void ImageBitmap::And(const ImageBitmap& other) {
+    size_t common = std::min(m_words.size(), other.m_words.size());
+    for (size_t w = 0; w < common; ++w) m_words[w] &= other.m_words[w];
+    std::fill(m_words.begin() + common, m_words.end(), 0);
+}
+
+void ImageBitmap::Or(const ImageBitmap& other) {
+    size_t common = std::min(m_words.size(), other.m_words.size());
+    for (size_t w = 0; w < common; ++w) m_words[w] |= other.m_words[w];
+}
+
+size_t ImageBitmap::Count() const {
+    size_t count = 0;
+    for (uint64_t word : m_words) count += std::bitset<64>(word).count();
+    return count;
+}
+
+void CatalogFilter::SetFilter(ImageFilter filter) {
+    m_filter = std::move(filter);
+    m_dirty = true;
+    if (!IsActive()) {
+        m_bitmap = ImageBitmap();
+        m_matches.clear();
+        m_matches.shrink_to_fit();
+        ++m_generation;
+    }
+}
+
+void CatalogFilter::Reset() {
+    m_indexed = 0;
+    m_extensionNames.clear();
+    m_extensionBitmaps.clear();
+    m_directoryRuns.clear();
+    m_bitmap = ImageBitmap();
+    m_matches.clear();
+    m_dirty = true;
+}
+
+bool CatalogFilter::Update(const ImageCatalog& catalog) {
+    if (!IsActive()) return false;
+    if (catalog.Size() < m_indexed) Reset();
+    if (!m_dirty && m_version == catalog.Version() && m_indexed == catalog.Size()) return false;
+
+    // Seulement des ajouts depuis la derniere compilation (lots du scan) : les images deja
+    // retenues ne changent pas, seules les nouvelles sont compilees, a la suite
+    bool append = !m_dirty && m_changeVersion == catalog.ChangeVersion() && m_bitmap.Size() < catalog.Size();
+    IndexNewImages(catalog);
+    Compile(catalog, append ? m_bitmap.Size() : 0);
+    m_version = catalog.Version();
+    m_changeVersion = catalog.ChangeVersion();
+    m_dirty = false;
+    if (!append) ++m_generation;
+    return true;
+}
+
+void CatalogFilter::IndexNewImages(const ImageCatalog& catalog) {
+    size_t size = catalog.Size();
+    if (m_indexed == size) return;
+    for (ImageBitmap& bitmap : m_extensionBitmaps) bitmap.Resize(size);
+    m_directoryRuns.resize(catalog.DirectoryCount());
+
+    size_t code = SIZE_MAX;
+    for (size_t index = m_indexed; index < size; ++index) {
+        ImageId id = (ImageId)index;
+        // Les images voisines ont presque toujours la meme extension : essayee en premier
+        std::wstring_view extension = ExtensionOf(catalog.FileName(id));
+        if (code == SIZE_MAX || !EqualsLower(extension, m_extensionNames[code])) {
+            code = 0;
+            while (code < m_extensionNames.size() && !EqualsLower(extension, m_extensionNames[code])) ++code;
+            if (code == m_extensionNames.size()) {
+                m_extensionNames.push_back(Lower(extension));
+                m_extensionBitmaps.emplace_back();
+                m_extensionBitmaps.back().Assign(size, false);
+            }
+        }
+        m_extensionBitmaps[code].Set(id);
+
+        auto& runs = m_directoryRuns[catalog.DirectoryOf(id)];
+        if (!runs.empty() && runs.back().second == id) ++runs.back().second;
+        else runs.emplace_back(id, id + 1);
+    }
+    m_indexed = size;
+}
+
+void CatalogFilter::Compile(const ImageCatalog& catalog, size_t first) {
+    auto start = std::chrono::steady_clock::now();
+    size_t size = catalog.Size();
+    if (first == 0) {
+        m_bitmap.Assign(size, true);
+        m_directoryMatches.assign(catalog.DirectoryCount(), UnknownMatch);
+    }
+    else {
+        m_bitmap.Resize(size);
+        m_bitmap.SetRange(first, size);
+        m_directoryMatches.resize(catalog.DirectoryCount(), UnknownMatch);
+    }
+
+    // Chaque passe ne touche que les mots des images [first, size) ; dans le premier, les
+    // bits des images deja compilees sont gardes tels quels
+    std::vector<uint64_t>& words = m_bitmap.Words();
+    const size_t firstWord = first / 64;
+    const uint64_t compiled = (first % 64) != 0 ? (1ull << (first % 64)) - 1 : 0;
+    auto andWord = [&](size_t w, uint64_t mask) { words[w] &= w == firstWord ? mask | compiled : mask; };
+
+    if (!m_filter.extensions.empty()) {
+        std::vector<const ImageBitmap*> selected;
+        for (size_t code = 0; code < m_extensionNames.size(); ++code) {
+            if (std::find(m_filter.extensions.begin(), m_filter.extensions.end(), m_extensionNames[code]) !=
+                m_filter.extensions.end()) {
+                selected.push_back(&m_extensionBitmaps[code]);
+            }
+        }
+        for (size_t w = firstWord; w < words.size(); ++w) {
+            uint64_t mask = 0;
+            for (const ImageBitmap* bitmap : selected) mask |= bitmap->Words()[w];
+            andWord(w, mask);
+        }
+    }
+    if (!m_filter.folder.empty()) {
+        ImageBitmap folders;
+        folders.Assign(size, false);
+        for (uint32_t directory = 0; directory < (uint32_t)m_directoryRuns.size(); ++directory) {
+            const auto& runs = m_directoryRuns[directory];
+            if (runs.empty() || runs.back().second <= first) continue;
+            uint8_t& match = m_directoryMatches[directory];
+            if (match == UnknownMatch) match = InFolder(catalog.DirectoryPath(directory), m_filter.folder) ? 1 : 0;
+            if (!match) continue;
+            for (auto run = runs.rbegin(); run != runs.rend() && run->second > first; ++run) {
+                folders.SetRange(std::max<size_t>(run->first, first), run->second);
+            }
+        }
+        for (size_t w = firstWord; w < words.size(); ++w) andWord(w, folders.Words()[w]);
+    }
+
+    // Exclusions et colonnes : une passe par colonne, 64 images par mot, sans branche dans
+    // le mot ; les mots deja vides sont sautes
+    auto keep = [&](auto predicate) {
+        for (size_t w = firstWord; w < words.size(); ++w) {
+            if (words[w] == 0) continue;
+            size_t base = w * 64, count = std::min<size_t>(64, size - base);
+            uint64_t mask = 0;
+            for (size_t bit = first > base ? first - base : 0; bit < count; ++bit) {
+                mask |= (uint64_t)predicate((ImageId)(base + bit)) << bit;
+            }
+            andWord(w, mask);
+        }
+    };
+    const ImageFilter& filter = m_filter;
+    if (catalog.ExcludedCount() != 0) keep([&](ImageId id) { return !catalog.IsExcluded(id); });
+    if (filter.HasDimensions()) {
+        keep([&](ImageId id) {
+            uint32_t width = catalog.Width(id), height = catalog.Height(id);
+            return (width != 0) & (width >= filter.minWidth) & (width <= filter.maxWidth) &
+                (height >= filter.minHeight) & (height <= filter.maxHeight);
+        });
+    }
+    if (filter.HasSize()) {
+        keep([&](ImageId id) {
+            uint64_t bytes = catalog.FileSize(id);
+            return (bytes != 0) & (bytes >= filter.minSize) & (bytes <= filter.maxSize);
+        });
+    }
+    if (filter.HasTime()) {
+        keep([&](ImageId id) {
+            int64_t mtime = catalog.ModifiedTime(id);
+            return (mtime != 0) & (mtime >= filter.minTime) & (mtime <= filter.maxTime);
+        });
+    }
+
+    if (first == 0) {
+        m_matches.clear();
+        m_matches.reserve(m_bitmap.Count());
+    }
+    for (size_t w = firstWord; w < words.size(); ++w) {
+        for (uint64_t pending = w == firstWord ? words[w] & ~compiled : words[w]; pending != 0; pending &= pending - 1) {
+            uint64_t bit = pending & (~pending + 1);
+            m_matches.push_back((ImageId)(w * 64 + std::bitset<64>(bit - 1).count()));
+        }
+    }
+
+    m_stats.matches = m_matches.size();
+    ++m_stats.compiles;
+    m_stats.compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+CatalogFilter::Stats CatalogFilter::GetStats() const {
+    Stats stats = m_stats;
+    stats.indexBytes = m_bitmap.MemoryUsage() + m_matches.capacity() * sizeof(ImageId);
+    for (const ImageBitmap& bitmap : m_extensionBitmaps) stats.indexBytes += bitmap.MemoryUsage();
+    for (const auto& runs : m_directoryRuns) stats.indexBytes += runs.capacity() * sizeof(runs[0]);
+    return stats;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ImageCatalog.h"
+
+// Criteres du tirage (--filter, champ Filtre). Un critere a sa valeur par defaut ne filtre
+// rien ; une image dont la valeur est inconnue (0 : non sondee, taille ou date non relevee)
+// ne passe pas un critere sur cette valeur.
+struct ImageFilter {
+    // Dossier dont les images et celles des sous-dossiers sont gardees : chemin absolu, ou
+    // composants de fin de chemin ("2023/vacances" garde ".../2023/vacances/...")
+    std::wstring folder;
+    // Extensions en minuscules, sans le point
+    std::vector<std::wstring> extensions;
+    uint32_t minWidth = 0;
+    uint32_t maxWidth = UINT32_MAX;
+    uint32_t minHeight = 0;
+    uint32_t maxHeight = UINT32_MAX;
+    uint64_t minSize = 0;
+    uint64_t maxSize = UINT64_MAX;
+    // Ticks de fs::file_time_type
+    int64_t minTime = INT64_MIN;
+    int64_t maxTime = INT64_MAX;
+
+    bool IsEmpty() const;
+    bool HasDimensions() const;
+    bool HasSize() const { return minSize != 0 || maxSize != UINT64_MAX; }
+    bool HasTime() const { return minTime != INT64_MIN || maxTime != INT64_MAX; }
+};
+
+// Termes separes par des espaces, valeurs entre guillemets si elles en contiennent :
+//   folder=2023/vacances ext=jpg,png width>=1920 height<2000 min=1920x1080 max=8000x8000
+//   size>=500K size<20M date>=2020-01-01 date<2021-01-01
+// Comparaisons =, <, <=, >, >= ; tailles en octets ou avec K, M, G ; dates locales.
+// Texte vide : aucun filtre. En cas d'erreur, `error` recoit le terme refuse.
+bool ParseImageFilter(const std::wstring& text, ImageFilter& filter, std::wstring* error = nullptr);
+
+// Ensemble d'images, un bit par ImageId
+class ImageBitmap {
+public:
+    void Assign(size_t size, bool value);
+    // Agrandit avec des bits a 0
+    void Resize(size_t size);
+    size_t Size() const { return m_size; }
+
+    bool Test(ImageId id) const { return id < m_size && ((m_words[id >> 6] >> (id & 63)) & 1) != 0; }
+    void Set(ImageId id) { m_words[id >> 6] |= 1ull << (id & 63); }
+    // Bits de [first, last)
+    void SetRange(size_t first, size_t last);
+    void And(const ImageBitmap& other);
+    void Or(const ImageBitmap& other);
+    size_t Count() const;
+
+    std::vector<uint64_t>& Words() { return m_words; }
+    const std::vector<uint64_t>& Words() const { return m_words; }
+    size_t MemoryUsage() const { return m_words.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> m_words;
+    size_t m_size = 0;
+};
+
+// Filtre compile sur un catalogue de plusieurs millions d'images. Les index sont tenus a
+// jour a chaque Update pour les images ajoutees : un bitmap par extension et les plages
+// d'index de chaque dossier (le scan ajoute les images d'un dossier ensemble). Compiler le
+// filtre combine par ET le bitmap des extensions et celui des dossiers retenus, puis ne
+// verifie dimensions, taille et date (colonnes du catalogue) que pour les images restantes.
+// Les images retenues sont rangees dans une liste dense : un tirage uniforme parmi elles
+// coute un index aleatoire. Thread UI seulement.
+class CatalogFilter {
+public:
+    struct Stats {
+        size_t matches = 0;
+        size_t compiles = 0;
+        double compileMs = 0;
+        size_t indexBytes = 0;
+    };
+
+    void SetFilter(ImageFilter filter);
+    const ImageFilter& Filter() const { return m_filter; }
+    bool IsActive() const { return !m_filter.IsEmpty(); }
+    // Oublie les index (catalogue remplace, index differents)
+    void Reset();
+
+    // Indexe les nouvelles images et recompile si le catalogue (Version) ou le filtre a
+    // change ; true si les images retenues ont change. Si le catalogue n'a fait que grandir
+    // (ChangeVersion inchange), seules les images ajoutees sont compilees : celles qui
+    // passent le filtre sont ajoutees a la fin de Matches, sans changer Generation.
+    bool Update(const ImageCatalog& catalog);
+    // Change a chaque compilation complete : les donnees derivees des images retenues sont
+    // a refaire, et pas seulement a completer avec la fin de Matches
+    uint64_t Generation() const { return m_generation; }
+
+    // Images retenues (non exclues) a la derniere compilation
+    size_t Count() const { return m_matches.size(); }
+    ImageId At(size_t index) const { return m_matches[index]; }
+    const std::vector<ImageId>& Matches() const { return m_matches; }
+    bool Contains(ImageId id) const { return !IsActive() || m_bitmap.Test(id); }
+
+    Stats GetStats() const;
+
+private:
+    void IndexNewImages(const ImageCatalog& catalog);
+    // Compile les images [first, Size()) ; 0 : tout le catalogue
+    void Compile(const ImageCatalog& catalog, size_t first);
+
+    static constexpr uint8_t UnknownMatch = 2;
+
+    ImageFilter m_filter;
+    bool m_dirty = true;
+    uint64_t m_version = 0;
+    uint64_t m_changeVersion = 0;
+    uint64_t m_generation = 0;
+
+    // Index, valables pour les images [0, m_indexed)
+    size_t m_indexed = 0;
+    std::vector<std::wstring> m_extensionNames;
+    std::vector<ImageBitmap> m_extensionBitmaps;
+    std::vector<std::vector<std::pair<ImageId, ImageId>>> m_directoryRuns;
+    // Dossier retenu par le critere de dossier (0 ou 1), UnknownMatch s'il n'a pas encore
+    // ete compare
+    std::vector<uint8_t> m_directoryMatches;
+
+    ImageBitmap m_bitmap;
+    std::vector<ImageId> m_matches;
+    Stats m_stats;
+};
@@ -0,0 +1,185 @@
+#include "ImageLoader.h"
+
+#include "ExifThumbnail.h"
+#include "FileReader.h"
+#include "ImageDecoder.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <cstring>
+#include <shlwapi.h>
+
+#pragma comment(lib, "shlwapi.lib")
+
+bool GetImageCacheKey(const std::wstring& path, ImageCacheKey& key) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) return false;
+    key.path = path;
+    key.mtime = ((int64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    key.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    return true;
+}
+
+bool DecodedBitmap::Covers(SIZE clientSize) const {
+    if (reduction == 1) return true;
+    RECT clientRect{ 0, 0, clientSize.cx, clientSize.cy };
+    RECT target = FitImageRect(bitmap->GetWidth(), bitmap->GetHeight(), clientRect);
+    return target.right - target.left <= (LONG)bitmap->GetWidth() &&
+        target.bottom - target.top <= (LONG)bitmap->GetHeight();
+}
+
+namespace {
+    std::unique_ptr<Gdiplus::Bitmap> DecodeWithGdiplus(IStream* stream) {
+        Gdiplus::Image image(stream);
+        if (image.GetLastStatus() != Gdiplus::Ok || image.GetWidth() == 0 || image.GetHeight() == 0) {
+            return nullptr;
+        }
+
+        UINT width = image.GetWidth();
+        UINT height = image.GetHeight();
+        auto bitmap = std::make_unique<Gdiplus::Bitmap>((INT)width, (INT)height, PixelFormat32bppPARGB);
+        if (bitmap->GetLastStatus() != Gdiplus::Ok) return nullptr;
+
+        Gdiplus::Graphics graphics(bitmap.get());
+        graphics.DrawImage(&image, 0, 0, (INT)width, (INT)height);
+        return bitmap;
+    }
+
+    // Formats que les decodeurs ne connaissent pas (GIF, TIFF...) : GDI+ lit le contenu deja
+    // charge plutot que de rouvrir le fichier. SHCreateMemStream copie le tampon, ces
+    // fichiers sont rares.
+    std::unique_ptr<Gdiplus::Bitmap> DecodeWithGdiplus(const FileData& file) {
+        if (file.Size() > MAXUINT) return nullptr;
+        IStream* stream = SHCreateMemStream(file.Data(), (UINT)file.Size());
+        if (!stream) return nullptr;
+        std::unique_ptr<Gdiplus::Bitmap> bitmap = DecodeWithGdiplus(stream);
+        stream->Release();
+        return bitmap;
+    }
+
+    std::unique_ptr<Gdiplus::Bitmap> ToBitmap(const DecodedImage& image) {
+        auto bitmap = std::make_unique<Gdiplus::Bitmap>(image.width, image.height, PixelFormat32bppPARGB);
+        if (bitmap->GetLastStatus() != Gdiplus::Ok) return nullptr;
+
+        Gdiplus::Rect rect(0, 0, image.width, image.height);
+        Gdiplus::BitmapData data;
+        if (bitmap->LockBits(&rect, Gdiplus::ImageLockModeWrite, PixelFormat32bppPARGB, &data) != Gdiplus::Ok) {
+            return nullptr;
+        }
+        for (int y = 0; y < image.height; ++y) {
+            std::memcpy((uint8_t*)data.Scan0 + (ptrdiff_t)y * data.Stride,
+                image.pixels.data() + (ptrdiff_t)y * image.stride, (size_t)image.width * 4);
+        }
+        bitmap->UnlockBits(&data);
+        return bitmap;
+    }
+}
+
+std::shared_ptr<DecodedBitmap> DecodeImage(const std::wstring& path, SIZE clientSize) {
+    TraceSpan span(TraceStage::Decode);
+    auto decoded = std::make_shared<DecodedBitmap>();
+    FileData file;
+    if (!file.Open(path)) return nullptr;
+    DecodedImage image;
+    if (DecodeImageMemory(file.Data(), file.Size(), clientSize.cx, clientSize.cy, image)) {
+        decoded->bitmap = ToBitmap(image);
+        decoded->reduction = image.reduction;
+    }
+    else {
+        decoded->bitmap = DecodeWithGdiplus(file);
+    }
+    return decoded->bitmap ? decoded : nullptr;
+}
+
+std::shared_ptr<Gdiplus::Bitmap> LoadDecodedImage(DecodedImageCache& cache, const std::wstring& path, SIZE clientSize) {
+    ImageCacheKey key;
+    if (!GetImageCacheKey(path, key)) return nullptr;
+
+    std::shared_ptr<DecodedBitmap> decoded = cache.Get(key);
+    if (!decoded || !decoded->Covers(clientSize)) {
+        decoded = DecodeImage(path, clientSize);
+        if (!decoded) return nullptr;
+        cache.Put(key, decoded, decoded->Bytes());
+    }
+    // Le bitmap partage la duree de vie de l'entree du cache
+    return std::shared_ptr<Gdiplus::Bitmap>(decoded, decoded->bitmap.get());
+}
+
+std::shared_ptr<Gdiplus::Bitmap> LoadExifPreview(const std::wstring& path) {
+    DecodedImage thumbnail;
+    if (!DecodeExifThumbnail(path, thumbnail)) return nullptr;
+    return ToBitmap(thumbnail);
+}
+
+RECT FitImageRect(UINT imageWidth, UINT imageHeight, const RECT& clientRect) {
+    float imageRatio = (float)imageWidth / imageHeight;
+    float clientRatio = (float)clientRect.right / clientRect.bottom;
+
+    int drawWidth, drawHeight;
+    if (clientRatio > imageRatio) {
+        drawHeight = clientRect.bottom;
+        drawWidth = (int)(drawHeight * imageRatio);
+    }
+    else {
+        drawWidth = clientRect.right;
+        drawHeight = (int)(drawWidth / imageRatio);
+    }
+
+    int x = (clientRect.right - drawWidth) / 2;
+    int y = (clientRect.bottom - drawHeight) / 2;
+    return RECT{ x, y, x + drawWidth, y + drawHeight };
+}
+
+namespace {
+    // Threads du redimensionnement, partages par toutes les mises a l'echelle
+    ThreadPool& ResamplerPool() {
+        static ThreadPool pool;
+        return pool;
+    }
+}
+
+std::shared_ptr<Gdiplus::Bitmap> ScaleBitmap(Gdiplus::Bitmap& source, int width, int height, ResampleFilter filter) {
+    if (width <= 0 || height <= 0) return nullptr;
+
+    auto scaled = std::make_shared<Gdiplus::Bitmap>(width, height, PixelFormat32bppPARGB);
+    if (scaled->GetLastStatus() != Gdiplus::Ok) return nullptr;
+
+    // Les deux bitmaps sont en 32 bits premultiplie : LockBits ne convertit rien et le
+    // filtre travaille directement sur les pixels premultiplies
+    Gdiplus::Rect sourceRect(0, 0, (INT)source.GetWidth(), (INT)source.GetHeight());
+    Gdiplus::BitmapData sourceData;
+    if (source.LockBits(&sourceRect, Gdiplus::ImageLockModeRead, PixelFormat32bppPARGB, &sourceData) != Gdiplus::Ok) {
+        return nullptr;
+    }
+    Gdiplus::Rect scaledRect(0, 0, width, height);
+    Gdiplus::BitmapData scaledData;
+    if (scaled->LockBits(&scaledRect, Gdiplus::ImageLockModeWrite, PixelFormat32bppPARGB, &scaledData) != Gdiplus::Ok) {
+        source.UnlockBits(&sourceData);
+        return nullptr;
+    }
+
+    ResampleOptions options;
+    options.filter = filter;
+    options.pool = &ResamplerPool();
+    bool resampled = ResampleImage(
+        ConstImageView((const uint8_t*)sourceData.Scan0, (int)sourceData.Width, (int)sourceData.Height, sourceData.Stride),
+        ImageView{ (uint8_t*)scaledData.Scan0, (int)scaledData.Width, (int)scaledData.Height, scaledData.Stride },
+        options);
+
+    scaled->UnlockBits(&scaledData);
+    source.UnlockBits(&sourceData);
+    return resampled ? scaled : nullptr;
+}
+
+bool ScaleToClient(Gdiplus::Bitmap& source, const std::wstring& path, SIZE clientSize, ScaledImage& out) {
+    if (clientSize.cx <= 0 || clientSize.cy <= 0) return false;
+    TraceSpan span(TraceStage::Scale);
+    RECT clientRect{ 0, 0, clientSize.cx, clientSize.cy };
+    RECT target = FitImageRect(source.GetWidth(), source.GetHeight(), clientRect);
+    std::shared_ptr<Gdiplus::Bitmap> scaled = ScaleBitmap(source, target.right - target.left, target.bottom - target.top);
+    if (!scaled) return false;
+    out.path = path;
+    out.bitmap = std::move(scaled);
+    out.clientSize = clientSize;
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <windows.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+// NOMINMAX est defini pour tout le projet : les en-tetes GDI+ attendent min et max
+namespace Gdiplus {
+    using std::max;
+    using std::min;
+}
+#include <gdiplus.h>
+
+#include "LruCache.h"
+#include "Resampler.h"
+
+// Chargement et mise a l'echelle des images avec GDI+
+
+// Image decodee gardee en cache. Une image bien plus grande que la fenetre est reduite
+// au decodage (ImageDecoder) : elle ne sert alors que tant que la fenetre reste petite.
+struct DecodedBitmap {
+    std::unique_ptr<Gdiplus::Bitmap> bitmap;
+    // 1, 2, 4 ou 8
+    int reduction = 1;
+
+    // Vrai si l'image suffit pour un affichage dans `clientSize` sans agrandissement
+    bool Covers(SIZE clientSize) const;
+    size_t Bytes() const { return (size_t)bitmap->GetWidth() * bitmap->GetHeight() * 4; }
+};
+
+using DecodedImageCache = LruCache<ImageCacheKey, DecodedBitmap, ImageCacheKeyHash>;
+
+// Image deja mise a l'echelle d'une zone client, prete a etre dessinee 1:1
+struct ScaledImage {
+    std::wstring path;
+    std::shared_ptr<Gdiplus::Bitmap> bitmap;
+    // Taille de la zone client pour laquelle `bitmap` a ete calcule
+    SIZE clientSize{ 0, 0 };
+
+    bool Matches(const std::wstring& imagePath, const RECT& clientRect) const {
+        return bitmap && path == imagePath &&
+            clientSize.cx == clientRect.right && clientSize.cy == clientRect.bottom;
+    }
+};
+
+// Cle de cache d'un fichier image : chemin, date de modification et taille
+bool GetImageCacheKey(const std::wstring& path, ImageCacheKey& key);
+
+// Decode l'image pour un affichage dans `clientSize` ({0, 0} : pleine resolution) dans un
+// bitmap 32 bits premultiplie, le format le plus rapide a dessiner. Les formats que
+// ImageDecoder ne connait pas passent par GDI+.
+std::shared_ptr<DecodedBitmap> DecodeImage(const std::wstring& path, SIZE clientSize);
+
+// Image decodee depuis le cache, ou depuis le disque si elle n'y est pas ou si la version
+// en cache a ete reduite pour une fenetre plus petite
+std::shared_ptr<Gdiplus::Bitmap> LoadDecodedImage(DecodedImageCache& cache, const std::wstring& path, SIZE clientSize);
+
+// Miniature EXIF d'une photo JPEG (ExifThumbnail), affichee le temps que l'image complete
+// soit decodee ; nullptr si le fichier n'en contient pas
+std::shared_ptr<Gdiplus::Bitmap> LoadExifPreview(const std::wstring& path);
+
+// Rectangle ou dessiner l'image pour qu'elle tienne entiere dans la zone client, centree
+RECT FitImageRect(UINT imageWidth, UINT imageHeight, const RECT& clientRect);
+
+// Copie de `source` redimensionnee par Resampler (Lanczos-3 par defaut)
+std::shared_ptr<Gdiplus::Bitmap> ScaleBitmap(Gdiplus::Bitmap& source, int width, int height,
+    ResampleFilter filter = ResampleFilter::Lanczos3);
+
+// Version de `source` ajustee a la zone client (FitImageRect puis ScaleBitmap)
+bool ScaleToClient(Gdiplus::Bitmap& source, const std::wstring& path, SIZE clientSize, ScaledImage& out);
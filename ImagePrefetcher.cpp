@@ -0,0 +1,82 @@
+#include "ImagePrefetcher.h"
+
+ImagePrefetcher::ImagePrefetcher(DecodedImageCache& cache, size_t threadCount)
+    : m_cache(cache), m_pool(threadCount) {
+}
+
+ImagePrefetcher::~ImagePrefetcher() {
+    Shutdown();
+}
+
+void ImagePrefetcher::Prepare(Slot& slot) {
+    ImageCacheKey key;
+    if (!GetImageCacheKey(slot.image.path, key) || m_cache.Contains(key)) return;
+
+    // Le bitmap n'est mis en cache qu'une fois la mise a l'echelle terminee : un objet
+    // GDI+ ne doit pas etre utilise par deux threads a la fois
+    std::shared_ptr<DecodedBitmap> decoded = DecodeImage(slot.image.path, slot.image.clientSize);
+    if (!decoded) return;
+
+    ScaleToClient(*decoded->bitmap, slot.image.path, slot.image.clientSize, slot.image);
+    m_cache.Put(key, decoded, decoded->Bytes());
+}
+
+void ImagePrefetcher::Refill(const ImageCatalog& catalog, const std::function<ImageId()>& pick, SIZE clientSize) {
+    while (m_queue.size() < depth) {
+        ImageId id = pick();
+        if (id == InvalidImageId) return;
+
+        auto slot = std::make_shared<Slot>();
+        slot->image.path = catalog.FullPath(id);
+        slot->image.clientSize = clientSize;
+        m_queue.push_back(slot);
+
+        m_pool.Submit([this, slot]() {
+            int expected = Queued;
+            if (!slot->state.compare_exchange_strong(expected, Running)) return;
+            Prepare(*slot);
+            {
+                std::lock_guard<std::mutex> lock(m_doneMutex);
+                slot->state = Done;
+            }
+            m_doneCv.notify_all();
+        });
+    }
+}
+
+bool ImagePrefetcher::Take(ScaledImage& image) {
+    if (m_queue.empty()) return false;
+    std::shared_ptr<Slot> slot = m_queue.front();
+    m_queue.pop_front();
+
+    int expected = Queued;
+    if (slot->state.compare_exchange_strong(expected, Claimed)) {
+        // Le thread de fond ne l'a pas encore pris : le decodage se fera a l'affichage
+        ++m_stats.misses;
+    }
+    else {
+        if (expected == Running) {
+            ++m_stats.late;
+            std::unique_lock<std::mutex> lock(m_doneMutex);
+            m_doneCv.wait(lock, [&slot] { return slot->state.load() == Done; });
+        }
+        else {
+            ++m_stats.hits;
+        }
+    }
+    image = std::move(slot->image);
+    return true;
+}
+
+void ImagePrefetcher::Reset() {
+    for (auto& slot : m_queue) {
+        int expected = Queued;
+        slot->state.compare_exchange_strong(expected, Claimed);
+    }
+    m_queue.clear();
+}
+
+void ImagePrefetcher::Shutdown() {
+    Reset();
+    m_pool.WaitIdle();
+}
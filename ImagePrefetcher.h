@@ -0,0 +1,69 @@
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ImageCatalog.h"
+#include "ImageLoader.h"
+#include "ThreadPool.h"
+
+// Tire les prochaines images aleatoires en avance et les decode sur des threads de fond,
+// pour que la touche R n'ait plus qu'a recuperer un bitmap pret. Les methodes publiques
+// sont reservees au thread UI.
+class ImagePrefetcher {
+public:
+    struct Stats {
+        // Image prete au moment de la demande
+        uint64_t hits = 0;
+        // Image en cours de decodage : on attend la fin
+        uint64_t late = 0;
+        // Decodage pas encore commence, fait directement sur le thread UI
+        uint64_t misses = 0;
+    };
+
+    explicit ImagePrefetcher(DecodedImageCache& cache, size_t threadCount = 2);
+    ~ImagePrefetcher();
+
+    ImagePrefetcher(const ImagePrefetcher&) = delete;
+    ImagePrefetcher& operator=(const ImagePrefetcher&) = delete;
+
+    // Complete la file jusqu'a `depth` images tirees par `pick`
+    void Refill(const ImageCatalog& catalog, const std::function<ImageId()>& pick, SIZE clientSize);
+    // Prochaine image de la file ; false si la file est vide. `image.bitmap` est null si
+    // l'image etait deja en cache ou n'a pas encore ete preparee.
+    bool Take(ScaledImage& image);
+    // Oublie les images en attente (changement de dossier)
+    void Reset();
+    // Attend les decodages en cours ; a appeler avant de liberer le cache et GDI+
+    void Shutdown();
+
+    Stats GetStats() const { return m_stats; }
+
+    // Nombre d'images preparees d'avance (--prefetch=N), 0 pour desactiver
+    size_t depth = 2;
+
+private:
+    enum SlotState : int { Queued, Running, Done, Claimed };
+
+    struct Slot {
+        std::atomic<int> state{ Queued };
+        ScaledImage image;
+    };
+
+    void Prepare(Slot& slot);
+
+    DecodedImageCache& m_cache;
+    ThreadPool m_pool;
+    std::deque<std::shared_ptr<Slot>> m_queue;
+    Stats m_stats;
+
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCv;
+};
@@ -0,0 +1,303 @@
+#include "ImageProbe.h"
+
+#include "PathString.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Taille des lectures : l'entete d'un PNG ou d'un BMP, et en general tous les segments
+    // d'un JPEG jusqu'aux dimensions quand il n'a pas de miniature EXIF
+    constexpr size_t ChunkBytes = 512;
+    // Fichiers sondes par tache du pool
+    constexpr size_t ProbeBatchSize = 256;
+
+    uint16_t ReadLe16(const uint8_t* data) {
+        return (uint16_t)(data[0] | (data[1] << 8));
+    }
+
+    uint32_t ReadLe32(const uint8_t* data) {
+        return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+
+    uint16_t ReadBe16(const uint8_t* data) {
+        return (uint16_t)((data[0] << 8) | data[1]);
+    }
+
+    uint32_t ReadBe32(const uint8_t* data) {
+        return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+    }
+
+    // Lectures a une position donnee, sans projection : une sonde ne lit que quelques
+    // centaines d'octets par fichier
+    class ProbeFile {
+    public:
+        ProbeFile() = default;
+        ~ProbeFile() { Close(); }
+
+        ProbeFile(const ProbeFile&) = delete;
+        ProbeFile& operator=(const ProbeFile&) = delete;
+
+        bool Open(const std::wstring& path) {
+#ifdef _WIN32
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size)) {
+                CloseHandle(file);
+                return false;
+            }
+            m_file = file;
+            m_size = (uint64_t)size.QuadPart;
+#else
+            int fd = open(WideToPath(path).c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                close(fd);
+                return false;
+            }
+            m_fd = fd;
+            m_size = (uint64_t)st.st_size;
+#endif
+            return true;
+        }
+
+        void Close() {
+#ifdef _WIN32
+            if (m_file) CloseHandle(m_file);
+            m_file = nullptr;
+#else
+            if (m_fd >= 0) close(m_fd);
+            m_fd = -1;
+#endif
+        }
+
+        uint64_t Size() const { return m_size; }
+
+        // Lit exactement `size` octets a `offset`
+        bool ReadAt(uint64_t offset, uint8_t* buffer, size_t size) {
+            if (offset > m_size || size > m_size - offset) return false;
+            while (size > 0) {
+#ifdef _WIN32
+                OVERLAPPED position = {};
+                position.Offset = (DWORD)offset;
+                position.OffsetHigh = (DWORD)(offset >> 32);
+                DWORD count = 0;
+                if (!ReadFile(m_file, buffer, (DWORD)size, &count, &position) || count == 0) return false;
+#else
+                ssize_t count = pread(m_fd, buffer, size, (off_t)offset);
+                if (count <= 0) return false;
+#endif
+                buffer += count;
+                offset += (uint64_t)count;
+                size -= (size_t)count;
+            }
+            return true;
+        }
+
+    private:
+#ifdef _WIN32
+        void* m_file = nullptr;
+#else
+        int m_fd = -1;
+#endif
+        uint64_t m_size = 0;
+    };
+
+    // Fenetre de lecture sur le fichier : les segments voisins d'un JPEG sont lus en une fois
+    class ProbeReader {
+    public:
+        explicit ProbeReader(ProbeFile& file) : m_file(file) {}
+
+        // Pointeur sur `size` octets (<= ChunkBytes) a `offset`, nullptr au-dela de la fin
+        const uint8_t* At(uint64_t offset, size_t size) {
+            if (offset < m_start || offset + size > m_start + m_length) {
+                if (offset > m_file.Size() || size > m_file.Size() - offset) return nullptr;
+                m_start = offset;
+                m_length = (size_t)std::min<uint64_t>(ChunkBytes, m_file.Size() - offset);
+                if (!m_file.ReadAt(m_start, m_chunk, m_length)) {
+                    m_length = 0;
+                    return nullptr;
+                }
+            }
+            return m_chunk + (offset - m_start);
+        }
+
+    private:
+        ProbeFile& m_file;
+        uint8_t m_chunk[ChunkBytes];
+        uint64_t m_start = 0;
+        size_t m_length = 0;
+    };
+
+    // Parcourt les segments jusqu'au debut des donnees compressees (SOS) : les dimensions
+    // sont dans le segment SOFn, et un fichier qui s'arrete avant SOS n'a aucun pixel
+    bool ProbeJpeg(ProbeFile& file, ProbeReader& reader, ImageProbe& out) {
+        uint64_t position = 2;
+        bool hasFrame = false;
+        for (int segments = 0; segments < 1024; ++segments) {
+            const uint8_t* marker = reader.At(position, 4);
+            if (!marker || marker[0] != 0xFF) return false;
+            uint8_t type = marker[1];
+            if (type == 0xFF) {
+                // Octet de remplissage avant le marqueur
+                ++position;
+                continue;
+            }
+            if (type == 0x01 || (type >= 0xD0 && type <= 0xD7)) {
+                position += 2;
+                continue;
+            }
+            if (type == 0xD9) return false;
+
+            uint16_t length = ReadBe16(marker + 2);
+            if (length < 2) return false;
+            bool isFrame = type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC;
+            if (isFrame) {
+                const uint8_t* frame = reader.At(position + 4, 6);
+                if (!frame || length < 8) return false;
+                out.height = ReadBe16(frame + 1);
+                out.width = ReadBe16(frame + 3);
+                if (out.width == 0) return false;
+                hasFrame = true;
+            }
+            position += 2 + (uint64_t)length;
+            if (type == 0xDA) return hasFrame && position < file.Size();
+        }
+        return false;
+    }
+
+    // Dimensions du chunk IHDR, et chunk IEND present dans les derniers octets
+    bool ProbePng(ProbeFile& file, ProbeReader& reader, ImageProbe& out) {
+        static const uint8_t ihdr[4] = { 'I', 'H', 'D', 'R' };
+        const uint8_t* header = reader.At(0, 33);
+        if (!header || ReadBe32(header + 8) != 13 || std::memcmp(header + 12, ihdr, 4) != 0) return false;
+        out.width = ReadBe32(header + 16);
+        out.height = ReadBe32(header + 20);
+        if (out.width == 0 || out.height == 0 || out.width > 0x7FFFFFFF || out.height > 0x7FFFFFFF) return false;
+
+        // Quelques octets en trop apres IEND sont toleres
+        uint8_t tail[64];
+        size_t tailLength = (size_t)std::min<uint64_t>(sizeof(tail), file.Size() - 33);
+        if (!file.ReadAt(file.Size() - tailLength, tail, tailLength)) return false;
+        static const uint8_t iend[4] = { 'I', 'E', 'N', 'D' };
+        for (size_t i = tailLength; i >= 8; --i) {
+            if (std::memcmp(tail + i - 8, iend, 4) == 0) return true;
+        }
+        return false;
+    }
+
+    // Entete BITMAPINFOHEADER (ou BITMAPCOREHEADER) ; les pixels non compresses doivent
+    // tenir dans le fichier
+    bool ProbeBmp(ProbeFile& file, ProbeReader& reader, ImageProbe& out) {
+        const uint8_t* header = reader.At(0, 26);
+        if (!header) return false;
+        uint32_t pixelOffset = ReadLe32(header + 10);
+        uint32_t headerSize = ReadLe32(header + 14);
+
+        int64_t width, height;
+        uint32_t bitsPerPixel, compression = 0;
+        if (headerSize == 12) {
+            width = ReadLe16(header + 18);
+            height = ReadLe16(header + 20);
+            bitsPerPixel = ReadLe16(header + 24);
+        }
+        else {
+            header = reader.At(0, 34);
+            if (headerSize < 40 || !header) return false;
+            width = (int32_t)ReadLe32(header + 18);
+            height = (int32_t)ReadLe32(header + 22);
+            bitsPerPixel = ReadLe16(header + 28);
+            compression = ReadLe32(header + 30);
+        }
+        if (height < 0) height = -height;
+        if (width <= 0 || height <= 0 || bitsPerPixel == 0 || bitsPerPixel > 32) return false;
+        if (pixelOffset < 14 + headerSize || pixelOffset >= file.Size()) return false;
+
+        // BI_RGB et BI_BITFIELDS : taille exacte connue ; RLE, JPEG ou PNG : a la charge du decodeur
+        if (compression == 0 || compression == 3) {
+            uint64_t rowBytes = (((uint64_t)width * bitsPerPixel + 31) / 32) * 4;
+            if (rowBytes * (uint64_t)height > file.Size() - pixelOffset) return false;
+        }
+        out.width = (uint32_t)width;
+        out.height = (uint32_t)height;
+        return true;
+    }
+}
+
+bool ProbeImageFile(const std::wstring& path, ImageProbe& out) {
+    out = ImageProbe();
+    ProbeFile file;
+    if (!file.Open(path)) return false;
+
+    ProbeReader reader(file);
+    const uint8_t* magic = reader.At(0, (size_t)std::min<uint64_t>(8, file.Size()));
+    if (!magic) return false;
+    out.format = DetectImageFormat(magic, (size_t)std::min<uint64_t>(8, file.Size()));
+
+    bool valid = false;
+    switch (out.format) {
+    case ImageFormat::Jpeg: valid = ProbeJpeg(file, reader, out); break;
+    case ImageFormat::Png: valid = ProbePng(file, reader, out); break;
+    case ImageFormat::Bmp: valid = ProbeBmp(file, reader, out); break;
+    default: break;
+    }
+    if (!valid) {
+        out.width = 0;
+        out.height = 0;
+    }
+    return valid;
+}
+
+size_t ProbeListings(std::vector<WalkDirectoryInfo>& directories, size_t threadCount,
+    const std::atomic<bool>* cancel, ProbeCounters* counters) {
+    struct Job {
+        uint32_t directory;
+        uint32_t file;
+    };
+    std::vector<Job> jobs;
+    for (uint32_t d = 0; d < (uint32_t)directories.size(); ++d) {
+        const auto& files = directories[d].files;
+        for (uint32_t f = 0; f < (uint32_t)files.size(); ++f) {
+            if (files[f].width == 0 && !files[f].rejected) jobs.push_back(Job{ d, f });
+        }
+    }
+    if (jobs.empty()) return 0;
+
+    // Les lectures attendent le disque : autant de threads que pour le parcours
+    std::atomic<size_t> rejected{ 0 };
+    ThreadPool pool(threadCount ? threadCount : DefaultWalkerThreadCount());
+    size_t batches = (jobs.size() + ProbeBatchSize - 1) / ProbeBatchSize;
+    pool.ParallelFor(batches, [&](size_t batch) {
+        size_t end = std::min(jobs.size(), (batch + 1) * ProbeBatchSize);
+        for (size_t i = batch * ProbeBatchSize; i < end; ++i) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) return;
+            WalkDirectoryInfo& directory = directories[jobs[i].directory];
+            WalkFileInfo& file = directory.files[jobs[i].file];
+            ImageProbe probe;
+            if (ProbeImageFile(JoinPath(directory.path, file.name), probe)) {
+                file.width = probe.width;
+                file.height = probe.height;
+            }
+            else {
+                file.rejected = true;
+                ++rejected;
+                if (counters) ++counters->rejected;
+            }
+            if (counters) ++counters->probed;
+        }
+    });
+    if (cancel && cancel->load()) return 0;
+    return rejected.load();
+}
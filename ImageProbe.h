@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DirectoryWalker.h"
+#include "ImageDecoder.h"
+
+// Verification rapide d'un fichier image sans le decoder : seuls l'entete et la fin du
+// fichier sont lus (quelques centaines d'octets, un peu plus pour un JPEG dont les
+// segments EXIF precedent les dimensions). Le format vient des premiers octets et non de
+// l'extension ; un fichier tronque avant les pixels est refuse.
+struct ImageProbe {
+    ImageFormat format = ImageFormat::Unknown;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// false si le fichier est illisible, n'est pas une image reconnue ou est tronque
+bool ProbeImageFile(const std::wstring& path, ImageProbe& out);
+
+struct ProbeCounters {
+    std::atomic<size_t> probed{ 0 };
+    std::atomic<size_t> rejected{ 0 };
+};
+
+// Sonde en parallele, par lots, les fichiers des listings qui n'ont pas encore de
+// dimensions (ceux repris d'un index les ont deja) et marque les fichiers refuses
+// (WalkFileInfo::rejected) sans les retirer : l'index les garde pour ne pas les ressonder.
+// Retourne le nombre de fichiers refuses.
+size_t ProbeListings(std::vector<WalkDirectoryInfo>& directories, size_t threadCount,
+    const std::atomic<bool>* cancel = nullptr, ProbeCounters* counters = nullptr);
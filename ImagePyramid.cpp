@@ -0,0 +1,231 @@
+#include "ImagePyramid.h"
+
+#include "ImageProbe.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+size_t TileKeyHash::operator()(const TileKey& key) const {
+    uint64_t hash = key.image * 0x9E3779B97F4A7C15ull;
+    hash ^= ((uint64_t)(uint32_t)key.level << 48) ^ ((uint64_t)(uint32_t)key.y << 24) ^ (uint64_t)(uint32_t)key.x;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    return (size_t)(hash ^ (hash >> 27));
+}
+
+bool ImagePyramid::Open(const std::wstring& path) {
+    static std::atomic<uint64_t> nextId{ 1 };
+
+    ImageProbe probe;
+    if (!ProbeImageFile(path, probe) || probe.width == 0 || probe.height == 0 ||
+        probe.width > INT32_MAX || probe.height > INT32_MAX) {
+        return false;
+    }
+    // Projection meme sur un partage : seules les pages des zones decodees sont lues
+    if (!m_file.Open(path, FileReadMode::Map)) return false;
+
+    m_path = path;
+    m_id = nextId++;
+    m_width = (int)probe.width;
+    m_height = (int)probe.height;
+    m_levelCount = 1;
+    while (LevelWidth(m_levelCount - 1) > TileSize || LevelHeight(m_levelCount - 1) > TileSize) ++m_levelCount;
+    return true;
+}
+
+int ImagePyramid::LevelWidth(int level) const {
+    return (int)(((int64_t)m_width + ((int64_t)1 << level) - 1) >> level);
+}
+
+int ImagePyramid::LevelHeight(int level) const {
+    return (int)(((int64_t)m_height + ((int64_t)1 << level) - 1) >> level);
+}
+
+int ImagePyramid::LevelForScale(double scale) const {
+    if (scale <= 0.0 || scale >= 1.0) return 0;
+    int level = (int)std::floor(std::log2(1.0 / scale));
+    return std::min(std::max(level, 0), m_levelCount - 1);
+}
+
+bool ImagePyramid::DecodeTiles(int level, int left, int top, int right, int bottom,
+    const std::function<void(const TileKey&, std::shared_ptr<DecodedImage>)>& onTile) const {
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+    right = std::min(right, TileColumns(level));
+    bottom = std::min(bottom, TileRows(level));
+    if (!m_file.IsOpen() || right <= left || bottom <= top) return false;
+
+    ImageRegion region{ left * TileSize, top * TileSize, (right - left) * TileSize, (bottom - top) * TileSize };
+    DecodedImage band;
+    if (!DecodeImageMemory(m_file.Data(), m_file.Size(), DecodeRequest::Region(level, region), band)) return false;
+
+    for (int y = top; y < bottom; ++y) {
+        for (int x = left; x < right; ++x) {
+            int offsetX = (x - left) * TileSize, offsetY = (y - top) * TileSize;
+            int width = std::min(TileSize, band.width - offsetX);
+            int height = std::min(TileSize, band.height - offsetY);
+            if (width <= 0 || height <= 0) continue;
+
+            auto tile = std::make_shared<DecodedImage>();
+            tile->Allocate(width, height);
+            tile->sourceWidth = m_width;
+            tile->sourceHeight = m_height;
+            tile->reduction = 1 << level;
+            for (int row = 0; row < height; ++row) {
+                std::memcpy(tile->Row(row), band.Row(offsetY + row) + (ptrdiff_t)offsetX * 4, (size_t)width * 4);
+            }
+            onTile(TileKey{ m_id, level, x, y }, std::move(tile));
+        }
+    }
+    return true;
+}
+
+TileLoader::~TileLoader() {
+    Cancel();
+}
+
+void TileLoader::Start(TileCache& cache, NotifyFn notify) {
+    Cancel();
+    m_cache = &cache;
+    m_notify = std::move(notify);
+    m_notifyPending = false;
+    m_ready = false;
+    m_pending = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = false;
+        m_view = TileView();
+    }
+    m_thread = std::thread(&TileLoader::Run, this);
+}
+
+void TileLoader::Cancel() {
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_view = TileView();
+        // Interrompt aussi le chargement en cours (LoadRect)
+        m_pending = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+}
+
+void TileLoader::Request(TileView view) {
+    {
+        // m_pending sous le verrou : sinon le reveil peut tomber entre le test de Run ou de
+        // WaitIdle et leur attente
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_view = std::move(view);
+        m_pending = true;
+    }
+    m_changed.notify_all();
+}
+
+bool TileLoader::TakeReady() {
+    m_notifyPending = false;
+    return m_ready.exchange(false);
+}
+
+TileLoader::Stats TileLoader::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void TileLoader::WaitIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this]() { return m_stop || (!m_pending && !m_busy); });
+}
+
+void TileLoader::Run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_changed.wait(lock, [this]() { return m_stop || m_pending; });
+        if (m_stop) break;
+        TileView view = m_view;
+        m_pending = false;
+        m_busy = true;
+        lock.unlock();
+
+        if (view.pyramid) Load(view);
+
+        lock.lock();
+        m_busy = false;
+        m_changed.notify_all();
+    }
+}
+
+void TileLoader::Load(const TileView& view) {
+    // Les tuiles visibles d'abord
+    if (!LoadRect(view, view.left, view.top, view.right, view.bottom, false)) return;
+
+    int reach = std::max(0, prefetchTiles);
+    if (reach == 0) return;
+    if (view.panX == 0 && view.panY == 0) {
+        LoadRect(view, view.left - reach, view.top - reach, view.right + reach, view.bottom + reach, true);
+        return;
+    }
+    if (view.panX > 0 && !LoadRect(view, view.right, view.top, view.right + reach, view.bottom, true)) return;
+    if (view.panX < 0 && !LoadRect(view, view.left - reach, view.top, view.left, view.bottom, true)) return;
+    if (view.panY > 0) LoadRect(view, view.left, view.bottom, view.right, view.bottom + reach, true);
+    if (view.panY < 0) LoadRect(view, view.left, view.top - reach, view.right, view.top, true);
+}
+
+bool TileLoader::LoadRect(const TileView& view, int left, int top, int right, int bottom, bool prefetch) {
+    const ImagePyramid& pyramid = *view.pyramid;
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+    right = std::min(right, pyramid.TileColumns(view.level));
+    bottom = std::min(bottom, pyramid.TileRows(view.level));
+
+    // Lignes de tuiles consecutives qui ont des tuiles manquantes, regroupees en passes
+    int y = top;
+    while (y < bottom) {
+        if (m_pending) return false;
+
+        int passLeft = INT32_MAX, passRight = -1, passTop = y;
+        for (; y < bottom; ++y) {
+            int rowLeft = INT32_MAX, rowRight = -1;
+            for (int x = left; x < right; ++x) {
+                if (m_cache->Contains(TileKey{ pyramid.Id(), view.level, x, y })) continue;
+                rowLeft = std::min(rowLeft, x);
+                rowRight = std::max(rowRight, x);
+            }
+            if (rowRight < 0) {
+                if (passRight >= 0) break;
+                passTop = y + 1;
+                continue;
+            }
+            int newLeft = std::min(passLeft, rowLeft), newRight = std::max(passRight, rowRight);
+            if (passRight >= 0 && (newRight - newLeft + 1) * (y - passTop + 1) > maxPassTiles) break;
+            passLeft = newLeft;
+            passRight = newRight;
+        }
+        if (passRight < 0) break;
+
+        auto start = std::chrono::steady_clock::now();
+        size_t added = 0;
+        pyramid.DecodeTiles(view.level, passLeft, passTop, passRight + 1, y,
+            [&](const TileKey& key, std::shared_ptr<DecodedImage> tile) {
+                if (m_cache->Contains(key)) return;
+                size_t bytes = tile->pixels.size();
+                m_cache->Put(key, std::move(tile), bytes);
+                ++added;
+            });
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.tiles += added;
+            if (prefetch) m_stats.prefetched += added;
+            ++m_stats.passes;
+            m_stats.decodeMs += ms;
+        }
+
+        m_ready = true;
+        if (!m_notifyPending.exchange(true) && m_notify) m_notify();
+    }
+    return !m_pending;
+}
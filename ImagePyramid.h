@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "FileReader.h"
+#include "ImageDecoder.h"
+#include "LruCache.h"
+
+// Tuile d'un niveau de la pyramide ; `image` distingue les images ouvertes (ImagePyramid::Id)
+struct TileKey {
+    uint64_t image = 0;
+    int level = 0;
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const TileKey& other) const {
+        return image == other.image && level == other.level && x == other.x && y == other.y;
+    }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& key) const;
+};
+
+// Tuiles decodees, BGRA premultiplie, limitees en octets
+using TileCache = LruCache<TileKey, DecodedImage, TileKeyHash>;
+
+// Pyramide de tuiles d'une grande image, pour le zoom et le deplacement. Le niveau L est
+// l'image reduite de 2^L, decoupee en tuiles de TileSize x TileSize ; le dernier niveau
+// tient dans une tuile. Rien n'est calcule d'avance : les tuiles sont decodees a la demande,
+// par zones (DecodeRequest::Region), et la memoire depend de la taille des zones, jamais de
+// celle de l'image. Le fichier reste projete tant que la pyramide existe.
+class ImagePyramid {
+public:
+    static constexpr int TileSize = 256;
+
+    bool Open(const std::wstring& path);
+
+    const std::wstring& Path() const { return m_path; }
+    // Different a chaque Open, pour les cles du cache
+    uint64_t Id() const { return m_id; }
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+
+    int LevelCount() const { return m_levelCount; }
+    int LevelWidth(int level) const;
+    int LevelHeight(int level) const;
+    int TileColumns(int level) const { return (LevelWidth(level) + TileSize - 1) / TileSize; }
+    int TileRows(int level) const { return (LevelHeight(level) + TileSize - 1) / TileSize; }
+
+    // Niveau a decoder pour un affichage a `scale` pixels d'ecran par pixel de l'image : le
+    // plus reduit qui garde au moins un pixel par pixel d'ecran
+    int LevelForScale(double scale) const;
+
+    // Decode en une passe les tuiles [left, right) x [top, bottom) du niveau et les donne
+    // une par une a `onTile`. Appelable depuis plusieurs threads.
+    bool DecodeTiles(int level, int left, int top, int right, int bottom,
+        const std::function<void(const TileKey&, std::shared_ptr<DecodedImage>)>& onTile) const;
+
+private:
+    FileData m_file;
+    std::wstring m_path;
+    uint64_t m_id = 0;
+    int m_width = 0;
+    int m_height = 0;
+    int m_levelCount = 0;
+};
+
+// Tuiles voulues par la vue : [left, right) x [top, bottom) d'un niveau, et le sens du
+// dernier deplacement (-1, 0 ou 1 par axe)
+struct TileView {
+    std::shared_ptr<const ImagePyramid> pyramid;
+    int level = 0;
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+    int panX = 0;
+    int panY = 0;
+};
+
+// Decodage des tuiles sur un thread de fond. Le thread UI donne a chaque dessin les tuiles
+// visibles (Request remplace la vue precedente) ; les tuiles manquantes sont decodees par
+// passes de lignes de tuiles, puis prefetchTiles tuiles plus loin dans le sens du
+// deplacement (tout autour sans deplacement). Le thread appelle `notify` apres chaque
+// passe et le thread UI redessine apres TakeReady.
+class TileLoader {
+public:
+    using NotifyFn = std::function<void()>;
+
+    struct Stats {
+        size_t tiles = 0;
+        size_t prefetched = 0;
+        size_t passes = 0;
+        double decodeMs = 0;
+    };
+
+    TileLoader() = default;
+    ~TileLoader();
+
+    TileLoader(const TileLoader&) = delete;
+    TileLoader& operator=(const TileLoader&) = delete;
+
+    void Start(TileCache& cache, NotifyFn notify);
+    // Attend la fin de la passe en cours
+    void Cancel();
+
+    void Request(TileView view);
+    // true si des tuiles ont ete ajoutees au cache depuis le dernier appel
+    bool TakeReady();
+    Stats GetStats() const;
+    // Attend que la derniere vue et son prefetch soient decodes (benchmark)
+    void WaitIdle();
+
+    int prefetchTiles = 1;
+    // Tuiles au plus par passe : borne la memoire d'une passe (256 Ko par tuile)
+    int maxPassTiles = 32;
+
+private:
+    void Run();
+    void Load(const TileView& view);
+    // false si une nouvelle vue est arrivee entre-temps
+    bool LoadRect(const TileView& view, int left, int top, int right, int bottom, bool prefetch);
+
+    TileCache* m_cache = nullptr;
+    NotifyFn m_notify;
+    std::thread m_thread;
+    std::atomic<bool> m_notifyPending{ false };
+    std::atomic<bool> m_ready{ false };
+    // Nouvelle vue pas encore prise par le thread
+    std::atomic<bool> m_pending{ false };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    TileView m_view;
+    bool m_busy = false;
+    bool m_stop = false;
+    Stats m_stats;
+};
@@ -0,0 +1,340 @@
+#include "ImageScanner.h"
+#include "LibraryIndex.h"
+#include "PathString.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <memory>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static void LogScanMessage(const std::wstring& message) {
+#ifdef _WIN32
+    OutputDebugStringW(message.c_str());
+#else
+    (void)message;
+#endif
+}
+
+bool IsImageExtension(std::wstring ext) {
+    std::transform(ext.begin(), ext.end(), ext.begin(), towlower);
+    return ext == L".jpg" || ext == L".jpeg" || ext == L".png" || ext == L".bmp";
+}
+
+bool IsImagePath(const fs::path& path) {
+    return IsImageExtension(PathToWide(path.extension()));
+}
+
+void ScanDirectoryRecursive(const std::wstring& directory, std::vector<std::wstring>& images) {
+    WalkCounters counters;
+    std::vector<std::wstring> found = WalkDirectoryTree(directory, WalkOptions(), &counters);
+    images.insert(images.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+    if (counters.errors > 0) {
+        std::wstringstream ss;
+        ss << L"Scan : " << counters.errors << L" dossier(s) ou fichier(s) illisible(s) ignore(s)\n";
+        LogScanMessage(ss.str());
+    }
+}
+
+ImageCatalog GetImageFiles(const std::wstring& folder) {
+    WalkOptions options;
+    options.collectDetails = true;
+    options.collectPaths = false;
+    WalkResult result = WalkDirectoryTreeDetailed(folder, options);
+    return BuildCatalog(result.directories);
+}
+
+ImageScanner::~ImageScanner() {
+    Cancel();
+}
+
+void ImageScanner::Start(const std::wstring& folder, NotifyFn notify) {
+    Start(std::vector<std::wstring>{ folder }, std::move(notify));
+}
+
+void ImageScanner::Start(std::vector<std::wstring> roots, NotifyFn notify) {
+    Cancel();
+
+    m_cancel = false;
+    m_counters.directories = 0;
+    m_counters.entries = 0;
+    m_counters.files = 0;
+    m_counters.errors = 0;
+    m_probeCounters.probed = 0;
+    m_probeCounters.rejected = 0;
+    m_notifyPending = false;
+    m_notify = std::move(notify);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.clear();
+        m_catalog.Clear();
+        m_catalogReady = false;
+        m_cancelled = false;
+        m_lastNotify = std::chrono::steady_clock::now();
+    }
+    m_running = true;
+    m_thread = std::thread(&ImageScanner::Run, this, std::move(roots));
+}
+
+void ImageScanner::Cancel() {
+    bool wasRunning = m_running.load();
+    if (m_thread.joinable()) {
+        m_cancel = true;
+        m_thread.join();
+    }
+    m_running = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_catalog.Clear();
+    m_catalogReady = false;
+    if (wasRunning) m_cancelled = true;
+}
+
+ScanProgress ImageScanner::GetProgress() const {
+    ScanProgress progress;
+    progress.filesFound = m_counters.files.load();
+    progress.entriesVisited = m_counters.entries.load();
+    progress.filesProbed = m_probeCounters.probed.load();
+    progress.filesRejected = m_probeCounters.rejected.load();
+    progress.running = m_running.load();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    progress.cancelled = m_cancelled;
+    return progress;
+}
+
+bool ImageScanner::TakeBatch(std::vector<std::wstring>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notifyPending = false;
+    if (m_pending.empty()) return false;
+    out.insert(out.end(),
+        std::make_move_iterator(m_pending.begin()),
+        std::make_move_iterator(m_pending.end()));
+    m_pending.clear();
+    return true;
+}
+
+bool ImageScanner::TakeCatalog(ImageCatalog& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_catalogReady) return false;
+    out = std::move(m_catalog);
+    m_catalog.Clear();
+    m_catalogReady = false;
+    return true;
+}
+
+void ImageScanner::Publish(std::vector<std::wstring>&& batch, bool force) {
+    bool shouldNotify = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pending.empty()) {
+            m_pending = std::move(batch);
+        }
+        else {
+            m_pending.insert(m_pending.end(),
+                std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (force || now - m_lastNotify >= notifyInterval) {
+            m_lastNotify = now;
+            shouldNotify = !m_notifyPending.exchange(true);
+        }
+    }
+    if (shouldNotify && m_notify) m_notify();
+}
+
+// Separe les racines en dossiers a parcourir et fichiers isoles, ranges par dossier comme
+// les listings du parcours. Les racines deja couvertes par un dossier sont ecartees ; une
+// racine illisible reste un dossier, le parcours la compte en erreur.
+static void SplitRoots(const std::vector<std::wstring>& roots, std::vector<std::wstring>& folders,
+    std::vector<WalkDirectoryInfo>& loose, std::vector<std::wstring>& loosePaths) {
+    std::vector<std::wstring> files;
+    for (const std::wstring& root : roots) {
+        std::error_code ec;
+        fs::path path = WideToPath(root);
+        if (!fs::is_regular_file(path, ec)) folders.push_back(root);
+        else if (IsImagePath(path)) files.push_back(root);
+    }
+
+    // Peu de dossiers deposes en general : comparaison de chaque racine a tous les dossiers
+    auto inside = [](const std::wstring& path, const std::wstring& folder) {
+        return path.size() > folder.size() && path.compare(0, folder.size(), folder) == 0 &&
+            (IsPathSeparator(path[folder.size()]) || IsPathSeparator(folder.back()));
+    };
+    auto covered = [&inside](const std::wstring& path, const std::vector<std::wstring>& folders) {
+        return std::any_of(folders.begin(), folders.end(), [&](const std::wstring& folder) { return inside(path, folder); });
+    };
+    std::sort(folders.begin(), folders.end());
+    folders.erase(std::unique(folders.begin(), folders.end()), folders.end());
+    std::vector<std::wstring> outer;
+    for (const std::wstring& folder : folders) {
+        if (!covered(folder, folders)) outer.push_back(folder);
+    }
+    folders = std::move(outer);
+
+    // Fichiers d'un meme dossier a la suite ; un dossier peut revenir apres un sous-dossier,
+    // le catalogue fusionne ses listings
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    for (std::wstring& file : files) {
+        if (covered(file, folders)) continue;
+
+        size_t separator = FindLastSeparator(file);
+        std::wstring directory = separator == std::wstring::npos ? std::wstring() : file.substr(0, separator);
+        if (loose.empty() || loose.back().path != directory) {
+            WalkDirectoryInfo listing;
+            listing.path = directory;
+            loose.push_back(std::move(listing));
+        }
+        // Memes unites que le parcours (ticks de fs::file_time_type)
+        WalkFileInfo info;
+        info.name = file.substr(separator + 1);
+        std::error_code ec;
+        fs::path path = WideToPath(file);
+        info.size = fs::file_size(path, ec);
+        if (ec) info.size = 0;
+        info.mtime = (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+        if (ec) info.mtime = 0;
+        loose.back().files.push_back(std::move(info));
+        loosePaths.push_back(std::move(file));
+    }
+}
+
+void ImageScanner::Run(std::vector<std::wstring> roots) {
+    std::vector<std::wstring> folders;
+    std::vector<WalkDirectoryInfo> loose;
+    std::vector<std::wstring> loosePaths;
+    SplitRoots(roots, folders, loose, loosePaths);
+    if (probeImages && !loose.empty()) {
+        // Les fichiers donnes un par un sont sondes avant d'etre publies, comme ceux des
+        // lots du parcours ; loosePaths suit l'ordre des listings
+        ProbeListings(loose, threadCount, &m_cancel, &m_probeCounters);
+        if (m_cancel) return;
+        size_t next = 0;
+        size_t kept = 0;
+        for (const auto& listing : loose) {
+            for (const auto& file : listing.files) {
+                if (!file.rejected) loosePaths[kept++] = std::move(loosePaths[next]);
+                ++next;
+            }
+        }
+        loosePaths.resize(kept);
+    }
+    m_counters.files += loosePaths.size();
+    if (!loosePaths.empty()) Publish(std::move(loosePaths), true);
+
+    WalkOptions options;
+    options.threadCount = threadCount;
+    options.batchSize = batchSize;
+    options.cancel = &m_cancel;
+    options.collectDetails = true;
+    options.collectPaths = false;
+
+    // L'index decrit un seul dossier racine
+    bool indexed = useLibraryIndex && folders.size() == 1 && loose.empty();
+    std::wstring indexPath;
+    LibraryIndex previous;
+    std::unique_ptr<LibraryIndexReuse> reuse;
+    if (indexed) {
+        indexPath = LibraryIndexPath(folders[0]);
+        if (previous.Open(indexPath, folders[0])) {
+            // Le contenu connu est publie tout de suite, le parcours ne fait que le mettre a jour
+            ImageCatalog known;
+            LoadCatalogFromIndex(previous, known);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_catalog = std::move(known);
+                m_catalogReady = true;
+            }
+            Publish({}, true);
+            reuse = std::make_unique<LibraryIndexReuse>(previous);
+            options.reuseDirectory = [&reuse](WalkDirectoryInfo& info, std::vector<std::wstring>& subdirectories) {
+                return reuse->Reuse(info, subdirectories);
+            };
+        }
+    }
+    if (probeImages) {
+        // Sonde pendant le parcours, avant que le fichier n'entre dans un lot publie
+        options.inspectFile = [this](const std::wstring& path, WalkFileInfo& file) {
+            ImageProbe probe;
+            bool valid = ProbeImageFile(path, probe);
+            if (valid) {
+                file.width = probe.width;
+                file.height = probe.height;
+            }
+            else {
+                ++m_probeCounters.rejected;
+            }
+            ++m_probeCounters.probed;
+            return valid;
+        };
+    }
+    if (!reuse) {
+        options.onBatch = [this](std::vector<std::wstring>&& batch) {
+            Publish(std::move(batch), false);
+        };
+    }
+
+    WalkResult result;
+    {
+        TraceSpan span(TraceStage::Scan);
+        for (const std::wstring& folder : folders) {
+            WalkResult walked = WalkDirectoryTreeDetailed(folder, options, &m_counters);
+            if (result.directories.empty()) {
+                result.directories = std::move(walked.directories);
+            }
+            else {
+                result.directories.insert(result.directories.end(), std::make_move_iterator(walked.directories.begin()),
+                    std::make_move_iterator(walked.directories.end()));
+            }
+            if (m_cancel) break;
+        }
+    }
+    reuse.reset();
+    previous.Close();
+    if (m_cancel) return;
+    result.directories.insert(result.directories.end(), std::make_move_iterator(loose.begin()),
+        std::make_move_iterator(loose.end()));
+
+    if (m_counters.errors > 0) {
+        std::wstringstream ss;
+        ss << L"Scan : " << m_counters.errors << L" dossier(s) ou fichier(s) illisible(s) ignore(s)\n";
+        LogScanMessage(ss.str());
+    }
+    if (probeImages) {
+        // Les fichiers sont deja sondes pendant le parcours ; il ne reste que ceux d'un
+        // index sans dimensions. Les fichiers refuses vont dans l'index avec leur taille et
+        // leur date : ils ne sont ressondes que s'ils changent
+        {
+            TraceSpan span(TraceStage::Probe);
+            ProbeListings(result.directories, threadCount, &m_cancel, &m_probeCounters);
+        }
+        if (m_cancel) return;
+        size_t rejected = m_probeCounters.rejected.load();
+        if (rejected > 0) {
+            std::wstringstream ss;
+            ss << L"Scan : " << rejected << L" fichier(s) tronque(s) ou qui ne sont pas des images ignore(s)\n";
+            LogScanMessage(ss.str());
+        }
+    }
+    if (indexed && !SaveLibraryIndex(indexPath, folders[0], result.directories)) {
+        LogScanMessage(L"Scan : impossible d'ecrire l'index " + indexPath + L"\n");
+    }
+
+    // Le catalogue est construit ici pour ne pas bloquer le thread UI
+    ImageCatalog catalog = BuildCatalog(result.directories);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_catalog = std::move(catalog);
+        m_catalogReady = true;
+    }
+    m_running = false;
+    Publish({}, true);
+}
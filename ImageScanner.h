@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DirectoryWalker.h"
+#include "ImageCatalog.h"
+#include "ImageProbe.h"
+
+// Extensions d'image reconnues (.jpg, .jpeg, .png, .bmp), sans tenir compte de la casse
+bool IsImageExtension(std::wstring ext);
+bool IsImagePath(const std::filesystem::path& path);
+
+void ScanDirectoryRecursive(const std::wstring& directory, std::vector<std::wstring>& images);
+ImageCatalog GetImageFiles(const std::wstring& folder);
+
+// Etat d'avancement d'un scan en arriere-plan
+struct ScanProgress {
+    size_t filesFound = 0;
+    size_t entriesVisited = 0;
+    // Sonde des entetes pendant le parcours (ImageScanner::probeImages)
+    size_t filesProbed = 0;
+    size_t filesRejected = 0;
+    bool running = false;
+    bool cancelled = false;
+};
+
+// Scan d'un dossier en arriere-plan (WalkDirectoryTree). Les fichiers trouves sont
+// publies par lots : les threads de scan appellent `notify` et le thread UI recupere
+// les lots avec TakeBatch, puis le catalogue complet avec TakeCatalog. Le scan peut aussi
+// porter sur plusieurs racines, dossiers et fichiers isoles (depot de fichiers).
+class ImageScanner {
+public:
+    using NotifyFn = std::function<void()>;
+
+    ImageScanner() = default;
+    ~ImageScanner();
+
+    ImageScanner(const ImageScanner&) = delete;
+    ImageScanner& operator=(const ImageScanner&) = delete;
+
+    // Annule le scan precedent s'il y en a un puis demarre un nouveau scan
+    void Start(const std::wstring& folder, NotifyFn notify);
+    // Dossiers parcourus et fichiers d'image pris tels quels. Une racine contenue dans un
+    // dossier de la liste n'est lue qu'une fois ; l'index n'est utilise que pour un seul
+    // dossier.
+    void Start(std::vector<std::wstring> roots, NotifyFn notify);
+    void Cancel();
+
+    bool IsRunning() const { return m_running.load(); }
+    ScanProgress GetProgress() const;
+
+    // Ajoute a `out` les fichiers publies depuis le dernier appel
+    bool TakeBatch(std::vector<std::wstring>& out);
+    // Catalogue complet : celui de l'index au demarrage s'il existe, puis celui du scan
+    // termine. Chacun n'est disponible qu'une fois.
+    bool TakeCatalog(ImageCatalog& out);
+
+    size_t batchSize = 512;
+    // 0 : DefaultWalkerThreadCount
+    size_t threadCount = 0;
+    // Reprend l'index sur disque du dossier (LibraryIndex) : le catalogue connu est publie
+    // des le depart et seuls les dossiers modifies sont relus, puis l'index est reecrit
+    bool useLibraryIndex = true;
+    // Lit l'entete de chaque nouveau fichier avant de le publier : les dimensions vont dans
+    // le catalogue et les fichiers qui ne sont pas des images valides sont ecartes (gardes
+    // dans l'index pour n'etre relus que s'ils changent)
+    bool probeImages = true;
+    std::chrono::milliseconds notifyInterval{ 100 };
+
+private:
+    void Run(std::vector<std::wstring> roots);
+    void Publish(std::vector<std::wstring>&& batch, bool force);
+
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{ false };
+    std::atomic<bool> m_running{ false };
+    std::atomic<bool> m_notifyPending{ false };
+    WalkCounters m_counters;
+    ProbeCounters m_probeCounters;
+    NotifyFn m_notify;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::wstring> m_pending;
+    ImageCatalog m_catalog;
+    bool m_catalogReady = false;
+    bool m_cancelled = false;
+    std::chrono::steady_clock::time_point m_lastNotify;
+};
@@ -0,0 +1,401 @@
+#include "ImageServer.h"
+
+#include "ImageDecoder.h"
+#include "PathString.h"
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+namespace {
+    // Au-dela, la requete est refusee : aucune requete valide de ce serveur n'en approche
+    constexpr size_t MaxRequestBytes = 8192;
+    // Plus grand cote d'une image reduite (limite de libjpeg, JPEG_MAX_DIMENSION) : la
+    // largeur et la hauteur tiennent sur 16 bits dans la cle du cache
+    constexpr int MaxScaledDimension = 65500;
+
+    const char* StatusText(int status) {
+        switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        }
+        return "Error";
+    }
+
+    std::string ResponseHead(int status, const char* contentType, bool keepAlive) {
+        std::string head = "HTTP/1.1 " + std::to_string(status) + " " + StatusText(status) + "\r\n";
+        head += "Server: RandomPictureServer\r\nContent-Type: ";
+        head += contentType;
+        head += "\r\nCache-Control: no-store\r\nConnection: ";
+        head += keepAlive ? "keep-alive\r\n" : "close\r\n";
+        return head;
+    }
+
+    const char* ContentTypeOf(std::wstring_view name) {
+        size_t dot = name.rfind(L'.');
+        std::string extension;
+        if (dot != std::wstring_view::npos) {
+            for (wchar_t c : name.substr(dot + 1)) extension += (char)std::tolower(c < 128 ? (int)c : '?');
+        }
+        if (extension == "png") return "image/png";
+        if (extension == "bmp") return "image/bmp";
+        return "image/jpeg";
+    }
+
+    // Nom de fichier UTF-8 encode en %XX, utilisable tel quel dans un en-tete
+    std::string EncodeHeaderValue(std::wstring_view name) {
+        static const char hex[] = "0123456789ABCDEF";
+        std::string out;
+        for (unsigned char c : WideToUtf8(std::wstring(name))) {
+            if (std::isalnum(c) || c == '.' || c == '-' || c == '_' || c == '~') {
+                out += (char)c;
+            }
+            else {
+                out += '%';
+                out += hex[c >> 4];
+                out += hex[c & 15];
+            }
+        }
+        return out;
+    }
+
+    bool EqualsIgnoreCase(const char* a, size_t length, const char* b) {
+        if (std::strlen(b) != length) return false;
+        for (size_t i = 0; i < length; ++i) {
+            if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+        }
+        return true;
+    }
+
+    int QueryInt(const std::string& query, const char* name) {
+        size_t length = std::strlen(name);
+        size_t position = 0;
+        while (position < query.size()) {
+            size_t end = query.find('&', position);
+            if (end == std::string::npos) end = query.size();
+            if (end - position > length && query.compare(position, length, name) == 0 && query[position + length] == '=') {
+                return std::max(0, std::atoi(query.c_str() + position + length + 1));
+            }
+            position = end + 1;
+        }
+        return 0;
+    }
+
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+    struct JpegErrorManager {
+        jpeg_error_mgr base;
+        jmp_buf jump;
+    };
+
+    void OnJpegError(j_common_ptr info) {
+        longjmp(((JpegErrorManager*)info->err)->jump, 1);
+    }
+
+    void OnJpegMessage(j_common_ptr) {
+    }
+
+    // Le gestionnaire d'erreurs par defaut de libjpeg termine le processus : une erreur
+    // d'encodage (memoire, dimensions) fait echouer la requete seulement
+    bool EncodeJpeg(const DecodedImage& image, int quality, std::vector<uint8_t>& out) {
+        jpeg_compress_struct info;
+        JpegErrorManager error;
+        info.err = jpeg_std_error(&error.base);
+        error.base.error_exit = OnJpegError;
+        error.base.output_message = OnJpegMessage;
+
+        // Declares avant setjmp : aucun destructeur n'est saute par longjmp
+        unsigned char* buffer = nullptr;
+        unsigned long size = 0;
+        std::vector<uint8_t> row((size_t)image.width * 3);
+        if (setjmp(error.jump)) {
+            jpeg_destroy_compress(&info);
+            std::free(buffer);
+            return false;
+        }
+
+        jpeg_create_compress(&info);
+        jpeg_mem_dest(&info, &buffer, &size);
+        info.image_width = (JDIMENSION)image.width;
+        info.image_height = (JDIMENSION)image.height;
+        info.input_components = 3;
+        info.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&info);
+        jpeg_set_quality(&info, quality, TRUE);
+        jpeg_start_compress(&info, TRUE);
+
+        // BGRA premultiplie : les valeurs sont deja celles de l'image posee sur du noir
+        while (info.next_scanline < info.image_height) {
+            const uint8_t* source = image.pixels.data() + (ptrdiff_t)info.next_scanline * image.stride;
+            for (int x = 0; x < image.width; ++x) {
+                row[x * 3 + 0] = source[x * 4 + 2];
+                row[x * 3 + 1] = source[x * 4 + 1];
+                row[x * 3 + 2] = source[x * 4 + 0];
+            }
+            JSAMPROW rowPointer = row.data();
+            jpeg_write_scanlines(&info, &rowPointer, 1);
+        }
+        jpeg_finish_compress(&info);
+        jpeg_destroy_compress(&info);
+        out.assign(buffer, buffer + size);
+        std::free(buffer);
+        return true;
+    }
+
+#else
+    // BMP 32 bits de haut en bas, sans compression : quand libjpeg n'est pas disponible
+    void EncodeBmp(const DecodedImage& image, std::vector<uint8_t>& out) {
+        uint32_t imageBytes = (uint32_t)image.width * 4 * (uint32_t)image.height;
+        out.assign(54 + (size_t)imageBytes, 0);
+        auto put32 = [&out](size_t offset, uint32_t value) { std::memcpy(out.data() + offset, &value, 4); };
+        out[0] = 'B';
+        out[1] = 'M';
+        put32(2, 54 + imageBytes);
+        put32(10, 54);
+        put32(14, 40);
+        put32(18, (uint32_t)image.width);
+        put32(22, (uint32_t)-image.height);
+        out[26] = 1;
+        out[28] = 32;
+        put32(34, imageBytes);
+        for (int y = 0; y < image.height; ++y) {
+            std::memcpy(out.data() + 54 + (size_t)y * image.width * 4,
+                image.pixels.data() + (ptrdiff_t)y * image.stride, (size_t)image.width * 4);
+        }
+    }
+#endif
+}
+
+size_t ParseHttpRequest(const char* data, size_t size, HttpRequest& out) {
+    const char* end = nullptr;
+    for (size_t i = 3; i < size; ++i) {
+        if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r') {
+            end = data + i + 1;
+            break;
+        }
+    }
+    if (!end) return size > MaxRequestBytes ? SIZE_MAX : 0;
+    if ((size_t)(end - data) > MaxRequestBytes) return SIZE_MAX;
+
+    // Ligne de requete : METHODE CIBLE VERSION
+    const char* lineEnd = (const char*)std::memchr(data, '\r', end - data);
+    const char* firstSpace = (const char*)std::memchr(data, ' ', lineEnd - data);
+    if (!firstSpace) return SIZE_MAX;
+    const char* secondSpace = (const char*)std::memchr(firstSpace + 1, ' ', lineEnd - firstSpace - 1);
+    if (!secondSpace || firstSpace == data || secondSpace == firstSpace + 1) return SIZE_MAX;
+
+    out = HttpRequest();
+    out.method.assign(data, firstSpace);
+    std::string target(firstSpace + 1, secondSpace);
+    std::string version(secondSpace + 1, lineEnd);
+    if (version.rfind("HTTP/1.", 0) != 0) return SIZE_MAX;
+    // HTTP/1.0 ferme la connexion sauf demande contraire
+    out.keepAlive = version != "HTTP/1.0";
+
+    size_t question = target.find('?');
+    out.path = target.substr(0, question);
+    if (question != std::string::npos) {
+        std::string query = target.substr(question + 1);
+        out.width = QueryInt(query, "w");
+        out.height = QueryInt(query, "h");
+    }
+
+    // En-tetes : seul Connection change le comportement du serveur
+    const char* line = lineEnd + 2;
+    while (line < end - 2) {
+        const char* next = (const char*)std::memchr(line, '\r', end - line);
+        const char* colon = (const char*)std::memchr(line, ':', next - line);
+        if (colon && EqualsIgnoreCase(line, colon - line, "connection")) {
+            const char* value = colon + 1;
+            while (value < next && *value == ' ') ++value;
+            if (EqualsIgnoreCase(value, next - value, "close")) out.keepAlive = false;
+            else if (EqualsIgnoreCase(value, next - value, "keep-alive")) out.keepAlive = true;
+        }
+        line = next + 2;
+    }
+    return (size_t)(end - data);
+}
+
+#if !defined(__linux__)
+std::unique_ptr<ServerBackend> CreateServerBackend() {
+    return nullptr;
+}
+#endif
+
+ImageServer::ImageServer() = default;
+
+ImageServer::~ImageServer() {
+    Stop();
+}
+
+bool ImageServer::Start(ImageCatalog catalog, const ImageServerOptions& options) {
+    Stop();
+    m_options = options;
+    m_catalog = std::move(catalog);
+    m_scaledCache = std::make_unique<ScaledCache>(options.scaledCacheBytes);
+
+    size_t threads = options.threadCount ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    m_selectors.clear();
+    uint64_t seed = options.seed;
+    for (size_t i = 0; i < threads; ++i) {
+        // Graines differentes et reproductibles par thread ; 0 reste aleatoire
+        auto selector = std::make_unique<RandomSelector>(seed ? seed + i * 0x9E3779B97F4A7C15ull : 0);
+        selector->SetMode(options.mode);
+        m_selectors.push_back(std::move(selector));
+    }
+
+    std::unique_ptr<ServerBackend> backend = CreateServerBackend();
+    if (!backend || !backend->Start(*this, options, threads)) return false;
+    m_backend = std::move(backend);
+    return true;
+}
+
+void ImageServer::Stop() {
+    if (!m_backend) return;
+    m_backend->Stop();
+    m_backend.reset();
+}
+
+ImageServerStats ImageServer::GetStats() const {
+    ImageServerStats stats;
+    stats.connections = connections.load();
+    stats.requests = m_requests.load();
+    stats.originals = m_originals.load();
+    stats.scaled = m_scaled.load();
+    stats.scaledCacheHits = m_scaledCacheHits.load();
+    stats.errors = m_errors.load();
+    stats.bytesSent = bytesSent.load();
+    return stats;
+}
+
+HttpResponse ImageServer::ErrorResponse(int status, bool keepAlive) {
+    HttpResponse response;
+    response.status = status;
+    response.keepAlive = keepAlive;
+    response.head = ResponseHead(status, "text/plain; charset=utf-8", keepAlive);
+    std::string text = std::to_string(status) + " " + StatusText(status) + "\n";
+    response.body = std::make_shared<const std::vector<uint8_t>>(text.begin(), text.end());
+    return response;
+}
+
+HttpResponse ImageServer::Respond(const HttpRequest& request, size_t worker) {
+    ++m_requests;
+    HttpResponse response;
+    bool headOnly = request.method == "HEAD";
+    if (request.method != "GET" && !headOnly) {
+        response = ErrorResponse(405, request.keepAlive);
+    }
+    else if (request.path == "/random") {
+        ImageId id = m_selectors[worker % m_selectors.size()]->Pick(m_catalog);
+        response = id == InvalidImageId ? ErrorResponse(503, request.keepAlive) : ImageResponse(id, request);
+    }
+    else if (request.path.rfind("/image/", 0) == 0) {
+        char* end = nullptr;
+        unsigned long long id = std::strtoull(request.path.c_str() + 7, &end, 10);
+        bool valid = end && *end == '\0' && end != request.path.c_str() + 7 && id < m_catalog.Size() &&
+            !m_catalog.IsExcluded((ImageId)id);
+        response = valid ? ImageResponse((ImageId)id, request) : ErrorResponse(404, request.keepAlive);
+    }
+    else if (request.path == "/stats") {
+        response = StatsResponse(request);
+    }
+    else {
+        response = ErrorResponse(404, request.keepAlive);
+    }
+    if (response.status != 200) ++m_errors;
+    response.headOnly = headOnly;
+    return response;
+}
+
+HttpResponse ImageServer::ImageResponse(ImageId id, const HttpRequest& request) {
+    HttpResponse response;
+    response.keepAlive = request.keepAlive;
+    std::string imageHeaders = "X-Image-Id: " + std::to_string(id) + "\r\nX-Image-Name: " +
+        EncodeHeaderValue(m_catalog.FileName(id)) + "\r\n";
+
+    if (request.width > 0 || request.height > 0) {
+        int limit = std::max(1, std::min(m_options.maxScaledSize, MaxScaledDimension));
+        int width = std::min(request.width > 0 ? request.width : limit, limit);
+        int height = std::min(request.height > 0 ? request.height : limit, limit);
+        response.body = ScaledCopy(id, width, height);
+        if (!response.body) return ErrorResponse(500, request.keepAlive);
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+        const char* contentType = "image/jpeg";
+#else
+        const char* contentType = "image/bmp";
+#endif
+        response.head = ResponseHead(200, contentType, request.keepAlive) + imageHeaders;
+        ++m_scaled;
+        return response;
+    }
+
+    response.head = ResponseHead(200, ContentTypeOf(m_catalog.FileName(id)), request.keepAlive) + imageHeaders;
+    response.filePath = m_catalog.FullPath(id);
+    ++m_originals;
+    return response;
+}
+
+HttpResponse ImageServer::StatsResponse(const HttpRequest& request) {
+    ImageServerStats stats = GetStats();
+    ScaledCache::Stats cache = m_scaledCache->GetStats();
+    char text[512];
+    int length = std::snprintf(text, sizeof(text),
+        "{\"images\":%zu,\"threads\":%zu,\"connections\":%llu,\"requests\":%llu,\"originals\":%llu,"
+        "\"scaled\":%llu,\"scaled_cache_hits\":%llu,\"scaled_cache_bytes\":%zu,\"errors\":%llu,\"bytes_sent\":%llu}\n",
+        m_catalog.Size() - m_catalog.ExcludedCount(), m_selectors.size(),
+        (unsigned long long)stats.connections, (unsigned long long)stats.requests,
+        (unsigned long long)stats.originals, (unsigned long long)stats.scaled,
+        (unsigned long long)stats.scaledCacheHits, cache.bytes, (unsigned long long)stats.errors,
+        (unsigned long long)stats.bytesSent);
+    HttpResponse response;
+    response.keepAlive = request.keepAlive;
+    response.head = ResponseHead(200, "application/json", request.keepAlive);
+    response.body = std::make_shared<const std::vector<uint8_t>>(text, text + std::max(0, length));
+    return response;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> ImageServer::ScaledCopy(ImageId id, int width, int height) {
+    // width et height <= MaxScaledDimension
+    uint64_t key = ((uint64_t)id << 32) | ((uint64_t)width << 16) | (uint64_t)height;
+    if (auto cached = m_scaledCache->Get(key)) {
+        ++m_scaledCacheHits;
+        return cached;
+    }
+
+    // Decodage reduit au plus pres de la taille demandee, puis Lanczos ; jamais agrandie
+    DecodedImage decoded;
+    if (!DecodeImageFile(m_catalog.FullPath(id), width, height, decoded)) return nullptr;
+    double scale = std::min({ (double)width / decoded.sourceWidth, (double)height / decoded.sourceHeight, 1.0 });
+    int targetWidth = std::max(1, (int)(decoded.sourceWidth * scale + 0.5));
+    int targetHeight = std::max(1, (int)(decoded.sourceHeight * scale + 0.5));
+
+    DecodedImage scaled;
+    if (targetWidth == decoded.width && targetHeight == decoded.height) {
+        scaled = std::move(decoded);
+    }
+    else {
+        scaled.Allocate(targetWidth, targetHeight);
+        if (!ResampleImage(decoded.View(), scaled.View(), ResampleOptions())) return nullptr;
+    }
+
+    auto encoded = std::make_shared<std::vector<uint8_t>>();
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+    if (!EncodeJpeg(scaled, m_options.jpegQuality, *encoded)) return nullptr;
+#else
+    EncodeBmp(scaled, *encoded);
+#endif
+    m_scaledCache->Put(key, encoded, encoded->size());
+    return encoded;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ImageCatalog.h"
+#include "LruCache.h"
+#include "RandomSelector.h"
+
+// Serveur HTTP d'images aleatoires pour les bornes et l'affichage dynamique (mode sans
+// fenetre, RandomPictureServer). Chaque thread d'evenements a son propre tirage sur le
+// catalogue partage, qui ne change plus une fois le serveur demarre.
+//
+//   GET /random               image originale, envoyee sans copie (sendfile)
+//   GET /random?w=800&h=600   image reduite pour tenir dans 800x600, gardee en cache
+//   GET /image/<id>[?w=&h=]   image donnee du catalogue (rechargement d'un affichage)
+//   GET /stats                compteurs du serveur en JSON
+//
+// Les reponses portent X-Image-Id et X-Image-Name (nom du fichier, UTF-8 encode en %XX).
+// Les connexions restent ouvertes (HTTP/1.1) et les requetes peuvent s'enchainer.
+struct ImageServerOptions {
+    // Adresse IPv4 d'ecoute ; 127.0.0.1 par defaut, 0.0.0.0 pour le reseau local
+    std::string address = "127.0.0.1";
+    // 0 : port choisi par le systeme (ImageServer::Port)
+    uint16_t port = 8080;
+    // Socket Unix a la place du TCP si non vide
+    std::string unixSocket;
+    // Threads d'evenements ; 0 : un par coeur
+    size_t threadCount = 0;
+    SelectionMode mode = SelectionMode::Uniform;
+    // 0 : graine aleatoire
+    uint64_t seed = 0;
+    // Memoire des images reduites (octets encodes)
+    size_t scaledCacheBytes = (size_t)256 << 20;
+    // Taille maximale d'une image reduite (au plus 65500, limite de JPEG)
+    int maxScaledSize = 4096;
+    // Qualite JPEG des images reduites
+    int jpegQuality = 85;
+};
+
+struct ImageServerStats {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t originals = 0;
+    uint64_t scaled = 0;
+    uint64_t scaledCacheHits = 0;
+    uint64_t errors = 0;
+    uint64_t bytesSent = 0;
+};
+
+// Requete analysee par ParseHttpRequest
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    // Parametres w et h de la requete, 0 si absents
+    int width = 0;
+    int height = 0;
+    bool keepAlive = true;
+};
+
+// Analyse une requete complete au debut de `data`. Retourne le nombre d'octets consommes,
+// 0 si la requete n'est pas encore complete, SIZE_MAX si elle est invalide ou trop longue.
+size_t ParseHttpRequest(const char* data, size_t size, HttpRequest& out);
+
+// Reponse preparee par ImageServer::Respond, envoyee par le backend. L'entete s'arrete
+// avant Content-Length : le backend l'ajoute une fois la taille du fichier connue.
+struct HttpResponse {
+    int status = 200;
+    std::string head;
+    // Fichier envoye tel quel, ou corps en memoire (partage avec le cache)
+    std::wstring filePath;
+    std::shared_ptr<const std::vector<uint8_t>> body;
+    bool headOnly = false;
+    bool keepAlive = true;
+};
+
+class ImageServer;
+
+// Boucle d'evenements du systeme : epoll et sendfile sous Linux (ImageServerLinux.cpp).
+// Absente ailleurs : ImageServer::Start echoue.
+class ServerBackend {
+public:
+    virtual ~ServerBackend() = default;
+
+    virtual bool Start(ImageServer& server, const ImageServerOptions& options, size_t threads) = 0;
+    virtual void Stop() = 0;
+    // Port effectif en TCP
+    virtual uint16_t Port() const = 0;
+};
+
+std::unique_ptr<ServerBackend> CreateServerBackend();
+
+class ImageServer {
+public:
+    ImageServer();
+    ~ImageServer();
+
+    ImageServer(const ImageServer&) = delete;
+    ImageServer& operator=(const ImageServer&) = delete;
+
+    // Demarre les threads d'evenements ; false si l'adresse n'est pas disponible ou si la
+    // plateforme n'a pas de backend
+    bool Start(ImageCatalog catalog, const ImageServerOptions& options);
+    void Stop();
+    bool IsRunning() const { return m_backend != nullptr; }
+    uint16_t Port() const { return m_backend ? m_backend->Port() : 0; }
+    const ImageCatalog& Catalog() const { return m_catalog; }
+
+    ImageServerStats GetStats() const;
+
+    // Appele par le backend depuis le thread d'evenements `worker`
+    HttpResponse Respond(const HttpRequest& request, size_t worker);
+    // Reponse d'erreur minimale (requete invalide, fichier disparu)
+    static HttpResponse ErrorResponse(int status, bool keepAlive);
+
+    // Compteurs mis a jour par le backend
+    std::atomic<uint64_t> connections{ 0 };
+    std::atomic<uint64_t> bytesSent{ 0 };
+
+private:
+    using ScaledCache = LruCache<uint64_t, const std::vector<uint8_t>>;
+
+    HttpResponse ImageResponse(ImageId id, const HttpRequest& request);
+    HttpResponse StatsResponse(const HttpRequest& request);
+    // Image reduite et encodee (JPEG, BMP sans libjpeg), depuis le cache si possible
+    std::shared_ptr<const std::vector<uint8_t>> ScaledCopy(ImageId id, int width, int height);
+
+    ImageServerOptions m_options;
+    ImageCatalog m_catalog;
+    // Un tirage par thread d'evenements, sans verrou
+    std::vector<std::unique_ptr<RandomSelector>> m_selectors;
+    std::unique_ptr<ScaledCache> m_scaledCache;
+    std::unique_ptr<ServerBackend> m_backend;
+
+    std::atomic<uint64_t> m_requests{ 0 };
+    std::atomic<uint64_t> m_originals{ 0 };
+    std::atomic<uint64_t> m_scaled{ 0 };
+    std::atomic<uint64_t> m_scaledCacheHits{ 0 };
+    std::atomic<uint64_t> m_errors{ 0 };
+};
@@ -0,0 +1,336 @@
+#include "ImageServer.h"
+
+#if defined(__linux__)
+
+#include "PathString.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+    // Lecture maximale par appel a recv ; une requete de ce serveur tient en quelques centaines d'octets
+    constexpr size_t ReadChunk = 16384;
+
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        // Reponse en cours d'envoi : entete, puis corps en memoire ou fichier
+        std::string head;
+        size_t headSent = 0;
+        std::shared_ptr<const std::vector<uint8_t>> body;
+        size_t bodySent = 0;
+        int file = -1;
+        off_t fileOffset = 0;
+        off_t fileEnd = 0;
+        bool closeAfter = false;
+        // Le client a fini d'ecrire : repondre a ce qui reste dans le tampon puis fermer
+        bool peerClosed = false;
+        // En attente d'EPOLLOUT : les requetes suivantes attendent la fin de l'envoi
+        bool blocked = false;
+
+        ~Connection() {
+            if (file >= 0) close(file);
+            if (fd >= 0) close(fd);
+        }
+
+        bool Sending() const { return headSent < head.size() || (body && bodySent < body->size()) || file >= 0; }
+    };
+
+    // Un epoll par thread ; la socket d'ecoute est partagee avec EPOLLEXCLUSIVE pour qu'une
+    // connexion ne reveille qu'un thread. Chaque connexion reste sur le thread qui l'a acceptee.
+    class EpollBackend : public ServerBackend {
+    public:
+        ~EpollBackend() override {
+            Stop();
+        }
+
+        bool Start(ImageServer& server, const ImageServerOptions& options, size_t threads) override {
+            m_server = &server;
+            m_listen = options.unixSocket.empty() ? ListenTcp(options) : ListenUnix(options.unixSocket);
+            m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_listen < 0 || m_wake < 0) {
+                Close();
+                return false;
+            }
+            m_stop = false;
+            for (size_t i = 0; i < threads; ++i) m_threads.emplace_back(&EpollBackend::Run, this, i);
+            return true;
+        }
+
+        void Stop() override {
+            if (!m_threads.empty()) {
+                m_stop = true;
+                uint64_t one = 1;
+                (void)!write(m_wake, &one, sizeof(one));
+                for (auto& thread : m_threads) thread.join();
+                m_threads.clear();
+            }
+            Close();
+        }
+
+        uint16_t Port() const override { return m_port; }
+
+    private:
+        int ListenTcp(const ImageServerOptions& options) {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(options.port);
+            if (inet_pton(AF_INET, options.address.c_str(), &address.sin_addr) != 1) return -1;
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) return -1;
+            int yes = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+                close(fd);
+                return -1;
+            }
+            socklen_t length = sizeof(address);
+            getsockname(fd, (sockaddr*)&address, &length);
+            m_port = ntohs(address.sin_port);
+            m_tcp = true;
+            return fd;
+        }
+
+        int ListenUnix(const std::string& path) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(address.sun_path)) return -1;
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) return -1;
+            // Socket laissee par une execution precedente
+            unlink(path.c_str());
+            if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+                close(fd);
+                return -1;
+            }
+            m_unixPath = path;
+            m_tcp = false;
+            return fd;
+        }
+
+        void Close() {
+            if (m_listen >= 0) close(m_listen);
+            if (m_wake >= 0) close(m_wake);
+            m_listen = m_wake = -1;
+            if (!m_unixPath.empty()) unlink(m_unixPath.c_str());
+            m_unixPath.clear();
+        }
+
+        void Run(size_t worker) {
+            int epoll = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll < 0) return;
+            // data.ptr : nullptr pour l'ecoute, &m_wake pour l'arret, sinon la connexion
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLEXCLUSIVE;
+            event.data.ptr = nullptr;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, m_listen, &event);
+            event.events = EPOLLIN;
+            event.data.ptr = &m_wake;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, m_wake, &event);
+
+            std::unordered_map<Connection*, std::unique_ptr<Connection>> connections;
+            epoll_event events[256];
+            while (!m_stop) {
+                int count = epoll_wait(epoll, events, 256, -1);
+                if (count < 0 && errno != EINTR) break;
+                for (int i = 0; i < count; ++i) {
+                    void* tag = events[i].data.ptr;
+                    if (tag == &m_wake) continue;
+                    if (!tag) {
+                        Accept(epoll, connections);
+                        continue;
+                    }
+                    Connection& connection = *(Connection*)tag;
+                    bool keep = !(events[i].events & EPOLLERR);
+                    if (keep && (events[i].events & EPOLLOUT)) keep = Flush(epoll, connection);
+                    if (keep && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) keep = Read(connection);
+                    if (keep) keep = Process(epoll, connection, worker);
+                    if (!keep) {
+                        epoll_ctl(epoll, EPOLL_CTL_DEL, connection.fd, nullptr);
+                        connections.erase(&connection);
+                    }
+                }
+            }
+            connections.clear();
+            close(epoll);
+        }
+
+        void Accept(int epoll, std::unordered_map<Connection*, std::unique_ptr<Connection>>& connections) {
+            for (;;) {
+                int fd = accept4(m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+                if (m_tcp) {
+                    int yes = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                }
+                auto connection = std::make_unique<Connection>();
+                connection->fd = fd;
+                epoll_event event{};
+                event.events = EPOLLIN | EPOLLRDHUP;
+                event.data.ptr = connection.get();
+                if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) continue;
+                ++m_server->connections;
+                connections.emplace(connection.get(), std::move(connection));
+            }
+        }
+
+        // false : connexion en erreur
+        static bool Read(Connection& connection) {
+            char buffer[ReadChunk];
+            for (;;) {
+                ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+                if (received > 0) {
+                    connection.input.append(buffer, (size_t)received);
+                    if ((size_t)received < sizeof(buffer)) return true;
+                    continue;
+                }
+                if (received == 0) {
+                    connection.peerClosed = true;
+                    return true;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+        }
+
+        // Repond aux requetes completes du tampon, dans l'ordre, tant que l'envoi ne bloque pas
+        bool Process(int epoll, Connection& connection, size_t worker) {
+            while (!connection.Sending() && !connection.closeAfter) {
+                HttpRequest request;
+                size_t used = ParseHttpRequest(connection.input.data(), connection.input.size(), request);
+                if (used == 0) break;
+                if (used == SIZE_MAX) {
+                    Prepare(connection, ImageServer::ErrorResponse(400, false));
+                    connection.input.clear();
+                }
+                else {
+                    connection.input.erase(0, used);
+                    Prepare(connection, m_server->Respond(request, worker));
+                }
+                if (!Flush(epoll, connection)) return false;
+            }
+            return connection.Sending() || !connection.peerClosed;
+        }
+
+        void Prepare(Connection& connection, HttpResponse response) {
+            off_t size = 0;
+            if (!response.filePath.empty()) {
+                // Fichier supprime depuis le parcours : 404 plutot qu'une connexion coupee
+                int file = open(WideToPath(response.filePath).c_str(), O_RDONLY | O_CLOEXEC);
+                struct stat info;
+                if (file >= 0 && fstat(file, &info) == 0 && S_ISREG(info.st_mode)) {
+                    size = info.st_size;
+                    if (!response.headOnly) {
+                        connection.file = file;
+                        connection.fileOffset = 0;
+                        connection.fileEnd = size;
+                        file = -1;
+                    }
+                }
+                else {
+                    bool headOnly = response.headOnly;
+                    response = ImageServer::ErrorResponse(404, response.keepAlive);
+                    response.headOnly = headOnly;
+                }
+                if (file >= 0) close(file);
+            }
+            if (response.filePath.empty() && response.body) size = (off_t)response.body->size();
+
+            connection.head = std::move(response.head);
+            connection.head += "Content-Length: " + std::to_string((long long)size) + "\r\n\r\n";
+            connection.headSent = 0;
+            connection.body = response.headOnly ? nullptr : std::move(response.body);
+            connection.bodySent = 0;
+            connection.closeAfter = !response.keepAlive;
+        }
+
+        // Envoie ce qui peut l'etre sans bloquer ; false si la connexion doit etre fermee
+        bool Flush(int epoll, Connection& connection) {
+            uint64_t sent = 0;
+            bool blocked = false;
+            bool failed = false;
+            auto check = [&](ssize_t written) {
+                if (written >= 0) {
+                    sent += (uint64_t)written;
+                    return true;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) blocked = true;
+                else if (errno != EINTR) failed = true;
+                return false;
+            };
+
+            while (!blocked && !failed && connection.headSent < connection.head.size()) {
+                // MSG_MORE : l'entete part dans le meme segment que le debut du corps
+                bool more = (connection.body && !connection.body->empty()) || connection.file >= 0;
+                ssize_t written = send(connection.fd, connection.head.data() + connection.headSent,
+                    connection.head.size() - connection.headSent, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+                if (check(written)) connection.headSent += (size_t)written;
+            }
+            while (!blocked && !failed && connection.body && connection.bodySent < connection.body->size()) {
+                ssize_t written = send(connection.fd, connection.body->data() + connection.bodySent,
+                    connection.body->size() - connection.bodySent, MSG_NOSIGNAL);
+                if (check(written)) connection.bodySent += (size_t)written;
+            }
+            // Fichier original : le noyau copie directement du cache de pages vers la socket
+            while (!blocked && !failed && connection.file >= 0) {
+                if (connection.fileOffset >= connection.fileEnd) {
+                    close(connection.file);
+                    connection.file = -1;
+                    break;
+                }
+                ssize_t written = sendfile(connection.fd, connection.file, &connection.fileOffset,
+                    (size_t)(connection.fileEnd - connection.fileOffset));
+                // Fichier raccourci pendant l'envoi : la reponse ne peut plus etre terminee
+                if (written == 0) failed = true;
+                else check(written);
+            }
+            m_server->bytesSent += sent;
+            if (failed) return false;
+
+            if (blocked != connection.blocked) {
+                epoll_event event{};
+                // Bloquee : plus de lecture tant que la reponse n'est pas partie
+                event.events = blocked ? EPOLLOUT : EPOLLIN | EPOLLRDHUP;
+                event.data.ptr = &connection;
+                epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event);
+                connection.blocked = blocked;
+            }
+            if (!blocked) {
+                connection.head.clear();
+                connection.headSent = 0;
+                connection.body.reset();
+                if (connection.closeAfter) return false;
+            }
+            return true;
+        }
+
+        ImageServer* m_server = nullptr;
+        int m_listen = -1;
+        int m_wake = -1;
+        bool m_tcp = true;
+        uint16_t m_port = 0;
+        std::string m_unixPath;
+        std::atomic<bool> m_stop{ false };
+        std::vector<std::thread> m_threads;
+    };
+}
+
+std::unique_ptr<ServerBackend> CreateServerBackend() {
+    return std::make_unique<EpollBackend>();
+}
+
+#endif
@@ -0,0 +1,262 @@
+#include "InstantPicker.h"
+
+#include "ImageScanner.h"
+#include "PathString.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Les liens symboliques ne sont pas suivis, la profondeur ne borne que les cas extremes
+    constexpr int MaxDepth = 256;
+
+    double UniformDouble(Xoshiro256& random) {
+        return (double)(random.Next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+}
+
+InstantPickReport CompareWithUniform(const std::vector<InstantPick>& picks, const ImageCatalog& catalog) {
+    InstantPickReport report;
+    size_t images = catalog.Size() - catalog.ExcludedCount();
+    if (picks.empty() || images == 0) return report;
+    report.picks = picks.size();
+    report.minRatio = HUGE_VAL;
+    for (const InstantPick& pick : picks) {
+        double ratio = pick.probability * (double)images;
+        report.minRatio = std::min(report.minRatio, ratio);
+        report.maxRatio = std::max(report.maxRatio, ratio);
+        report.meanDeviation += std::fabs(ratio - 1.0);
+    }
+    report.meanDeviation /= (double)picks.size();
+    return report;
+}
+
+TreeSampler::TreeSampler(std::wstring root, uint64_t seed, const std::atomic<bool>* cancel)
+    : m_random(seed != 0 ? seed : ((uint64_t)std::random_device()() << 32 | std::random_device()())), m_cancel(cancel) {
+    Node node;
+    node.path = std::move(root);
+    m_nodes.push_back(std::move(node));
+}
+
+bool TreeSampler::List(uint32_t index) {
+    if (m_nodes[index].listed) return true;
+    if (m_cancel && m_cancel->load(std::memory_order_relaxed)) return false;
+    ++m_directoriesRead;
+
+    // Dossier illisible : branche vide, comme pour le parcours complet
+    std::vector<std::wstring> subdirectories;
+    std::vector<std::wstring> names;
+    std::error_code ec;
+    fs::directory_iterator it(WideToPath(m_nodes[index].path), fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        try {
+            const fs::directory_entry& entry = *it;
+            std::error_code entryEc;
+            if (entry.is_directory(entryEc) && !entry.is_symlink(entryEc)) {
+                subdirectories.push_back(PathToWide(entry.path()));
+            }
+            else if (entry.is_regular_file(entryEc) && IsImagePath(entry.path())) {
+                names.push_back(PathToWide(entry.path().filename()));
+            }
+        }
+        catch (const std::exception&) {
+            // Nom non convertible ou entree disparue : on passe a la suivante
+        }
+    }
+
+    m_nodes[index].listed = true;
+    uint32_t images = (uint32_t)names.size();
+    m_nodes[index].imageCount = images;
+    m_nodes[index].names = std::move(names);
+    for (auto& path : subdirectories) {
+        Node child;
+        child.path = std::move(path);
+        m_nodes[index].children.push_back((uint32_t)m_nodes.size());
+        m_nodes.push_back(std::move(child));
+    }
+    if (m_nodes[index].children.empty()) m_nodes[index].exact = images;
+    return true;
+}
+
+double TreeSampler::Estimate(uint32_t index) {
+    Node& node = m_nodes[index];
+    if (node.exact >= 0) return node.exact;
+    if (!node.listed) return -1.0;
+
+    // Branche exacte des que tous les sous-dossiers le sont
+    double total = node.imageCount;
+    bool exact = true;
+    for (uint32_t child : node.children) {
+        if (m_nodes[child].exact < 0) {
+            exact = false;
+            break;
+        }
+        total += m_nodes[child].exact;
+    }
+    if (exact) {
+        m_nodes[index].exact = total;
+        return total;
+    }
+    return node.samples > 0 ? node.sampleSum / node.samples : -1.0;
+}
+
+double TreeSampler::Probe(uint32_t index, int depth) {
+    if (!List(index)) return -1.0;
+    double known = Estimate(index);
+    if (m_nodes[index].exact >= 0 || depth >= MaxDepth) return std::max(known, 0.0);
+
+    const std::vector<uint32_t>& children = m_nodes[index].children;
+    uint32_t child = children[m_random.Below((uint32_t)children.size())];
+    double below = Probe(child, depth + 1);
+    if (below < 0) return -1.0;
+    Node& node = m_nodes[index];
+    double sample = node.imageCount + (double)node.children.size() * below;
+    node.sampleSum += sample;
+    ++node.samples;
+    return sample;
+}
+
+bool TreeSampler::Pick(InstantPick& out) {
+    size_t readsBefore = m_directoriesRead;
+    std::vector<double> weights;
+    for (size_t attempt = 0; attempt < maxAttempts; ++attempt) {
+        uint32_t index = 0;
+        double probability = 1.0;
+        for (int depth = 0;; ++depth) {
+            if (!List(index)) return false;
+            const size_t childCount = m_nodes[index].children.size();
+            if (childCount == 0 || depth >= MaxDepth) break;
+
+            // Chaque passage affine l'estimation ; inutile une fois la branche lue entierement
+            // Peu de sous-dossiers : chacun est sonde au moins une fois
+            Estimate(index);
+            for (size_t i = 0; i < childCount && childCount <= probeAllLimit; ++i) {
+                uint32_t child = m_nodes[index].children[i];
+                if (m_nodes[child].exact < 0 && m_nodes[child].samples == 0 && Probe(child, depth + 1) < 0) return false;
+            }
+            for (size_t probe = 0; probe < probesPerStep && m_nodes[index].exact < 0; ++probe) {
+                uint32_t child = m_nodes[index].children[m_random.Below((uint32_t)childCount)];
+                if (Probe(child, depth + 1) < 0) return false;
+            }
+
+            // Branche sans sonde : moyenne des branches voisines deja estimees
+            weights.assign(childCount + 1, 0.0);
+            weights[0] = m_nodes[index].imageCount;
+            double knownSum = 0.0;
+            size_t knownCount = 0;
+            for (size_t i = 0; i < childCount; ++i) {
+                double estimate = Estimate(m_nodes[index].children[i]);
+                weights[i + 1] = estimate;
+                if (estimate >= 0) {
+                    knownSum += estimate;
+                    ++knownCount;
+                }
+            }
+            double unknown = knownCount > 0 ? knownSum / knownCount : 1.0;
+            double total = 0.0;
+            for (double& weight : weights) {
+                if (weight < 0) weight = unknown;
+                total += weight;
+            }
+            if (total <= 0) break;
+
+            double target = UniformDouble(m_random) * total;
+            size_t chosen = 0;
+            while (chosen + 1 < weights.size() && (target >= weights[chosen] || weights[chosen] == 0)) {
+                target -= weights[chosen];
+                ++chosen;
+            }
+            probability *= weights[chosen] / total;
+            if (chosen == 0) break;
+            index = m_nodes[index].children[chosen - 1];
+        }
+
+        const Node& node = m_nodes[index];
+        if (node.imageCount == 0) continue;
+        out.path = JoinPath(node.path, node.names[m_random.Below(node.imageCount)]);
+        out.probability = probability / node.imageCount;
+        out.directoriesRead = m_directoriesRead - readsBefore;
+        return true;
+    }
+    return false;
+}
+
+InstantPicker::~InstantPicker() {
+    Cancel();
+}
+
+void InstantPicker::Start(const std::wstring& root, uint64_t seed, NotifyFn notify) {
+    Cancel();
+    m_cancel = false;
+    m_notify = std::move(notify);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requested = 0;
+        m_ready.clear();
+        m_history.clear();
+    }
+    m_active = true;
+    m_thread = std::thread(&InstantPicker::Run, this, root, seed);
+}
+
+void InstantPicker::Cancel() {
+    {
+        // Sous le verrou : sinon le reveil peut tomber entre le test de Run et son attente
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancel = true;
+    }
+    m_active = false;
+    m_wake.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void InstantPicker::Request() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_requested;
+    }
+    m_wake.notify_all();
+}
+
+bool InstantPicker::TakePicks(std::vector<InstantPick>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ready.empty()) return false;
+    out.insert(out.end(), std::make_move_iterator(m_ready.begin()), std::make_move_iterator(m_ready.end()));
+    m_ready.clear();
+    return true;
+}
+
+std::vector<InstantPick> InstantPicker::History() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_history;
+}
+
+void InstantPicker::Run(std::wstring root, uint64_t seed) {
+    TreeSampler sampler(std::move(root), seed, &m_cancel);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_cancel.load() || m_requested > 0; });
+            if (m_cancel) return;
+            --m_requested;
+        }
+        InstantPick pick;
+        bool found = sampler.Pick(pick);
+        if (m_cancel) return;
+        if (found) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_history.push_back(pick);
+            m_ready.push_back(std::move(pick));
+        }
+        else {
+            // Aucune image : le thread UI revient au tirage dans les lots du scan
+            m_active = false;
+        }
+        if (m_notify) m_notify();
+        if (!found) return;
+    }
+}
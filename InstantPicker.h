@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageCatalog.h"
+#include "RandomSelector.h"
+
+// Image tiree sans liste complete du dossier
+struct InstantPick {
+    std::wstring path;
+    // Probabilite qu'avait ce tirage, d'apres les estimations de la marche. Les marches
+    // recommencees apres un dossier sans image n'y sont pas comptees : la probabilite reelle
+    // est plus forte d'un facteur 1 / (1 - part des marches perdues), le meme pour toutes
+    // les images d'un tirage, qui diminue a mesure que les dossiers vides sont lus.
+    double probability = 0.0;
+    // Dossiers lus pour ce tirage (ceux des tirages precedents sont deja connus)
+    size_t directoriesRead = 0;
+};
+
+// Ecart des tirages rapides au tirage uniforme, une fois le catalogue complet connu.
+// Le rapport d'un tirage est sa probabilite multipliee par le nombre d'images : 1 pour un
+// tirage uniforme, 2 pour une image sortie deux fois trop souvent.
+struct InstantPickReport {
+    size_t picks = 0;
+    double minRatio = 0.0;
+    double maxRatio = 0.0;
+    // Moyenne de |rapport - 1|
+    double meanDeviation = 0.0;
+};
+
+InstantPickReport CompareWithUniform(const std::vector<InstantPick>& picks, const ImageCatalog& catalog);
+
+// Tirage approximativement uniforme par une marche aleatoire de la racine vers un dossier :
+// a chaque dossier, rester (images du dossier) ou descendre dans un sous-dossier avec un
+// poids egal au nombre d'images estime de chaque branche. Les tailles sont estimees par des
+// sondes de Knuth (un chemin au hasard, produit des nombres de sous-dossiers), exactes une
+// fois une branche entierement lue. Chaque dossier lu garde tous ses noms d'image : le
+// tirage dans le dossier est uniforme parmi toutes ses images, d'un tirage a l'autre.
+//
+// Les dossiers lus restent en memoire (noms compris, comme le catalogue le ferait) : les
+// tirages suivants sont plus rapides et plus justes. Un seul thread a la fois.
+class TreeSampler {
+public:
+    // Graine 0 : graine aleatoire ; `cancel` interrompt le tirage entre deux lectures
+    explicit TreeSampler(std::wstring root, uint64_t seed = 0, const std::atomic<bool>* cancel = nullptr);
+
+    // false si aucune image n'a ete trouvee ou si le tirage a ete annule
+    bool Pick(InstantPick& out);
+
+    size_t DirectoriesRead() const { return m_directoriesRead; }
+
+    // Sondes faites a chaque dossier de la marche avant de choisir une branche
+    size_t probesPerStep = 2;
+    // Jusqu'a ce nombre de sous-dossiers, chacun est sonde au moins une fois ; au-dela, les
+    // branches pas encore sondees recoivent la moyenne de leurs voisines
+    size_t probeAllLimit = 16;
+    // Marches recommencees depuis la racine apres un dossier sans image
+    size_t maxAttempts = 16;
+
+private:
+    struct Node {
+        std::wstring path;
+        bool listed = false;
+        uint32_t imageCount = 0;
+        std::vector<std::wstring> names;
+        std::vector<uint32_t> children;
+        // Nombre d'images de la branche : exact si >= 0, sinon moyenne des sondes
+        double exact = -1.0;
+        double sampleSum = 0.0;
+        uint32_t samples = 0;
+    };
+
+    bool List(uint32_t node);
+    // Estimation sans biais du nombre d'images de la branche (Knuth) ; -1 si annule
+    double Probe(uint32_t node, int depth);
+    // -1 si la branche n'a encore ni sonde ni lecture complete
+    double Estimate(uint32_t node);
+
+    std::vector<Node> m_nodes;
+    Xoshiro256 m_random;
+    const std::atomic<bool>* m_cancel;
+    size_t m_directoriesRead = 0;
+};
+
+// TreeSampler en arriere-plan, pour le debut d'un scan : le thread UI demande une image avec
+// Request, le thread appelle `notify` quand elle est prete et le thread UI la recupere avec
+// TakePicks. Remplace le tirage normal jusqu'a ce que le catalogue complet soit connu.
+class InstantPicker {
+public:
+    using NotifyFn = std::function<void()>;
+
+    InstantPicker() = default;
+    ~InstantPicker();
+
+    InstantPicker(const InstantPicker&) = delete;
+    InstantPicker& operator=(const InstantPicker&) = delete;
+
+    void Start(const std::wstring& root, uint64_t seed, NotifyFn notify);
+    // Attend la fin de la lecture de dossier en cours
+    void Cancel();
+
+    // Demarre, pas annule, et a trouve des images jusqu'ici
+    bool IsActive() const { return m_active.load(); }
+    void Request();
+
+    // Ajoute a `out` les tirages prets depuis le dernier appel
+    bool TakePicks(std::vector<InstantPick>& out);
+    // Tous les tirages depuis Start, pour CompareWithUniform
+    std::vector<InstantPick> History() const;
+
+private:
+    void Run(std::wstring root, uint64_t seed);
+
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{ false };
+    std::atomic<bool> m_active{ false };
+    NotifyFn m_notify;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    size_t m_requested = 0;
+    std::vector<InstantPick> m_ready;
+    std::vector<InstantPick> m_history;
+};
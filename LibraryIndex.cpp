@@ -0,0 +1,349 @@
+#include "LibraryIndex.h"
+
+#include "PathString.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char IndexMagic[8] = { 'R', 'P', 'I', 'N', 'D', 'E', 'X', '\0' };
+
+    uint64_t HashPath(const std::wstring& path) {
+        // FNV-1a 64 bits
+        uint64_t hash = 1469598103934665603ull;
+        for (unsigned char c : WideToUtf8(path)) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Chemin relatif a la racine, sans separateur en tete ("" pour la racine)
+    bool RelativePath(const std::wstring& root, const std::wstring& path, std::wstring& relative) {
+        if (path.compare(0, root.size(), root) != 0) return false;
+        size_t start = root.size();
+        while (start < path.size() && IsPathSeparator(path[start])) ++start;
+        relative = path.substr(start);
+        return true;
+    }
+
+    std::wstring ParentRelativePath(const std::wstring& relative) {
+        size_t pos = FindLastSeparator(relative);
+        return pos == std::wstring::npos ? std::wstring() : relative.substr(0, pos);
+    }
+
+    size_t AlignUp(size_t value) {
+        return (value + 7) & ~(size_t)7;
+    }
+}
+
+std::wstring LibraryIndexPath(const std::wstring& root) {
+    fs::path base;
+#ifdef _WIN32
+    wchar_t* localAppData = nullptr;
+    size_t length = 0;
+    if (_wdupenv_s(&localAppData, &length, L"LOCALAPPDATA") == 0 && localAppData) {
+        base = fs::path(localAppData) / L"RandomPicture" / L"index";
+    }
+    free(localAppData);
+    std::wstring key = root;
+    std::transform(key.begin(), key.end(), key.begin(), towlower);
+#else
+    if (const char* cache = std::getenv("XDG_CACHE_HOME")) {
+        base = fs::path(cache) / "RandomPicture" / "index";
+    }
+    else if (const char* home = std::getenv("HOME")) {
+        base = fs::path(home) / ".cache" / "RandomPicture" / "index";
+    }
+    const std::wstring& key = root;
+#endif
+    if (base.empty()) base = fs::temp_directory_path() / "RandomPicture" / "index";
+
+    std::error_code ec;
+    fs::create_directories(base, ec);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.rpidx", (unsigned long long)HashPath(key));
+    return PathToWide(base / name);
+}
+
+bool LibraryIndex::Open(const std::wstring& indexPath, const std::wstring& root) {
+    Close();
+    if (!m_file.Open(indexPath)) return false;
+
+    const uint8_t* data = m_file.Data();
+    size_t size = m_file.Size();
+    if (size < sizeof(LibraryIndexHeader)) {
+        Close();
+        return false;
+    }
+
+    const auto* header = (const LibraryIndexHeader*)data;
+    bool valid = std::memcmp(header->magic, IndexMagic, sizeof(IndexMagic)) == 0
+        && header->version == Version
+        && header->headerSize == sizeof(LibraryIndexHeader)
+        && header->directoriesOffset + (uint64_t)header->directoryCount * sizeof(LibraryIndexDirectory) <= size
+        && header->filesOffset + (uint64_t)header->fileCount * sizeof(LibraryIndexFile) <= size
+        && header->stringsOffset + header->stringUnits * sizeof(char16_t) <= size
+        && (uint64_t)header->rootOffset + header->rootLength <= header->stringUnits;
+    if (!valid) {
+        Close();
+        return false;
+    }
+
+    m_header = header;
+    m_directories = (const LibraryIndexDirectory*)(data + header->directoriesOffset);
+    m_files = (const LibraryIndexFile*)(data + header->filesOffset);
+    m_strings = (const char16_t*)(data + header->stringsOffset);
+
+    // Verifie les references pour ne jamais lire hors de la projection
+    for (uint32_t i = 0; i < header->directoryCount; ++i) {
+        const auto& dir = m_directories[i];
+        if ((uint64_t)dir.pathOffset + dir.pathLength > header->stringUnits ||
+            (uint64_t)dir.firstFile + dir.fileCount > header->fileCount) {
+            valid = false;
+            break;
+        }
+    }
+    for (uint32_t i = 0; valid && i < header->fileCount; ++i) {
+        const auto& file = m_files[i];
+        if (file.directory >= header->directoryCount ||
+            (uint64_t)file.nameOffset + file.nameLength > header->stringUnits) {
+            valid = false;
+        }
+    }
+
+    if (!valid || Root() != root) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void LibraryIndex::Close() {
+    m_file.Close();
+    m_header = nullptr;
+    m_directories = nullptr;
+    m_files = nullptr;
+    m_strings = nullptr;
+}
+
+std::wstring LibraryIndex::String(uint32_t offset, uint32_t length) const {
+    return Utf16ToWide(m_strings + offset, length);
+}
+
+std::wstring LibraryIndex::Root() const {
+    return String(m_header->rootOffset, m_header->rootLength);
+}
+
+std::wstring LibraryIndex::DirectoryPath(uint32_t index) const {
+    const auto& dir = m_directories[index];
+    std::wstring root = Root();
+    if (dir.pathLength == 0) return root;
+    return JoinPath(root, String(dir.pathOffset, dir.pathLength));
+}
+
+std::wstring LibraryIndex::FullPath(uint32_t fileIndex) const {
+    const auto& file = m_files[fileIndex];
+    return JoinPath(DirectoryPath(file.directory), String(file.nameOffset, file.nameLength));
+}
+
+std::vector<std::wstring> LibraryIndex::AllPaths() const {
+    std::vector<std::wstring> paths;
+    paths.reserve(FileCount());
+    for (uint32_t d = 0; d < DirectoryCount(); ++d) {
+        const auto& dir = m_directories[d];
+        std::wstring directory = DirectoryPath(d);
+        for (uint32_t f = dir.firstFile; f < dir.firstFile + dir.fileCount; ++f) {
+            paths.push_back(JoinPath(directory, String(m_files[f].nameOffset, m_files[f].nameLength)));
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+LibraryIndexReuse::LibraryIndexReuse(const LibraryIndex& index)
+    : m_index(index), m_root(index.Root()), m_children(index.DirectoryCount()) {
+    m_directoryByPath.reserve(index.DirectoryCount());
+    for (uint32_t d = 0; d < index.DirectoryCount(); ++d) {
+        const auto& dir = index.Directory(d);
+        m_directoryByPath.emplace(index.String(dir.pathOffset, dir.pathLength), d);
+        if (dir.parent != LibraryIndex::NoParent && dir.parent < index.DirectoryCount()) {
+            m_children[dir.parent].push_back(d);
+        }
+    }
+}
+
+bool LibraryIndexReuse::Reuse(WalkDirectoryInfo& info, std::vector<std::wstring>& subdirectories) const {
+    std::wstring relative;
+    if (!RelativePath(m_root, info.path, relative)) return false;
+
+    auto it = m_directoryByPath.find(relative);
+    if (it == m_directoryByPath.end()) return false;
+
+    const auto& dir = m_index.Directory(it->second);
+    if (dir.mtime != info.mtime) return false;
+
+    info.files.reserve(dir.fileCount);
+    for (uint32_t f = dir.firstFile; f < dir.firstFile + dir.fileCount; ++f) {
+        const auto& file = m_index.File(f);
+        WalkFileInfo entry;
+        entry.name = m_index.String(file.nameOffset, file.nameLength);
+        entry.size = file.size;
+        entry.mtime = file.mtime;
+        entry.width = file.width;
+        entry.height = file.height;
+        entry.rejected = (file.flags & LibraryIndexFile::Rejected) != 0;
+        if (entry.rejected) {
+            // Rares : seul moyen de voir qu'un fichier refuse a ete remplace depuis
+            std::error_code ec;
+            fs::path path = WideToPath(JoinPath(info.path, entry.name));
+            uint64_t size = fs::file_size(path, ec);
+            int64_t mtime = ec ? 0 : (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+            if (!ec && (size != entry.size || mtime != entry.mtime)) {
+                entry.size = size;
+                entry.mtime = mtime;
+                entry.width = entry.height = 0;
+                entry.rejected = false;
+            }
+        }
+        info.files.push_back(std::move(entry));
+    }
+    for (uint32_t child : m_children[it->second]) {
+        subdirectories.push_back(m_index.DirectoryPath(child));
+    }
+    return true;
+}
+
+void LoadCatalogFromIndex(const LibraryIndex& index, ImageCatalog& catalog) {
+    catalog.Clear();
+    catalog.Reserve(index.FileCount(), 0);
+    for (uint32_t d = 0; d < index.DirectoryCount(); ++d) {
+        const auto& dir = index.Directory(d);
+        if (dir.fileCount == 0) continue;
+
+        uint32_t directory = UINT32_MAX;
+        for (uint32_t f = dir.firstFile; f < dir.firstFile + dir.fileCount; ++f) {
+            const auto& file = index.File(f);
+            if (file.flags & LibraryIndexFile::Rejected) continue;
+            if (directory == UINT32_MAX) directory = catalog.AddDirectory(index.DirectoryPath(d));
+            catalog.Add(directory, index.String(file.nameOffset, file.nameLength), file.mtime, file.size, file.width,
+                file.height);
+        }
+    }
+}
+
+bool SaveLibraryIndex(const std::wstring& indexPath, const std::wstring& root,
+    const std::vector<WalkDirectoryInfo>& directories) {
+    struct PendingDirectory {
+        std::wstring relative;
+        const WalkDirectoryInfo* info;
+    };
+
+    std::vector<PendingDirectory> pending;
+    pending.reserve(directories.size());
+    for (const auto& info : directories) {
+        std::wstring relative;
+        if (RelativePath(root, info.path, relative)) {
+            pending.push_back({ std::move(relative), &info });
+        }
+    }
+    std::sort(pending.begin(), pending.end(),
+        [](const PendingDirectory& a, const PendingDirectory& b) { return a.relative < b.relative; });
+
+    std::unordered_map<std::wstring, uint32_t> idByPath;
+    idByPath.reserve(pending.size());
+    for (uint32_t i = 0; i < (uint32_t)pending.size(); ++i) {
+        idByPath.emplace(pending[i].relative, i);
+    }
+
+    std::u16string strings;
+    auto addString = [&strings](const std::wstring& text, uint32_t& offset, uint32_t& length) {
+        std::u16string utf16 = WideToUtf16(text);
+        offset = (uint32_t)strings.size();
+        length = (uint32_t)utf16.size();
+        strings += utf16;
+    };
+
+    LibraryIndexHeader header = {};
+    std::memcpy(header.magic, IndexMagic, sizeof(IndexMagic));
+    header.version = LibraryIndex::Version;
+    header.headerSize = sizeof(LibraryIndexHeader);
+    addString(root, header.rootOffset, header.rootLength);
+
+    std::vector<LibraryIndexDirectory> dirRecords(pending.size());
+    std::vector<LibraryIndexFile> fileRecords;
+    for (uint32_t i = 0; i < (uint32_t)pending.size(); ++i) {
+        const auto& entry = pending[i];
+        auto& record = dirRecords[i];
+        record.parent = LibraryIndex::NoParent;
+        if (!entry.relative.empty()) {
+            auto parent = idByPath.find(ParentRelativePath(entry.relative));
+            if (parent != idByPath.end()) record.parent = parent->second;
+        }
+        addString(entry.relative, record.pathOffset, record.pathLength);
+        record.mtime = entry.info->mtime;
+        record.firstFile = (uint32_t)fileRecords.size();
+
+        std::vector<const WalkFileInfo*> files;
+        files.reserve(entry.info->files.size());
+        for (const auto& file : entry.info->files) files.push_back(&file);
+        std::sort(files.begin(), files.end(),
+            [](const WalkFileInfo* a, const WalkFileInfo* b) { return a->name < b->name; });
+
+        for (const WalkFileInfo* file : files) {
+            LibraryIndexFile fileRecord = {};
+            fileRecord.directory = i;
+            addString(file->name, fileRecord.nameOffset, fileRecord.nameLength);
+            fileRecord.size = file->size;
+            fileRecord.mtime = file->mtime;
+            fileRecord.width = file->width;
+            fileRecord.height = file->height;
+            if (file->rejected) fileRecord.flags = LibraryIndexFile::Rejected;
+            fileRecords.push_back(fileRecord);
+        }
+        record.fileCount = (uint32_t)fileRecords.size() - record.firstFile;
+    }
+
+    header.directoryCount = (uint32_t)dirRecords.size();
+    header.fileCount = (uint32_t)fileRecords.size();
+    header.stringUnits = strings.size();
+    header.directoriesOffset = AlignUp(sizeof(LibraryIndexHeader));
+    header.filesOffset = AlignUp(header.directoriesOffset + dirRecords.size() * sizeof(LibraryIndexDirectory));
+    header.stringsOffset = AlignUp(header.filesOffset + fileRecords.size() * sizeof(LibraryIndexFile));
+
+    fs::path target = WideToPath(indexPath);
+    fs::path temporary = target;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        auto writeAt = [&out](uint64_t offset, const void* data, size_t size) {
+            static const char zeros[8] = {};
+            uint64_t position = (uint64_t)out.tellp();
+            if (position < offset) out.write(zeros, (std::streamsize)(offset - position));
+            out.write((const char*)data, (std::streamsize)size);
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.directoriesOffset, dirRecords.data(), dirRecords.size() * sizeof(LibraryIndexDirectory));
+        writeAt(header.filesOffset, fileRecords.data(), fileRecords.size() * sizeof(LibraryIndexFile));
+        writeAt(header.stringsOffset, strings.data(), strings.size() * sizeof(char16_t));
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(temporary, target, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DirectoryWalker.h"
+#include "ImageCatalog.h"
+#include "MappedFile.h"
+
+// Format binaire de l'index d'un dossier racine (.rpidx), lu directement par projection
+// en memoire. Les chaines sont en UTF-16 dans une table commune ; les fichiers d'un meme
+// dossier sont contigus. Les dates sont en ticks de fs::file_time_type.
+struct LibraryIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t directoryCount;
+    uint32_t fileCount;
+    uint64_t stringUnits;
+    uint64_t directoriesOffset;
+    uint64_t filesOffset;
+    uint64_t stringsOffset;
+    uint32_t rootOffset;
+    uint32_t rootLength;
+};
+
+struct LibraryIndexDirectory {
+    uint32_t parent;        // UINT32_MAX pour la racine
+    uint32_t pathOffset;    // chemin relatif a la racine
+    uint32_t pathLength;
+    uint32_t firstFile;
+    uint32_t fileCount;
+    uint32_t reserved;
+    int64_t mtime;
+};
+
+struct LibraryIndexFile {
+    // Fichier refuse par la sonde : garde pour ne le ressonder que s'il change
+    static constexpr uint32_t Rejected = 1;
+
+    uint32_t directory;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t flags;         // 0 dans les index ecrits avant les fichiers refuses
+    uint64_t size;
+    int64_t mtime;
+    // 0 si le fichier n'a pas ete sonde (version 2)
+    uint32_t width;
+    uint32_t height;
+};
+
+// Emplacement de l'index d'un dossier racine, dans le dossier de cache de l'utilisateur
+std::wstring LibraryIndexPath(const std::wstring& root);
+
+// Vue en lecture seule sur un index projete en memoire
+class LibraryIndex {
+public:
+    static constexpr uint32_t Version = 2;
+    static constexpr uint32_t NoParent = UINT32_MAX;
+
+    // Echoue si le fichier est absent, corrompu ou ne correspond pas a `root`
+    bool Open(const std::wstring& indexPath, const std::wstring& root);
+    void Close();
+    bool IsOpen() const { return m_header != nullptr; }
+
+    uint32_t DirectoryCount() const { return m_header ? m_header->directoryCount : 0; }
+    uint32_t FileCount() const { return m_header ? m_header->fileCount : 0; }
+    const LibraryIndexDirectory& Directory(uint32_t index) const { return m_directories[index]; }
+    const LibraryIndexFile& File(uint32_t index) const { return m_files[index]; }
+
+    std::wstring String(uint32_t offset, uint32_t length) const;
+    std::wstring Root() const;
+    std::wstring DirectoryPath(uint32_t index) const;
+    std::wstring FullPath(uint32_t fileIndex) const;
+    std::vector<std::wstring> AllPaths() const;
+
+private:
+    MappedFile m_file;
+    const LibraryIndexHeader* m_header = nullptr;
+    const LibraryIndexDirectory* m_directories = nullptr;
+    const LibraryIndexFile* m_files = nullptr;
+    const char16_t* m_strings = nullptr;
+};
+
+// Reprise des dossiers inchanges d'un index precedent pendant un nouveau parcours
+// (WalkOptions::reuseDirectory) : la liste des fichiers, leur taille, leur date et leurs
+// dimensions sont reprises sans aucun appel systeme par fichier, sauf pour les fichiers
+// refuses par la sonde : leur taille et leur date sont relues et un changement les
+// rend a nouveau candidats (rejected efface, dimensions a 0). Un fichier modifie sur
+// place ne change pas la date de son dossier : ses anciennes valeurs restent jusqu'a ce
+// que ChangeWatcher le signale (modification pendant que l'application tourne) ou que le
+// dossier change. L'index doit rester ouvert pendant le parcours.
+class LibraryIndexReuse {
+public:
+    explicit LibraryIndexReuse(const LibraryIndex& index);
+
+    // Appelable depuis plusieurs threads
+    bool Reuse(WalkDirectoryInfo& info, std::vector<std::wstring>& subdirectories) const;
+
+private:
+    const LibraryIndex& m_index;
+    std::wstring m_root;
+    std::unordered_map<std::wstring, uint32_t> m_directoryByPath;
+    std::vector<std::vector<uint32_t>> m_children;
+};
+
+// Remplit un catalogue avec le contenu de l'index, sans construire les chemins complets
+// ni reprendre les fichiers refuses
+void LoadCatalogFromIndex(const LibraryIndex& index, ImageCatalog& catalog);
+
+// Ecrit l'index complet d'un parcours (WalkOptions::collectDetails). Le fichier est
+// d'abord ecrit a cote puis renomme ; toute vue sur l'ancien index doit etre fermee
+// avant (Windows refuse de remplacer un fichier projete).
+bool SaveLibraryIndex(const std::wstring& indexPath, const std::wstring& root,
+    const std::vector<WalkDirectoryInfo>& directories);
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Cache LRU limite en octets. Les valeurs sont partagees : une entree evincee reste
+// valide tant qu'un appelant la detient. Utilisable depuis plusieurs threads.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t bytes = 0;
+        size_t entries = 0;
+    };
+
+    explicit LruCache(size_t byteBudget) : m_budget(byteBudget) {}
+
+    std::shared_ptr<Value> Get(const Key& key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            ++m_stats.misses;
+            return nullptr;
+        }
+        ++m_stats.hits;
+        m_order.splice(m_order.begin(), m_order, it->second);
+        return it->second->value;
+    }
+
+    bool Contains(const Key& key) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_index.find(key) != m_index.end();
+    }
+
+    // Une valeur plus grosse que le budget n'est pas gardee
+    void Put(const Key& key, std::shared_ptr<Value> value, size_t bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_stats.bytes -= it->second->bytes;
+            m_order.erase(it->second);
+            m_index.erase(it);
+        }
+        if (bytes > m_budget) return;
+
+        m_order.push_front(Node{ key, std::move(value), bytes });
+        m_index.emplace(key, m_order.begin());
+        m_stats.bytes += bytes;
+        EvictToBudget();
+    }
+
+    void Erase(const Key& key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return;
+        m_stats.bytes -= it->second->bytes;
+        m_order.erase(it->second);
+        m_index.erase(it);
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_order.clear();
+        m_index.clear();
+        m_stats.bytes = 0;
+    }
+
+    void SetBudget(size_t byteBudget) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_budget = byteBudget;
+        EvictToBudget();
+    }
+
+    size_t Budget() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_budget;
+    }
+
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats stats = m_stats;
+        stats.entries = m_index.size();
+        return stats;
+    }
+
+private:
+    struct Node {
+        Key key;
+        std::shared_ptr<Value> value;
+        size_t bytes;
+    };
+
+    void EvictToBudget() {
+        while (m_stats.bytes > m_budget && !m_order.empty()) {
+            const Node& last = m_order.back();
+            m_stats.bytes -= last.bytes;
+            m_index.erase(last.key);
+            m_order.pop_back();
+            ++m_stats.evictions;
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    size_t m_budget;
+    std::list<Node> m_order;
+    std::unordered_map<Key, typename std::list<Node>::iterator, Hash> m_index;
+    Stats m_stats;
+};
+
+// Cle des images decodees : une modification du fichier change la date et invalide l'entree
+struct ImageCacheKey {
+    std::wstring path;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+
+    bool operator==(const ImageCacheKey& other) const {
+        return mtime == other.mtime && size == other.size && path == other.path;
+    }
+};
+
+struct ImageCacheKeyHash {
+    size_t operator()(const ImageCacheKey& key) const {
+        size_t hash = std::hash<std::wstring>()(key.path);
+        hash ^= std::hash<int64_t>()(key.mtime) + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
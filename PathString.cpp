@@ -0,0 +1,159 @@
+#include "PathString.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+bool IsPathSeparator(wchar_t c) {
+#ifdef _WIN32
+    return c == L'/' || c == L'\\';
+#else
+    return c == L'/';
+#endif
+}
+
+size_t FindLastSeparator(std::wstring_view path) {
+    for (size_t i = path.size(); i > 0; --i) {
+        if (IsPathSeparator(path[i - 1])) return i - 1;
+    }
+    return std::wstring::npos;
+}
+
+std::string WideToUtf8(const std::wstring& text) {
+#ifdef _WIN32
+    if (text.empty()) return {};
+    int size = WideCharToMultiByte(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0, nullptr, nullptr);
+    std::string out(size, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text.data(), (int)text.size(), out.data(), size, nullptr, nullptr);
+    return out;
+#else
+    std::string out;
+    out.reserve(text.size());
+    for (wchar_t wc : text) {
+        char32_t c = (char32_t)wc;
+        if (c >= 0xDC80 && c <= 0xDCFF) {
+            // Octet invalide conserve par Utf8ToWide
+            out += (char)(c & 0xFF);
+        }
+        else if (c < 0x80) {
+            out += (char)c;
+        }
+        else if (c < 0x800) {
+            out += (char)(0xC0 | (c >> 6));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000) {
+            out += (char)(0xE0 | (c >> 12));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+        else {
+            out += (char)(0xF0 | (c >> 18));
+            out += (char)(0x80 | ((c >> 12) & 0x3F));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+#endif
+}
+
+std::wstring Utf8ToWide(const std::string& text) {
+#ifdef _WIN32
+    if (text.empty()) return {};
+    int size = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0);
+    std::wstring out(size, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), out.data(), size);
+    return out;
+#else
+    std::wstring out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = (unsigned char)text[i];
+        size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            // Octet invalide : conserve dans un demi-code de substitution pour l'aller-retour
+            out += (wchar_t)(0xDC00 | c);
+            ++i;
+            continue;
+        }
+        char32_t cp = length == 1 ? c : c & (0x7F >> length);
+        for (size_t k = 1; k < length; ++k) {
+            cp = (cp << 6) | ((unsigned char)text[i + k] & 0x3F);
+        }
+        out += (wchar_t)cp;
+        i += length;
+    }
+    return out;
+#endif
+}
+
+std::wstring PathToWide(const fs::path& path) {
+#ifdef _WIN32
+    return path.native();
+#else
+    return Utf8ToWide(path.native());
+#endif
+}
+
+fs::path WideToPath(const std::wstring& path) {
+#ifdef _WIN32
+    return fs::path(path);
+#else
+    return fs::path(WideToUtf8(path));
+#endif
+}
+
+std::u16string WideToUtf16(const std::wstring& text) {
+#ifdef _WIN32
+    return std::u16string(text.begin(), text.end());
+#else
+    std::u16string out;
+    out.reserve(text.size());
+    for (wchar_t wc : text) {
+        char32_t c = (char32_t)wc;
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            out += (char16_t)(0xD800 | (c >> 10));
+            out += (char16_t)(0xDC00 | (c & 0x3FF));
+        }
+        else {
+            out += (char16_t)c;
+        }
+    }
+    return out;
+#endif
+}
+
+std::wstring Utf16ToWide(const char16_t* text, size_t length) {
+#ifdef _WIN32
+    return std::wstring((const wchar_t*)text, length);
+#else
+    std::wstring out;
+    out.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        char32_t c = text[i];
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < length && text[i + 1] >= 0xDC00 && text[i + 1] < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+            ++i;
+        }
+        out += (wchar_t)c;
+    }
+    return out;
+#endif
+}
+
+uint64_t FileKey(const std::wstring& fullPath, int64_t mtime) {
+    // FNV-1a sur le chemin, puis melange avec la date (finaliseur de SplitMix64)
+    uint64_t key = 1469598103934665603ull;
+    for (wchar_t c : fullPath) {
+        key ^= (uint64_t)c;
+        key *= 1099511628211ull;
+    }
+    key ^= (uint64_t)mtime * 0x9E3779B97F4A7C15ull;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
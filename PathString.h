@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Conversions entre fs::path et les chemins std::wstring utilises partout dans l'application.
+// Sous Windows c'est le format natif ; ailleurs les noms sont convertis en UTF-8 <-> UTF-32
+// sans passer par la locale, qui refuse les caracteres non ASCII par defaut.
+std::wstring PathToWide(const std::filesystem::path& path);
+std::filesystem::path WideToPath(const std::wstring& path);
+
+// Separateurs de chemin : '/' partout, et '\' aussi sous Windows
+bool IsPathSeparator(wchar_t c);
+// Position du dernier separateur, ou std::wstring::npos
+size_t FindLastSeparator(std::wstring_view path);
+
+// Conversion UTF-8 (noms de fichiers, formats sur disque)
+std::string WideToUtf8(const std::wstring& text);
+std::wstring Utf8ToWide(const std::string& text);
+
+// Conversion UTF-16 (format des index sur disque, identique a wchar_t sous Windows)
+std::u16string WideToUtf16(const std::wstring& text);
+std::wstring Utf16ToWide(const char16_t* text, size_t length);
+
+// Cle 64 bits d'un fichier dans les caches sur disque (HashStore, ThumbnailAtlas) : le
+// chemin complet et la date, une modification du fichier donne une autre cle
+uint64_t FileKey(const std::wstring& fullPath, int64_t mtime);
@@ -0,0 +1,189 @@
+#include "PerceptualHash.h"
+
+#include "ImageDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+namespace {
+    constexpr int ReducedSize = 32;
+    constexpr int LowFrequencies = 8;
+    // Taille demandee au decodeur : la reduction la plus forte (1/8) suffit presque toujours
+    constexpr int DecodeTarget = 64;
+
+    // cos((2x + 1) * u * pi / 64) pour les 8 premieres frequences de la DCT-II sur 32 points
+    struct DctTable {
+        float values[LowFrequencies][ReducedSize];
+
+        DctTable() {
+            for (int u = 0; u < LowFrequencies; ++u) {
+                for (int x = 0; x < ReducedSize; ++x) {
+                    values[u][x] = (float)std::cos((2 * x + 1) * u * 3.14159265358979 / (2 * ReducedSize));
+                }
+            }
+        }
+    };
+
+    ImageId FindRoot(std::vector<ImageId>& parent, ImageId id) {
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    }
+}
+
+PerceptualHash DctHash(const ConstImageView& image, SimdLevel simd) {
+    static const DctTable table;
+
+    uint8_t pixels[ReducedSize * ReducedSize * 4];
+    ImageView reduced{ pixels, ReducedSize, ReducedSize, ReducedSize * 4 };
+    ResampleOptions options;
+    options.filter = ResampleFilter::Box;
+    options.simd = simd;
+    if (!ResampleImage(image, reduced, options)) return 0;
+
+    // Luminance BT.601
+    float luma[ReducedSize][ReducedSize];
+    for (int y = 0; y < ReducedSize; ++y) {
+        for (int x = 0; x < ReducedSize; ++x) {
+            const uint8_t* pixel = pixels + (y * ReducedSize + x) * 4;
+            luma[y][x] = pixel[0] * 0.114f + pixel[1] * 0.587f + pixel[2] * 0.299f;
+        }
+    }
+
+    // DCT separable, limitee aux basses frequences : lignes puis colonnes
+    float rows[ReducedSize][LowFrequencies];
+    for (int y = 0; y < ReducedSize; ++y) {
+        for (int u = 0; u < LowFrequencies; ++u) {
+            float sum = 0.0f;
+            for (int x = 0; x < ReducedSize; ++x) sum += luma[y][x] * table.values[u][x];
+            rows[y][u] = sum;
+        }
+    }
+    float coefficients[LowFrequencies * LowFrequencies];
+    for (int v = 0; v < LowFrequencies; ++v) {
+        for (int u = 0; u < LowFrequencies; ++u) {
+            float sum = 0.0f;
+            for (int y = 0; y < ReducedSize; ++y) sum += table.values[v][y] * rows[y][u];
+            coefficients[v * LowFrequencies + u] = sum;
+        }
+    }
+
+    // Mediane sans la composante continue, qui ne depend que de la luminosite moyenne
+    float sorted[LowFrequencies * LowFrequencies - 1];
+    std::copy(coefficients + 1, coefficients + LowFrequencies * LowFrequencies, sorted);
+    std::nth_element(sorted, sorted + 31, sorted + 63);
+    float median = sorted[31];
+
+    PerceptualHash hash = 0;
+    for (int i = 1; i < LowFrequencies * LowFrequencies; ++i) {
+        hash = (hash << 1) | (coefficients[i] > median ? 1u : 0u);
+    }
+    return hash;
+}
+
+bool HashImageFile(const std::wstring& path, PerceptualHash& hash) {
+    DecodedImage image;
+    if (!DecodeImageFile(path, DecodeTarget, DecodeTarget, image)) return false;
+    hash = DctHash(image.View());
+    return true;
+}
+
+bool HashImageMemory(const uint8_t* data, size_t size, PerceptualHash& hash) {
+    DecodedImage image;
+    if (!DecodeImageMemory(data, size, DecodeTarget, DecodeTarget, image)) return false;
+    hash = DctHash(image.View());
+    return true;
+}
+
+void DuplicateGroups::Clear() {
+    m_group.clear();
+    m_size.clear();
+    m_groupCount = 0;
+    m_duplicateGroupCount = 0;
+    m_duplicateCount = 0;
+}
+
+uint32_t DuplicateGroups::GroupSize(ImageId id) const {
+    if (id >= m_group.size()) return 1;
+    return std::max<uint32_t>(1, m_size[m_group[id]]);
+}
+
+void DuplicateGroups::Build(const ImageCatalog& catalog) {
+    size_t count = catalog.Size();
+    std::vector<ImageId> parent(count);
+    std::iota(parent.begin(), parent.end(), 0);
+
+    std::vector<ImageId> hashed;
+    hashed.reserve(count);
+    for (ImageId id = 0; id < (ImageId)count; ++id) {
+        if (catalog.ImageHash(id) != 0 && !catalog.IsExcluded(id)) hashed.push_back(id);
+    }
+
+    // Pour chaque bloc de 16 bits, images rangees par valeur du bloc (tri par comptage) :
+    // le seau v est ids[offsets[v] .. offsets[v + 1]), avec les empreintes a cote dans
+    // `sortedHashes` pour les comparer sans aller les chercher dans le catalogue
+    std::vector<uint32_t> offsets(65537);
+    std::vector<uint32_t> next(65536);
+    std::vector<ImageId> ids(hashed.size());
+    std::vector<PerceptualHash> sortedHashes(hashed.size());
+    auto unite = [&](ImageId a, ImageId b) {
+        // La plus petite image du groupe en est le representant
+        a = FindRoot(parent, a);
+        b = FindRoot(parent, b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    };
+    for (int band = 0; band < 4; ++band) {
+        int shift = 16 * band;
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (ImageId id : hashed) ++offsets[((catalog.ImageHash(id) >> shift) & 0xFFFF) + 1];
+        for (size_t v = 1; v < offsets.size(); ++v) offsets[v] += offsets[v - 1];
+        std::copy(offsets.begin(), offsets.end() - 1, next.begin());
+        for (ImageId id : hashed) {
+            PerceptualHash hash = catalog.ImageHash(id);
+            uint32_t slot = next[(hash >> shift) & 0xFFFF]++;
+            ids[slot] = id;
+            sortedHashes[slot] = hash;
+        }
+
+        for (uint32_t value = 0; value < 65536; ++value) {
+            for (uint32_t i = offsets[value]; i < offsets[value + 1]; ++i) {
+                PerceptualHash hash = sortedHashes[i];
+                // Meme valeur du bloc : chaque paire une seule fois
+                for (uint32_t j = i + 1; j < offsets[value + 1]; ++j) {
+                    if (HashDistance(hash, sortedHashes[j]) <= DuplicateHashDistance) unite(ids[i], ids[j]);
+                }
+                // Bloc a un bit pres : seulement vers les valeurs plus grandes, l'autre sens
+                // est couvert depuis le seau voisin
+                for (int bit = 0; bit < 16; ++bit) {
+                    uint32_t probe = value ^ (1u << bit);
+                    if (probe < value) continue;
+                    for (uint32_t j = offsets[probe]; j < offsets[probe + 1]; ++j) {
+                        if (HashDistance(hash, sortedHashes[j]) <= DuplicateHashDistance) unite(ids[i], ids[j]);
+                    }
+                }
+            }
+        }
+    }
+
+    m_group.resize(count);
+    m_size.assign(count, 0);
+    m_groupCount = 0;
+    m_duplicateGroupCount = 0;
+    m_duplicateCount = 0;
+    for (ImageId id = 0; id < (ImageId)count; ++id) {
+        m_group[id] = FindRoot(parent, id);
+        if (!catalog.IsExcluded(id)) ++m_size[m_group[id]];
+    }
+    for (ImageId id = 0; id < (ImageId)count; ++id) {
+        if (m_group[id] != id || m_size[id] == 0) continue;
+        ++m_groupCount;
+        if (m_size[id] > 1) {
+            ++m_duplicateGroupCount;
+            m_duplicateCount += m_size[id];
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ImageCatalog.h"
+#include "Resampler.h"
+
+// Empreinte perceptuelle (pHash) : l'image est reduite a 32x32 en niveaux de gris, et
+// chaque bit indique si un des 8x8 coefficients basse frequence de sa DCT est au-dessus de
+// leur mediane. Deux copies de la meme photo (reencodage, redimensionnement, autre format)
+// ont des empreintes a quelques bits pres, deux photos differentes en general a plus de 15.
+// 0 signifie "pas d'empreinte" (une image parfaitement uniforme n'en a pas).
+using PerceptualHash = uint64_t;
+
+// Ecart maximal (bits differents) entre deux empreintes de la meme image
+constexpr int DuplicateHashDistance = 6;
+
+inline int HashDistance(PerceptualHash a, PerceptualHash b) {
+    return (int)std::bitset<64>(a ^ b).count();
+}
+
+// Empreinte d'une image BGRA ; la reduction passe par ResampleImage (filtre Box, noyaux SIMD)
+PerceptualHash DctHash(const ConstImageView& image, SimdLevel simd = SimdLevel::Auto);
+
+// Decode le fichier en basse resolution (reduction 1/8 dans le domaine DCT pour un JPEG)
+// puis calcule son empreinte ; false si le fichier ne se decode pas
+bool HashImageFile(const std::wstring& path, PerceptualHash& hash);
+// Meme chose sur le contenu deja lu du fichier (HashIndexer et sa lecture d'avance)
+bool HashImageMemory(const uint8_t* data, size_t size, PerceptualHash& hash);
+
+// Groupes de quasi-doublons du catalogue : images dont les empreintes sont a au plus
+// DuplicateHashDistance bits. Les paires candidates sont trouvees sans comparer toutes
+// les empreintes entre elles : deux empreintes a 7 bits ou moins ont forcement un de
+// leurs quatre blocs de 16 bits egal ou a un bit pres, et seules les empreintes de ces
+// 17 valeurs du bloc sont comparees.
+class DuplicateGroups {
+public:
+    void Build(const ImageCatalog& catalog);
+    void Clear();
+
+    // Groupe de l'image (l'image elle-meme si elle n'a pas de doublon ou pas d'empreinte)
+    ImageId Group(ImageId id) const { return id < m_group.size() ? m_group[id] : id; }
+    // Images non exclues du groupe de `id`, au moins 1
+    uint32_t GroupSize(ImageId id) const;
+
+    size_t GroupCount() const { return m_groupCount; }
+    // Groupes de plus d'une image, et nombre d'images qu'ils contiennent
+    size_t DuplicateGroupCount() const { return m_duplicateGroupCount; }
+    size_t DuplicateCount() const { return m_duplicateCount; }
+
+private:
+    std::vector<ImageId> m_group;
+    std::vector<uint32_t> m_size;
+    size_t m_groupCount = 0;
+    size_t m_duplicateGroupCount = 0;
+    size_t m_duplicateCount = 0;
+};
@@ -4,15 +4,37 @@
 #include <shlobj.h>
 #include <string>
 #include <vector>
-#include <random>
+#include <memory>
 #include <filesystem>
-#include <gdiplus.h>
 #include <sstream>
 #include <shellapi.h>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cwchar>
 #include <shobjidl.h> 
 #include <shlwapi.h>
 
+#include "RandomPicture.h"
+#include "BackBuffer.h"
+#include "ChangeWatcher.h"
+#include "DisplayScaler.h"
+#include "HistoryRing.h"
+#include "ImageCatalog.h"
+#include "ImageFilter.h"
+#include "ImageScanner.h"
+#include "ImageLoader.h"
+#include "ImageProbe.h"
+#include "HashIndexer.h"
+#include "ImagePrefetcher.h"
+#include "ImagePyramid.h"
+#include "InstantPicker.h"
+#include "LibraryIndex.h"
+#include "PathString.h"
+#include "RandomSelector.h"
+#include "ThumbnailAtlas.h"
+#include "Trace.h"
+
 #pragma comment(lib, "shlwapi.lib")
 #pragma comment(lib, "gdiplus.lib")
 #pragma comment(lib, "shell32.lib")
@@ -20,12 +42,19 @@
 
 namespace fs = std::filesystem;
 
+// Contenu de la grille de miniatures (touche G)
+enum class GridSource {
+    Off,
+    Catalog,
+    History,
+};
+
 // Structure pour gerer l'etat de l'application
 struct AppState {
     std::wstring currentImage;
-    std::vector<std::wstring> imageFiles;
-    std::vector<std::wstring> history;
-    size_t historyIndex = 0;
+    ImageCatalog imageFiles;
+    // Dernieres images affichees (--history=N)
+    HistoryRing history;
     std::wstring currentFolder;
     ULONG_PTR gdiplusToken;
     bool gdiplusInitialized = false;
@@ -33,8 +62,88 @@ struct AppState {
     bool isDragging = false;
     bool englishLanguage = false;
     bool showHistory = false;
+    ImageScanner scanner;
+    bool waitingForFirstImage = false;
+    // Fichiers et dossiers deposes : parcourus et sondes par un second scanner (sans index),
+    // puis ajoutes au catalogue ; ils y restent quand le catalogue du dossier est remplace
+    ImageScanner dropScanner;
+    std::vector<std::wstring> dropRoots;
+    ImageCatalog droppedFiles;
+    // Images ajoutees par les lots du depot en cours, avant la sonde
+    std::vector<ImageId> dropBatchIds;
+    // Sans index du dossier, images tirees par une marche dans l'arborescence jusqu'a la fin
+    // du scan (--no-instant pour attendre les lots du scan), et leur ecart au tirage uniforme
+    InstantPicker instantPicker;
+    bool instantPick = true;
+    InstantPickReport instantReport;
+    // Ajouts et suppressions dans le dossier apres le scan
+    ChangeWatcher watcher;
+    // Changements recus pendant le scan, rejoues sur chaque catalogue qu'il publie
+    std::vector<FileChange> changesDuringScan;
+    // Tirage des images (--seed, --pick, touche M)
+    RandomSelector selector;
+    // Tirage limite aux images qui passent le filtre (--filter, champ Filtre)
+    CatalogFilter filter;
+    std::wstring filterText;
+    // Empreintes perceptuelles calculees apres le scan : les quasi-doublons sont tires
+    // comme une seule image (--no-dedup pour desactiver)
+    HashIndexer hashIndexer;
+    DuplicateGroups duplicates;
+    bool skipDuplicates = true;
+    // Images decodees, limitees en memoire (--cache-mb)
+    DecodedImageCache imageCache{ (size_t)512 << 20 };
+    // Prochaines images tirees et decodees a l'avance (--prefetch)
+    ImagePrefetcher prefetcher{ imageCache };
+    // Image courante deja a la taille de la fenetre : un affichage normal est une copie 1:1
+    ScaledImage display;
+    DisplayScaler displayScaler{ imageCache };
+    bool inSizeMove = false;
+    // Derniere image que DisplayImage n'a pas pu charger (WM_APP_IMAGE_FAILED)
+    std::wstring failedImage;
+    // Temps des dernieres etapes affiches sur l'image (bouton Temps ON/OFF) ; la trace est
+    // active tant qu'ils sont affiches ou avec --trace
+    bool showTimings = false;
+    // --trace[=fichier] : trace active des le demarrage et ecrite a la fermeture
+    std::wstring traceFile;
+    // Grille : seules les cases visibles sont dessinees, depuis l'atlas projete du dossier
+    GridSource grid = GridSource::Off;
+    int64_t gridScroll = 0;
+    std::vector<ImageId> gridItems;
+    ThumbnailAtlas thumbnails;
+    ThumbnailGenerator thumbnailGenerator;
+    // Zoom (molette, +/-, 0) et deplacement a la souris : au-dela de l'image ajustee a la
+    // fenetre, l'image est dessinee par tuiles de sa pyramide, decodees a la demande et
+    // limitees en memoire (--tile-cache-mb) ; l'image ajustee sert de fond tant qu'elles manquent
+    std::shared_ptr<const ImagePyramid> pyramid;
+    // 1 : image entiere dans la fenetre
+    double zoom = 1.0;
+    // Centre de la vue, en pixels de l'image
+    double zoomCenterX = 0;
+    double zoomCenterY = 0;
+    bool isPanning = false;
+    POINT panLast{};
+    // Sens du dernier deplacement de la vue, pour le prefetch des tuiles
+    int panX = 0;
+    int panY = 0;
+    TileCache tiles{ (size_t)128 << 20 };
+    TileLoader tileLoader;
+    // Derniere vue demandee a tileLoader
+    TileView tileRequest;
+    // Tuiles recues, dans la cle de la couche image zoomee
+    uint64_t tilesReceived = 0;
+    // Rendu hors ecran : l'image et chaque texte sont des couches en cache, redessinees
+    // seulement quand leur contenu change ; seules leurs zones sont recomposees dans backBuffer
+    FrameCompositor compositor;
+    BackBuffer imageLayer;
+    BackBuffer backBuffer;
+    // Texte d'une couche, dessine par GDI avant d'etre repris par compositor
+    BackBuffer textLayer;
 };
 
+void ShowNewImage(HWND hwnd, AppState& state, const std::wstring& path);
+void UpdateScanStatus(HWND hwnd, AppState& state);
+void IngestDroppedItems(HWND hwnd, AppState& state, std::vector<std::wstring> paths);
+
 // Implementation de IDropTarget pour recevoir les fichiers
 class DropTarget : public IDropTarget {
 public:
@@ -79,25 +188,21 @@ public:
 
         if (SUCCEEDED(pDataObj->GetData(&fmt, &stg))) {
             HDROP hDrop = (HDROP)stg.hGlobal;
-            UINT fileCount = DragQueryFile(hDrop, 0xFFFFFFFF, NULL, 0);
+            UINT fileCount = DragQueryFileW(hDrop, 0xFFFFFFFF, NULL, 0);
 
+            // Tous les elements deposes, fichiers et dossiers ; la longueur de chaque chemin
+            // est demandee d'abord, sans limite MAX_PATH
+            std::vector<std::wstring> paths;
+            paths.reserve(fileCount);
             for (UINT i = 0; i < fileCount; ++i) {
-                wchar_t filePath[MAX_PATH];
-                if (DragQueryFile(hDrop, i, filePath, MAX_PATH)) {
-                    std::wstring ext = fs::path(filePath).extension().wstring();
-                    std::transform(ext.begin(), ext.end(), ext.begin(), towlower);
-
-                    if (ext == L".jpg" || ext == L".jpeg" || ext == L".png" || ext == L".bmp") {
-                        m_pState->currentImage = filePath;
-                        m_pState->history.push_back(filePath);
-                        m_pState->historyIndex = m_pState->history.size() - 1;
-                        InvalidateRect(m_hwnd, NULL, TRUE);
-                        break; // on prend la première image valide
-                    }
-                }
+                UINT length = DragQueryFileW(hDrop, i, NULL, 0);
+                if (length == 0) continue;
+                std::wstring path(length, L'\0');
+                if (DragQueryFileW(hDrop, i, &path[0], length + 1) == length) paths.push_back(std::move(path));
             }
 
             ReleaseStgMedium(&stg);
+            IngestDroppedItems(m_hwnd, *m_pState, std::move(paths));
         }
 
         *pdwEffect = DROPEFFECT_COPY;
@@ -192,112 +297,751 @@ std::wstring SelectFolder(HWND hwnd) {
     return L"";
 }
 
-void ScanDirectoryRecursive(const std::wstring& directory, std::vector<std::wstring>& images) {
-    try {
-        for (const auto& entry : fs::recursive_directory_iterator(directory)) {
-            if (entry.is_regular_file()) {
-                std::wstring ext = entry.path().extension().wstring();
-                std::transform(ext.begin(), ext.end(), ext.begin(), towlower);
+// Fichier de trace de la touche T sans --trace=fichier
+std::wstring DefaultTracePath() {
+    std::error_code ec;
+    fs::path directory = fs::temp_directory_path(ec);
+    return (directory / L"RandomPictureTrace.json").wstring();
+}
 
-                if (ext == L".jpg" || ext == L".jpeg" || ext == L".png" || ext == L".bmp") {
-                    images.push_back(entry.path().wstring());
-                }
+// Options de la ligne de commande : --cache-mb=N (memoire des images decodees),
+// --scan-threads=N (threads du parcours des dossiers), --prefetch=N (images preparees d'avance),
+// --seed=N (suite de tirages reproductible), --pick=uniform|shuffle|folders|recent,
+// --history=N (taille de l'historique), --no-probe (pas de lecture des entetes pendant le scan),
+// --no-dedup (pas d'empreintes ni de regroupement des doublons), --hash-threads=N,
+// --trace[=fichier] (trace Chrome des etapes, ecrite a la fermeture), --no-instant (premiere
+// image tiree dans les lots du scan plutot que par une marche dans l'arborescence),
+// --filter="..." (criteres du tirage, voir ParseImageFilter)
+void ApplyCommandLine(AppState& state) {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) return;
+
+    for (int i = 1; i < argc; ++i) {
+        std::wstring arg = argv[i];
+        if (arg.rfind(L"--cache-mb=", 0) == 0) {
+            state.imageCache.SetBudget((size_t)wcstoull(arg.c_str() + 11, nullptr, 10) << 20);
+        }
+        else if (arg.rfind(L"--tile-cache-mb=", 0) == 0) {
+            state.tiles.SetBudget((size_t)wcstoull(arg.c_str() + 16, nullptr, 10) << 20);
+        }
+        else if (arg.rfind(L"--scan-threads=", 0) == 0) {
+            state.scanner.threadCount = (size_t)wcstoull(arg.c_str() + 15, nullptr, 10);
+        }
+        else if (arg.rfind(L"--prefetch=", 0) == 0) {
+            state.prefetcher.depth = (size_t)wcstoull(arg.c_str() + 11, nullptr, 10);
+        }
+        else if (arg.rfind(L"--history=", 0) == 0) {
+            state.history.SetCapacity((size_t)wcstoull(arg.c_str() + 10, nullptr, 10));
+        }
+        else if (arg.rfind(L"--seed=", 0) == 0) {
+            state.selector.Seed(wcstoull(arg.c_str() + 7, nullptr, 10));
+        }
+        else if (arg.rfind(L"--pick=", 0) == 0) {
+            std::string name(arg.begin() + 7, arg.end());
+            SelectionMode mode;
+            if (ParseSelectionMode(name.c_str(), mode)) state.selector.SetMode(mode);
+        }
+        else if (arg == L"--no-dedup") {
+            state.skipDuplicates = false;
+        }
+        else if (arg.rfind(L"--hash-threads=", 0) == 0) {
+            state.hashIndexer.threadCount = (size_t)wcstoull(arg.c_str() + 15, nullptr, 10);
+        }
+        else if (arg == L"--no-probe") {
+            state.scanner.probeImages = false;
+            state.watcher.probeImages = false;
+        }
+        else if (arg == L"--no-instant") {
+            state.instantPick = false;
+        }
+        else if (arg.rfind(L"--filter=", 0) == 0) {
+            ImageFilter filter;
+            if (ParseImageFilter(arg.substr(9), filter)) {
+                state.filter.SetFilter(std::move(filter));
+                state.filterText = arg.substr(9);
             }
         }
-        std::sort(images.begin(), images.end());
-    }
-    catch (const std::exception& e) {
-        std::wstringstream ss;
-        ss << L"Erreur : " << e.what();
-        OutputDebugStringW(ss.str().c_str());
+        else if (arg == L"--trace" || arg.rfind(L"--trace=", 0) == 0) {
+            state.traceFile = arg.size() > 8 ? arg.substr(8) : DefaultTracePath();
+            SetTraceEnabled(true);
+        }
     }
+    LocalFree(argv);
 }
 
-std::vector<std::wstring> GetImageFiles(const std::wstring& folder) {
-    std::vector<std::wstring> images;
-    ScanDirectoryRecursive(folder, images);
-    return images;
+// Demande la version haute qualite de l'image courante a la taille de la fenetre
+void RequestDisplayScale(HWND hwnd, AppState& state, SIZE clientSize) {
+    if (state.displayScaler.IsRequested(state.currentImage, clientSize)) return;
+    state.displayScaler.Request(state.currentImage, clientSize, [hwnd]() {
+        PostMessageW(hwnd, WM_APP_DISPLAY_SCALED, 0, 0);
+    });
 }
 
-std::wstring GetRandomImage(const std::vector<std::wstring>& images) {
-    if (images.empty()) return L"";
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<size_t> distrib(0, images.size() - 1);
-    return images[distrib(gen)];
+// Couches de texte au-dessus de l'image, dans l'ordre de dessin
+enum TextLayer : size_t {
+    FileNameLayer,
+    HistoryLayer,
+    TimingLayer,
+};
+
+const int TextLineHeight = 15;
+const int TimingBoxWidth = 190;
+
+// Lignes des temps des dernieres etapes (Trace). Le total du dessin est celui de
+// l'affichage precedent, celui-ci n'etant pas termine.
+std::vector<std::wstring> TimingLines(const AppState& state) {
+    struct TimingLine {
+        TraceStage stage;
+        const wchar_t* english;
+        const wchar_t* french;
+    };
+    const TimingLine lines[] = {
+        { TraceStage::Decode, L"Decode", L"Decodage" },
+        { TraceStage::Scale, L"Scale", L"Mise a l'echelle" },
+        { TraceStage::Blit, L"Draw", L"Dessin" },
+        { TraceStage::Text, L"Text", L"Texte" },
+        { TraceStage::Paint, L"Paint", L"Affichage" },
+    };
+    std::vector<std::wstring> result;
+    wchar_t text[64];
+    for (const TimingLine& line : lines) {
+        int length = swprintf(text, 64, L"%ls : %.2f ms", state.englishLanguage ? line.english : line.french,
+            LastTraceDuration(line.stage) / 1e6);
+        result.emplace_back(text, (size_t)std::max(0, length));
+    }
+    return result;
 }
 
-void DisplayImage(HWND hwnd, const std::wstring& imagePath, AppState& state) {
-    if (!InitializeGDIplus(state)) return;
+// Temps des dernieres etapes en haut a droite, dessines directement (grille)
+void DrawTimingOverlay(HDC hdc, const RECT& clientRect, const AppState& state) {
+    std::vector<std::wstring> lines = TimingLines(state);
+    RECT box{ clientRect.right - TimingBoxWidth - 10, 10, clientRect.right - 10, 18 + TextLineHeight * (int)lines.size() };
+    FillRect(hdc, &box, (HBRUSH)GetStockObject(WHITE_BRUSH));
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, RGB(0, 0, 0));
+    int y = box.top + 4;
+    for (const std::wstring& line : lines) {
+        TextOutW(hdc, box.left + 6, y, line.c_str(), (int)line.length());
+        y += TextLineHeight;
+    }
+}
 
-    Gdiplus::Image image(imagePath.c_str());
-    if (image.GetLastStatus() != Gdiplus::Ok || image.GetWidth() == 0 || image.GetHeight() == 0) {
-        MessageBoxW(hwnd,
-            state.englishLanguage ? L"Unable to load image or invalid image" : L"Impossible de charger l'image ou image invalide",
-            state.englishLanguage ? L"Error" : L"Erreur",
-            MB_ICONERROR);
+// Cle du contenu d'une couche de texte (FNV-1a sur les lignes)
+uint64_t TextKey(const std::vector<std::wstring>& lines) {
+    uint64_t key = 14695981039346656037ull;
+    for (const std::wstring& line : lines) {
+        for (wchar_t c : line) key = (key ^ (uint64_t)c) * 1099511628211ull;
+        key = (key ^ 0x10000) * 1099511628211ull;
+    }
+    return key;
+}
+
+// Couche de texte `layer` en (x, y), une ligne tous les TextLineHeight pixels, sur fond
+// transparent ou dans un encadre blanc de largeur `boxWidth`. Le texte n'est redessine (noir
+// sur blanc dans textLayer, puis converti par le compositeur) que s'il a change.
+void UpdateTextLayer(AppState& state, size_t layer, int x, int y, const std::vector<std::wstring>& lines, int boxWidth) {
+    HDC measure = state.backBuffer.Dc();
+    int width = boxWidth, height = 8 + TextLineHeight * (int)lines.size();
+    if (boxWidth == 0) {
+        TEXTMETRICW metrics;
+        GetTextMetricsW(measure, &metrics);
+        for (const std::wstring& line : lines) {
+            SIZE extent;
+            if (GetTextExtentPoint32W(measure, line.c_str(), (int)line.length(), &extent)) width = std::max(width, (int)extent.cx);
+        }
+        height = lines.empty() ? 0 : TextLineHeight * ((int)lines.size() - 1) + metrics.tmHeight;
+    }
+    if (!state.compositor.SetOverlay(layer, TextKey(lines), PixelRect{ x, y, x + width, y + height })) return;
+    if (!state.textLayer.Reserve(measure, width, height)) {
+        state.compositor.HideOverlay(layer);
         return;
     }
 
-    PAINTSTRUCT ps;
-    HDC hdc = BeginPaint(hwnd, &ps);
+    HDC dc = state.textLayer.Dc();
+    RECT area{ 0, 0, width, height };
+    FillRect(dc, &area, (HBRUSH)GetStockObject(WHITE_BRUSH));
+    SetBkMode(dc, TRANSPARENT);
+    SetTextColor(dc, RGB(0, 0, 0));
+    int textX = boxWidth > 0 ? 6 : 0, textY = boxWidth > 0 ? 4 : 0;
+    for (const std::wstring& line : lines) {
+        TextOutW(dc, textX, textY, line.c_str(), (int)line.length());
+        textY += TextLineHeight;
+    }
+    GdiFlush();
+    state.compositor.SetOverlayPixels(layer, state.textLayer.ConstView(), boxWidth > 0 ? OverlayPixels::Opaque : OverlayPixels::BlackText);
+}
+
+// Nom du fichier et historique par-dessus l'image, temps en haut a droite
+void UpdateTextLayers(AppState& state, const RECT& clientRect, const std::wstring& imagePath) {
+    UpdateTextLayer(state, FileNameLayer, 10, 80, { fs::path(imagePath).filename().wstring() }, 0);
+
+    if (state.showHistory) {
+        state.compositor.HideOverlay(HistoryLayer);
+    }
+    else {
+        const int top = 100;
+        std::vector<std::wstring> lines{ state.englishLanguage ? L"History :" : L"Historique" };
+        // Seules les lignes qui tiennent dans la fenetre sont dessinees, en gardant l'image
+        // courante visible au milieu de la liste
+        size_t visible = (size_t)std::max(0, (int)(clientRect.bottom - top) / TextLineHeight - 1);
+        size_t count = std::min(visible, state.history.Size());
+        size_t first = state.history.Cursor() > count / 2 ? state.history.Cursor() - count / 2 : 0;
+        first = std::min(first, state.history.Size() - count);
+        for (size_t i = first; i < first + count; ++i) {
+            lines.push_back((i == state.history.Cursor() ? L"> " : L"   ") + state.imageFiles.FullPath(state.history[i]));
+        }
+        UpdateTextLayer(state, HistoryLayer, 10, top, lines, 0);
+    }
+
+    if (state.showTimings) {
+        UpdateTextLayer(state, TimingLayer, clientRect.right - TimingBoxWidth - 10, 10, TimingLines(state), TimingBoxWidth);
+    }
+    else {
+        state.compositor.HideOverlay(TimingLayer);
+    }
+}
+
+// Zoom maximal, en pixels d'ecran par pixel de l'image
+const double MaxZoomScale = 8.0;
+
+bool IsZoomed(const AppState& state) {
+    return state.pyramid && state.zoom > 1.0;
+}
+
+// Pixels d'ecran par pixel de l'image : image ajustee, puis zoomee
+double FitScale(const AppState& state, const RECT& clientRect) {
+    return std::min((double)clientRect.right / state.pyramid->Width(), (double)clientRect.bottom / state.pyramid->Height());
+}
+
+double ZoomScale(const AppState& state, const RECT& clientRect) {
+    return FitScale(state, clientRect) * state.zoom;
+}
+
+// Garde la fenetre couverte par l'image ; sur un axe ou l'image est plus petite, elle est centree
+void ClampZoomCenter(AppState& state, const RECT& clientRect) {
+    double scale = ZoomScale(state, clientRect);
+    double halfWidth = clientRect.right / 2.0 / scale, halfHeight = clientRect.bottom / 2.0 / scale;
+    double width = state.pyramid->Width(), height = state.pyramid->Height();
+    state.zoomCenterX = halfWidth * 2 >= width ? width / 2 : std::clamp(state.zoomCenterX, halfWidth, width - halfWidth);
+    state.zoomCenterY = halfHeight * 2 >= height ? height / 2 : std::clamp(state.zoomCenterY, halfHeight, height - halfHeight);
+}
 
+void ResetZoom(AppState& state) {
+    state.zoom = 1.0;
+    state.isPanning = false;
+    state.panX = 0;
+    state.panY = 0;
+    if (!state.pyramid) return;
+    // Les tuiles de l'image quittee ne servent plus
+    state.pyramid.reset();
+    state.tileRequest = TileView();
+    state.tileLoader.Request(TileView());
+    state.tiles.Clear();
+}
+
+// Multiplie le zoom par `factor` en gardant sous (x, y) le meme point de l'image
+void ZoomAt(HWND hwnd, AppState& state, double factor, int x, int y) {
+    if (state.currentImage.empty() || state.grid != GridSource::Off) return;
     RECT clientRect;
     GetClientRect(hwnd, &clientRect);
+    if (clientRect.right <= 0 || clientRect.bottom <= 0) return;
+
+    if (!state.pyramid || state.pyramid->Path() != state.currentImage) {
+        ResetZoom(state);
+        if (factor <= 1.0) return;
+        auto pyramid = std::make_shared<ImagePyramid>();
+        if (!pyramid->Open(state.currentImage)) return;
+        state.zoomCenterX = pyramid->Width() / 2.0;
+        state.zoomCenterY = pyramid->Height() / 2.0;
+        state.pyramid = std::move(pyramid);
+    }
 
-    float imageRatio = (float)image.GetWidth() / image.GetHeight();
-    float clientRatio = (float)clientRect.right / clientRect.bottom;
-
-    int drawWidth, drawHeight;
-    if (clientRatio > imageRatio) {
-        drawHeight = clientRect.bottom;
-        drawWidth = (int)(drawHeight * imageRatio);
+    double previousScale = ZoomScale(state, clientRect);
+    state.zoom = std::clamp(state.zoom * factor, 1.0, std::max(1.0, MaxZoomScale / FitScale(state, clientRect)));
+    if (state.zoom <= 1.0) {
+        ResetZoom(state);
     }
     else {
-        drawWidth = clientRect.right;
-        drawHeight = (int)(drawWidth / imageRatio);
+        double scale = ZoomScale(state, clientRect);
+        double offsetX = x - clientRect.right / 2.0, offsetY = y - clientRect.bottom / 2.0;
+        state.zoomCenterX += offsetX / previousScale - offsetX / scale;
+        state.zoomCenterY += offsetY / previousScale - offsetY / scale;
+        state.panX = 0;
+        state.panY = 0;
+        ClampZoomCenter(state, clientRect);
     }
+    InvalidateRect(hwnd, NULL, FALSE);
+}
 
-    int x = (clientRect.right - drawWidth) / 2;
-    int y = (clientRect.bottom - drawHeight) / 2;
+// Deplacement a la souris : l'image suit le curseur
+void PanZoomedImage(HWND hwnd, AppState& state, int x, int y) {
+    int dx = x - state.panLast.x, dy = y - state.panLast.y;
+    state.panLast = POINT{ x, y };
+    if (dx == 0 && dy == 0) return;
 
-    Gdiplus::Graphics graphics(hdc);
-    graphics.DrawImage(&image, x, y, drawWidth, drawHeight);
+    RECT clientRect;
+    GetClientRect(hwnd, &clientRect);
+    double scale = ZoomScale(state, clientRect);
+    state.zoomCenterX -= dx / scale;
+    state.zoomCenterY -= dy / scale;
+    // La vue va dans le sens oppose au curseur
+    state.panX = dx < 0 ? 1 : dx > 0 ? -1 : 0;
+    state.panY = dy < 0 ? 1 : dy > 0 ? -1 : 0;
+    ClampZoomCenter(state, clientRect);
+    InvalidateRect(hwnd, NULL, FALSE);
+}
 
-    // Afficher le nom du fichier
-    std::wstring fileName = fs::path(imagePath).filename().wstring();
-    SetBkMode(hdc, TRANSPARENT);
-    SetTextColor(hdc, RGB(0, 0, 0));
-    TextOutW(hdc, 10, 80, fileName.c_str(), (int)fileName.length());
+// Image zoomee : l'image ajustee agrandie en fond, puis les tuiles visibles deja decodees.
+// Les tuiles manquantes sont demandees a tileLoader, qui redessine a leur arrivee.
+void DrawZoomedImage(Gdiplus::Graphics& graphics, const RECT& clientRect, AppState& state) {
+    ClampZoomCenter(state, clientRect);
+    const ImagePyramid& pyramid = *state.pyramid;
+    double scale = ZoomScale(state, clientRect);
+    // Origine de l'image sur l'ecran et partie visible, en pixels de l'image
+    double originX = clientRect.right / 2.0 - state.zoomCenterX * scale;
+    double originY = clientRect.bottom / 2.0 - state.zoomCenterY * scale;
+    double visibleLeft = std::max(0.0, -originX / scale), visibleTop = std::max(0.0, -originY / scale);
+    double visibleRight = std::min((double)pyramid.Width(), (clientRect.right - originX) / scale);
+    double visibleBottom = std::min((double)pyramid.Height(), (clientRect.bottom - originY) / scale);
+    if (visibleRight <= visibleLeft || visibleBottom <= visibleTop) return;
+
+    if (Gdiplus::Bitmap* fit = state.display.bitmap.get()) {
+        double ratioX = fit->GetWidth() / (double)pyramid.Width(), ratioY = fit->GetHeight() / (double)pyramid.Height();
+        graphics.SetInterpolationMode(Gdiplus::InterpolationModeLowQuality);
+        graphics.DrawImage(fit,
+            Gdiplus::RectF((Gdiplus::REAL)(originX + visibleLeft * scale), (Gdiplus::REAL)(originY + visibleTop * scale),
+                (Gdiplus::REAL)((visibleRight - visibleLeft) * scale), (Gdiplus::REAL)((visibleBottom - visibleTop) * scale)),
+            (Gdiplus::REAL)(visibleLeft * ratioX), (Gdiplus::REAL)(visibleTop * ratioY),
+            (Gdiplus::REAL)((visibleRight - visibleLeft) * ratioX), (Gdiplus::REAL)((visibleBottom - visibleTop) * ratioY),
+            Gdiplus::UnitPixel);
+    }
+
+    TileView view;
+    view.pyramid = state.pyramid;
+    view.level = pyramid.LevelForScale(scale);
+    // Pixels de l'image couverts par une tuile du niveau
+    double span = std::ldexp((double)ImagePyramid::TileSize, view.level);
+    view.left = (int)(visibleLeft / span);
+    view.top = (int)(visibleTop / span);
+    view.right = std::min(pyramid.TileColumns(view.level), (int)std::ceil(visibleRight / span));
+    view.bottom = std::min(pyramid.TileRows(view.level), (int)std::ceil(visibleBottom / span));
+    view.panX = state.panX;
+    view.panY = state.panY;
+
+    // Bords etendus par miroir : le filtrage ne melange pas le bord d'une tuile avec du vide
+    Gdiplus::ImageAttributes attributes;
+    attributes.SetWrapMode(Gdiplus::WrapModeTileFlipXY);
+    graphics.SetInterpolationMode(Gdiplus::InterpolationModeBilinear);
+    graphics.SetPixelOffsetMode(Gdiplus::PixelOffsetModeHalf);
+    for (int y = view.top; y < view.bottom; ++y) {
+        for (int x = view.left; x < view.right; ++x) {
+            std::shared_ptr<DecodedImage> tile = state.tiles.Get(TileKey{ pyramid.Id(), view.level, x, y });
+            if (!tile) continue;
+            // Bords arrondis depuis les positions dans l'image : pas de trou entre deux tuiles
+            int left = (int)std::lround(originX + std::min(x * span, (double)pyramid.Width()) * scale);
+            int top = (int)std::lround(originY + std::min(y * span, (double)pyramid.Height()) * scale);
+            int right = (int)std::lround(originX + std::min((x + 1) * span, (double)pyramid.Width()) * scale);
+            int bottom = (int)std::lround(originY + std::min((y + 1) * span, (double)pyramid.Height()) * scale);
+            Gdiplus::Bitmap bitmap(tile->width, tile->height, (INT)tile->stride, PixelFormat32bppPARGB, tile->pixels.data());
+            graphics.DrawImage(&bitmap, Gdiplus::Rect(left, top, right - left, bottom - top),
+                0, 0, tile->width, tile->height, Gdiplus::UnitPixel, &attributes);
+        }
+    }
+
+    const TileView& last = state.tileRequest;
+    if (last.pyramid != view.pyramid || last.level != view.level || last.left != view.left || last.top != view.top ||
+        last.right != view.right || last.bottom != view.bottom || last.panX != view.panX || last.panY != view.panY) {
+        state.tileRequest = view;
+        state.tileLoader.Request(view);
+    }
+}
 
-    // affiocher l'historique
-    if (state.showHistory)
+// Cle de la couche image : change avec tout ce qui modifie son dessin
+uint64_t ImageLayerKey(const AppState& state, const RECT& clientRect, bool stretched) {
+    uint64_t values[] = {
+        (uint64_t)(uintptr_t)state.display.bitmap.get(),
+        state.display.bitmap ? ((uint64_t)state.display.bitmap->GetWidth() << 32 | state.display.bitmap->GetHeight()) : 0,
+        (uint64_t)std::hash<std::wstring>()(state.display.path),
+        (uint64_t)clientRect.right << 32 | (uint32_t)clientRect.bottom,
+        stretched, 0, 0, 0, 0,
+    };
+    if (IsZoomed(state)) {
+        std::memcpy(&values[5], &state.zoom, sizeof(double));
+        std::memcpy(&values[6], &state.zoomCenterX, sizeof(double));
+        std::memcpy(&values[7], &state.zoomCenterY, sizeof(double));
+        values[8] = state.tilesReceived;
+    }
+    uint64_t key = 14695981039346656037ull;
+    for (uint64_t value : values) key = (key ^ value) * 1099511628211ull;
+    return key;
+}
+
+// Fond de la fenetre et image : copie 1:1, etiree pendant un redimensionnement, ou zoomee
+void DrawImageLayer(AppState& state, const RECT& clientRect, bool stretched) {
+    HDC dc = state.imageLayer.Dc();
+    FillRect(dc, &clientRect, (HBRUSH)(COLOR_WINDOW + 1));
     {
+        Gdiplus::Bitmap* image = state.display.bitmap.get();
+        Gdiplus::Graphics graphics(dc);
+        if (IsZoomed(state)) {
+            DrawZoomedImage(graphics, clientRect, state);
+        }
+        else if (stretched) {
+            RECT target = FitImageRect(image->GetWidth(), image->GetHeight(), clientRect);
+            graphics.SetInterpolationMode(Gdiplus::InterpolationModeLowQuality);
+            graphics.DrawImage(image, (INT)target.left, (INT)target.top,
+                (INT)(target.right - target.left), (INT)(target.bottom - target.top));
+        }
+        else {
+            int x = (clientRect.right - (int)image->GetWidth()) / 2;
+            int y = (clientRect.bottom - (int)image->GetHeight()) / 2;
+            graphics.DrawImage(image, x, y, (INT)image->GetWidth(), (INT)image->GetHeight());
+        }
+    }
+    // Les pixels de la section sont lus directement par le compositeur
+    GdiFlush();
+}
+
+void DisplayImage(HWND hwnd, const std::wstring& imagePath, AppState& state) {
+    if (!InitializeGDIplus(state)) return;
+    TraceSpan paintSpan(TraceStage::Paint);
+
+    RECT clientRect;
+    GetClientRect(hwnd, &clientRect);
+    SIZE clientSize{ clientRect.right, clientRect.bottom };
+    if (clientSize.cx <= 0 || clientSize.cy <= 0) {
+        ValidateRect(hwnd, NULL);
+        return;
+    }
+    // Autre image : le zoom repart de l'image entiere
+    if (state.pyramid && state.pyramid->Path() != imagePath) ResetZoom(state);
+
+    // Nouvelle image : mise a l'echelle une fois, les affichages suivants sont des copies 1:1.
+    // Si seule la taille de la fenetre a change, l'image actuelle est etiree en basse
+    // qualite et la version haute qualite est calculee en arriere-plan.
+    bool stretched = false;
+    if (!state.display.bitmap || state.display.path != imagePath) {
+        // Le thread de fond peut utiliser la meme image du cache
+        state.displayScaler.Cancel();
+        std::shared_ptr<Gdiplus::Bitmap> image = LoadDecodedImage(state.imageCache, imagePath, clientSize);
+        if (!image || !ScaleToClient(*image, imagePath, clientSize, state.display)) {
+            // Pas de boite de dialogue pendant WM_PAINT : l'echec est traite une fois le
+            // dessin termine (OnImageFailed)
+            state.display = ScaledImage();
+            ValidateRect(hwnd, NULL);
+            if (state.failedImage != imagePath) {
+                state.failedImage = imagePath;
+                PostMessageW(hwnd, WM_APP_IMAGE_FAILED, 0, 0);
+            }
+            return;
+        }
+    }
+    else if (!state.display.Matches(imagePath, clientRect)) {
+        stretched = true;
+        if (!state.inSizeMove) RequestDisplayScale(hwnd, state, clientSize);
+    }
+
+    // Couches composees hors ecran, puis copiees : pas d'effacement du fond ni de scintillement
+    if (!state.backBuffer.Reserve(NULL, clientSize.cx, clientSize.cy) ||
+        !state.imageLayer.Reserve(NULL, clientSize.cx, clientSize.cy)) {
+        ValidateRect(hwnd, NULL);
+        return;
+    }
+    state.compositor.Resize(clientSize.cx, clientSize.cy);
+    {
+        TraceSpan span(TraceStage::Text);
+        UpdateTextLayers(state, clientRect, imagePath);
+    }
+
+    PAINTSTRUCT ps;
+    {
+        TraceSpan span(TraceStage::Blit);
+        if (IsZoomed(state)) ClampZoomCenter(state, clientRect);
+        if (state.compositor.SetBase(state.imageLayer.View(), ImageLayerKey(state, clientRect, stretched))) {
+            DrawImageLayer(state, clientRect, stretched);
+        }
+        // Les zones recomposees sont ajoutees a la zone a redessiner avant BeginPaint : un
+        // texte modifie est copie a l'ecran meme si seule une autre partie etait invalidee
+        for (const PixelRect& rect : state.compositor.Compose(state.backBuffer.View())) {
+            RECT dirty{ rect.left, rect.top, rect.right, rect.bottom };
+            InvalidateRect(hwnd, &dirty, FALSE);
+        }
+        HDC hdc = BeginPaint(hwnd, &ps);
+        BitBlt(hdc, ps.rcPaint.left, ps.rcPaint.top, ps.rcPaint.right - ps.rcPaint.left, ps.rcPaint.bottom - ps.rcPaint.top,
+            state.backBuffer.Dc(), ps.rcPaint.left, ps.rcPaint.top, SRCCOPY);
+    }
+    EndPaint(hwnd, &ps);
+}
+
+// Haut de la grille, sous les boutons
+const int GridTop = 90;
+
+// Images de la grille : le catalogue sans les images exclues ni celles hors du filtre, ou
+// l'historique dans l'ordre
+void BuildGridItems(AppState& state) {
+    state.gridItems.clear();
+    if (state.grid == GridSource::Catalog && state.filter.IsActive()) {
+        state.filter.Update(state.imageFiles);
+        state.gridItems = state.filter.Matches();
+    }
+    else if (state.grid == GridSource::Catalog) {
+        state.gridItems.reserve(state.imageFiles.Size());
+        for (ImageId id = 0; id < (ImageId)state.imageFiles.Size(); ++id) {
+            if (!state.imageFiles.IsExcluded(id)) state.gridItems.push_back(id);
+        }
+    }
+    else if (state.grid == GridSource::History) {
+        for (size_t i = 0; i < state.history.Size(); ++i) state.gridItems.push_back(state.history[i]);
+    }
+}
+
+ThumbnailGridLayout GridLayout(HWND hwnd, const AppState& state) {
+    RECT clientRect;
+    GetClientRect(hwnd, &clientRect);
+    return LayoutThumbnailGrid(clientRect.right, clientRect.bottom - GridTop, state.gridItems.size(), state.gridScroll);
+}
+
+void InvalidateGrid(HWND hwnd) {
+    RECT gridRect;
+    GetClientRect(hwnd, &gridRect);
+    gridRect.top = std::min<LONG>(GridTop, gridRect.bottom);
+    InvalidateRect(hwnd, &gridRect, FALSE);
+}
+
+// Catalogue ou historique modifie : les index de la grille sont recalcules
+void RefreshGrid(HWND hwnd, AppState& state) {
+    if (state.grid == GridSource::Off) return;
+    BuildGridItems(state);
+    InvalidateGrid(hwnd);
+}
+
+// Cases visibles de la grille, depuis l'atlas projete. Une case sans miniature est dessinee
+// vide et demandee a ThumbnailGenerator, avec l'ecran suivant pour le defilement.
+void DrawThumbnailGrid(HWND hwnd, AppState& state) {
+    TraceSpan paintSpan(TraceStage::Paint);
+    const int size = ThumbnailAtlas::ThumbnailSize;
+
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hwnd, &ps);
+    RECT clientRect;
+    GetClientRect(hwnd, &clientRect);
+    int width = clientRect.right;
+    int height = clientRect.bottom - GridTop;
+    if (width <= 0 || height <= 0) {
         EndPaint(hwnd, &ps);
         return;
     }
-    int pos = 100;
-    std::wstring message = state.englishLanguage ? L"History :" : L"Historique";
-    TextOutW(hdc, 10, pos, message.c_str(), (int)message.length());
-    for (std::wstring fileName : state.history)
+    ThumbnailGridLayout layout = GridLayout(hwnd, state);
+    state.gridScroll = std::clamp<int64_t>(state.gridScroll, 0, layout.maxScroll);
+
+    // Dessin hors ecran puis une seule copie : pas de scintillement pendant le defilement
+    HDC memory = CreateCompatibleDC(hdc);
+    HBITMAP bitmap = CreateCompatibleBitmap(hdc, width, height);
+    HGDIOBJ previous = SelectObject(memory, bitmap);
+    HBRUSH background = CreateSolidBrush(RGB(ThumbnailAtlas::Background, ThumbnailAtlas::Background, ThumbnailAtlas::Background));
+    HBRUSH placeholder = CreateSolidBrush(RGB(0xD8, 0xD8, 0xD8));
+    RECT area{ 0, 0, width, height };
+    FillRect(memory, &area, background);
+
+    // Cases BGR 24 bits de haut en bas, lignes deja alignees sur 4 octets
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = size;
+    info.bmiHeader.biHeight = -size;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 24;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    ImageId current = state.imageFiles.Find(state.currentImage);
+    std::vector<ThumbnailJob> missing;
     {
-        pos += 15;
-        TextOutW(hdc, 10, pos, fileName.c_str(), (int)fileName.length());
+        TraceSpan span(TraceStage::Blit);
+        for (size_t i = layout.first; i < layout.last; ++i) {
+            ImageId id = state.gridItems[i];
+            int x = layout.left + (int)((i - layout.first) % layout.columns) * layout.cell;
+            int y = layout.top + (int)((i - layout.first) / layout.columns) * layout.cell;
+            std::wstring path = state.imageFiles.FullPath(id);
+            uint64_t key = FileKey(path, state.imageFiles.ModifiedTime(id));
+            Thumbnail thumbnail;
+            if (state.thumbnails.Find(key, thumbnail)) {
+                SetDIBitsToDevice(memory, x, y, size, size, 0, 0, 0, size, thumbnail.pixels, &info, DIB_RGB_COLORS);
+            }
+            else {
+                RECT cell{ x, y, x + size, y + size };
+                FillRect(memory, &cell, placeholder);
+                missing.push_back(ThumbnailJob{ key, std::move(path) });
+            }
+            bool selected = state.grid == GridSource::History ? i == state.history.Cursor() : id == current;
+            if (selected) {
+                RECT frame{ x - 3, y - 3, x + size + 3, y + size + 3 };
+                for (int border = 0; border < 2; ++border) {
+                    FrameRect(memory, &frame, (HBRUSH)GetStockObject(BLACK_BRUSH));
+                    InflateRect(&frame, -1, -1);
+                }
+            }
+        }
+        BitBlt(hdc, 0, GridTop, width, height, memory, 0, 0, SRCCOPY);
     }
+
+    SelectObject(memory, previous);
+    DeleteObject(placeholder);
+    DeleteObject(background);
+    DeleteObject(bitmap);
+    DeleteDC(memory);
+    if (state.showTimings) DrawTimingOverlay(hdc, clientRect, state);
     EndPaint(hwnd, &ps);
+
+    size_t ahead = std::min(state.gridItems.size(), layout.last + (layout.last - layout.first));
+    for (size_t i = layout.last; i < ahead; ++i) {
+        ImageId id = state.gridItems[i];
+        std::wstring path = state.imageFiles.FullPath(id);
+        uint64_t key = FileKey(path, state.imageFiles.ModifiedTime(id));
+        if (!state.thumbnails.Contains(key)) missing.push_back(ThumbnailJob{ key, std::move(path) });
+    }
+    // Remplace les demandes des cases qui ne sont plus visibles
+    state.thumbnailGenerator.Request(std::move(missing));
+}
+
+void ScrollGrid(HWND hwnd, AppState& state, int64_t delta) {
+    ThumbnailGridLayout layout = GridLayout(hwnd, state);
+    int64_t scroll = std::clamp<int64_t>(state.gridScroll + delta, 0, layout.maxScroll);
+    if (scroll == state.gridScroll) return;
+    state.gridScroll = scroll;
+    InvalidateGrid(hwnd);
+}
+
+// Retour a l'image ; les miniatures en attente ne sont plus demandees
+void CloseGrid(HWND hwnd, AppState& state) {
+    if (state.grid == GridSource::Off) return;
+    state.grid = GridSource::Off;
+    state.gridItems.clear();
+    state.thumbnailGenerator.Request({});
+    UpdateScanStatus(hwnd, state);
+    InvalidateRect(hwnd, NULL, FALSE);
+}
+
+// Touche G : grille du catalogue, puis de l'historique, puis retour a l'image
+void ToggleGrid(HWND hwnd, AppState& state) {
+    if (state.grid == GridSource::History) {
+        CloseGrid(hwnd, state);
+        return;
+    }
+    state.grid = state.grid == GridSource::Off ? GridSource::Catalog : GridSource::History;
+    BuildGridItems(state);
+    state.gridScroll = 0;
+    if (state.grid == GridSource::History) {
+        // L'image courante au milieu de l'ecran
+        ThumbnailGridLayout layout = GridLayout(hwnd, state);
+        RECT clientRect;
+        GetClientRect(hwnd, &clientRect);
+        state.gridScroll = (int64_t)(state.history.Cursor() / layout.columns) * layout.cell - (clientRect.bottom - GridTop) / 2;
+    }
+    UpdateScanStatus(hwnd, state);
+    InvalidateRect(hwnd, NULL, TRUE);
+}
+
+// Index dans la grille de la case sous le point (coordonnees client), SIZE_MAX hors des cases
+size_t GridItemAt(HWND hwnd, const AppState& state, int x, int y) {
+    ThumbnailGridLayout layout = GridLayout(hwnd, state);
+    int offsetX = x - layout.left;
+    int offsetY = y - GridTop - layout.top;
+    if (y < GridTop || offsetX < 0 || offsetY < 0) return SIZE_MAX;
+    if (offsetX % layout.cell >= ThumbnailAtlas::ThumbnailSize || offsetY % layout.cell >= ThumbnailAtlas::ThumbnailSize) {
+        return SIZE_MAX;
+    }
+    int column = offsetX / layout.cell;
+    if (column >= layout.columns) return SIZE_MAX;
+    size_t index = layout.first + (size_t)(offsetY / layout.cell) * layout.columns + column;
+    return index < state.gridItems.size() ? index : SIZE_MAX;
+}
+
+// Clic sur une case : affiche l'image et quitte la grille. Dans l'historique, le curseur
+// est deplace sans ajouter d'entree.
+void OpenGridItem(HWND hwnd, AppState& state, size_t index) {
+    if (state.grid == GridSource::History) {
+        while (state.history.Cursor() > index && state.history.Back()) {}
+        while (state.history.Cursor() < index && state.history.Forward()) {}
+        state.currentImage = state.imageFiles.FullPath(state.history.Current());
+    }
+    else {
+        ShowNewImage(hwnd, state, state.imageFiles.FullPath(state.gridItems[index]));
+    }
+    CloseGrid(hwnd, state);
+}
+
+// Affiche `path` comme nouvelle image courante et l'ajoute a l'historique. Si l'image n'est
+// ni preparee ni en cache, sa miniature EXIF est affichee tout de suite, etiree, et l'image
+// complete la remplace quand DisplayScaler l'a decodee.
+void ShowNewImage(HWND hwnd, AppState& state, const std::wstring& path) {
+    ImageId id = state.imageFiles.Find(path);
+    if (id == InvalidImageId) id = state.imageFiles.Add(path);
+    state.currentImage = path;
+
+    ImageCacheKey key;
+    if (state.display.path != path && GetImageCacheKey(path, key) && !state.imageCache.Contains(key)) {
+        RECT clientRect;
+        GetClientRect(hwnd, &clientRect);
+        SIZE clientSize{ clientRect.right, clientRect.bottom };
+        std::shared_ptr<Gdiplus::Bitmap> preview;
+        if (clientSize.cx > 0 && clientSize.cy > 0 && InitializeGDIplus(state)) preview = LoadExifPreview(path);
+        if (preview) {
+            // Taille client vide : DisplayImage dessine la miniature etiree sans la redimensionner
+            state.display = ScaledImage{ path, std::move(preview), SIZE{ 0, 0 } };
+            RequestDisplayScale(hwnd, state, clientSize);
+        }
+    }
+
+    state.history.Push(id);
+    InvalidateRect(hwnd, NULL, FALSE);
+}
+
+// Relance la preparation des prochaines images pour la taille actuelle de la fenetre
+void RefillPrefetch(HWND hwnd, AppState& state) {
+    // Pendant les tirages rapides, le catalogue partiel du scan n'est pas representatif
+    if (state.instantPicker.IsActive()) return;
+    if (state.imageFiles.Size() <= state.imageFiles.ExcludedCount()) return;
+    RECT clientRect;
+    GetClientRect(hwnd, &clientRect);
+    state.prefetcher.Refill(state.imageFiles, [&state]() { return state.selector.Pick(state.imageFiles); },
+        SIZE{ clientRect.right, clientRect.bottom });
 }
 
 void LoadNewRandomImage(HWND hwnd, AppState& state) {
-    if (!state.currentFolder.empty() && !state.imageFiles.empty()) {
-        std::wstring newImage = GetRandomImage(state.imageFiles);
-        if (!newImage.empty()) {
-            state.currentImage = newImage;
-            state.history.push_back(newImage);
-            state.historyIndex = state.history.size() - 1;
-            InvalidateRect(hwnd, NULL, TRUE);
+    // La marche dans l'arborescence ignore le filtre : avec un filtre, on tire dans les lots du scan
+    if (!state.currentFolder.empty() && state.instantPicker.IsActive() && !state.filter.IsActive()) {
+        // L'image arrive avec WM_APP_INSTANT_PICK
+        state.instantPicker.Request();
+    }
+    else if (state.imageFiles.Size() > state.imageFiles.ExcludedCount()) {
+        // Dossier choisi ou images deposees. L'image preparee d'avance si elle fait toujours partie du catalogue
+        ScaledImage next;
+        bool found = false;
+        while (!found && state.prefetcher.Take(next)) {
+            ImageId id = state.imageFiles.Find(next.path);
+            found = id != InvalidImageId && !state.imageFiles.IsExcluded(id) && state.filter.Contains(id);
         }
+
+        if (found) {
+            std::wstring path = next.path;
+            if (next.bitmap) state.display = std::move(next);
+            ShowNewImage(hwnd, state, path);
+        }
+        else {
+            ImageId newImage = state.selector.Pick(state.imageFiles);
+            if (newImage != InvalidImageId) {
+                ShowNewImage(hwnd, state, state.imageFiles.FullPath(newImage));
+            }
+            else if (state.filter.IsActive() && !state.scanner.IsRunning()) {
+                MessageBoxW(hwnd,
+                    state.englishLanguage ? L"No image matches the filter." : L"Aucune image ne passe le filtre.",
+                    L"Information", MB_ICONINFORMATION);
+            }
+        }
+        RefillPrefetch(hwnd, state);
+        UpdateScanStatus(hwnd, state);
     }
-    else {
+    else if (!state.scanner.IsRunning()) {
         MessageBoxW(hwnd,
             state.englishLanguage ? L"No images found in the folder." : L"Aucune image trouvee dans le dossier.",
             state.englishLanguage ? L"Information" : L"Information",
@@ -305,6 +1049,338 @@ void LoadNewRandomImage(HWND hwnd, AppState& state) {
     }
 }
 
+// Met a jour le titre de la fenetre avec l'avancement du scan et le taux de reussite
+// du prefetch (images pretes au moment de la demande)
+void UpdateScanStatus(HWND hwnd, AppState& state) {
+    std::wstringstream ss;
+    ss << (state.englishLanguage ? L"Random Image Viewer" : L"Visionneuse d'images aleatoires");
+    ScanProgress progress = state.scanner.GetProgress();
+    if (progress.running) {
+        ss << L" - " << progress.filesFound
+            << (state.englishLanguage ? L" images (scanning...)" : L" images (scan en cours...)");
+        if (progress.filesProbed > 0) {
+            ss << L" - " << progress.filesProbed << (state.englishLanguage ? L" checked" : L" verifiees");
+        }
+    }
+    if (state.selector.Mode() != SelectionMode::Uniform) {
+        ss << L" - " << SelectionModeName(state.selector.Mode());
+    }
+    if (state.filter.IsActive()) {
+        state.filter.Update(state.imageFiles);
+        ss << (state.englishLanguage ? L" - filter: " : L" - filtre : ") << state.filter.Count() << L" images";
+    }
+    if (state.instantPicker.IsActive()) {
+        ss << (state.englishLanguage ? L" - quick pick" : L" - tirage rapide");
+    }
+    else if (state.instantReport.picks > 0) {
+        // Probabilite des tirages rapides rapportee a celle du tirage uniforme
+        wchar_t text[128];
+        std::swprintf(text, 128, state.englishLanguage ? L" - %zu quick picks x%.2f-x%.2f of uniform" :
+            L" - %zu tirages rapides x%.2f-x%.2f de l'uniforme", state.instantReport.picks,
+            state.instantReport.minRatio, state.instantReport.maxRatio);
+        ss << text;
+    }
+    HashIndexer::Progress hashing = state.hashIndexer.GetProgress();
+    if (hashing.running) {
+        ss << (state.englishLanguage ? L" - fingerprints " : L" - empreintes ") << hashing.done << L"/" << hashing.total;
+        if (hashing.computed > 0 && hashing.threads > 0) {
+            ss << L" (" << (int)(hashing.imagesPerSecond / hashing.threads)
+                << (state.englishLanguage ? L" img/s per core)" : L" img/s par coeur)");
+        }
+    }
+    if (state.duplicates.DuplicateCount() > 0) {
+        ss << L" - " << state.duplicates.DuplicateCount()
+            << (state.englishLanguage ? L" duplicates in " : L" doublons en ") << state.duplicates.DuplicateGroupCount()
+            << (state.englishLanguage ? L" groups" : L" groupes");
+    }
+    ScanProgress dropping = state.dropScanner.GetProgress();
+    if (dropping.running) {
+        ss << (state.englishLanguage ? L" - drop: " : L" - depot : ") << dropping.filesFound << L" images";
+        if (dropping.filesProbed > 0) {
+            ss << L", " << dropping.filesProbed << (state.englishLanguage ? L" checked" : L" verifiees");
+        }
+    }
+    else if (state.droppedFiles.Size() > 0) {
+        ss << L" - " << state.droppedFiles.Size() << (state.englishLanguage ? L" dropped images" : L" images deposees");
+    }
+    if (state.grid != GridSource::Off) {
+        ss << (state.grid == GridSource::Catalog ? (state.englishLanguage ? L" - grid: " : L" - grille : ") :
+            (state.englishLanguage ? L" - history grid: " : L" - grille de l'historique : "))
+            << state.gridItems.size() << L" images";
+        ThumbnailGenerator::Stats thumbnails = state.thumbnailGenerator.GetStats();
+        if (thumbnails.queued > 0) {
+            ss << L", " << thumbnails.queued << (state.englishLanguage ? L" thumbnails pending" : L" miniatures en attente");
+        }
+    }
+    ImagePrefetcher::Stats prefetch = state.prefetcher.GetStats();
+    uint64_t requests = prefetch.hits + prefetch.late + prefetch.misses;
+    if (requests > 0) {
+        ss << L" - prefetch " << prefetch.hits << L"/" << requests
+            << L" (" << (prefetch.hits * 100 / requests) << L"%)";
+    }
+    SetWindowTextW(hwnd, ss.str().c_str());
+}
+
+// Tire la premiere image directement dans l'index projete du dossier, sans attendre
+// que le scanner ait charge la liste complete
+bool ShowImageFromLibraryIndex(HWND hwnd, AppState& state, const std::wstring& folder) {
+    LibraryIndex index;
+    if (!index.Open(LibraryIndexPath(folder), folder) || index.FileCount() == 0) return false;
+
+    std::wstring path = index.FullPath(state.selector.Random().Below(index.FileCount()));
+    if (!PathFileExistsW(path.c_str())) return false;
+
+    state.currentImage = path;
+    state.history.Push(state.imageFiles.Add(path));
+    InvalidateRect(hwnd, NULL, FALSE);
+    return true;
+}
+
+// Remplace le catalogue en conservant l'historique : les index sont recalcules et les
+// images qui ne font pas partie du nouveau catalogue y restent, exclues du tirage
+void ReplaceCatalog(AppState& state, ImageCatalog&& catalog) {
+    // Les images deposees font partie du catalogue, quel que soit le dossier
+    for (ImageId id = 0; id < (ImageId)state.droppedFiles.Size(); ++id) {
+        catalog.Add(state.droppedFiles.FullPath(id), state.droppedFiles.ModifiedTime(id), state.droppedFiles.FileSize(id),
+            state.droppedFiles.Width(id), state.droppedFiles.Height(id));
+    }
+    for (ImageId& id : state.dropBatchIds) id = catalog.Add(state.imageFiles.FullPath(id));
+    for (size_t i = 0; i < state.history.Size(); ++i) {
+        ImageId& id = state.history[i];
+        std::wstring path = state.imageFiles.FullPath(id);
+        ImageId mapped = catalog.Find(path);
+        if (mapped == InvalidImageId) {
+            mapped = catalog.Add(path);
+            catalog.Exclude(mapped);
+        }
+        id = mapped;
+    }
+    state.selector.Rebase(state.imageFiles, catalog);
+    state.imageFiles = std::move(catalog);
+    // Images preparees d'apres l'ancien catalogue
+    state.prefetcher.Reset();
+
+    // Les groupes de doublons designent les index de l'ancien catalogue
+    state.hashIndexer.Cancel();
+    state.duplicates.Clear();
+    state.selector.SetDuplicates(&state.duplicates);
+}
+
+void StartFolderScan(HWND hwnd, AppState& state, const std::wstring& folder) {
+    state.scanner.Cancel();
+    state.instantPicker.Cancel();
+    state.instantReport = InstantPickReport();
+    state.prefetcher.Reset();
+    // Un nouveau dossier remplace aussi les images deposees
+    state.dropScanner.Cancel();
+    state.dropRoots.clear();
+    state.droppedFiles.Clear();
+    state.dropBatchIds.clear();
+    // Miniatures du nouveau dossier ; les calculs en cours visaient l'ancien atlas
+    state.thumbnailGenerator.Cancel();
+    state.thumbnails.Open(ThumbnailAtlas::PathFor(folder));
+    state.gridScroll = 0;
+    state.currentFolder = folder;
+    ReplaceCatalog(state, ImageCatalog());
+    state.selector.Reset();
+    state.waitingForFirstImage = !ShowImageFromLibraryIndex(hwnd, state, folder);
+    if (state.waitingForFirstImage && state.instantPick) {
+        state.instantPicker.Start(folder, state.selector.Random().Next(), [hwnd]() {
+            PostMessageW(hwnd, WM_APP_INSTANT_PICK, 0, 0);
+        });
+        state.instantPicker.Request();
+    }
+    state.scanner.Start(folder, [hwnd]() {
+        PostMessageW(hwnd, WM_APP_SCAN_UPDATE, 0, 0);
+    });
+    state.changesDuringScan.clear();
+    state.watcher.Start(folder, [hwnd]() {
+        PostMessageW(hwnd, WM_APP_FILES_CHANGED, 0, 0);
+    });
+    RefreshGrid(hwnd, state);
+    UpdateScanStatus(hwnd, state);
+}
+
+// Catalogue connu (index, puis fin du scan) : fin des tirages rapides, retour au tirage
+// exact et ecart des tirages rapides mesure sur ce catalogue
+void FinishInstantPicks(AppState& state) {
+    std::vector<InstantPick> picks = state.instantPicker.History();
+    state.instantPicker.Cancel();
+    state.instantReport = CompareWithUniform(picks, state.imageFiles);
+}
+
+// Image tiree par InstantPicker ; sans image trouvee, le tirage revient aux lots du scan
+void OnInstantPick(HWND hwnd, AppState& state) {
+    std::vector<InstantPick> picks;
+    if (state.instantPicker.TakePicks(picks)) {
+        state.waitingForFirstImage = false;
+        ShowNewImage(hwnd, state, picks.back().path);
+    }
+    else if (!state.instantPicker.IsActive() && state.waitingForFirstImage &&
+        (state.imageFiles.Size() > state.imageFiles.ExcludedCount() || !state.scanner.IsRunning())) {
+        state.waitingForFirstImage = false;
+        LoadNewRandomImage(hwnd, state);
+    }
+    UpdateScanStatus(hwnd, state);
+}
+
+// Depot de fichiers et de dossiers : la premiere image deposee est affichee tout de suite,
+// le reste est parcouru et sonde en arriere-plan (dropScanner) et ajoute au catalogue
+void IngestDroppedItems(HWND hwnd, AppState& state, std::vector<std::wstring> paths) {
+    if (paths.empty()) return;
+    auto first = std::find_if(paths.begin(), paths.end(), [](const std::wstring& path) { return IsImagePath(path); });
+    ImageProbe probe;
+    if (first != paths.end() && ProbeImageFile(*first, probe)) ShowNewImage(hwnd, state, *first);
+
+    // Un depot pendant le precedent reprend aussi ses racines : les images deja ajoutees ne
+    // sont pas dupliquees
+    for (auto& path : paths) state.dropRoots.push_back(std::move(path));
+    state.dropScanner.Start(state.dropRoots, [hwnd]() {
+        PostMessageW(hwnd, WM_APP_DROP_UPDATE, 0, 0);
+    });
+    UpdateScanStatus(hwnd, state);
+}
+
+// Images sondees du depot : ajoutees au catalogue et gardees a part pour les remplacements
+// du catalogue. Les fichiers des lots ecartes par la sonde sont exclus du tirage.
+void MergeDroppedCatalog(AppState& state, const ImageCatalog& dropped) {
+    for (ImageId id = 0; id < (ImageId)dropped.Size(); ++id) {
+        std::wstring path = dropped.FullPath(id);
+        uint32_t width = dropped.Width(id), height = dropped.Height(id);
+        ImageId added = state.imageFiles.Add(path, dropped.ModifiedTime(id), dropped.FileSize(id), width, height);
+        state.droppedFiles.Add(path, dropped.ModifiedTime(id), dropped.FileSize(id), width, height);
+        // Deja exclue d'un depot precedent ou d'un changement de fichier : de nouveau valide
+        if (state.imageFiles.IsExcluded(added)) state.imageFiles.Restore(added);
+    }
+    for (ImageId id : state.dropBatchIds) {
+        if (dropped.Find(state.imageFiles.FullPath(id)) == InvalidImageId) state.imageFiles.Exclude(id);
+    }
+    state.dropBatchIds.clear();
+}
+
+void OnDropUpdate(HWND hwnd, AppState& state) {
+    std::vector<std::wstring> batch;
+    if (state.dropScanner.TakeBatch(batch)) {
+        for (const auto& path : batch) {
+            size_t before = state.imageFiles.Size();
+            ImageId id = state.imageFiles.Add(path);
+            if (state.imageFiles.Size() > before) state.dropBatchIds.push_back(id);
+        }
+    }
+    ImageCatalog dropped;
+    if (state.dropScanner.TakeCatalog(dropped)) {
+        MergeDroppedCatalog(state, dropped);
+        state.dropRoots.clear();
+    }
+
+    bool hasImages = state.imageFiles.Size() > state.imageFiles.ExcludedCount();
+    if (state.currentImage.empty() && !state.waitingForFirstImage && hasImages) LoadNewRandomImage(hwnd, state);
+    RefillPrefetch(hwnd, state);
+    RefreshGrid(hwnd, state);
+    UpdateScanStatus(hwnd, state);
+}
+
+// Cases de l'atlas des fichiers supprimes ou modifies : reprises par les prochaines miniatures
+void ReleaseStaleThumbnails(AppState& state) {
+    if (state.thumbnails.Count() == 0) return;
+    std::unordered_set<uint64_t> live;
+    live.reserve(state.imageFiles.Size());
+    for (ImageId id = 0; id < (ImageId)state.imageFiles.Size(); ++id) {
+        if (state.imageFiles.IsExcluded(id)) continue;
+        live.insert(FileKey(state.imageFiles.FullPath(id), state.imageFiles.ModifiedTime(id)));
+    }
+    state.thumbnails.ReleaseUnused(live);
+}
+
+// Recupere les lots publies par le scanner (thread UI uniquement)
+void OnScanUpdate(HWND hwnd, AppState& state) {
+    std::vector<std::wstring> batch;
+    if (state.scanner.TakeBatch(batch)) {
+        for (const auto& path : batch) {
+            state.imageFiles.Add(path);
+        }
+    }
+    ImageCatalog catalog;
+    if (state.scanner.TakeCatalog(catalog)) {
+        ReplaceCatalog(state, std::move(catalog));
+        // Le scan a pu lire un dossier avant ou apres un changement deja recu
+        ApplyFileChanges(state.imageFiles, state.changesDuringScan);
+        FinishInstantPicks(state);
+        // Catalogue definitif : calcul des empreintes en arriere-plan
+        if (!state.scanner.IsRunning()) {
+            ReleaseStaleThumbnails(state);
+            if (state.skipDuplicates) {
+                state.hashIndexer.Start(state.currentFolder, state.imageFiles, [hwnd]() {
+                    PostMessageW(hwnd, WM_APP_HASHES_READY, 0, 0);
+                });
+            }
+        }
+    }
+    if (!state.scanner.IsRunning()) state.changesDuringScan.clear();
+
+    bool hasImages = state.imageFiles.Size() > state.imageFiles.ExcludedCount();
+    if (state.waitingForFirstImage && !state.instantPicker.IsActive() && (hasImages || !state.scanner.IsRunning())) {
+        state.waitingForFirstImage = false;
+        LoadNewRandomImage(hwnd, state);
+    }
+    RefillPrefetch(hwnd, state);
+    RefreshGrid(hwnd, state);
+    UpdateScanStatus(hwnd, state);
+}
+
+// Applique au catalogue les fichiers ajoutes, supprimes ou renommes dans le dossier. Une
+// image supprimee est exclue du tirage tout de suite, y compris si elle etait preparee.
+void OnFilesChanged(HWND hwnd, AppState& state) {
+    std::vector<FileChange> changes;
+    if (!state.watcher.TakeChanges(changes)) return;
+    size_t changed = ApplyFileChanges(state.imageFiles, changes);
+    if (state.scanner.IsRunning()) {
+        state.changesDuringScan.insert(state.changesDuringScan.end(),
+            std::make_move_iterator(changes.begin()), std::make_move_iterator(changes.end()));
+    }
+    if (changed == 0) return;
+
+    bool hasImages = state.imageFiles.Size() > state.imageFiles.ExcludedCount();
+    if (state.waitingForFirstImage && !state.instantPicker.IsActive() && hasImages) {
+        state.waitingForFirstImage = false;
+        LoadNewRandomImage(hwnd, state);
+    }
+    RefillPrefetch(hwnd, state);
+    RefreshGrid(hwnd, state);
+    UpdateScanStatus(hwnd, state);
+}
+
+// Empreintes et groupes de doublons publies par HashIndexer (thread UI uniquement)
+void OnHashesReady(HWND hwnd, AppState& state) {
+    std::vector<HashIndexer::Result> results;
+    DuplicateGroups groups;
+    if (!state.hashIndexer.TakeResults(results, groups)) return;
+    for (const auto& result : results) {
+        if (result.id < state.imageFiles.Size()) state.imageFiles.SetImageHash(result.id, result.hash);
+    }
+    if (groups.GroupCount() > 0) {
+        state.duplicates = std::move(groups);
+        state.selector.SetDuplicates(&state.duplicates);
+    }
+    UpdateScanStatus(hwnd, state);
+}
+
+// Image que DisplayImage n'a pas pu charger malgre la sonde du scan (fichier modifie depuis,
+// variante non prise en charge) : elle est exclue du tirage et une autre est affichee
+void OnImageFailed(HWND hwnd, AppState& state) {
+    if (state.failedImage != state.currentImage) return;
+    ImageId id = state.imageFiles.Find(state.failedImage);
+    if (id != InvalidImageId) state.imageFiles.Exclude(id);
+    if (state.imageFiles.Size() > state.imageFiles.ExcludedCount()) {
+        LoadNewRandomImage(hwnd, state);
+        return;
+    }
+    MessageBoxW(hwnd,
+        state.englishLanguage ? L"Unable to load image or invalid image" : L"Impossible de charger l'image ou image invalide",
+        state.englishLanguage ? L"Error" : L"Erreur",
+        MB_ICONERROR);
+}
+
 void OpenFileLocation(const std::wstring& filePath) {
     if (!filePath.empty()) {
         PIDLIST_ABSOLUTE pidl = ILCreateFromPathW(filePath.c_str());
@@ -447,18 +1523,54 @@ void StartDragOperation(HWND hwnd, AppState& state) {
 }
 
 void NavigateHistory(HWND hwnd, AppState& state, bool forward) {
-    if (state.history.empty()) return;
+    if (forward ? state.history.Forward() : state.history.Back()) {
+        state.currentImage = state.imageFiles.FullPath(state.history.Current());
+        InvalidateRect(hwnd, NULL, FALSE);
+    }
+}
 
-    if (forward && state.historyIndex < state.history.size() - 1) {
-        state.historyIndex++;
-        state.currentImage = state.history[state.historyIndex];
-        InvalidateRect(hwnd, NULL, TRUE);
+// Touche T : ecrit la trace (fichier de --trace, sinon dans le dossier temporaire)
+void ExportTrace(HWND hwnd, AppState& state) {
+    std::wstring path = state.traceFile.empty() ? DefaultTracePath() : state.traceFile;
+    int64_t written = WriteChromeTrace(path);
+    std::wstringstream ss;
+    if (written < 0) {
+        ss << (state.englishLanguage ? L"Cannot write " : L"Impossible d'ecrire ") << path;
     }
-    else if (!forward && state.historyIndex > 0) {
-        state.historyIndex--;
-        state.currentImage = state.history[state.historyIndex];
-        InvalidateRect(hwnd, NULL, TRUE);
+    else if (written == 0) {
+        ss << (state.englishLanguage ? L"Nothing recorded: turn timings on or start with --trace." :
+            L"Rien d'enregistre : activez l'affichage des temps ou lancez avec --trace.");
     }
+    else {
+        ss << written << (state.englishLanguage ? L" events written to " : L" evenements ecrits dans ") << path
+            << (state.englishLanguage ? L"\n(open in chrome://tracing or ui.perfetto.dev)" :
+                L"\n(a ouvrir dans chrome://tracing ou ui.perfetto.dev)");
+    }
+    MessageBoxW(hwnd, ss.str().c_str(), L"Trace", written > 0 ? MB_ICONINFORMATION : MB_ICONWARNING);
+}
+
+// Applique le texte du champ Filtre ; les images deja preparees suivaient l'ancien filtre
+void ApplyFilter(HWND hwnd, AppState& state) {
+    wchar_t text[1024];
+    GetDlgItemTextW(hwnd, 6, text, 1024);
+    ImageFilter filter;
+    std::wstring error;
+    if (!ParseImageFilter(text, filter, &error)) {
+        std::wstring message = (state.englishLanguage ? L"Invalid filter: " : L"Filtre invalide : ") + error;
+        MessageBoxW(hwnd, message.c_str(), state.englishLanguage ? L"Filter" : L"Filtre", MB_ICONWARNING);
+        return;
+    }
+    state.filterText = text;
+    state.filter.SetFilter(std::move(filter));
+    state.prefetcher.Reset();
+    RefreshGrid(hwnd, state);
+    if (state.grid == GridSource::Off && state.imageFiles.Size() > state.imageFiles.ExcludedCount()) {
+        LoadNewRandomImage(hwnd, state);
+    }
+    else {
+        RefillPrefetch(hwnd, state);
+    }
+    UpdateScanStatus(hwnd, state);
 }
 
 void ToggleLanguage(AppState& state) {
@@ -466,12 +1578,21 @@ void ToggleLanguage(AppState& state) {
 }
 
 void UpdateUI(HWND hwnd, AppState& state) {
-    SetWindowTextW(hwnd, state.englishLanguage ? L"Random Image Viewer" : L"Visionneuse d'images aleatoires");
+    UpdateScanStatus(hwnd, state);
     SetDlgItemTextW(hwnd, 1, state.englishLanguage ?
         L"Select folder (R: Pick a random picture)" : L"Choisir un dossier (R: nouvelle image)");
     SetDlgItemTextW(hwnd, 3, state.englishLanguage ?
         L"History ON/OFF" : L"Historique ON/OFF");
-    InvalidateRect(hwnd, NULL, TRUE);
+    SetDlgItemTextW(hwnd, 4, state.englishLanguage ?
+        L"Timings ON/OFF" : L"Temps ON/OFF");
+    SetDlgItemTextW(hwnd, 5, state.englishLanguage ? L"Filter" : L"Filtrer");
+    if (state.grid == GridSource::Off && !state.currentImage.empty()) {
+        // Seuls les textes changent : WM_PAINT n'invalide que leurs zones
+        RedrawWindow(hwnd, NULL, NULL, RDW_INTERNALPAINT);
+    }
+    else {
+        InvalidateRect(hwnd, NULL, TRUE);
+    }
 }
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
@@ -481,8 +1602,17 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     switch (uMsg) {
     case WM_CREATE: {
         CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+        ApplyCommandLine(state);
+        state.selector.SetFilter(&state.filter);
+        state.dropScanner.useLibraryIndex = false;
         pDropTarget = new DropTarget(hwnd, &state);
         RegisterDragDrop(hwnd, pDropTarget);
+        state.thumbnailGenerator.Start(state.thumbnails, [hwnd]() {
+            PostMessageW(hwnd, WM_APP_THUMBNAILS_READY, 0, 0);
+        });
+        state.tileLoader.Start(state.tiles, [hwnd]() {
+            PostMessageW(hwnd, WM_APP_TILES_READY, 0, 0);
+        });
 
         // Bouton pour selectionner le dossier
         CreateWindowW(
@@ -506,15 +1636,33 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             10, 50, 250, 30,
             hwnd, (HMENU)3, ((LPCREATESTRUCT)lParam)->hInstance, NULL
         );
+        // Bouton pour afficher les temps de decodage, mise a l'echelle et dessin
+        CreateWindowW(
+            L"BUTTON", L"Temps ON/OFF",
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+            270, 50, 120, 30,
+            hwnd, (HMENU)4, ((LPCREATESTRUCT)lParam)->hInstance, NULL
+        );
+        // Criteres du tirage (ext=jpg,png width>=1920 date>=2020-01-01...) et bouton pour les appliquer
+        CreateWindowW(
+            L"EDIT", state.filterText.c_str(),
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | WS_BORDER | ES_AUTOHSCROLL,
+            400, 54, 250, 22,
+            hwnd, (HMENU)6, ((LPCREATESTRUCT)lParam)->hInstance, NULL
+        );
+        CreateWindowW(
+            L"BUTTON", L"Filtrer",
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+            660, 50, 80, 30,
+            hwnd, (HMENU)5, ((LPCREATESTRUCT)lParam)->hInstance, NULL
+        );
         break;
     }
     case WM_COMMAND:
         if (LOWORD(wParam) == 1) {
             std::wstring folder = SelectFolder(hwnd);
             if (!folder.empty()) {
-                state.currentFolder = folder;
-                state.imageFiles = GetImageFiles(folder);
-                LoadNewRandomImage(hwnd, state);
+                StartFolderScan(hwnd, state, folder);
             }
             SetFocus(hwnd);
         }
@@ -528,21 +1676,136 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             UpdateUI(hwnd, state);
             SetFocus(hwnd);
         }
+        else if (LOWORD(wParam) == 4) {
+            state.showTimings = !state.showTimings;
+            SetTraceEnabled(state.showTimings || !state.traceFile.empty());
+            UpdateUI(hwnd, state);
+            SetFocus(hwnd);
+        }
+        else if (LOWORD(wParam) == 5) {
+            ApplyFilter(hwnd, state);
+            SetFocus(hwnd);
+        }
+        break;
+
+    case WM_APP_SCAN_UPDATE:
+        OnScanUpdate(hwnd, state);
+        break;
+
+    case WM_APP_FILES_CHANGED:
+        OnFilesChanged(hwnd, state);
+        break;
+
+    case WM_APP_IMAGE_FAILED:
+        OnImageFailed(hwnd, state);
+        break;
+
+    case WM_APP_HASHES_READY:
+        OnHashesReady(hwnd, state);
+        break;
+
+    case WM_APP_INSTANT_PICK:
+        OnInstantPick(hwnd, state);
+        break;
+
+    case WM_APP_DROP_UPDATE:
+        OnDropUpdate(hwnd, state);
+        break;
+
+    case WM_APP_THUMBNAILS_READY:
+        if (state.thumbnailGenerator.TakeReady() && state.grid != GridSource::Off) {
+            InvalidateGrid(hwnd);
+            UpdateScanStatus(hwnd, state);
+        }
+        break;
+
+    case WM_APP_TILES_READY:
+        if (state.tileLoader.TakeReady() && IsZoomed(state) && state.grid == GridSource::Off) {
+            ++state.tilesReceived;
+            InvalidateRect(hwnd, NULL, FALSE);
+        }
         break;
 
     case WM_KEYDOWN:
-        if (wParam == 'R' || wParam == 'r') {
+        if (state.grid != GridSource::Off && (wParam == VK_UP || wParam == VK_DOWN || wParam == VK_PRIOR ||
+            wParam == VK_NEXT || wParam == VK_HOME || wParam == VK_END)) {
+            ThumbnailGridLayout layout = GridLayout(hwnd, state);
+            RECT clientRect;
+            GetClientRect(hwnd, &clientRect);
+            int64_t page = std::max<int64_t>(layout.cell, (clientRect.bottom - GridTop) / layout.cell * layout.cell);
+            int64_t delta = wParam == VK_UP ? -layout.cell : wParam == VK_DOWN ? layout.cell :
+                wParam == VK_PRIOR ? -page : wParam == VK_NEXT ? page :
+                wParam == VK_HOME ? -state.gridScroll : layout.maxScroll - state.gridScroll;
+            ScrollGrid(hwnd, state, delta);
+        }
+        else if (wParam == 'G') {
+            ToggleGrid(hwnd, state);
+        }
+        else if (wParam == VK_ESCAPE) {
+            CloseGrid(hwnd, state);
+        }
+        else if (wParam == VK_ADD || wParam == VK_OEM_PLUS || wParam == VK_SUBTRACT || wParam == VK_OEM_MINUS) {
+            RECT clientRect;
+            GetClientRect(hwnd, &clientRect);
+            bool zoomIn = wParam == VK_ADD || wParam == VK_OEM_PLUS;
+            ZoomAt(hwnd, state, zoomIn ? 2.0 : 0.5, clientRect.right / 2, clientRect.bottom / 2);
+        }
+        else if (wParam == '0' || wParam == VK_NUMPAD0) {
+            if (IsZoomed(state)) {
+                ResetZoom(state);
+                InvalidateRect(hwnd, NULL, FALSE);
+            }
+        }
+        else if (wParam == 'R' || wParam == 'r') {
+            CloseGrid(hwnd, state);
             LoadNewRandomImage(hwnd, state);
         }
+        else if (wParam == 'M') {
+            // Mode de tirage suivant ; les images deja preparees suivaient l'ancien mode
+            SelectionMode mode = (SelectionMode)(((int)state.selector.Mode() + 1) % 4);
+            state.selector.SetMode(mode);
+            state.prefetcher.Reset();
+            RefillPrefetch(hwnd, state);
+            UpdateScanStatus(hwnd, state);
+        }
+        else if (wParam == 'T') {
+            ExportTrace(hwnd, state);
+        }
         else if (wParam == VK_LEFT) {
+            CloseGrid(hwnd, state);
             NavigateHistory(hwnd, state, false);
         }
         else if (wParam == VK_RIGHT) {
+            CloseGrid(hwnd, state);
             NavigateHistory(hwnd, state, true);
         }
         break;
 
+    case WM_MOUSEWHEEL:
+        if (state.grid == GridSource::Off) {
+            // Zoom autour du curseur, x1.25 par cran
+            POINT cursor{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+            ScreenToClient(hwnd, &cursor);
+            ZoomAt(hwnd, state, std::pow(1.25, (double)GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA), cursor.x, cursor.y);
+            break;
+        }
+        // Trois lignes de miniatures par cran
+        ScrollGrid(hwnd, state, -(int64_t)GET_WHEEL_DELTA_WPARAM(wParam) * 3 * GridLayout(hwnd, state).cell / WHEEL_DELTA);
+        break;
+
     case WM_LBUTTONDOWN:
+        if (state.grid != GridSource::Off) {
+            size_t index = GridItemAt(hwnd, state, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+            if (index != SIZE_MAX) OpenGridItem(hwnd, state, index);
+            break;
+        }
+        if (IsZoomed(state)) {
+            // Image zoomee : le glisser deplace la vue au lieu de sortir le fichier
+            state.panLast = POINT{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+            state.isPanning = true;
+            SetCapture(hwnd);
+            break;
+        }
         state.dragStartPos.x = GET_X_LPARAM(lParam);
         state.dragStartPos.y = GET_Y_LPARAM(lParam);
         state.isDragging = true;
@@ -554,7 +1817,10 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         break;
 
     case WM_MOUSEMOVE:
-        if (state.isDragging) {
+        if (state.isPanning) {
+            PanZoomedImage(hwnd, state, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        }
+        else if (state.isDragging) {
             int dx = abs(GET_X_LPARAM(lParam) - state.dragStartPos.x);
             int dy = abs(GET_Y_LPARAM(lParam) - state.dragStartPos.y);
             if (dx > 5 || dy > 5) {
@@ -567,11 +1833,15 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
     case WM_LBUTTONUP:
         state.isDragging = false;
+        state.isPanning = false;
         ReleaseCapture();
         break;
 
     case WM_PAINT:
-        if (!state.currentImage.empty()) {
+        if (state.grid != GridSource::Off) {
+            DrawThumbnailGrid(hwnd, state);
+        }
+        else if (!state.currentImage.empty()) {
             DisplayImage(hwnd, state.currentImage, state);
         }
         else {
@@ -589,11 +1859,45 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         }
         break;
 
+    case WM_ERASEBKGND:
+        // L'image recouvre toute la fenetre (tampon hors ecran) : pas d'effacement
+        if (state.grid == GridSource::Off && !state.currentImage.empty()) return 1;
+        return DefWindowProc(hwnd, uMsg, wParam, lParam);
+
     case WM_SIZE:
-        InvalidateRect(hwnd, NULL, TRUE);
+        // La grille ne redessine pas la bande des boutons
+        InvalidateRect(hwnd, NULL, state.grid != GridSource::Off);
+        break;
+
+    case WM_ENTERSIZEMOVE:
+        state.inSizeMove = true;
+        break;
+
+    case WM_EXITSIZEMOVE:
+        state.inSizeMove = false;
+        InvalidateRect(hwnd, NULL, FALSE);
         break;
 
+    case WM_APP_DISPLAY_SCALED: {
+        ScaledImage scaled;
+        if (state.displayScaler.Take(scaled) && scaled.path == state.currentImage) {
+            state.display = std::move(scaled);
+            InvalidateRect(hwnd, NULL, FALSE);
+        }
+        break;
+    }
+
     case WM_DESTROY:
+        state.scanner.Cancel();
+        state.dropScanner.Cancel();
+        state.instantPicker.Cancel();
+        state.thumbnailGenerator.Cancel();
+        state.thumbnails.Close();
+        state.tileLoader.Cancel();
+        state.pyramid.reset();
+        // Enregistre les empreintes deja calculees
+        state.hashIndexer.Cancel();
+        state.watcher.Stop();
         RevokeDragDrop(hwnd);
         if (pDropTarget) {
             RevokeDragDrop(hwnd);
@@ -601,6 +1905,12 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             pDropTarget = nullptr;
         }
         CoUninitialize();
+        // Les bitmaps GDI+ doivent etre liberes avant GdiplusShutdown
+        state.prefetcher.Shutdown();
+        state.displayScaler.Cancel();
+        state.display = ScaledImage();
+        state.imageCache.Clear();
+        if (!state.traceFile.empty()) WriteChromeTrace(state.traceFile);
         if (state.gdiplusInitialized) {
             Gdiplus::GdiplusShutdown(state.gdiplusToken);
         }
@@ -647,7 +1957,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         0,
         CLASS_NAME,
         L"Selecteur d'Image (Glissez-deposez)",
-        WS_OVERLAPPEDWINDOW,
+        WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN,
         CW_USEDEFAULT, CW_USEDEFAULT, 800, 600,
         NULL, NULL, hInstance, NULL
     );
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <windows.h>
+
+// Messages internes postes par les threads de travail vers la fenetre principale
+#define WM_APP_SCAN_UPDATE (WM_APP + 1)
+#define WM_APP_DISPLAY_SCALED (WM_APP + 2)
+#define WM_APP_FILES_CHANGED (WM_APP + 3)
+#define WM_APP_IMAGE_FAILED (WM_APP + 4)
+#define WM_APP_HASHES_READY (WM_APP + 5)
+#define WM_APP_INSTANT_PICK (WM_APP + 6)
+#define WM_APP_THUMBNAILS_READY (WM_APP + 7)
+#define WM_APP_DROP_UPDATE (WM_APP + 8)
+#define WM_APP_TILES_READY (WM_APP + 9)
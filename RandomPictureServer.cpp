@@ -0,0 +1,125 @@
+// Mode serveur sans fenetre : parcourt le dossier une fois (index compris) puis sert des
+// images aleatoires en HTTP, pour les bornes et les ecrans d'affichage dynamique.
+//
+//   RandomPictureServer [--address=IP] [--port=N] [--unix=chemin] [--threads=N]
+//                       [--pick=mode] [--seed=N] [--cache-mb=N] [--no-probe] dossier
+//
+//   curl -o image.jpg http://127.0.0.1:8080/random?w=1920&h=1080
+
+#include "ImageScanner.h"
+#include "ImageServer.h"
+#include "PathString.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    int Usage() {
+        std::fprintf(stderr,
+            "usage: RandomPictureServer [--address=IP] [--port=N] [--unix=path] [--threads=N]\n"
+            "                           [--pick=mode] [--seed=N] [--cache-mb=N] [--no-probe] folder\n");
+        return 2;
+    }
+
+    // Catalogue du dernier parcours termine ; l'index sur disque accelere les relances
+    ImageCatalog ScanFolder(const std::wstring& folder, bool probe) {
+        ImageScanner scanner;
+        scanner.probeImages = probe;
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool notified = false;
+        scanner.Start(folder, [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            notified = true;
+            changed.notify_one();
+        });
+
+        // Avec un index, un premier catalogue arrive avant la fin : on garde le dernier
+        ImageCatalog catalog;
+        std::vector<std::wstring> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return notified; });
+                notified = false;
+            }
+            // Les chemins publies ne servent pas, mais les prendre rearme la notification.
+            // La fin est lue apres : le catalogue final est deja en place quand elle arrive.
+            batch.clear();
+            scanner.TakeBatch(batch);
+            bool finished = !scanner.IsRunning();
+            scanner.TakeCatalog(catalog);
+            if (finished) break;
+        }
+        return catalog;
+    }
+}
+
+int main(int argc, char** argv) {
+    ImageServerOptions options;
+    std::string folder;
+    bool probe = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--address=", 0) == 0) options.address = arg.substr(10);
+        else if (arg.rfind("--port=", 0) == 0) options.port = (uint16_t)std::strtoul(arg.c_str() + 7, nullptr, 10);
+        else if (arg.rfind("--unix=", 0) == 0) options.unixSocket = arg.substr(7);
+        else if (arg.rfind("--threads=", 0) == 0) options.threadCount = std::strtoull(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--pick=", 0) == 0) {
+            if (!ParseSelectionMode(arg.c_str() + 7, options.mode)) return Usage();
+        }
+        else if (arg.rfind("--seed=", 0) == 0) options.seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else if (arg.rfind("--cache-mb=", 0) == 0) options.scaledCacheBytes = (size_t)std::strtoull(arg.c_str() + 11, nullptr, 10) << 20;
+        else if (arg == "--no-probe") probe = false;
+        else if (arg.rfind("--", 0) == 0 || !folder.empty()) return Usage();
+        else folder = arg;
+    }
+    if (folder.empty()) return Usage();
+
+    auto start = std::chrono::steady_clock::now();
+    ImageCatalog catalog = ScanFolder(PathToWide(fs::path(folder)), probe);
+    std::chrono::duration<double> scanTime = std::chrono::steady_clock::now() - start;
+    size_t images = catalog.Size() - catalog.ExcludedCount();
+    std::fprintf(stderr, "%zu images in %.2f s\n", images, scanTime.count());
+    if (images == 0) {
+        std::fprintf(stderr, "no image found in %s\n", folder.c_str());
+        return 1;
+    }
+
+    // Les threads du serveur heritent du masque : seul sigwait recoit l'arret
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    ImageServer server;
+    if (!server.Start(std::move(catalog), options)) {
+        std::fprintf(stderr, "cannot listen on %s\n",
+            options.unixSocket.empty() ? (options.address + ":" + std::to_string(options.port)).c_str() : options.unixSocket.c_str());
+        return 1;
+    }
+    if (options.unixSocket.empty()) std::fprintf(stderr, "listening on http://%s:%u/random\n", options.address.c_str(), server.Port());
+    else std::fprintf(stderr, "listening on %s\n", options.unixSocket.c_str());
+
+    int received = 0;
+    sigwait(&signals, &received);
+    server.Stop();
+
+    ImageServerStats stats = server.GetStats();
+    std::fprintf(stderr, "%llu connections, %llu requests (%llu originals, %llu scaled, %llu cache hits, %llu errors), %.1f MB sent\n",
+        (unsigned long long)stats.connections, (unsigned long long)stats.requests, (unsigned long long)stats.originals,
+        (unsigned long long)stats.scaled, (unsigned long long)stats.scaledCacheHits, (unsigned long long)stats.errors,
+        stats.bytesSent / 1048576.0);
+    return 0;
+}
@@ -0,0 +1,352 @@
+#include "RandomSelector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+namespace {
+    uint64_t SplitMix64(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    inline uint64_t RotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t RandomSeed() {
+        std::random_device device;
+        return ((uint64_t)device() << 32) ^ device();
+    }
+}
+
+void Xoshiro256::Seed(uint64_t seed) {
+    uint64_t state = seed;
+    for (uint64_t& word : m_state) word = SplitMix64(state);
+}
+
+uint64_t Xoshiro256::Next() {
+    uint64_t result = RotateLeft(m_state[1] * 5, 7) * 9;
+    uint64_t t = m_state[1] << 17;
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = RotateLeft(m_state[3], 45);
+    return result;
+}
+
+uint32_t Xoshiro256::Below(uint32_t bound) {
+    // Produit 32x32 -> 64 : la partie haute est l'index. On ne rejette que les tirages de
+    // la zone biaisee, reconnue sans division dans presque tous les cas.
+    uint64_t product = (Next() >> 32) * bound;
+    uint32_t low = (uint32_t)product;
+    if (low < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            product = (Next() >> 32) * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return (uint32_t)(product >> 32);
+}
+
+bool AliasTable::Build(const std::vector<double>& weights) {
+    m_buckets.clear();
+    double total = 0.0;
+    for (double weight : weights) total += std::max(weight, 0.0);
+    if (weights.empty() || weights.size() > UINT32_MAX || !(total > 0.0)) return false;
+
+    size_t count = weights.size();
+    std::vector<double> scaled(count);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < count; ++i) {
+        scaled[i] = std::max(weights[i], 0.0) * (double)count / total;
+        (scaled[i] < 1.0 ? small : large).push_back((uint32_t)i);
+    }
+
+    m_buckets.resize(count);
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        small.pop_back();
+        uint32_t more = large.back();
+
+        m_buckets[less].threshold = (uint32_t)(scaled[less] * 4294967296.0);
+        m_buckets[less].alias = more;
+
+        // La case `more` cede ce qui manque a `less` pour atteindre 1
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // Restes (a l'arrondi pres, probabilite 1)
+    for (uint32_t i : large) m_buckets[i] = Bucket{ UINT32_MAX, i };
+    for (uint32_t i : small) m_buckets[i] = Bucket{ UINT32_MAX, i };
+    return true;
+}
+
+uint32_t AliasTable::Pick(Xoshiro256& random) const {
+    uint32_t index = random.Below((uint32_t)m_buckets.size());
+    const Bucket& bucket = m_buckets[index];
+    if (bucket.alias == index) return index;
+    return (uint32_t)(random.Next() >> 32) < bucket.threshold ? index : bucket.alias;
+}
+
+const char* SelectionModeName(SelectionMode mode) {
+    switch (mode) {
+    case SelectionMode::Uniform: return "uniform";
+    case SelectionMode::ShuffleBag: return "shuffle";
+    case SelectionMode::BalancedFolders: return "folders";
+    case SelectionMode::RecentFirst: return "recent";
+    }
+    return "?";
+}
+
+bool ParseSelectionMode(const char* name, SelectionMode& mode) {
+    for (SelectionMode candidate : { SelectionMode::Uniform, SelectionMode::ShuffleBag,
+        SelectionMode::BalancedFolders, SelectionMode::RecentFirst }) {
+        if (std::strcmp(name, SelectionModeName(candidate)) == 0) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+RandomSelector::RandomSelector(uint64_t seed) {
+    Seed(seed);
+}
+
+void RandomSelector::Seed(uint64_t seed) {
+    m_random.Seed(seed != 0 ? seed : RandomSeed());
+}
+
+void RandomSelector::SetMode(SelectionMode mode) {
+    if (mode == m_mode) return;
+    m_mode = mode;
+    m_alias.Clear();
+}
+
+void RandomSelector::Reset() {
+    m_bag.clear();
+    m_bagKnown = 0;
+    m_alias.Clear();
+    m_groupRound.clear();
+    m_round = 1;
+    m_filteredBag.clear();
+    m_filteredShown = ImageBitmap();
+    m_filteredGeneration = UINT64_MAX;
+    if (m_filter) m_filter->Reset();
+}
+
+void RandomSelector::SetDuplicates(const DuplicateGroups* duplicates) {
+    m_duplicates = duplicates;
+    m_groupRound.clear();
+}
+
+void RandomSelector::SetFilter(CatalogFilter* filter) {
+    m_filter = filter;
+    m_alias.Clear();
+    m_filteredGeneration = UINT64_MAX;
+}
+
+bool RandomSelector::AcceptDuplicate(ImageId id) {
+    if (!m_duplicates) return true;
+    uint32_t size = m_duplicates->GroupSize(id);
+    return size <= 1 || m_random.Below(size) == 0;
+}
+
+ImageId RandomSelector::Pick(const ImageCatalog& catalog) {
+    if (catalog.Size() <= catalog.ExcludedCount()) return InvalidImageId;
+    if (IsFiltered()) {
+        m_filter->Update(catalog);
+        if (m_filter->Count() == 0) return InvalidImageId;
+    }
+    if (m_mode == SelectionMode::ShuffleBag) return IsFiltered() ? PickFromFilteredBag(catalog) : PickFromBag(catalog);
+    m_catalogSettled = catalog.Version() == m_previousPickVersion;
+    m_previousPickVersion = catalog.Version();
+
+    // Rejet : une image d'un groupe de n doublons n'est gardee qu'une fois sur n. Le nombre
+    // de tentatives est borne pour un catalogue fait presque uniquement de doublons.
+    ImageId id = InvalidImageId;
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        id = m_mode == SelectionMode::Uniform ? PickUniform(catalog) : PickWeighted(catalog);
+        if (AcceptDuplicate(id)) break;
+    }
+    return id;
+}
+
+ImageId RandomSelector::PickUniform(const ImageCatalog& catalog) {
+    // Liste des images retenues, deja sans les exclues
+    if (IsFiltered()) return m_filter->At(m_random.Below((uint32_t)m_filter->Count()));
+    ImageId id;
+    do {
+        id = m_random.Below((uint32_t)catalog.Size());
+    } while (catalog.IsExcluded(id));
+    return id;
+}
+
+ImageId RandomSelector::PickFromBag(const ImageCatalog& catalog) {
+    // Les images decouvertes depuis le dernier tirage rejoignent le tour en cours
+    if (m_bagKnown > catalog.Size()) Reset();
+    for (size_t id = m_bagKnown; id < catalog.Size(); ++id) m_bag.push_back((ImageId)id);
+    m_bagKnown = catalog.Size();
+
+    for (int round = 0; round < 2; ++round) {
+        while (!m_bag.empty()) {
+            // Retrait d'un element quelconque en O(1) : echange avec le dernier
+            uint32_t index = m_random.Below((uint32_t)m_bag.size());
+            ImageId id = m_bag[index];
+            m_bag[index] = m_bag.back();
+            m_bag.pop_back();
+            if (catalog.IsExcluded(id) || !FirstOfGroupInRound(catalog, id)) continue;
+            return id;
+        }
+        // Tour termine : toutes les images reviennent dans le sac
+        ++m_round;
+        m_bag.resize(catalog.Size());
+        for (size_t id = 0; id < m_bag.size(); ++id) m_bag[id] = (ImageId)id;
+    }
+    return InvalidImageId;
+}
+
+ImageId RandomSelector::PickFromFilteredBag(const ImageCatalog& catalog) {
+    if (m_filteredGeneration != m_filter->Generation()) {
+        m_filteredShown.Resize(catalog.Size());
+        m_filteredBag.clear();
+        for (ImageId id : m_filter->Matches()) {
+            if (!m_filteredShown.Test(id)) m_filteredBag.push_back(id);
+        }
+        m_filteredGeneration = m_filter->Generation();
+        m_filteredKnown = m_filter->Count();
+    }
+    else if (m_filter->Count() > m_filteredKnown) {
+        // Images ajoutees par le scan depuis le dernier tirage : a la fin de Matches
+        m_filteredShown.Resize(catalog.Size());
+        const std::vector<ImageId>& matches = m_filter->Matches();
+        m_filteredBag.insert(m_filteredBag.end(), matches.begin() + m_filteredKnown, matches.end());
+        m_filteredKnown = matches.size();
+    }
+
+    for (int round = 0; round < 2; ++round) {
+        while (!m_filteredBag.empty()) {
+            uint32_t index = m_random.Below((uint32_t)m_filteredBag.size());
+            ImageId id = m_filteredBag[index];
+            m_filteredBag[index] = m_filteredBag.back();
+            m_filteredBag.pop_back();
+            m_filteredShown.Set(id);
+            if (FirstOfGroupInRound(catalog, id)) return id;
+        }
+        // Tour termine : toutes les images retenues reviennent dans le sac
+        ++m_round;
+        m_filteredShown.Assign(catalog.Size(), false);
+        m_filteredBag = m_filter->Matches();
+        m_filteredKnown = m_filteredBag.size();
+    }
+    return InvalidImageId;
+}
+
+bool RandomSelector::FirstOfGroupInRound(const ImageCatalog& catalog, ImageId id) {
+    if (!m_duplicates) return true;
+    // Un doublon d'une image deja montree pendant ce tour est retire sans etre montre
+    ImageId group = m_duplicates->Group(id);
+    if (group >= m_groupRound.size()) m_groupRound.resize(std::max<size_t>(catalog.Size(), group + 1), 0);
+    if (m_groupRound[group] == m_round) return false;
+    m_groupRound[group] = m_round;
+    return true;
+}
+
+ImageId RandomSelector::PickWeighted(const ImageCatalog& catalog) {
+    uint64_t generation = IsFiltered() ? m_filter->Generation() : 0;
+    bool rebuild = m_alias.Empty() || m_aliasGeneration != generation || catalog.Size() < m_alias.Size();
+    if (!rebuild && m_aliasVersion != catalog.Version()) {
+        rebuild = m_catalogSettled || catalog.Size() - m_alias.Size() >= m_alias.Size() / 8;
+    }
+    if (rebuild && !BuildAlias(catalog, generation)) return PickUniform(catalog);
+
+    ImageId id = m_alias.Pick(m_random);
+    // Table perimee : l'image a pu etre exclue depuis sa construction
+    if (catalog.IsExcluded(id) && m_aliasVersion != catalog.Version()) {
+        if (!BuildAlias(catalog, generation)) return PickUniform(catalog);
+        id = m_alias.Pick(m_random);
+    }
+    return id;
+}
+
+bool RandomSelector::BuildAlias(const ImageCatalog& catalog, uint64_t generation) {
+    const CatalogFilter* filter = IsFiltered() ? m_filter : nullptr;
+    std::vector<double> weights;
+    if (m_mode == SelectionMode::BalancedFolders) FolderWeights(catalog, filter, weights);
+    else RecentWeights(catalog, filter, weights);
+    if (!m_alias.Build(weights)) return false;
+    m_aliasVersion = catalog.Version();
+    m_aliasGeneration = generation;
+    return true;
+}
+
+void RandomSelector::Rebase(const ImageCatalog& previous, const ImageCatalog& next) {
+    m_alias.Clear();
+    m_groupRound.clear();
+    // Tour du sac filtre recommence sur le nouveau catalogue
+    m_filteredBag.clear();
+    m_filteredShown = ImageBitmap();
+    m_filteredGeneration = UINT64_MAX;
+    if (m_filter) m_filter->Reset();
+    if (m_bagKnown == 0 || m_bagKnown > previous.Size()) {
+        Reset();
+        return;
+    }
+
+    std::vector<bool> pending(m_bagKnown, false);
+    for (ImageId id : m_bag) pending[id] = true;
+    std::vector<bool> seen(next.Size(), false);
+    for (size_t id = 0; id < m_bagKnown; ++id) {
+        if (pending[id]) continue;
+        ImageId mapped = next.Find(previous.FullPath((ImageId)id));
+        if (mapped != InvalidImageId) seen[mapped] = true;
+    }
+
+    m_bag.clear();
+    for (size_t id = 0; id < next.Size(); ++id) {
+        if (!seen[id]) m_bag.push_back((ImageId)id);
+    }
+    m_bagKnown = next.Size();
+}
+
+void RandomSelector::FolderWeights(const ImageCatalog& catalog, const CatalogFilter* filter, std::vector<double>& weights) {
+    // Chaque dossier qui a des images retenues a le meme poids
+    auto kept = [&](ImageId id) { return !catalog.IsExcluded(id) && (!filter || filter->Contains(id)); };
+    std::vector<uint32_t> counts(catalog.DirectoryCount(), 0);
+    for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) {
+        if (kept(id)) ++counts[catalog.DirectoryOf(id)];
+    }
+    weights.resize(catalog.Size());
+    for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) {
+        weights[id] = kept(id) ? 1.0 / counts[catalog.DirectoryOf(id)] : 0.0;
+    }
+}
+
+void RandomSelector::RecentWeights(const ImageCatalog& catalog, const CatalogFilter* filter, std::vector<double>& weights) {
+    // Poids de 1 (ancien ou date inconnue) a 16 (le plus recent), divise par deux tous les
+    // 30 jours d'ecart avec le fichier le plus recent
+    const double halfLife = (double)std::chrono::duration_cast<std::filesystem::file_time_type::duration>(
+        std::chrono::hours(24 * 30)).count();
+    int64_t newest = 0;
+    for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) newest = std::max(newest, catalog.ModifiedTime(id));
+
+    weights.resize(catalog.Size());
+    for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) {
+        int64_t mtime = catalog.ModifiedTime(id);
+        if (catalog.IsExcluded(id) || (filter && !filter->Contains(id))) weights[id] = 0.0;
+        else if (mtime == 0) weights[id] = 1.0;
+        else weights[id] = 1.0 + 15.0 * std::exp2(-(double)(newest - mtime) / halfLife);
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageCatalog.h"
+#include "ImageFilter.h"
+#include "PerceptualHash.h"
+
+// Generateur xoshiro256** : rapide, 256 bits d'etat, reproductible a partir d'une graine
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed = 0) { Seed(seed); }
+
+    // L'etat est derive de la graine par SplitMix64, comme le recommandent les auteurs
+    void Seed(uint64_t seed);
+    uint64_t Next();
+    // Entier uniforme dans [0, bound) sans division dans le cas courant (methode de Lemire)
+    uint32_t Below(uint32_t bound);
+
+private:
+    uint64_t m_state[4];
+};
+
+// Tirage pondere en O(1) par la methode des alias (Vose) : chaque case contient un seuil
+// et un second candidat, un tirage coute un index uniforme et une comparaison
+class AliasTable {
+public:
+    // Les poids nuls ne sont jamais tires ; false si tous les poids sont nuls
+    bool Build(const std::vector<double>& weights);
+    void Clear() { m_buckets.clear(); }
+    bool Empty() const { return m_buckets.empty(); }
+    size_t Size() const { return m_buckets.size(); }
+
+    uint32_t Pick(Xoshiro256& random) const;
+
+private:
+    struct Bucket {
+        // Probabilite de garder la case, sur 32 bits ; alias == case si elle est toujours gardee
+        uint32_t threshold;
+        uint32_t alias;
+    };
+
+    std::vector<Bucket> m_buckets;
+};
+
+enum class SelectionMode {
+    // Chaque image a la meme probabilite, les repetitions sont possibles
+    Uniform,
+    // Pas de repetition tant que toutes les images n'ont pas ete vues
+    ShuffleBag,
+    // Chaque dossier a le meme poids, quel que soit son nombre d'images
+    BalancedFolders,
+    // Les fichiers modifies recemment sortent plus souvent
+    RecentFirst,
+};
+
+const char* SelectionModeName(SelectionMode mode);
+bool ParseSelectionMode(const char* name, SelectionMode& mode);
+
+// Choix de la prochaine image du catalogue. Un seul generateur pour toute la session :
+// avec une graine fixe (--seed) la suite des tirages est reproductible. Thread UI seulement.
+class RandomSelector {
+public:
+    // Graine 0 : graine aleatoire (std::random_device)
+    explicit RandomSelector(uint64_t seed = 0);
+
+    void Seed(uint64_t seed);
+    SelectionMode Mode() const { return m_mode; }
+    void SetMode(SelectionMode mode);
+
+    // Image non exclue du catalogue, InvalidImageId s'il n'y en a pas
+    ImageId Pick(const ImageCatalog& catalog);
+
+    // Le catalogue `previous` va etre remplace par `next` (index differents) : le sac garde
+    // les images deja vues, retrouvees par leur chemin
+    void Rebase(const ImageCatalog& previous, const ImageCatalog& next);
+    // Oublie les tirages du sac et les poids (changement de dossier)
+    void Reset();
+
+    // Groupes de quasi-doublons du catalogue (HashIndexer), null pour les ignorer. Chaque
+    // groupe compte pour une seule image : sa probabilite est celle d'une image seule et le
+    // sac n'en montre qu'un membre par tour. Les groupes doivent rester valides.
+    void SetDuplicates(const DuplicateGroups* duplicates);
+
+    // Filtre du tirage, null pour aucun. Avec un filtre actif, chaque mode ne tire que parmi
+    // les images retenues : uniforme en O(1) dans leur liste, sac rempli avec elles, poids
+    // nuls pour les autres. Le filtre doit rester valide ; Reset et Rebase oublient ses index.
+    void SetFilter(CatalogFilter* filter);
+
+    // Generateur de la session, pour les autres tirages (image de l'index au demarrage)
+    Xoshiro256& Random() { return m_random; }
+
+    // Images restant dans le sac avant qu'il ne soit rempli a nouveau
+    size_t BagRemaining() const { return m_bag.size(); }
+
+private:
+    // Poids des modes ponderes, 0 pour les images exclues ou ecartees par `filter`
+    static void FolderWeights(const ImageCatalog& catalog, const CatalogFilter* filter, std::vector<double>& weights);
+    static void RecentWeights(const ImageCatalog& catalog, const CatalogFilter* filter, std::vector<double>& weights);
+
+    bool IsFiltered() const { return m_filter && m_filter->IsActive(); }
+    ImageId PickUniform(const ImageCatalog& catalog);
+    ImageId PickFromBag(const ImageCatalog& catalog);
+    ImageId PickFromFilteredBag(const ImageCatalog& catalog);
+    ImageId PickWeighted(const ImageCatalog& catalog);
+    bool BuildAlias(const ImageCatalog& catalog, uint64_t generation);
+    // Garde un tirage avec une probabilite 1/taille de son groupe de doublons
+    bool AcceptDuplicate(ImageId id);
+    // Sac : false si un doublon de l'image a deja ete montre pendant ce tour
+    bool FirstOfGroupInRound(const ImageCatalog& catalog, ImageId id);
+
+    Xoshiro256 m_random;
+    SelectionMode m_mode = SelectionMode::Uniform;
+
+    // Sac : images pas encore tirees de ce tour ; les images ajoutees au catalogue depuis
+    // le dernier tirage (index >= m_bagKnown) y sont versees au fur et a mesure
+    std::vector<ImageId> m_bag;
+    size_t m_bagKnown = 0;
+
+    const DuplicateGroups* m_duplicates = nullptr;
+    // Tour du sac ou chaque groupe de doublons a ete montre pour la derniere fois
+    std::vector<uint32_t> m_groupRound;
+    uint32_t m_round = 1;
+
+    CatalogFilter* m_filter = nullptr;
+    // Sac du tirage filtre : images retenues pas encore montrees pendant ce tour. Refait a
+    // chaque compilation complete du filtre, sans les images deja montrees ; les images
+    // retenues ajoutees ensuite (Matches au-dela de m_filteredKnown) y sont versees.
+    std::vector<ImageId> m_filteredBag;
+    ImageBitmap m_filteredShown;
+    uint64_t m_filteredGeneration = UINT64_MAX;
+    size_t m_filteredKnown = 0;
+
+    // Table des modes ponderes, reconstruite en O(N) quand le catalogue ou le filtre a
+    // change. Tant que le catalogue change entre deux tirages (scan en cours), la table
+    // perimee sert jusqu'a ce qu'il ait grandi d'un huitieme : les images ajoutees
+    // entre-temps attendent la reconstruction suivante, le cout reste lineaire sur le scan.
+    AliasTable m_alias;
+    uint64_t m_aliasVersion = 0;
+    uint64_t m_aliasGeneration = 0;
+    // Version du catalogue au tirage precedent, et si elle n'a pas change depuis
+    uint64_t m_previousPickVersion = UINT64_MAX;
+    bool m_catalogSettled = false;
+};
@@ -0,0 +1,343 @@
+#include "Resampler.h"
+
+#include "ResamplerKernels.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#if RESAMPLER_X86
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+    constexpr double Pi = 3.14159265358979323846;
+
+    double FilterSupport(ResampleFilter filter) {
+        switch (filter) {
+        case ResampleFilter::Box: return 0.5;
+        case ResampleFilter::Bilinear: return 1.0;
+        default: return 3.0;
+        }
+    }
+
+    double Sinc(double x) {
+        if (x == 0.0) return 1.0;
+        x *= Pi;
+        return std::sin(x) / x;
+    }
+
+    double FilterValue(ResampleFilter filter, double x) {
+        switch (filter) {
+        case ResampleFilter::Box:
+            return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+        case ResampleFilter::Bilinear:
+            x = std::fabs(x);
+            return x < 1.0 ? 1.0 - x : 0.0;
+        default:
+            return (x > -3.0 && x < 3.0) ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+        }
+    }
+
+    // Contributions de chaque pixel de sortie ; en reduction, le filtre est elargi du
+    // facteur d'echelle pour couvrir tous les pixels d'entree
+    ResampleAxis BuildAxis(int inSize, int outSize, ResampleFilter filter) {
+        double scale = (double)inSize / outSize;
+        double filterScale = std::max(scale, 1.0);
+        double support = FilterSupport(filter) * filterScale;
+
+        ResampleAxis axis;
+        axis.taps = (int)std::ceil(support) * 2 + 1;
+        axis.first.resize(outSize);
+        axis.count.resize(outSize);
+        axis.weights.assign((size_t)outSize * axis.taps, 0);
+
+        std::vector<double> weights(axis.taps);
+        for (int i = 0; i < outSize; ++i) {
+            double center = (i + 0.5) * scale;
+            int first = std::max(0, (int)std::floor(center - support + 0.5));
+            int last = std::min(inSize, (int)std::floor(center + support + 0.5));
+            int count = std::min(last - first, axis.taps);
+
+            double total = 0.0;
+            for (int k = 0; k < count; ++k) {
+                weights[k] = FilterValue(filter, (first + k - center + 0.5) / filterScale);
+                total += weights[k];
+            }
+            if (count <= 0 || total == 0.0) {
+                // Pixel de sortie sans contribution (arrondi au bord) : pixel d'entree le plus proche
+                first = std::min(inSize - 1, std::max(0, (int)center));
+                count = 1;
+                weights[0] = total = 1.0;
+            }
+
+            // Quantification ; l'erreur d'arrondi va sur le plus gros poids pour que la
+            // somme soit exacte et qu'une zone uniforme le reste
+            int16_t* quantized = &axis.weights[(size_t)i * axis.taps];
+            int sum = 0;
+            int largest = 0;
+            for (int k = 0; k < count; ++k) {
+                quantized[k] = (int16_t)std::lround(weights[k] / total * (1 << ResampleWeightBits));
+                sum += quantized[k];
+                if (quantized[k] > quantized[largest]) largest = k;
+            }
+            quantized[largest] = (int16_t)(quantized[largest] + (1 << ResampleWeightBits) - sum);
+
+            axis.first[i] = first;
+            axis.count[i] = count;
+        }
+        return axis;
+    }
+
+#if RESAMPLER_X86
+    inline __m128i LoadPixel(const uint8_t* pixel) {
+        int32_t value;
+        std::memcpy(&value, pixel, 4);
+        return _mm_cvtsi32_si128(value);
+    }
+
+    inline __m128i WeightPair(int16_t first, int16_t second) {
+        return _mm_set1_epi32((int32_t)((uint32_t)(uint16_t)first | ((uint32_t)(uint16_t)second << 16)));
+    }
+#endif
+}
+
+void HorizontalRowScalar(const uint8_t* source, uint8_t* destination, int width, const ResampleAxis& axis) {
+    for (int x = 0; x < width; ++x) {
+        const int16_t* weights = &axis.weights[(size_t)x * axis.taps];
+        const uint8_t* pixel = source + (size_t)axis.first[x] * 4;
+        int32_t b = 0, g = 0, r = 0, a = 0;
+        for (int k = 0; k < axis.count[x]; ++k, pixel += 4) {
+            b += pixel[0] * weights[k];
+            g += pixel[1] * weights[k];
+            r += pixel[2] * weights[k];
+            a += pixel[3] * weights[k];
+        }
+        destination[x * 4 + 0] = ClampResampled(b);
+        destination[x * 4 + 1] = ClampResampled(g);
+        destination[x * 4 + 2] = ClampResampled(r);
+        destination[x * 4 + 3] = ClampResampled(a);
+    }
+}
+
+void VerticalRowScalar(const uint8_t* const* rows, const int16_t* weights, int count,
+    uint8_t* destination, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        int32_t sum = 0;
+        for (int k = 0; k < count; ++k) {
+            sum += rows[k][i] * weights[k];
+        }
+        destination[i] = ClampResampled(sum);
+    }
+}
+
+#if RESAMPLER_X86
+void HorizontalRowSse2(const uint8_t* source, uint8_t* destination, int width, const ResampleAxis& axis) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (ResampleWeightBits - 1));
+
+    for (int x = 0; x < width; ++x) {
+        const int16_t* weights = &axis.weights[(size_t)x * axis.taps];
+        const uint8_t* pixel = source + (size_t)axis.first[x] * 4;
+        int count = axis.count[x];
+        __m128i sum = zero;
+
+        // Deux pixels a la fois : [b0 b1 g0 g1 r0 r1 a0 a1] multiplie par [w0 w1] (pmaddwd)
+        int k = 0;
+        for (; k + 2 <= count; k += 2) {
+            __m128i pair = _mm_loadl_epi64((const __m128i*)(pixel + k * 4));
+            pair = _mm_unpacklo_epi8(pair, _mm_srli_si128(pair, 4));
+            pair = _mm_unpacklo_epi8(pair, zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, WeightPair(weights[k], weights[k + 1])));
+        }
+        if (k < count) {
+            __m128i single = _mm_unpacklo_epi8(_mm_unpacklo_epi8(LoadPixel(pixel + k * 4), zero), zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(single, WeightPair(weights[k], 0)));
+        }
+
+        sum = _mm_srai_epi32(_mm_add_epi32(sum, rounding), ResampleWeightBits);
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_packus_epi16(sum, sum);
+        int32_t result = _mm_cvtsi128_si32(sum);
+        std::memcpy(destination + x * 4, &result, 4);
+    }
+}
+
+void VerticalRowSse2(const uint8_t* const* rows, const int16_t* weights, int count,
+    uint8_t* destination, int bytes) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (ResampleWeightBits - 1));
+
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i sum0 = zero, sum1 = zero, sum2 = zero, sum3 = zero;
+
+        // Deux lignes a la fois : octets entrelaces [l0 l1] multiplies par [w0 w1]
+        int k = 0;
+        for (; k < count; k += 2) {
+            __m128i row0 = _mm_loadu_si128((const __m128i*)(rows[k] + i));
+            __m128i row1 = k + 1 < count ? _mm_loadu_si128((const __m128i*)(rows[k + 1] + i)) : zero;
+            __m128i weight = WeightPair(weights[k], k + 1 < count ? weights[k + 1] : 0);
+
+            __m128i low = _mm_unpacklo_epi8(row0, row1);
+            __m128i high = _mm_unpackhi_epi8(row0, row1);
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), weight));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), weight));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), weight));
+            sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), weight));
+        }
+
+        sum0 = _mm_srai_epi32(_mm_add_epi32(sum0, rounding), ResampleWeightBits);
+        sum1 = _mm_srai_epi32(_mm_add_epi32(sum1, rounding), ResampleWeightBits);
+        sum2 = _mm_srai_epi32(_mm_add_epi32(sum2, rounding), ResampleWeightBits);
+        sum3 = _mm_srai_epi32(_mm_add_epi32(sum3, rounding), ResampleWeightBits);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(sum0, sum1), _mm_packs_epi32(sum2, sum3));
+        _mm_storeu_si128((__m128i*)(destination + i), packed);
+    }
+
+    for (; i < bytes; ++i) {
+        int32_t sum = 0;
+        for (int k = 0; k < count; ++k) {
+            sum += rows[k][i] * weights[k];
+        }
+        destination[i] = ClampResampled(sum);
+    }
+}
+#endif
+
+SimdLevel DetectSimdLevel() {
+#if RESAMPLER_X86
+    static const SimdLevel level = []() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        bool sse2 = __builtin_cpu_supports("sse2");
+        bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        if (avx2) return SimdLevel::Avx2;
+        if (sse2) return SimdLevel::Sse2;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::Sse2: return "sse2";
+    case SimdLevel::Avx2: return "avx2";
+    default: return "auto";
+    }
+}
+
+const char* ResampleFilterName(ResampleFilter filter) {
+    switch (filter) {
+    case ResampleFilter::Box: return "box";
+    case ResampleFilter::Bilinear: return "bilinear";
+    default: return "lanczos3";
+    }
+}
+
+bool ResampleImage(const ConstImageView& source, const ImageView& destination, const ResampleOptions& options) {
+    if (!source.data || !destination.data || source.width <= 0 || source.height <= 0 ||
+        destination.width <= 0 || destination.height <= 0) {
+        return false;
+    }
+
+    SimdLevel supported = DetectSimdLevel();
+    SimdLevel level = options.simd == SimdLevel::Auto ? supported : options.simd;
+    if (level > supported) return false;
+
+    HorizontalKernel horizontal = HorizontalRowScalar;
+    VerticalKernel vertical = VerticalRowScalar;
+#if RESAMPLER_X86
+    if (level == SimdLevel::Sse2) {
+        horizontal = HorizontalRowSse2;
+        vertical = VerticalRowSse2;
+    }
+    else if (level == SimdLevel::Avx2) {
+        horizontal = HorizontalRowAvx2;
+        vertical = VerticalRowAvx2;
+    }
+#endif
+
+    auto parallelFor = [&options](size_t count, const std::function<void(size_t)>& body) {
+        if (options.pool) {
+            options.pool->ParallelFor(count, body);
+        }
+        else {
+            for (size_t i = 0; i < count; ++i) body(i);
+        }
+    };
+
+    // Passe horizontale : seules les lignes d'entree utilisees par la passe verticale
+    ResampleAxis rowsAxis = BuildAxis(source.height, destination.height, options.filter);
+    int firstRow = rowsAxis.first.front();
+    int lastRow = rowsAxis.first.back() + rowsAxis.count.back();
+
+    std::vector<uint8_t> intermediate;
+    ConstImageView horizontalResult = source;
+    // Premiere ligne d'entree presente dans horizontalResult
+    int rowOffset = 0;
+    if (source.width != destination.width) {
+        ResampleAxis columnsAxis = BuildAxis(source.width, destination.width, options.filter);
+        ptrdiff_t stride = (ptrdiff_t)destination.width * 4;
+        intermediate.resize((size_t)(lastRow - firstRow) * stride);
+
+        constexpr int BandRows = 16;
+        int rowCount = lastRow - firstRow;
+        parallelFor((rowCount + BandRows - 1) / BandRows, [&](size_t band) {
+            int begin = (int)band * BandRows;
+            int end = std::min(rowCount, begin + BandRows);
+            for (int y = begin; y < end; ++y) {
+                horizontal(source.data + (ptrdiff_t)(firstRow + y) * source.stride,
+                    intermediate.data() + (ptrdiff_t)y * stride, destination.width, columnsAxis);
+            }
+        });
+        horizontalResult = ConstImageView(intermediate.data(), destination.width, rowCount, stride);
+        rowOffset = firstRow;
+    }
+
+    // Passe verticale
+    constexpr int BandRows = 8;
+    int bytes = destination.width * 4;
+    parallelFor((destination.height + BandRows - 1) / BandRows, [&](size_t band) {
+        int begin = (int)band * BandRows;
+        int end = std::min(destination.height, begin + BandRows);
+        std::vector<const uint8_t*> rows(rowsAxis.taps);
+        for (int y = begin; y < end; ++y) {
+            uint8_t* output = destination.data + (ptrdiff_t)y * destination.stride;
+            if (source.height == destination.height) {
+                std::memcpy(output, horizontalResult.data + (ptrdiff_t)(y - rowOffset) * horizontalResult.stride, bytes);
+                continue;
+            }
+            int count = rowsAxis.count[y];
+            for (int k = 0; k < count; ++k) {
+                rows[k] = horizontalResult.data + (ptrdiff_t)(rowsAxis.first[y] + k - rowOffset) * horizontalResult.stride;
+            }
+            vertical(rows.data(), &rowsAxis.weights[(size_t)y * rowsAxis.taps], count, output, bytes);
+        }
+    });
+    return true;
+}
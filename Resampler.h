@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// Redimensionnement d'images 32 bits (BGRA, alpha premultiplie ou non) independant de la
+// plateforme. Les deux passes (horizontale puis verticale) sont separables, calculees en
+// virgule fixe avec un tampon intermediaire 8 bits, et reparties par bandes de lignes.
+enum class ResampleFilter {
+    Box,
+    Bilinear,
+    Lanczos3,
+};
+
+// Jeu d'instructions des noyaux ; Auto choisit le meilleur disponible a l'execution
+enum class SimdLevel {
+    Auto,
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+struct ImageView {
+    uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    // Octets entre deux lignes, au moins width * 4
+    ptrdiff_t stride = 0;
+};
+
+struct ConstImageView {
+    const uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    ptrdiff_t stride = 0;
+
+    ConstImageView() = default;
+    ConstImageView(const uint8_t* data, int width, int height, ptrdiff_t stride)
+        : data(data), width(width), height(height), stride(stride) {}
+    ConstImageView(const ImageView& view)
+        : data(view.data), width(view.width), height(view.height), stride(view.stride) {}
+};
+
+struct ResampleOptions {
+    ResampleFilter filter = ResampleFilter::Lanczos3;
+    SimdLevel simd = SimdLevel::Auto;
+    // Null : calcul sur le thread appelant
+    ThreadPool* pool = nullptr;
+};
+
+// Meilleur jeu d'instructions supporte par le processeur
+SimdLevel DetectSimdLevel();
+const char* SimdLevelName(SimdLevel level);
+const char* ResampleFilterName(ResampleFilter filter);
+
+// Redimensionne `source` a la taille de `destination`. Echoue si une des images est vide
+// ou si le jeu d'instructions demande n'est pas disponible.
+bool ResampleImage(const ConstImageView& source, const ImageView& destination,
+    const ResampleOptions& options = ResampleOptions());
@@ -0,0 +1,111 @@
+#include "ResamplerKernels.h"
+
+#if RESAMPLER_X86
+
+#include <cstring>
+#include <immintrin.h>
+
+// Noyaux AVX2, appeles seulement si DetectSimdLevel les signale. MSVC accepte les
+// intrinsics sans option ; GCC et Clang les activent fonction par fonction.
+#if defined(__GNUC__) || defined(__clang__)
+#define RESAMPLER_AVX2 __attribute__((target("avx2")))
+#else
+#define RESAMPLER_AVX2
+#endif
+
+namespace {
+    RESAMPLER_AVX2 inline int32_t PackWeights(int16_t first, int16_t second) {
+        return (int32_t)((uint32_t)(uint16_t)first | ((uint32_t)(uint16_t)second << 16));
+    }
+}
+
+RESAMPLER_AVX2
+void HorizontalRowAvx2(const uint8_t* source, uint8_t* destination, int width, const ResampleAxis& axis) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (ResampleWeightBits - 1));
+    // Dans chaque moitie : [b0 g0 r0 a0 b1 g1 r1 a1] (16 bits) -> [b0 b1 g0 g1 r0 r1 a0 a1]
+    const __m256i interleave = _mm256_setr_epi8(
+        0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+        0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+
+    for (int x = 0; x < width; ++x) {
+        const int16_t* weights = &axis.weights[(size_t)x * axis.taps];
+        const uint8_t* pixel = source + (size_t)axis.first[x] * 4;
+        int count = axis.count[x];
+
+        // Quatre pixels a la fois : pixels 0-1 dans la moitie basse, 2-3 dans la haute
+        __m256i wideSum = _mm256_setzero_si256();
+        int k = 0;
+        for (; k + 4 <= count; k += 4) {
+            __m256i pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(pixel + k * 4)));
+            pixels = _mm256_shuffle_epi8(pixels, interleave);
+            int32_t low = PackWeights(weights[k], weights[k + 1]);
+            int32_t high = PackWeights(weights[k + 2], weights[k + 3]);
+            __m256i weight = _mm256_setr_epi32(low, low, low, low, high, high, high, high);
+            wideSum = _mm256_add_epi32(wideSum, _mm256_madd_epi16(pixels, weight));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(wideSum), _mm256_extracti128_si256(wideSum, 1));
+
+        for (; k + 2 <= count; k += 2) {
+            __m128i pair = _mm_loadl_epi64((const __m128i*)(pixel + k * 4));
+            pair = _mm_unpacklo_epi8(pair, _mm_srli_si128(pair, 4));
+            pair = _mm_unpacklo_epi8(pair, zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, _mm_set1_epi32(PackWeights(weights[k], weights[k + 1]))));
+        }
+        if (k < count) {
+            int32_t value;
+            std::memcpy(&value, pixel + k * 4, 4);
+            __m128i single = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(value));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(single, _mm_set1_epi32(weights[k])));
+        }
+
+        sum = _mm_srai_epi32(_mm_add_epi32(sum, rounding), ResampleWeightBits);
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_packus_epi16(sum, sum);
+        int32_t result = _mm_cvtsi128_si32(sum);
+        std::memcpy(destination + x * 4, &result, 4);
+    }
+}
+
+RESAMPLER_AVX2
+void VerticalRowAvx2(const uint8_t* const* rows, const int16_t* weights, int count,
+    uint8_t* destination, int bytes) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i rounding = _mm256_set1_epi32(1 << (ResampleWeightBits - 1));
+
+    // Meme schema que VerticalRowSse2 sur 32 octets ; les depaquetages et les
+    // repaquetages restent dans chaque moitie, l'ordre des octets est donc conserve
+    int i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i sum0 = zero, sum1 = zero, sum2 = zero, sum3 = zero;
+        for (int k = 0; k < count; k += 2) {
+            __m256i row0 = _mm256_loadu_si256((const __m256i*)(rows[k] + i));
+            __m256i row1 = k + 1 < count ? _mm256_loadu_si256((const __m256i*)(rows[k + 1] + i)) : zero;
+            __m256i weight = _mm256_set1_epi32(PackWeights(weights[k], k + 1 < count ? weights[k + 1] : 0));
+
+            __m256i low = _mm256_unpacklo_epi8(row0, row1);
+            __m256i high = _mm256_unpackhi_epi8(row0, row1);
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_unpacklo_epi8(low, zero), weight));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_unpackhi_epi8(low, zero), weight));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_unpacklo_epi8(high, zero), weight));
+            sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_unpackhi_epi8(high, zero), weight));
+        }
+
+        sum0 = _mm256_srai_epi32(_mm256_add_epi32(sum0, rounding), ResampleWeightBits);
+        sum1 = _mm256_srai_epi32(_mm256_add_epi32(sum1, rounding), ResampleWeightBits);
+        sum2 = _mm256_srai_epi32(_mm256_add_epi32(sum2, rounding), ResampleWeightBits);
+        sum3 = _mm256_srai_epi32(_mm256_add_epi32(sum3, rounding), ResampleWeightBits);
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(sum0, sum1), _mm256_packs_epi32(sum2, sum3));
+        _mm256_storeu_si256((__m256i*)(destination + i), packed);
+    }
+
+    for (; i < bytes; ++i) {
+        int32_t sum = 0;
+        for (int k = 0; k < count; ++k) {
+            sum += rows[k][i] * weights[k];
+        }
+        destination[i] = ClampResampled(sum);
+    }
+}
+
+#endif
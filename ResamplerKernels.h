@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Interne au redimensionnement (Resampler.cpp et noyaux SIMD)
+
+// Poids en virgule fixe : la somme des poids d'un pixel vaut 1 << ResampleWeightBits
+constexpr int ResampleWeightBits = 14;
+
+// Contributions d'un axe : pour chaque pixel de sortie, `count` pixels d'entree a partir
+// de `first`, avec leurs poids ranges tous les `taps` elements de `weights`
+struct ResampleAxis {
+    int taps = 0;
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<int16_t> weights;
+};
+
+using HorizontalKernel = void (*)(const uint8_t* source, uint8_t* destination, int width,
+    const ResampleAxis& axis);
+using VerticalKernel = void (*)(const uint8_t* const* rows, const int16_t* weights, int count,
+    uint8_t* destination, int bytes);
+
+void HorizontalRowScalar(const uint8_t* source, uint8_t* destination, int width, const ResampleAxis& axis);
+void VerticalRowScalar(const uint8_t* const* rows, const int16_t* weights, int count,
+    uint8_t* destination, int bytes);
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RESAMPLER_X86 1
+void HorizontalRowSse2(const uint8_t* source, uint8_t* destination, int width, const ResampleAxis& axis);
+void VerticalRowSse2(const uint8_t* const* rows, const int16_t* weights, int count,
+    uint8_t* destination, int bytes);
+void HorizontalRowAvx2(const uint8_t* source, uint8_t* destination, int width, const ResampleAxis& axis);
+void VerticalRowAvx2(const uint8_t* const* rows, const int16_t* weights, int count,
+    uint8_t* destination, int bytes);
+#endif
+
+inline uint8_t ClampResampled(int32_t sum) {
+    int32_t value = (sum + (1 << (ResampleWeightBits - 1))) >> ResampleWeightBits;
+    return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
@@ -0,0 +1,150 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+    thread_local const ThreadPool* t_pool = nullptr;
+    thread_local int t_workerIndex = -1;
+}
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) threadCount = 1;
+    }
+
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_workers[i]->thread = std::thread(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stop = true;
+    }
+    m_wakeCv.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+int ThreadPool::CurrentWorkerIndex() const {
+    return t_pool == this ? t_workerIndex : -1;
+}
+
+void ThreadPool::Submit(Task task) {
+    int current = CurrentWorkerIndex();
+    size_t target = current >= 0
+        ? (size_t)current
+        : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+    m_pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(m_workers[target]->mutex);
+        m_workers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Le verrou evite de perdre un reveil entre le test et l'attente d'un thread
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_queued.fetch_add(1);
+    }
+    m_wakeCv.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> lock(m_idleMutex);
+    m_idleCv.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+    if (count == 1) {
+        body(0);
+        return;
+    }
+
+    // Les index sont distribues par un compteur commun : l'appelant travaille aussi, et
+    // une tache qui demarre apres la fin n'a simplement plus rien a prendre
+    struct Shared {
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> done{ 0 };
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto shared = std::make_shared<Shared>();
+    auto run = [shared, count, &body]() {
+        size_t finished = 0;
+        for (size_t i = shared->next.fetch_add(1); i < count; i = shared->next.fetch_add(1)) {
+            body(i);
+            ++finished;
+        }
+        if (finished > 0 && shared->done.fetch_add(finished) + finished == count) {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->cv.notify_all();
+        }
+    };
+
+    size_t helpers = std::min(count - 1, m_workers.size());
+    for (size_t i = 0; i < helpers; ++i) {
+        Submit(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->cv.wait(lock, [&shared, count] { return shared->done.load() == count; });
+}
+
+bool ThreadPool::PopLocal(size_t index, Task& task) {
+    Worker& worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::Steal(size_t thief, Task& task) {
+    size_t count = m_workers.size();
+    for (size_t offset = 1; offset < count; ++offset) {
+        Worker& victim = *m_workers[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    t_pool = this;
+    t_workerIndex = (int)index;
+
+    for (;;) {
+        Task task;
+        if (PopLocal(index, task) || Steal(index, task)) {
+            m_queued.fetch_sub(1);
+            try {
+                task();
+            }
+            catch (...) {
+                // Une tache ne doit pas arreter le pool
+            }
+            if (m_pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m_idleMutex);
+                m_idleCv.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeCv.wait(lock, [this] { return m_stop || m_queued.load() > 0; });
+        if (m_stop && m_queued.load() == 0) return;
+    }
+}
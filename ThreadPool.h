@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de threads a vol de taches : chaque thread a sa propre file, les taches
+// soumises depuis un thread du pool vont dans sa file locale (LIFO) et les
+// threads inactifs volent les taches les plus anciennes des autres files.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 : un thread par coeur
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(Task task);
+
+    // Attend que toutes les taches soumises soient terminees.
+    // Ne doit pas etre appele depuis un thread du pool.
+    void WaitIdle();
+
+    size_t ThreadCount() const { return m_workers.size(); }
+
+    // Appelle body(i) pour i dans [0, count) sur les threads du pool et sur l'appelant,
+    // puis attend la fin. Utilisable depuis un thread du pool (pas d'attente de WaitIdle).
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    // Index du thread courant dans ce pool, ou -1 si l'appelant n'en fait pas partie
+    int CurrentWorkerIndex() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void WorkerLoop(size_t index);
+    bool PopLocal(size_t index, Task& task);
+    bool Steal(size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_queued{ 0 };
+    std::atomic<size_t> m_pending{ 0 };
+    std::atomic<size_t> m_nextWorker{ 0 };
+    bool m_stop = false;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCv;
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCv;
+};
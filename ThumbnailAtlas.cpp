@@ -0,0 +1,461 @@
+#include "ThumbnailAtlas.h"
+
+#include "ExifThumbnail.h"
+#include "LibraryIndex.h"
+#include "PathString.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char AtlasMagic[8] = { 'R', 'P', 'T', 'H', 'U', 'M', 'B', '\0' };
+    constexpr uint32_t AtlasVersion = 1;
+    constexpr uint32_t ReadyBit = 0x80000000u;
+    constexpr int GridSpacing = 8;
+
+    // Les projections commencent sur un multiple de 64 Ko (granularite de MapViewOfFile)
+    constexpr size_t HeaderBytes = 65536;
+    constexpr size_t KeyBlockBytes = 65536;
+    constexpr size_t SlotBytes = (size_t)ThumbnailAtlas::ThumbnailStride * ThumbnailAtlas::ThumbnailSize;
+    constexpr size_t ChunkBytes = KeyBlockBytes + ThumbnailAtlas::ChunkSlots * SlotBytes;
+
+    struct AtlasHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t thumbnailSize;
+        uint32_t chunkSlots;
+        uint32_t reserved;
+        uint64_t chunkCount;
+        // Cases attribuees ; celles dont le record n'est pas marque pret sont libres
+        uint64_t slotCount;
+    };
+
+    struct SlotRecord {
+        uint64_t key;
+        uint16_t width;
+        uint16_t height;
+        uint32_t ready;
+    };
+    static_assert(ThumbnailAtlas::ChunkSlots * sizeof(SlotRecord) <= KeyBlockBytes, "cles d'un bloc trop grandes");
+    static_assert(ChunkBytes % 65536 == 0, "blocs non alignes");
+
+    uint64_t ChunkOffset(size_t index) {
+        return HeaderBytes + (uint64_t)index * ChunkBytes;
+    }
+
+#ifdef _WIN32
+    uint64_t FileSize(void* file) {
+        LARGE_INTEGER size;
+        return GetFileSizeEx((HANDLE)file, &size) ? (uint64_t)size.QuadPart : 0;
+    }
+
+    bool Truncate(void* file, uint64_t size) {
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG)size;
+        return SetFilePointerEx((HANDLE)file, position, NULL, FILE_BEGIN) && SetEndOfFile((HANDLE)file);
+    }
+
+    // Une projection de la taille voulue agrandit le fichier ; la vue la garde ouverte
+    uint8_t* MapRegion(void* file, uint64_t offset, size_t size) {
+        uint64_t end = offset + size;
+        HANDLE mapping = CreateFileMappingW((HANDLE)file, NULL, PAGE_READWRITE, (DWORD)(end >> 32), (DWORD)end, NULL);
+        if (!mapping) return nullptr;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, size);
+        CloseHandle(mapping);
+        return (uint8_t*)view;
+    }
+
+    void UnmapRegion(uint8_t* data, size_t) {
+        UnmapViewOfFile(data);
+    }
+#else
+    uint64_t FileSize(int fd) {
+        struct stat st;
+        return fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    }
+
+    bool Truncate(int fd, uint64_t size) {
+        return ftruncate(fd, (off_t)size) == 0;
+    }
+
+    uint8_t* MapRegion(int fd, uint64_t offset, size_t size) {
+        if (FileSize(fd) < offset + size && !Truncate(fd, offset + size)) return nullptr;
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)offset);
+        return view == MAP_FAILED ? nullptr : (uint8_t*)view;
+    }
+
+    void UnmapRegion(uint8_t* data, size_t size) {
+        munmap(data, size);
+    }
+#endif
+}
+
+std::wstring ThumbnailAtlas::PathFor(const std::wstring& root) {
+    fs::path path = WideToPath(LibraryIndexPath(root));
+    path.replace_extension(".rpthumb");
+    return PathToWide(path);
+}
+
+ThumbnailAtlas::~ThumbnailAtlas() {
+    Close();
+}
+
+bool ThumbnailAtlas::Open(const std::wstring& path) {
+    Close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+#ifdef _WIN32
+    // Pas de partage en ecriture : une seconde fenetre sur le meme dossier dessine sans cache
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    m_file = file;
+    void* handle = m_file;
+#else
+    int fd = open(WideToPath(path).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return false;
+    }
+    m_fd = fd;
+    int handle = m_fd;
+#endif
+
+    uint64_t size = FileSize(handle);
+    if (size >= HeaderBytes) m_header = MapRegion(handle, 0, HeaderBytes);
+    auto* header = (AtlasHeader*)m_header;
+    if (!header || std::memcmp(header->magic, AtlasMagic, sizeof(AtlasMagic)) != 0 || header->version != AtlasVersion ||
+        header->thumbnailSize != (uint32_t)ThumbnailSize || header->chunkSlots != (uint32_t)ChunkSlots) {
+        // Fichier absent, d'une autre version ou abime : on repart d'un atlas vide
+        if (m_header) UnmapRegion(m_header, HeaderBytes);
+        m_header = nullptr;
+        if (!Truncate(handle, 0) || !(m_header = MapRegion(handle, 0, HeaderBytes))) {
+            Release();
+            return false;
+        }
+        header = (AtlasHeader*)m_header;
+        std::memset(header, 0, sizeof(AtlasHeader));
+        std::memcpy(header->magic, AtlasMagic, sizeof(AtlasMagic));
+        header->version = AtlasVersion;
+        header->thumbnailSize = ThumbnailSize;
+        header->chunkSlots = ChunkSlots;
+        size = HeaderBytes;
+    }
+
+    // Un bloc tronque (arret pendant l'agrandissement) est abandonne avec ceux qui le suivent
+    size_t chunks = (size_t)std::min<uint64_t>(header->chunkCount, (size - HeaderBytes) / ChunkBytes);
+    header->chunkCount = chunks;
+    header->slotCount = std::min<uint64_t>(header->slotCount, (uint64_t)chunks * ChunkSlots);
+    // Sans assez d'espace d'adressage (processus 32 bits), les derniers blocs restent dans le
+    // fichier mais ne sont pas lus, et l'atlas ne grandit plus
+    for (size_t chunk = 0; chunk < chunks && MapChunk(chunk); ++chunk) {}
+    uint64_t mapped = std::min<uint64_t>(header->slotCount, (uint64_t)m_chunks.size() * ChunkSlots);
+    m_slots.reserve((size_t)mapped);
+    for (uint64_t slot = 0; slot < mapped; ++slot) {
+        auto* records = (SlotRecord*)m_chunks[slot / ChunkSlots];
+        SlotRecord& record = records[slot % ChunkSlots];
+        // Reservation abandonnee (arret pendant l'ecriture) ou cle en double : case libre
+        if (record.ready == 1 && m_slots.emplace(record.key, (uint32_t)slot | ReadyBit).second) {
+            ++m_ready;
+            continue;
+        }
+        record.ready = 0;
+        m_free.push_back((uint32_t)slot);
+    }
+    // Les plus basses d'abord
+    std::reverse(m_free.begin(), m_free.end());
+    return true;
+}
+
+void ThumbnailAtlas::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Release();
+}
+
+void ThumbnailAtlas::Release() {
+    for (uint8_t* chunk : m_chunks) UnmapRegion(chunk, ChunkBytes);
+    m_chunks.clear();
+    if (m_header) UnmapRegion(m_header, HeaderBytes);
+    m_header = nullptr;
+#ifdef _WIN32
+    if (m_file) CloseHandle((HANDLE)m_file);
+    m_file = nullptr;
+#else
+    if (m_fd >= 0) close(m_fd);
+    m_fd = -1;
+#endif
+    m_slots.clear();
+    m_free.clear();
+    m_ready = 0;
+}
+
+bool ThumbnailAtlas::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_header != nullptr;
+}
+
+bool ThumbnailAtlas::MapChunk(size_t index) {
+    // Les blocs sont projetes dans l'ordre : `index` est au plus le suivant
+    if (index < m_chunks.size()) return true;
+#ifdef _WIN32
+    uint8_t* data = MapRegion(m_file, ChunkOffset(index), ChunkBytes);
+#else
+    uint8_t* data = MapRegion(m_fd, ChunkOffset(index), ChunkBytes);
+#endif
+    if (!data) return false;
+    m_chunks.push_back(data);
+    auto* header = (AtlasHeader*)m_header;
+    header->chunkCount = std::max<uint64_t>(header->chunkCount, m_chunks.size());
+    return true;
+}
+
+bool ThumbnailAtlas::Find(uint64_t key, Thumbnail& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_slots.find(key);
+    if (it == m_slots.end() || !(it->second & ReadyBit)) return false;
+    uint32_t slot = it->second & ~ReadyBit;
+    const uint8_t* chunk = m_chunks[slot / ChunkSlots];
+    const SlotRecord& record = ((const SlotRecord*)chunk)[slot % ChunkSlots];
+    out.pixels = chunk + KeyBlockBytes + (slot % ChunkSlots) * SlotBytes;
+    out.width = record.width;
+    out.height = record.height;
+    return true;
+}
+
+bool ThumbnailAtlas::Contains(uint64_t key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_slots.find(key);
+    return it != m_slots.end() && (it->second & ReadyBit);
+}
+
+bool ThumbnailAtlas::Store(uint64_t key, const DecodedImage& image) {
+    if (image.width <= 0 || image.height <= 0) return false;
+
+    // Reservation de la case ; les pixels sont ecrits sans verrou
+    uint32_t slot;
+    uint8_t* pixels;
+    SlotRecord* record;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_header) return false;
+        if (m_slots.count(key)) return true;
+        auto* header = (AtlasHeader*)m_header;
+        if (!m_free.empty()) {
+            slot = m_free.back();
+            m_free.pop_back();
+        }
+        else {
+            if (header->slotCount >= ReadyBit) return false;
+            slot = (uint32_t)header->slotCount;
+            if (slot / ChunkSlots > m_chunks.size() || !MapChunk(slot / ChunkSlots)) return false;
+            header->slotCount = slot + 1;
+        }
+        m_slots[key] = slot;
+        uint8_t* chunk = m_chunks[slot / ChunkSlots];
+        record = (SlotRecord*)chunk + slot % ChunkSlots;
+        pixels = chunk + KeyBlockBytes + (slot % ChunkSlots) * SlotBytes;
+    }
+
+    // Ajustee a la case, jamais agrandie
+    double scale = std::min({ 1.0, (double)ThumbnailSize / image.width, (double)ThumbnailSize / image.height });
+    int width = std::clamp((int)std::lround(image.width * scale), 1, ThumbnailSize);
+    int height = std::clamp((int)std::lround(image.height * scale), 1, ThumbnailSize);
+    DecodedImage reduced;
+    const DecodedImage* source = &image;
+    if (width != image.width || height != image.height) {
+        reduced.Allocate(width, height);
+        ResampleOptions options;
+        options.filter = ResampleFilter::Bilinear;
+        if (!ResampleImage(ConstImageView(image.pixels.data(), image.width, image.height, image.stride), reduced.View(),
+                options)) {
+            // Case rendue (jamais prete) ; la cle peut etre reessayee
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_slots.erase(key);
+            m_free.push_back(slot);
+            return false;
+        }
+        source = &reduced;
+    }
+
+    // BGRA premultiplie compose sur le fond, en BGR
+    std::memset(pixels, Background, SlotBytes);
+    int left = (ThumbnailSize - width) / 2;
+    int top = (ThumbnailSize - height) / 2;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* in = source->pixels.data() + (ptrdiff_t)y * source->stride;
+        uint8_t* out = pixels + (ptrdiff_t)(top + y) * ThumbnailStride + left * 3;
+        for (int x = 0; x < width; ++x, in += 4, out += 3) {
+            uint32_t under = (255u - in[3]) * Background / 255u;
+            out[0] = (uint8_t)std::min(255u, in[0] + under);
+            out[1] = (uint8_t)std::min(255u, in[1] + under);
+            out[2] = (uint8_t)std::min(255u, in[2] + under);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    record->key = key;
+    record->width = (uint16_t)width;
+    record->height = (uint16_t)height;
+    record->ready = 1;
+    m_slots[key] = slot | ReadyBit;
+    ++m_ready;
+    return true;
+}
+
+size_t ThumbnailAtlas::ReleaseUnused(const std::unordered_set<uint64_t>& live) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t released = 0;
+    for (auto it = m_slots.begin(); it != m_slots.end();) {
+        if (!(it->second & ReadyBit) || live.count(it->first)) {
+            ++it;
+            continue;
+        }
+        uint32_t slot = it->second & ~ReadyBit;
+        ((SlotRecord*)m_chunks[slot / ChunkSlots])[slot % ChunkSlots].ready = 0;
+        m_free.push_back(slot);
+        it = m_slots.erase(it);
+        --m_ready;
+        ++released;
+    }
+    return released;
+}
+
+size_t ThumbnailAtlas::Count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ready;
+}
+
+uint64_t ThumbnailAtlas::FileBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_header ? ChunkOffset(m_chunks.size()) : 0;
+}
+
+ThumbnailGridLayout LayoutThumbnailGrid(int width, int height, size_t count, int64_t scroll) {
+    ThumbnailGridLayout layout;
+    layout.cell = ThumbnailAtlas::ThumbnailSize + GridSpacing;
+    layout.left = GridSpacing;
+    layout.columns = std::max(1, (width - GridSpacing) / layout.cell);
+    int64_t rows = (int64_t)((count + layout.columns - 1) / layout.columns);
+    layout.maxScroll = std::max<int64_t>(0, rows * layout.cell + GridSpacing - std::max(0, height));
+    scroll = std::clamp<int64_t>(scroll, 0, layout.maxScroll);
+
+    // Lignes coupees en haut et en bas comprises
+    int64_t firstRow = scroll / layout.cell;
+    int64_t lastRow = (scroll + std::max(0, height)) / layout.cell + 1;
+    layout.first = std::min(count, (size_t)firstRow * layout.columns);
+    layout.last = std::min(count, (size_t)lastRow * layout.columns);
+    layout.top = (int)(GridSpacing + firstRow * layout.cell - scroll);
+    return layout;
+}
+
+ThumbnailGenerator::~ThumbnailGenerator() {
+    Cancel();
+    m_pool.reset();
+}
+
+void ThumbnailGenerator::Start(ThumbnailAtlas& atlas, NotifyFn notify) {
+    Cancel();
+    m_atlas = &atlas;
+    m_notify = std::move(notify);
+    if (!m_pool) {
+        size_t threads = threadCount ? threadCount : std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+        m_pool = std::make_unique<ThreadPool>(threads);
+    }
+}
+
+void ThumbnailGenerator::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.clear();
+        m_unreadable.clear();
+    }
+    if (m_pool) {
+        m_cancel = true;
+        m_pool->WaitIdle();
+        m_cancel = false;
+    }
+    m_ready = false;
+    m_notifyPending = false;
+}
+
+void ThumbnailGenerator::Request(std::vector<ThumbnailJob> jobs) {
+    if (!m_pool || !m_atlas) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    for (auto it = jobs.rbegin(); it != jobs.rend(); ++it) {
+        if (m_unreadable.count(it->key) || m_atlas->Contains(it->key)) continue;
+        m_queue.push_back(std::move(*it));
+    }
+    // Un decodage a la fois par thread du pool
+    size_t wanted = std::min(m_pool->ThreadCount(), m_queue.size());
+    for (; m_workers < wanted; ++m_workers) m_pool->Submit([this]() { Work(); });
+}
+
+bool ThumbnailGenerator::TakeReady() {
+    m_notifyPending = false;
+    return m_ready.exchange(false);
+}
+
+ThumbnailGenerator::Stats ThumbnailGenerator::GetStats() const {
+    Stats stats;
+    stats.generated = m_generated.load();
+    stats.failed = m_failed.load();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.queued = m_queue.size();
+    return stats;
+}
+
+void ThumbnailGenerator::WaitIdle() {
+    if (m_pool) m_pool->WaitIdle();
+}
+
+void ThumbnailGenerator::Work() {
+    for (;;) {
+        ThumbnailJob job;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_cancel || m_queue.empty()) {
+                --m_workers;
+                return;
+            }
+            job = std::move(m_queue.back());
+            m_queue.pop_back();
+        }
+        if (m_atlas->Contains(job.key)) continue;
+
+        if (!Generate(job)) {
+            ++m_failed;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_unreadable.insert(job.key);
+            continue;
+        }
+        ++m_generated;
+        m_ready = true;
+        if (!m_notifyPending.exchange(true) && m_notify) m_notify();
+    }
+}
+
+bool ThumbnailGenerator::Generate(const ThumbnailJob& job) {
+    // La miniature EXIF des photos suffit si elle couvre la case ; sinon decodage reduit
+    DecodedImage image;
+    bool decoded = DecodeExifThumbnail(job.path, image) &&
+        std::max(image.width, image.height) >= ThumbnailAtlas::ThumbnailSize;
+    if (!decoded) decoded = DecodeImageFile(job.path, ThumbnailAtlas::ThumbnailSize, ThumbnailAtlas::ThumbnailSize, image);
+    return decoded && m_atlas->Store(job.key, image);
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ImageDecoder.h"
+#include "ThreadPool.h"
+
+// Miniature prete a dessiner, directement dans la projection du fichier : BGR 24 bits,
+// ThumbnailSize x ThumbnailSize, lignes de haut en bas. L'image est centree dans la case,
+// le reste est rempli avec la couleur de fond.
+struct Thumbnail {
+    const uint8_t* pixels = nullptr;
+    // Taille de l'image dans la case
+    int width = 0;
+    int height = 0;
+};
+
+// Miniatures d'un dossier racine, enregistrees dans le dossier de cache a cote de l'index
+// (.rpthumb) et projetees en memoire en lecture-ecriture : une miniature deja calculee se
+// dessine sans lecture ni conversion. Le fichier est fait de blocs de ChunkSlots cases de
+// taille fixe, precedes de leurs cles (FileKey : chemin et date). Les cases libres (reservees
+// puis abandonnees, ou rendues par ReleaseUnused) sont reprises par Store avant d'agrandir
+// le fichier ; il ne retrecit pas.
+//
+// Les pointeurs de Find restent valides jusqu'a Close ; apres ReleaseUnused, ceux des cles
+// rendues peuvent montrer une autre miniature. Find et Store peuvent etre appeles depuis
+// plusieurs threads.
+class ThumbnailAtlas {
+public:
+    static constexpr int ThumbnailSize = 96;
+    static constexpr ptrdiff_t ThumbnailStride = ThumbnailSize * 3;
+    static constexpr size_t ChunkSlots = 1024;
+    // Fond des cases et des pixels transparents, aussi celui de la grille (gris clair)
+    static constexpr uint8_t Background = 0xF0;
+
+    static std::wstring PathFor(const std::wstring& root);
+
+    ThumbnailAtlas() = default;
+    ~ThumbnailAtlas();
+
+    ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+    ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+    // Cree le fichier s'il n'existe pas ou s'il n'est pas reconnu
+    bool Open(const std::wstring& path);
+    void Close();
+    bool IsOpen() const;
+
+    bool Find(uint64_t key, Thumbnail& out) const;
+    bool Contains(uint64_t key) const;
+    // Reduit `image` a la taille d'une case et l'enregistre. true aussi si la cle est deja
+    // enregistree ou en cours d'enregistrement ; false si l'atlas est ferme ou si le
+    // fichier ne peut pas grandir.
+    bool Store(uint64_t key, const DecodedImage& image);
+    // Rend les cases des miniatures dont la cle n'est pas dans `live` (fichiers supprimes ou
+    // modifies depuis) ; les enregistrements en cours ne sont pas touches. Retourne le
+    // nombre de cases rendues.
+    size_t ReleaseUnused(const std::unordered_set<uint64_t>& live);
+
+    // Miniatures pretes
+    size_t Count() const;
+    uint64_t FileBytes() const;
+
+private:
+    // Appeles avec m_mutex pris
+    bool MapChunk(size_t index);
+    void Release();
+
+    mutable std::mutex m_mutex;
+    // Case de chaque cle ; ReadyBit une fois les pixels ecrits
+    std::unordered_map<uint64_t, uint32_t> m_slots;
+    // Cases sans miniature en deca de slotCount, reprises par Store
+    std::vector<uint32_t> m_free;
+    size_t m_ready = 0;
+    uint8_t* m_header = nullptr;
+    std::vector<uint8_t*> m_chunks;
+#ifdef _WIN32
+    void* m_file = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+// Disposition de la grille de miniatures, commune a la fenetre et au benchmark. Seules les
+// cases de [first, last) sont visibles ; `top` est l'ordonnee de la ligne de `first`.
+struct ThumbnailGridLayout {
+    // Pas entre deux cases et abscisse de la premiere colonne
+    int cell = 0;
+    int left = 0;
+    int columns = 1;
+    size_t first = 0;
+    size_t last = 0;
+    int top = 0;
+    // Defilement maximal, en pixels
+    int64_t maxScroll = 0;
+};
+
+ThumbnailGridLayout LayoutThumbnailGrid(int width, int height, size_t count, int64_t scroll);
+
+// Miniature a calculer : cle dans l'atlas et fichier a decoder
+struct ThumbnailJob {
+    uint64_t key;
+    std::wstring path;
+};
+
+// Calcul des miniatures manquantes sur un pool de threads, en arriere-plan. Le thread UI
+// donne a chaque dessin les cases visibles qui manquent (Request remplace les demandes
+// precedentes, les premieres sont traitees d'abord) ; les threads appellent `notify` et le
+// thread UI redessine apres TakeReady.
+class ThumbnailGenerator {
+public:
+    using NotifyFn = std::function<void()>;
+
+    struct Stats {
+        size_t generated = 0;
+        size_t failed = 0;
+        size_t queued = 0;
+    };
+
+    ThumbnailGenerator() = default;
+    ~ThumbnailGenerator();
+
+    ThumbnailGenerator(const ThumbnailGenerator&) = delete;
+    ThumbnailGenerator& operator=(const ThumbnailGenerator&) = delete;
+
+    // L'atlas doit rester ouvert, ou etre rouvert apres Cancel
+    void Start(ThumbnailAtlas& atlas, NotifyFn notify);
+    // Vide la file et attend les decodages en cours
+    void Cancel();
+
+    void Request(std::vector<ThumbnailJob> jobs);
+    // true si des miniatures ont ete enregistrees depuis le dernier appel
+    bool TakeReady();
+    Stats GetStats() const;
+    // Attend que la file soit vide (benchmark)
+    void WaitIdle();
+
+    // 0 : la moitie des coeurs, comme HashIndexer
+    size_t threadCount = 0;
+
+private:
+    void Work();
+    bool Generate(const ThumbnailJob& job);
+
+    ThumbnailAtlas* m_atlas = nullptr;
+    std::unique_ptr<ThreadPool> m_pool;
+    NotifyFn m_notify;
+    std::atomic<bool> m_cancel{ false };
+    std::atomic<bool> m_notifyPending{ false };
+    std::atomic<bool> m_ready{ false };
+    std::atomic<size_t> m_generated{ 0 };
+    std::atomic<size_t> m_failed{ 0 };
+
+    mutable std::mutex m_mutex;
+    // Prochaine miniature a la fin
+    std::vector<ThumbnailJob> m_queue;
+    size_t m_workers = 0;
+    // Fichiers qui ne se decodent pas : pas retentes a chaque dessin
+    std::unordered_set<uint64_t> m_unreadable;
+};
@@ -0,0 +1,173 @@
+#include "Trace.h"
+
+#include "PathString.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace {
+    // Evenements gardes par thread : environ 100 Ko, quelques minutes d'utilisation normale
+    constexpr uint64_t RingCapacity = 4096;
+
+    // Anneau d'un thread : un seul ecrivain, des lecteurs a tout moment. Les champs sont
+    // atomiques pour qu'une lecture concurrente ne soit pas une course de donnees ; une
+    // case ecrasee pendant la lecture est ecartee grace a `head` (la case d'index `head`
+    // est celle en cours d'ecriture), comme un verrou de sequence.
+    struct TraceRing {
+        struct Slot {
+            std::atomic<uint8_t> stage{ 0 };
+            std::atomic<uint32_t> thread{ 0 };
+            std::atomic<int64_t> start{ 0 };
+            std::atomic<int64_t> duration{ 0 };
+        };
+
+        Slot slots[RingCapacity];
+        std::atomic<uint64_t> head{ 0 };
+        // Thread termine : l'anneau sera repris par le prochain nouveau thread
+        bool retired = false;
+    };
+
+    struct TraceRegistry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TraceRing>> rings;
+        uint32_t nextThread = 1;
+    };
+
+    TraceRegistry& Registry() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    // Derniere duree de chaque etape, pour l'affichage des temps
+    std::atomic<int64_t>* LastDurations() {
+        static std::atomic<int64_t> durations[(size_t)TraceStage::Count];
+        return durations;
+    }
+
+    // Anneau du thread courant, attribue a sa premiere trace et rendu a sa fin
+    struct ThreadTrace {
+        TraceRing* ring = nullptr;
+        uint32_t thread = 0;
+
+        ThreadTrace() {
+            TraceRegistry& registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            thread = registry.nextThread++;
+            for (auto& candidate : registry.rings) {
+                if (candidate->retired) {
+                    candidate->retired = false;
+                    ring = candidate.get();
+                    return;
+                }
+            }
+            registry.rings.push_back(std::make_unique<TraceRing>());
+            ring = registry.rings.back().get();
+        }
+
+        ~ThreadTrace() {
+            std::lock_guard<std::mutex> lock(Registry().mutex);
+            ring->retired = true;
+        }
+    };
+
+    // Origine des dates : premier appel, au plus tard la premiere trace
+    std::chrono::steady_clock::time_point TraceEpoch() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return epoch;
+    }
+}
+
+const char* TraceStageName(TraceStage stage) {
+    switch (stage) {
+    case TraceStage::Scan: return "scan";
+    case TraceStage::Probe: return "probe";
+    case TraceStage::Hash: return "hash";
+    case TraceStage::Decode: return "decode";
+    case TraceStage::Scale: return "scale";
+    case TraceStage::Paint: return "paint";
+    case TraceStage::Blit: return "blit";
+    case TraceStage::Text: return "text";
+    case TraceStage::Count: break;
+    }
+    return "?";
+}
+
+void SetTraceEnabled(bool enabled) {
+    TraceEnabledFlag().store(enabled, std::memory_order_relaxed);
+}
+
+int64_t TraceNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - TraceEpoch()).count();
+}
+
+void RecordTrace(TraceStage stage, int64_t start, int64_t duration) {
+    thread_local ThreadTrace current;
+    TraceRing& ring = *current.ring;
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    TraceRing::Slot& slot = ring.slots[head % RingCapacity];
+    // Un lecteur qui voit une partie de cette ecriture voit aussi `head` a jour
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.stage.store((uint8_t)stage, std::memory_order_relaxed);
+    slot.thread.store(current.thread, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(duration, std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+
+    LastDurations()[(size_t)stage].store(duration, std::memory_order_relaxed);
+}
+
+int64_t LastTraceDuration(TraceStage stage) {
+    if (stage >= TraceStage::Count) return 0;
+    return LastDurations()[(size_t)stage].load(std::memory_order_relaxed);
+}
+
+std::vector<TraceEvent> CollectTraceEvents() {
+    std::vector<TraceEvent> events;
+    TraceRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& ring : registry.rings) {
+        uint64_t end = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = end > RingCapacity ? end - RingCapacity : 0;
+        size_t first = events.size();
+        for (uint64_t i = begin; i < end; ++i) {
+            const TraceRing::Slot& slot = ring->slots[i % RingCapacity];
+            events.push_back(TraceEvent{ (TraceStage)slot.stage.load(std::memory_order_relaxed),
+                slot.thread.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                slot.duration.load(std::memory_order_relaxed) });
+        }
+        // Cases reecrites par le thread pendant la copie, y compris celle en cours
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = ring->head.load(std::memory_order_relaxed) + 1;
+        uint64_t overwritten = after > RingCapacity ? std::min(end, after - RingCapacity) : 0;
+        if (overwritten > begin) {
+            events.erase(events.begin() + first, events.begin() + first + (size_t)(overwritten - begin));
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.start < b.start;
+    });
+    return events;
+}
+
+int64_t WriteChromeTrace(const std::wstring& path) {
+    std::vector<TraceEvent> events = CollectTraceEvents();
+    std::ofstream out(WideToPath(path), std::ios::binary | std::ios::trunc);
+    if (!out) return -1;
+
+    // Evenements complets ("X"), dates et durees en microsecondes
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char line[160];
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        std::snprintf(line, sizeof(line),
+            "%s\n{\"name\":\"%s\",\"cat\":\"RandomPicture\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            i ? "," : "", TraceStageName(event.stage), event.thread, event.start / 1000.0, event.duration / 1000.0);
+        out << line;
+    }
+    out << "\n]}\n";
+    return out ? (int64_t)events.size() : -1;
+}
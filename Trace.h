@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Traces des etapes couteuses (parcours, decodage, mise a l'echelle, dessin) pour savoir
+// ou passe le temps quand la visionneuse semble lente. Chaque thread ecrit ses evenements
+// dans son propre anneau, sans verrou ; les plus anciens sont ecrases. Desactivee, une
+// TraceSpan ne coute qu'une lecture atomique.
+enum class TraceStage : uint8_t {
+    Scan,
+    Probe,
+    Hash,
+    Decode,
+    Scale,
+    Paint,
+    Blit,
+    Text,
+    Count,
+};
+
+const char* TraceStageName(TraceStage stage);
+
+void SetTraceEnabled(bool enabled);
+inline std::atomic<bool>& TraceEnabledFlag() {
+    static std::atomic<bool> enabled{ false };
+    return enabled;
+}
+inline bool TraceEnabled() { return TraceEnabledFlag().load(std::memory_order_relaxed); }
+
+// Nanosecondes depuis le demarrage du programme (horloge monotone)
+int64_t TraceNow();
+
+// Enregistre une etape terminee dans l'anneau du thread appelant
+void RecordTrace(TraceStage stage, int64_t start, int64_t duration);
+
+// Duree de la derniere occurrence de l'etape, tous threads confondus, en ns (0 si aucune)
+int64_t LastTraceDuration(TraceStage stage);
+
+// Mesure la duree de la portee si la trace est active a sa creation
+class TraceSpan {
+public:
+    explicit TraceSpan(TraceStage stage)
+        : m_stage(stage), m_start(TraceEnabled() ? TraceNow() : -1) {}
+    ~TraceSpan() {
+        if (m_start >= 0) RecordTrace(m_stage, m_start, TraceNow() - m_start);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    TraceStage m_stage;
+    int64_t m_start;
+};
+
+struct TraceEvent {
+    TraceStage stage;
+    // Numero du thread dans l'ordre de leur premiere trace, a partir de 1
+    uint32_t thread;
+    int64_t start;
+    int64_t duration;
+};
+
+// Copie des evenements encore presents dans les anneaux, tries par date de debut.
+// Appelable pendant que les autres threads continuent d'ecrire.
+std::vector<TraceEvent> CollectTraceEvents();
+
+// Ecrit les evenements au format "Trace Event" de Chrome (chrome://tracing, Perfetto).
+// Retourne le nombre d'evenements ecrits, ou -1 si le fichier n'a pas pu etre ecrit.
+int64_t WriteChromeTrace(const std::wstring& path);
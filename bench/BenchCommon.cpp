@@ -0,0 +1,139 @@
+#include "BenchCommon.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+#include <jpeglib.h>
+#endif
+#if defined(RANDOMPICTURE_HAVE_LIBPNG)
+#include <png.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::vector<uint8_t> MakeRgb(int width, int height, uint32_t seed) {
+    std::vector<uint8_t> pixels((size_t)width * height * 3);
+    uint32_t state = 987654321u + seed * 7919u;
+    double phase = seed * 0.7;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            state = state * 1664525u + 1013904223u;
+            int noise = (int)(state >> 29);
+            double wave = std::sin(x * 0.02 + phase) * std::cos(y * 0.017 - phase);
+            uint8_t* pixel = &pixels[((size_t)y * width + x) * 3];
+            pixel[0] = (uint8_t)std::clamp(x * 255 / width + noise, 0, 255);
+            pixel[1] = (uint8_t)std::clamp(y * 255 / height + noise, 0, 255);
+            pixel[2] = (uint8_t)std::clamp((int)(128 + 100 * wave) + noise, 0, 255);
+        }
+    }
+    return pixels;
+}
+
+bool WriteBmp(const fs::path& path, const std::vector<uint8_t>& rgb, int width, int height) {
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return false;
+    uint32_t rowBytes = ((uint32_t)width * 3 + 3) & ~3u;
+    uint32_t imageBytes = rowBytes * (uint32_t)height;
+    uint8_t header[54] = { 'B', 'M' };
+    auto put32 = [&header](int offset, uint32_t value) { std::memcpy(header + offset, &value, 4); };
+    put32(2, 54 + imageBytes);
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, (uint32_t)width);
+    put32(22, (uint32_t)height);
+    header[26] = 1;
+    header[28] = 24;
+    put32(34, imageBytes);
+    bool written = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    std::vector<uint8_t> row(rowBytes, 0);
+    for (int y = height - 1; y >= 0 && written; --y) {
+        const uint8_t* source = &rgb[(size_t)y * width * 3];
+        for (int x = 0; x < width; ++x) {
+            row[x * 3 + 0] = source[x * 3 + 2];
+            row[x * 3 + 1] = source[x * 3 + 1];
+            row[x * 3 + 2] = source[x * 3 + 0];
+        }
+        written = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    return std::fclose(file) == 0 && written;
+}
+
+bool WriteJpeg(const fs::path& path, const std::vector<uint8_t>& rgb, int width, int height, int quality) {
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return false;
+    jpeg_compress_struct info;
+    jpeg_error_mgr error;
+    info.err = jpeg_std_error(&error);
+    jpeg_create_compress(&info);
+    jpeg_stdio_dest(&info, file);
+    info.image_width = (JDIMENSION)width;
+    info.image_height = (JDIMENSION)height;
+    info.input_components = 3;
+    info.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&info);
+    jpeg_set_quality(&info, quality, TRUE);
+    jpeg_start_compress(&info, TRUE);
+    while (info.next_scanline < info.image_height) {
+        JSAMPROW row = (JSAMPROW)&rgb[(size_t)info.next_scanline * width * 3];
+        jpeg_write_scanlines(&info, &row, 1);
+    }
+    jpeg_finish_compress(&info);
+    jpeg_destroy_compress(&info);
+    return std::fclose(file) == 0;
+#else
+    (void)path;
+    (void)rgb;
+    (void)width;
+    (void)height;
+    (void)quality;
+    return false;
+#endif
+}
+
+bool WritePng(const fs::path& path, const std::vector<uint8_t>& rgb, int width, int height) {
+#if defined(RANDOMPICTURE_HAVE_LIBPNG)
+    FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return false;
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png_create_info_struct(png);
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        std::fclose(file);
+        return false;
+    }
+    png_init_io(png, file);
+    png_set_compression_level(png, 3);
+    png_set_IHDR(png, info, (png_uint_32)width, (png_uint_32)height, 8, PNG_COLOR_TYPE_RGB,
+        PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (int y = 0; y < height; ++y) {
+        png_write_row(png, (png_const_bytep)&rgb[(size_t)y * width * 3]);
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return std::fclose(file) == 0;
+#else
+    (void)path;
+    (void)rgb;
+    (void)width;
+    (void)height;
+    return false;
+#endif
+}
+
+WalkResult Walk(const std::wstring& root, size_t threads) {
+    WalkOptions options;
+    options.threadCount = threads;
+    options.collectDetails = true;
+    options.collectPaths = false;
+    return WalkDirectoryTreeDetailed(root, options);
+}
+
+double Milliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
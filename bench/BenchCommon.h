@@ -0,0 +1,28 @@
+#pragma once
+
+// Outils communs aux benchmarks : images synthetiques ecrites sur disque, parcours
+// detaille et chronometrage.
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "DirectoryWalker.h"
+
+// Photo synthetique differente pour chaque graine : degrades, motif a basse frequence,
+// bruit. Pixels RGB 8 bits, lignes contigues.
+std::vector<uint8_t> MakeRgb(int width, int height, uint32_t seed);
+
+// Ecriture d'une image RGB (MakeRgb) ; false si le fichier n'a pas pu etre ecrit en entier.
+// WriteJpeg et WritePng echouent toujours sans libjpeg ou libpng.
+bool WriteBmp(const std::filesystem::path& path, const std::vector<uint8_t>& rgb, int width, int height);
+bool WriteJpeg(const std::filesystem::path& path, const std::vector<uint8_t>& rgb, int width, int height,
+    int quality = 85);
+bool WritePng(const std::filesystem::path& path, const std::vector<uint8_t>& rgb, int width, int height);
+
+// Parcours detaille de `root` (collectDetails, sans liste de chemins ni sonde)
+WalkResult Walk(const std::wstring& root, size_t threads);
+
+double Milliseconds(std::chrono::steady_clock::time_point start);
@@ -0,0 +1,184 @@
+// Composition par couches de la fenetre (FrameCompositor) : une image de --view et trois
+// textes au-dessus (nom du fichier, historique, encadre des temps), comme DisplayImage.
+// Pour chaque scenario, temps par affichage et pixels recomposes quand toute la fenetre est
+// refaite a chaque WM_PAINT (ancien rendu : image puis textes) et quand seules les zones
+// des couches modifiees le sont. Verifie que les deux donnent la meme image.
+//
+//   CompositorBench [--view=WxH] [--frames=N]
+
+#include "BenchCommon.h"
+#include "FrameCompositor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    enum Layer : size_t {
+        FileNameLayer,
+        HistoryLayer,
+        TimingLayer,
+    };
+
+    struct Surface {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+
+        Surface(int width, int height) : pixels((size_t)width * height * 4), width(width), height(height) {}
+        ImageView View() { return ImageView{ pixels.data(), width, height, (ptrdiff_t)width * 4 }; }
+        ConstImageView ConstView() const { return ConstImageView(pixels.data(), width, height, (ptrdiff_t)width * 4); }
+    };
+
+    // Texte GDI simule : noir sur blanc, traits et bords antialiases variant avec `seed`
+    void RenderText(Surface& surface, uint32_t seed, bool box) {
+        uint32_t state = seed * 2654435761u + 1;
+        for (int y = 0; y < surface.height; ++y) {
+            uint8_t* row = surface.pixels.data() + (size_t)y * surface.width * 4;
+            for (int x = 0; x < surface.width; ++x) {
+                state = state * 1664525u + 1013904223u;
+                bool ink = (y % 15) > 2 && (y % 15) < 13 && (state >> 24) < 70;
+                uint8_t value = ink ? (uint8_t)((state >> 8) & 0x7F) : 255;
+                if (box && (x == 0 || y == 0 || x == surface.width - 1 || y == surface.height - 1)) value = 0;
+                row[x * 4] = row[x * 4 + 1] = row[x * 4 + 2] = value;
+                row[x * 4 + 3] = 0;
+            }
+        }
+    }
+
+    void FillImage(Surface& surface, uint32_t seed) {
+        for (size_t i = 0; i < surface.pixels.size(); i += 4) {
+            seed = seed * 1664525u + 1013904223u;
+            std::memcpy(&surface.pixels[i], &seed, 3);
+            surface.pixels[i + 3] = 255;
+        }
+    }
+
+    // Etat de la fenetre pour un affichage
+    struct Frame {
+        uint64_t image = 1;
+        uint64_t history = 1;
+        uint64_t timings = 1;
+        bool showHistory = true;
+    };
+
+    // Deux versions de chaque couche, dessinees d'avance : le cout mesure est celui de la
+    // composition, pas celui du texte GDI simule
+    struct Scene {
+        Surface base;
+        std::vector<Surface> images;
+        std::vector<Surface> fileNames;
+        std::vector<Surface> histories;
+        std::vector<Surface> timings;
+        PixelRect fileNameRect;
+        PixelRect historyRect;
+        PixelRect timingRect;
+
+        Scene(int width, int height) : base(width, height) {
+            int historyWidth = std::min(width - 20, 900), historyHeight = std::max(15, (height - 110) / 15 * 15);
+            for (uint32_t seed = 1; seed <= 2; ++seed) {
+                images.emplace_back(width, height);
+                FillImage(images.back(), seed);
+                fileNames.emplace_back(320, 16);
+                RenderText(fileNames.back(), seed, false);
+                histories.emplace_back(historyWidth, historyHeight);
+                RenderText(histories.back(), seed + 10, false);
+                timings.emplace_back(190, 93);
+                RenderText(timings.back(), seed + 20, true);
+            }
+            fileNameRect = PixelRect{ 10, 80, 330, 96 };
+            historyRect = PixelRect{ 10, 100, 10 + historyWidth, 100 + historyHeight };
+            timingRect = PixelRect{ width - 200, 10, width - 10, 103 };
+        }
+
+        // Meme sequence d'appels que DisplayImage ; les couches a refaire sont dessinees.
+        // `everything` : toutes le sont, comme l'ancien WM_PAINT
+        void Update(FrameCompositor& compositor, const Frame& frame, bool everything) {
+            if (compositor.SetBase(base.View(), frame.image) || everything) {
+                base.pixels = images[frame.image % 2].pixels;
+            }
+            if (compositor.SetOverlay(FileNameLayer, frame.image, fileNameRect) || everything) {
+                compositor.SetOverlayPixels(FileNameLayer, fileNames[frame.image % 2].ConstView(), OverlayPixels::BlackText);
+            }
+            if (!frame.showHistory) {
+                compositor.HideOverlay(HistoryLayer);
+            }
+            else if (compositor.SetOverlay(HistoryLayer, frame.history, historyRect) || everything) {
+                compositor.SetOverlayPixels(HistoryLayer, histories[frame.history % 2].ConstView(), OverlayPixels::BlackText);
+            }
+            if (compositor.SetOverlay(TimingLayer, frame.timings, timingRect) || everything) {
+                compositor.SetOverlayPixels(TimingLayer, timings[frame.timings % 2].ConstView(), OverlayPixels::Opaque);
+            }
+            if (everything) compositor.InvalidateAll();
+        }
+    };
+
+    struct Result {
+        double ms = 0;
+        double pixels = 0;
+    };
+}
+
+int main(int argc, char** argv) {
+    int width = 1920, height = 1080;
+    int frames = 200;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--view=", 0) == 0 && std::sscanf(arg.c_str() + 7, "%dx%d", &width, &height) == 2 && width >= 400 && height >= 200) {}
+        else if (arg.rfind("--frames=", 0) == 0) frames = std::max(1, std::atoi(arg.c_str() + 9));
+        else {
+            std::fprintf(stderr, "usage: CompositorBench [--view=WxH] [--frames=N]\n");
+            return 2;
+        }
+    }
+
+    struct Scenario {
+        const char* name;
+        // Change l'etat de la fenetre entre deux affichages
+        void (*next)(Frame&, int);
+    };
+    const Scenario scenarios[] = {
+        { "uncovered window (nothing changed)", [](Frame&, int) {} },
+        { "timings refreshed", [](Frame& frame, int) { ++frame.timings; } },
+        { "history cursor moved", [](Frame& frame, int) { ++frame.history; } },
+        { "history shown/hidden", [](Frame& frame, int) { frame.showHistory = !frame.showHistory; } },
+        { "new image", [](Frame& frame, int i) { ++frame.image; ++frame.history; if (i % 2) ++frame.timings; } },
+    };
+
+    int failures = 0;
+    std::printf("view %dx%d, %d frames per scenario\n", width, height, frames);
+    std::printf("%-36s %12s %12s %14s %9s\n", "scenario", "full ms", "layered ms", "layered Mpx", "speedup");
+    for (const Scenario& scenario : scenarios) {
+        Result results[2];
+        Surface targets[2] = { Surface(width, height), Surface(width, height) };
+        for (int layered = 0; layered < 2; ++layered) {
+            Scene scene(width, height);
+            FrameCompositor compositor;
+            compositor.Resize(width, height);
+            Frame frame;
+            scene.Update(compositor, frame, true);
+            compositor.Compose(targets[layered].View());
+
+            uint64_t pixels = compositor.GetStats().composedPixels;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; ++i) {
+                scenario.next(frame, i);
+                scene.Update(compositor, frame, !layered);
+                compositor.Compose(targets[layered].View());
+            }
+            results[layered].ms = Milliseconds(start) / frames;
+            results[layered].pixels = (compositor.GetStats().composedPixels - pixels) / 1e6 / frames;
+        }
+        if (targets[0].pixels != targets[1].pixels) {
+            std::printf("%s: layered frame differs from the full frame\n", scenario.name);
+            ++failures;
+        }
+        std::printf("%-36s %12.3f %12.3f %14.3f %8.1fx\n", scenario.name, results[0].ms, results[1].ms, results[1].pixels,
+            results[0].ms / std::max(results[1].ms, 1e-6));
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// Decodage pleine resolution contre decodage reduit pour l'affichage (ImageDecoder).
+// Mesure le temps et la memoire des pixels decodes, et verifie que l'image reduite
+// ressemble a l'image complete redimensionnee a la meme taille.
+//
+//   DecodeBench [--generate=MP] [--target=WxH] [--iterations=N] [--keep] [fichiers...]
+//
+// Sans fichier, des images synthetiques JPEG, PNG et BMP de MP megapixels sont ecrites
+// dans le dossier temporaire.
+
+#include "BenchCommon.h"
+#include "ImageDecoder.h"
+#include "PathString.h"
+#include "Resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Ecart moyen (0-255) entre deux images de meme taille
+    double MeanDifference(const DecodedImage& a, const DecodedImage& b) {
+        uint64_t total = 0;
+        for (int y = 0; y < a.height; ++y) {
+            const uint8_t* rowA = a.pixels.data() + (ptrdiff_t)y * a.stride;
+            const uint8_t* rowB = b.pixels.data() + (ptrdiff_t)y * b.stride;
+            for (int i = 0; i < a.width * 4; ++i) total += (uint64_t)std::abs(rowA[i] - rowB[i]);
+        }
+        return (double)total / ((double)a.width * a.height * 4);
+    }
+
+    double BestDecodeMs(const std::wstring& path, int width, int height, int iterations, DecodedImage& out) {
+        double best = 1e30;
+        for (int i = 0; i < iterations; ++i) {
+            DecodedImage image;
+            auto start = std::chrono::steady_clock::now();
+            bool decoded = DecodeImageFile(path, width, height, image);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (!decoded) return -1.0;
+            best = std::min(best, elapsed.count());
+            out = std::move(image);
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    int megapixels = 48;
+    int targetWidth = 800, targetHeight = 600;
+    int iterations = 3;
+    bool keep = false;
+    std::vector<fs::path> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--generate=", 0) == 0) megapixels = std::max(1, std::atoi(arg.c_str() + 11));
+        else if (arg.rfind("--target=", 0) == 0) std::sscanf(arg.c_str() + 9, "%dx%d", &targetWidth, &targetHeight);
+        else if (arg.rfind("--iterations=", 0) == 0) iterations = std::max(1, std::atoi(arg.c_str() + 13));
+        else if (arg == "--keep") keep = true;
+        else if (arg.rfind("--", 0) == 0) {
+            std::fprintf(stderr, "usage: DecodeBench [--generate=MP] [--target=WxH] [--iterations=N] [--keep] [files...]\n");
+            return 2;
+        }
+        else files.push_back(arg);
+    }
+
+    std::vector<fs::path> generated;
+    if (files.empty()) {
+        int height = (int)std::lround(std::sqrt(megapixels * 1e6 / (4.0 / 3.0)));
+        int width = height * 4 / 3;
+        std::printf("generating %dx%d test images...\n", width, height);
+        std::vector<uint8_t> rgb = MakeRgb(width, height, 0);
+        fs::path directory = fs::temp_directory_path();
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+        if (WriteJpeg(directory / "DecodeBench.jpg", rgb, width, height, 90)) generated.push_back(directory / "DecodeBench.jpg");
+#endif
+#if defined(RANDOMPICTURE_HAVE_LIBPNG)
+        if (WritePng(directory / "DecodeBench.png", rgb, width, height)) generated.push_back(directory / "DecodeBench.png");
+#endif
+        if (WriteBmp(directory / "DecodeBench.bmp", rgb, width, height)) generated.push_back(directory / "DecodeBench.bmp");
+        files = generated;
+    }
+
+    std::printf("target %dx%d\n", targetWidth, targetHeight);
+    std::printf("%-28s %-11s %9s %9s %9s %9s %8s %8s %6s\n",
+        "file", "source", "full ms", "full MB", "fit ms", "fit MB", "speedup", "memory", "diff");
+
+    int failures = 0;
+    for (const auto& file : files) {
+        std::wstring path = PathToWide(file);
+        DecodedImage full, reduced;
+        double fullMs = BestDecodeMs(path, 0, 0, iterations, full);
+        double reducedMs = BestDecodeMs(path, targetWidth, targetHeight, iterations, reduced);
+        if (fullMs < 0 || reducedMs < 0) {
+            std::printf("%-28s decode failed\n", file.filename().string().c_str());
+            ++failures;
+            continue;
+        }
+
+        // Reference : l'image complete reduite par le resampler a la taille du decodage reduit
+        DecodedImage reference;
+        reference.Allocate(reduced.width, reduced.height);
+        ResampleOptions options;
+        options.filter = ResampleFilter::Box;
+        ResampleImage(full.View(), reference.View(), options);
+        double difference = MeanDifference(reduced, reference);
+
+        char source[32];
+        std::snprintf(source, sizeof(source), "%dx%d", full.width, full.height);
+        double fullMb = full.pixels.size() / 1048576.0;
+        double reducedMb = reduced.pixels.size() / 1048576.0;
+        std::printf("%-28s %-11s %9.1f %9.1f %9.1f %9.1f %7.1fx %7.1fx %6.2f  (1/%d)\n",
+            file.filename().string().c_str(), source, fullMs, fullMb, reducedMs, reducedMb,
+            fullMs / reducedMs, fullMb / reducedMb, difference, reduced.reduction);
+        if (difference > 8.0) ++failures;
+    }
+
+    if (!keep) {
+        for (const auto& file : generated) {
+            std::error_code error;
+            fs::remove(file, error);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// Tirage filtre (CatalogFilter, RandomSelector) sur un catalogue synthetique : extensions,
+// dossiers par annee, dimensions, tailles et dates variees. Pour chaque filtre : temps de
+// compilation, images retenues, cout d'un tirage, compare au tirage par parcours lineaire
+// du catalogue a chaque appel. Verifie les images retenues contre un parcours lineaire, que
+// le sac filtre ne repete rien pendant un tour, que le tirage reste uniforme parmi les
+// images retenues et que l'ajout d'images ne refait pas les index.
+//
+//   FilterBench [--files=10000000] [--folder-size=1000] [--picks=N] [--seed=N]
+
+#include "BenchCommon.h"
+#include "ImageCatalog.h"
+#include "ImageFilter.h"
+#include "RandomSelector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <cwctype>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+    const wchar_t* Extensions[] = { L"jpg", L"JPG", L"jpeg", L"png", L"webp" };
+
+    int64_t NowTicks() {
+        return (int64_t)std::filesystem::file_time_type::clock::now().time_since_epoch().count();
+    }
+
+    int64_t DayTicks() {
+        return std::chrono::duration_cast<std::filesystem::file_time_type::duration>(std::chrono::hours(24)).count();
+    }
+
+    // Dossiers /photos/<annee>/<n>, dates sur les cinq dernieres annees ; quelques images sans
+    // dimensions (non sondees)
+    void AddImages(ImageCatalog& catalog, size_t files, size_t folderSize, uint32_t& state) {
+        const int64_t now = NowTicks(), day = DayTicks();
+        uint32_t directory = 0;
+        size_t remaining = 0;
+        wchar_t name[40];
+        size_t first = catalog.Size();
+        for (size_t i = 0; i < files; ++i) {
+            if (remaining == 0) {
+                state = state * 1664525u + 1013904223u;
+                remaining = 1 + (state >> 8) % (folderSize * 2);
+                unsigned year = 2019 + (state >> 4) % 6;
+                directory = catalog.AddDirectory(L"/photos/" + std::to_wstring(year) + L"/" + std::to_wstring(catalog.DirectoryCount()));
+            }
+            --remaining;
+            state = state * 1664525u + 1013904223u;
+            uint32_t random = state;
+            std::swprintf(name, 40, L"IMG_%08zu.%ls", first + i, Extensions[(random >> 4) % 5]);
+            int64_t mtime = now - (int64_t)((random >> 8) % (5 * 365)) * day;
+            uint64_t size = 20000ull << ((random >> 12) % 10);
+            bool probed = (random >> 16) % 64 != 0;
+            catalog.Add(directory, name, mtime, size, probed ? 640u << ((random >> 20) % 4) : 0,
+                probed ? 480u << ((random >> 23) % 4) : 0);
+        }
+    }
+
+    std::string DaysAgo(int days) {
+        std::time_t time = std::time(nullptr) - (std::time_t)days * 86400;
+        char text[16];
+        std::strftime(text, sizeof(text), "%Y-%m-%d", std::localtime(&time));
+        return text;
+    }
+
+    // Meme test que CatalogFilter, image par image
+    bool Matches(const ImageCatalog& catalog, ImageId id, const ImageFilter& filter) {
+        if (catalog.IsExcluded(id)) return false;
+        if (!filter.extensions.empty()) {
+            std::wstring_view name = catalog.FileName(id);
+            std::wstring extension(name.substr(name.rfind(L'.') + 1));
+            for (wchar_t& c : extension) c = (wchar_t)std::towlower(c);
+            if (std::find(filter.extensions.begin(), filter.extensions.end(), extension) == filter.extensions.end()) return false;
+        }
+        if (!filter.folder.empty()) {
+            std::wstring directory = catalog.DirectoryPath(catalog.DirectoryOf(id)) + L"/";
+            if (directory.find(L"/" + filter.folder + L"/") == std::wstring::npos) return false;
+        }
+        if (filter.HasDimensions()) {
+            uint32_t width = catalog.Width(id), height = catalog.Height(id);
+            if (width == 0 || width < filter.minWidth || width > filter.maxWidth ||
+                height < filter.minHeight || height > filter.maxHeight) {
+                return false;
+            }
+        }
+        if (filter.HasSize()) {
+            uint64_t size = catalog.FileSize(id);
+            if (size == 0 || size < filter.minSize || size > filter.maxSize) return false;
+        }
+        if (filter.HasTime()) {
+            int64_t mtime = catalog.ModifiedTime(id);
+            if (mtime == 0 || mtime < filter.minTime || mtime > filter.maxTime) return false;
+        }
+        return true;
+    }
+
+    // Ancien tirage : parcours de tout le catalogue a chaque appel
+    ImageId LinearPick(const ImageCatalog& catalog, const ImageFilter& filter, Xoshiro256& random) {
+        std::vector<ImageId> matches;
+        for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) {
+            if (Matches(catalog, id, filter)) matches.push_back(id);
+        }
+        return matches.empty() ? InvalidImageId : matches[random.Below((uint32_t)matches.size())];
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t files = 10000000;
+    size_t folderSize = 1000;
+    size_t picks = 1000000;
+    uint64_t seed = 42;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--files=", 0) == 0) files = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--folder-size=", 0) == 0) folderSize = std::max<size_t>(1, std::strtoull(arg.c_str() + 14, nullptr, 10));
+        else if (arg.rfind("--picks=", 0) == 0) picks = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else {
+            std::fprintf(stderr, "usage: FilterBench [--files=N] [--folder-size=N] [--picks=N] [--seed=N]\n");
+            return 2;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ImageCatalog catalog;
+    catalog.Reserve(files, files * 16);
+    uint32_t state = 24681357;
+    AddImages(catalog, files, folderSize, state);
+    // Quelques images supprimees depuis le scan
+    for (ImageId id = 7; id < (ImageId)catalog.Size(); id += 997) catalog.Exclude(id);
+    std::printf("catalog: %zu files in %zu folders (%.0f ms)\n", catalog.Size(), catalog.DirectoryCount(), Milliseconds(start));
+
+    std::string lastYear = DaysAgo(365), lastMonth = DaysAgo(30);
+    // Un dossier de 2022 pour les petits ensembles
+    std::string smallFolder = "2022";
+    for (uint32_t directory = 0; directory < (uint32_t)catalog.DirectoryCount(); ++directory) {
+        const std::wstring& path = catalog.DirectoryPath(directory);
+        if (path.find(L"/2022/") != std::wstring::npos) {
+            smallFolder = std::string(path.begin() + 8, path.end());
+            break;
+        }
+    }
+    std::vector<std::string> filters = {
+        "ext=png",
+        "folder=2021",
+        "min=1920x1080 size>=1M",
+        "ext=jpg,jpeg folder=2023 width>=2560 date>=" + lastYear,
+        "folder=" + smallFolder + " date>=" + lastMonth,
+        "ext=gif",
+    };
+
+    int failures = 0;
+    uint64_t checksum = 0;
+    CatalogFilter filter;
+    RandomSelector selector(seed);
+    selector.SetFilter(&filter);
+
+    std::printf("%-60s %9s %10s %10s %12s\n", "filter", "matches", "compile ms", "ns/pick", "linear ms");
+    for (const std::string& text : filters) {
+        ImageFilter parsed;
+        std::wstring error;
+        if (!ParseImageFilter(std::wstring(text.begin(), text.end()), parsed, &error)) {
+            std::printf("cannot parse %s\n", text.c_str());
+            ++failures;
+            continue;
+        }
+        filter.SetFilter(parsed);
+        selector.SetMode(SelectionMode::Uniform);
+
+        auto compileStart = std::chrono::steady_clock::now();
+        filter.Update(catalog);
+        double compileMs = Milliseconds(compileStart);
+
+        size_t expected = 0;
+        bool wrong = false;
+        for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) {
+            bool match = Matches(catalog, id, parsed);
+            expected += match;
+            wrong |= match != filter.Contains(id);
+        }
+        if (wrong || expected != filter.Count()) {
+            std::printf("%s: %zu matches, %zu expected\n", text.c_str(), filter.Count(), expected);
+            ++failures;
+        }
+
+        double nsPerPick = 0, linearMs = 0;
+        if (filter.Count() > 0) {
+            auto pickStart = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < picks; ++i) checksum += selector.Pick(catalog);
+            nsPerPick = Milliseconds(pickStart) * 1e6 / picks;
+
+            Xoshiro256 random(seed);
+            auto linearStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < 3; ++i) checksum += LinearPick(catalog, parsed, random);
+            linearMs = Milliseconds(linearStart) / 3;
+        }
+        else if (selector.Pick(catalog) != InvalidImageId) {
+            std::printf("%s: picked an image without matches\n", text.c_str());
+            ++failures;
+        }
+        std::printf("%-60s %9zu %10.1f %10.1f %12.1f\n", text.c_str(), filter.Count(), compileMs, nsPerPick, linearMs);
+    }
+
+    // Petit ensemble : uniformite (khi-deux) et sac sans repetition
+    {
+        std::string text = "folder=" + smallFolder + " ext=jpg";
+        ImageFilter parsed;
+        ParseImageFilter(std::wstring(text.begin(), text.end()), parsed);
+        filter.SetFilter(parsed);
+        selector.SetMode(SelectionMode::Uniform);
+        filter.Update(catalog);
+        size_t count = filter.Count();
+        if (count > 1) {
+            std::vector<size_t> hits(catalog.Size(), 0);
+            size_t samples = count * 200;
+            for (size_t i = 0; i < samples; ++i) ++hits[selector.Pick(catalog)];
+            double chi = 0, expected = (double)samples / count;
+            for (ImageId id : filter.Matches()) chi += (hits[id] - expected) * (hits[id] - expected) / expected;
+            double z = (chi - (count - 1)) / std::sqrt(2.0 * (count - 1));
+            std::printf("uniformity over %zu matches: chi2 %.0f (z %.2f)\n", count, chi, z);
+            if (std::fabs(z) > 5) ++failures;
+
+            selector.SetMode(SelectionMode::ShuffleBag);
+            std::vector<bool> seen(catalog.Size(), false);
+            bool repeated = false, outside = false;
+            for (size_t i = 0; i < count; ++i) {
+                ImageId id = selector.Pick(catalog);
+                outside |= !filter.Contains(id);
+                repeated |= seen[id];
+                seen[id] = true;
+            }
+            if (repeated || outside) {
+                std::printf("filtered bag %s\n", repeated ? "repeated an image" : "left the filter");
+                ++failures;
+            }
+        }
+    }
+
+    // Images ajoutees apres la compilation, par lots comme pendant un scan : seules les
+    // nouvelles sont indexees et compilees, a la suite des images deja retenues
+    {
+        ImageFilter parsed;
+        ParseImageFilter(L"ext=png folder=2021 min=1280x960", parsed);
+        filter.SetFilter(parsed);
+        filter.Update(catalog);
+        size_t before = filter.Count();
+        uint64_t generation = filter.Generation();
+        double updateMs = 0;
+        for (int batch = 0; batch < 10; ++batch) {
+            AddImages(catalog, 1000, folderSize, state);
+            auto updateStart = std::chrono::steady_clock::now();
+            filter.Update(catalog);
+            updateMs += Milliseconds(updateStart);
+        }
+        std::vector<ImageId> appended = filter.Matches();
+        if (filter.Generation() != generation) {
+            std::printf("generation changed while only appending images\n");
+            ++failures;
+        }
+
+        // Compilation complete du meme catalogue, pour comparaison
+        filter.SetFilter(parsed);
+        auto compileStart = std::chrono::steady_clock::now();
+        filter.Update(catalog);
+        double compileMs = Milliseconds(compileStart);
+        std::printf("10 x 1000 new images: update %.2f ms per batch (full compile %.1f ms), %zu -> %zu matches\n",
+            updateMs / 10, compileMs, before, filter.Count());
+        if (appended != filter.Matches()) {
+            std::printf("appended matches differ from a full compile\n");
+            ++failures;
+        }
+        size_t expected = 0;
+        for (ImageId id = 0; id < (ImageId)catalog.Size(); ++id) expected += Matches(catalog, id, parsed);
+        if (expected != filter.Count()) ++failures;
+    }
+
+    CatalogFilter::Stats stats = filter.GetStats();
+    std::printf("filter index %.1f MB, catalog %.1f MB\n", stats.indexBytes / 1048576.0, catalog.MemoryUsage() / 1048576.0);
+    std::printf("checksum %llu\n", (unsigned long long)checksum);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,263 @@
+// Empreintes perceptuelles (PerceptualHash) : debit du calcul par jeu d'instructions,
+// debit du decodage reduit + empreinte en images/s par coeur, ecart entre les copies d'une
+// meme photo et entre photos differentes, et temps de regroupement des doublons.
+//
+//   HashBench [--photos=24] [--size=WxH] [--threads=N] [--catalog=1000000] [--keep]
+//
+// Les photos synthetiques et leurs copies (reencodage, demi-taille, autre format) sont
+// ecrites dans le dossier temporaire.
+
+#include "BenchCommon.h"
+#include "ImageCatalog.h"
+#include "ImageDecoder.h"
+#include "PathString.h"
+#include "PerceptualHash.h"
+#include "RandomSelector.h"
+#include "Resampler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Photo synthetique propre a `seed` : quelques taches de couleur sur un degrade
+    std::vector<uint8_t> MakePhoto(int width, int height, uint32_t seed) {
+        uint32_t state = seed * 2654435761u + 12345;
+        auto next = [&state]() {
+            state = state * 1664525u + 1013904223u;
+            return (double)(state >> 8) / 16777216.0;
+        };
+        struct Blob {
+            double x, y, radius, r, g, b;
+        };
+        std::vector<Blob> blobs(6);
+        for (auto& blob : blobs) blob = Blob{ next(), next(), 0.1 + next() * 0.3, next() * 255, next() * 255, next() * 255 };
+        double angle = next() * 6.283;
+
+        std::vector<uint8_t> rgb((size_t)width * height * 3);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                double u = (double)x / width, v = (double)y / height;
+                double base = 128 + 100 * ((u - 0.5) * std::cos(angle) + (v - 0.5) * std::sin(angle));
+                double r = base, g = base, b = base;
+                for (const auto& blob : blobs) {
+                    double dx = u - blob.x, dy = v - blob.y;
+                    double weight = std::exp(-(dx * dx + dy * dy) / (blob.radius * blob.radius));
+                    r += (blob.r - r) * weight;
+                    g += (blob.g - g) * weight;
+                    b += (blob.b - b) * weight;
+                }
+                uint8_t* pixel = &rgb[((size_t)y * width + x) * 3];
+                pixel[0] = (uint8_t)std::clamp((int)r, 0, 255);
+                pixel[1] = (uint8_t)std::clamp((int)g, 0, 255);
+                pixel[2] = (uint8_t)std::clamp((int)b, 0, 255);
+            }
+        }
+        return rgb;
+    }
+
+    std::vector<uint8_t> HalfSize(const std::vector<uint8_t>& rgb, int width, int height) {
+        std::vector<uint8_t> half((size_t)(width / 2) * (height / 2) * 3);
+        for (int y = 0; y < height / 2; ++y) {
+            for (int x = 0; x < width / 2; ++x) {
+                for (int c = 0; c < 3; ++c) {
+                    int sum = rgb[((size_t)(2 * y) * width + 2 * x) * 3 + c] + rgb[((size_t)(2 * y) * width + 2 * x + 1) * 3 + c]
+                        + rgb[((size_t)(2 * y + 1) * width + 2 * x) * 3 + c] + rgb[((size_t)(2 * y + 1) * width + 2 * x + 1) * 3 + c];
+                    half[((size_t)y * (width / 2) + x) * 3 + c] = (uint8_t)((sum + 2) / 4);
+                }
+            }
+        }
+        return half;
+    }
+
+    // Original et copies d'une photo ; les copies doivent avoir la meme empreinte a
+    // DuplicateHashDistance pres
+    struct PhotoFiles {
+        std::vector<std::wstring> copies;
+    };
+
+    PhotoFiles WritePhoto(const fs::path& directory, int index, int width, int height) {
+        PhotoFiles files;
+        std::vector<uint8_t> rgb = MakePhoto(width, height, (uint32_t)index + 1);
+        std::vector<uint8_t> half = HalfSize(rgb, width, height);
+        std::string stem = "photo" + std::to_string(index);
+        auto add = [&files](const fs::path& path, bool written) {
+            if (written) files.copies.push_back(PathToWide(path));
+        };
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+        add(directory / (stem + ".jpg"), WriteJpeg(directory / (stem + ".jpg"), rgb, width, height, 92));
+        add(directory / (stem + "_q40.jpg"), WriteJpeg(directory / (stem + "_q40.jpg"), rgb, width, height, 40));
+        add(directory / (stem + "_half.jpg"), WriteJpeg(directory / (stem + "_half.jpg"), half, width / 2, height / 2, 85));
+#endif
+        add(directory / (stem + "_half.bmp"), WriteBmp(directory / (stem + "_half.bmp"), half, width / 2, height / 2));
+        return files;
+    }
+
+    double Seconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Debit de HashImageFile sur `threads` threads (l'appelant compris)
+    double HashFiles(const std::vector<std::wstring>& files, size_t threads, std::vector<PerceptualHash>& hashes) {
+        hashes.assign(files.size(), 0);
+        std::atomic<size_t> failed{ 0 };
+        auto body = [&](size_t i) {
+            if (!HashImageFile(files[i], hashes[i])) ++failed;
+        };
+        auto start = std::chrono::steady_clock::now();
+        if (threads > 1) {
+            ThreadPool pool(threads - 1);
+            pool.ParallelFor(files.size(), body);
+        }
+        else {
+            for (size_t i = 0; i < files.size(); ++i) body(i);
+        }
+        double elapsed = Seconds(start);
+        if (failed > 0) std::printf("%zu files failed to decode\n", failed.load());
+        return files.size() / elapsed;
+    }
+}
+
+int main(int argc, char** argv) {
+    int photos = 24;
+    int width = 2048, height = 1536;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t catalogSize = 1000000;
+    bool keep = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--photos=", 0) == 0) photos = std::max(2, std::atoi(arg.c_str() + 9));
+        else if (arg.rfind("--size=", 0) == 0) std::sscanf(arg.c_str() + 7, "%dx%d", &width, &height);
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::max<size_t>(1, std::strtoull(arg.c_str() + 10, nullptr, 10));
+        else if (arg.rfind("--catalog=", 0) == 0) catalogSize = std::strtoull(arg.c_str() + 10, nullptr, 10);
+        else if (arg == "--keep") keep = true;
+        else {
+            std::fprintf(stderr, "usage: HashBench [--photos=N] [--size=WxH] [--threads=N] [--catalog=N] [--keep]\n");
+            return 2;
+        }
+    }
+    int failures = 0;
+
+    // Calcul de l'empreinte seul, sur une image deja decodee a la taille d'un JPEG reduit 1/8
+    {
+        std::vector<uint8_t> rgb = MakePhoto(width / 8, height / 8, 7);
+        DecodedImage image;
+        image.Allocate(width / 8, height / 8);
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                const uint8_t* source = &rgb[((size_t)y * image.width + x) * 3];
+                uint8_t* pixel = image.Row(y) + x * 4;
+                pixel[0] = source[2];
+                pixel[1] = source[1];
+                pixel[2] = source[0];
+                pixel[3] = 255;
+            }
+        }
+        std::printf("hash kernel on %dx%d\n%-8s %12s %8s\n", image.width, image.height, "simd", "hashes/s", "hash");
+        PerceptualHash reference = 0;
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2 }) {
+            if (level > DetectSimdLevel()) continue;
+            int iterations = 2000;
+            PerceptualHash hash = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) hash = DctHash(image.View(), level);
+            double rate = iterations / Seconds(start);
+            std::printf("%-8s %12.0f %016llx\n", SimdLevelName(level), rate, (unsigned long long)hash);
+            if (level == SimdLevel::Scalar) reference = hash;
+            else if (HashDistance(hash, reference) > 1) {
+                std::printf("%s hash differs from scalar\n", SimdLevelName(level));
+                ++failures;
+            }
+        }
+    }
+
+    // Decodage reduit + empreinte, fichiers en cache
+    fs::path directory = fs::temp_directory_path() / "RandomPictureHashBench";
+    std::error_code ec;
+    fs::remove_all(directory, ec);
+    fs::create_directories(directory, ec);
+    std::printf("\ngenerating %d photos of %dx%d with their copies...\n", photos, width, height);
+    std::vector<PhotoFiles> photoFiles;
+    std::vector<std::wstring> files;
+    for (int i = 0; i < photos; ++i) {
+        photoFiles.push_back(WritePhoto(directory, i, width, height));
+        files.insert(files.end(), photoFiles.back().copies.begin(), photoFiles.back().copies.end());
+    }
+
+    std::vector<PerceptualHash> hashes;
+    HashFiles(files, 1, hashes);
+    std::printf("%-8s %12s %14s\n", "threads", "images/s", "images/s/core");
+    std::vector<size_t> threadCounts;
+    for (size_t count = 1; count < threads; count *= 2) threadCounts.push_back(count);
+    threadCounts.push_back(threads);
+    for (size_t count : threadCounts) {
+        double rate = HashFiles(files, count, hashes);
+        std::printf("%-8zu %12.1f %14.1f\n", count, rate, rate / count);
+    }
+
+    // Copies d'une meme photo proches, photos differentes eloignees
+    int worstCopy = 0;
+    int closestOther = 64;
+    size_t index = 0;
+    std::vector<PerceptualHash> originals;
+    for (const auto& photo : photoFiles) {
+        PerceptualHash original = hashes[index];
+        for (size_t c = 0; c < photo.copies.size(); ++c) worstCopy = std::max(worstCopy, HashDistance(original, hashes[index + c]));
+        for (PerceptualHash other : originals) closestOther = std::min(closestOther, HashDistance(original, other));
+        originals.push_back(original);
+        index += photo.copies.size();
+    }
+    std::printf("largest distance between copies %d, smallest between photos %d (threshold %d)\n",
+        worstCopy, closestOther, DuplicateHashDistance);
+    if (worstCopy > DuplicateHashDistance || closestOther <= DuplicateHashDistance) ++failures;
+
+    if (!keep) fs::remove_all(directory, ec);
+
+    // Regroupement sur un gros catalogue : empreintes aleatoires, dont 10 % de copies a
+    // 1 a DuplicateHashDistance bits de leur original
+    if (catalogSize > 0) {
+        ImageCatalog catalog;
+        catalog.Reserve(catalogSize, catalogSize * 12);
+        uint32_t directoryId = catalog.AddDirectory(L"/photos");
+        Xoshiro256 random(99);
+        std::vector<PerceptualHash> planted;
+        size_t copies = 0;
+        wchar_t name[32];
+        for (size_t i = 0; i < catalogSize; ++i) {
+            std::swprintf(name, 32, L"IMG_%08zu.jpg", i);
+            ImageId id = catalog.Add(directoryId, name);
+            PerceptualHash hash = random.Next();
+            if (i % 10 == 9) {
+                hash = catalog.ImageHash(id - 1 - random.Below(8));
+                int flips = 1 + (int)random.Below(DuplicateHashDistance);
+                for (int f = 0; f < flips; ++f) hash ^= 1ull << random.Below(64);
+                ++copies;
+            }
+            catalog.SetImageHash(id, hash);
+        }
+
+        DuplicateGroups groups;
+        auto start = std::chrono::steady_clock::now();
+        groups.Build(catalog);
+        double elapsed = Seconds(start);
+        std::printf("\ngrouping %zu hashes: %.0f ms, %zu groups, %zu images in %zu duplicate groups (%zu copies planted)\n",
+            catalog.Size(), elapsed * 1000, groups.GroupCount(), groups.DuplicateCount(), groups.DuplicateGroupCount(), copies);
+        if (catalog.Size() - groups.GroupCount() < copies) {
+            std::printf("some planted copies were not grouped\n");
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
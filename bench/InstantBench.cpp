@@ -0,0 +1,179 @@
+// Premier tirage sans liste complete (TreeSampler) sur une arborescence synthetique
+// desequilibree : dossiers lus et temps avant la premiere image, compares au parcours
+// complet, puis ecart au tirage uniforme des premiers tirages (rapport des probabilites)
+// et de nombreux tirages (distance en variation totale entre la repartition des tirages
+// par dossier de premier niveau et celle des images, a cote de celle d'un vrai tirage
+// uniforme du meme nombre d'images, qui ne mesure que le bruit).
+//
+//   InstantBench [--files=N] [--runs=N] [--early=N] [--picks=N] [--seed=N] [--keep]
+
+#include "BenchCommon.h"
+#include "DirectoryWalker.h"
+#include "ImageScanner.h"
+#include "InstantPicker.h"
+#include "PathString.h"
+#include "RandomSelector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Albums de premier niveau de tailles tres differentes (de 1 a plusieurs milliers
+    // d'images), certains decoupes en sous-dossiers de profondeur variable, d'autres vides.
+    // Fichiers vides : seuls les noms comptent ici.
+    size_t GenerateTree(const fs::path& root, size_t files) {
+        uint32_t state = 13572468;
+        auto next = [&state]() {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        };
+        size_t written = 0;
+        for (int album = 0; written < files; ++album) {
+            fs::path albumPath = root / ("album" + std::to_string(album));
+            // Loi a longue traine : la plupart des albums sont petits, quelques-uns enormes
+            double u = (next() % 10000 + 1) / 10000.0;
+            size_t size = std::min({ files - written, (size_t)(20.0 / u), (size_t)5000 });
+            int depth = (int)(next() % 3);
+            size_t fanout = 2 + next() % 6;
+            if (album % 7 == 3) {
+                // Dossier sans image, avec des sous-dossiers vides
+                fs::create_directories(albumPath / "vide" / "encore");
+                continue;
+            }
+            for (size_t i = 0; i < size; ++i) {
+                fs::path folder = albumPath;
+                size_t branch = i;
+                for (int level = 0; level < depth; ++level) {
+                    folder /= "part" + std::to_string(branch % fanout);
+                    branch /= fanout;
+                }
+                if (i < fanout * fanout) fs::create_directories(folder);
+                std::FILE* file = std::fopen((folder / ("IMG_" + std::to_string(written) + ".jpg")).string().c_str(), "wb");
+                if (!file || std::fclose(file) != 0) return 0;
+                ++written;
+            }
+        }
+        return written;
+    }
+
+    std::wstring TopFolder(const std::wstring& root, const std::wstring& path) {
+        size_t start = root.size() + 1;
+        size_t end = path.find_first_of(L"/\\", start);
+        return path.substr(start, end == std::wstring::npos ? std::wstring::npos : end - start);
+    }
+
+    // Distance en variation totale entre deux repartitions de comptes
+    double TotalVariation(const std::map<std::wstring, double>& expected, const std::map<std::wstring, size_t>& observed,
+        size_t picks) {
+        double distance = 0.0;
+        for (const auto& [folder, share] : expected) {
+            auto it = observed.find(folder);
+            double seen = it == observed.end() ? 0.0 : (double)it->second / picks;
+            distance += std::fabs(seen - share);
+        }
+        return distance / 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t files = 50000;
+    size_t runs = 20;
+    size_t early = 10;
+    size_t picks = 20000;
+    uint64_t seed = 1;
+    bool keep = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--files=", 0) == 0) files = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--runs=", 0) == 0) runs = std::max<size_t>(1, std::strtoull(arg.c_str() + 7, nullptr, 10));
+        else if (arg.rfind("--early=", 0) == 0) early = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--picks=", 0) == 0) picks = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else if (arg == "--keep") keep = true;
+        else {
+            std::fprintf(stderr, "usage: InstantBench [--files=N] [--runs=N] [--early=N] [--picks=N] [--seed=N] [--keep]\n");
+            return 2;
+        }
+    }
+
+    fs::path root = fs::temp_directory_path() / "RandomPictureInstantBench";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    size_t written = GenerateTree(root, files);
+    if (written == 0) {
+        std::fprintf(stderr, "cannot write %s\n", root.string().c_str());
+        return 1;
+    }
+    std::wstring rootPath = PathToWide(root);
+
+    WalkCounters counters;
+    auto start = std::chrono::steady_clock::now();
+    ImageCatalog catalog = GetImageFiles(rootPath);
+    double walkMs = Milliseconds(start);
+    WalkDirectoryTree(rootPath, WalkOptions(), &counters);
+    std::printf("%zu images, %zu folders; full walk %.1f ms\n", catalog.Size(), counters.directories.load(), walkMs);
+
+    int failures = 0;
+    if (catalog.Size() != written) {
+        std::printf("catalog has %zu images, %zu written\n", catalog.Size(), written);
+        ++failures;
+    }
+
+    // Premier tirage et premiers tirages d'une session, graines differentes
+    double firstReads = 0, firstMs = 0, maxFirstReads = 0;
+    std::vector<InstantPick> earlyPicks;
+    for (size_t run = 0; run < runs; ++run) {
+        TreeSampler sampler(rootPath, seed + run);
+        InstantPick pick;
+        start = std::chrono::steady_clock::now();
+        if (!sampler.Pick(pick)) {
+            ++failures;
+            continue;
+        }
+        firstMs += Milliseconds(start);
+        firstReads += (double)pick.directoriesRead;
+        maxFirstReads = std::max(maxFirstReads, (double)pick.directoriesRead);
+        if (catalog.Find(pick.path) == InvalidImageId) {
+            std::printf("picked %s, not in the catalog\n", fs::path(pick.path).string().c_str());
+            ++failures;
+        }
+        earlyPicks.push_back(pick);
+        for (size_t i = 1; i < early && sampler.Pick(pick); ++i) earlyPicks.push_back(pick);
+    }
+    std::printf("first pick: %.1f folders read (max %.0f), %.2f ms on average\n", firstReads / runs, maxFirstReads, firstMs / runs);
+    InstantPickReport report = CompareWithUniform(earlyPicks, catalog);
+    std::printf("first %zu picks x %zu runs: probability x%.2f to x%.2f of uniform, mean deviation %.2f\n",
+        early, runs, report.minRatio, report.maxRatio, report.meanDeviation);
+
+    // Repartition de nombreux tirages par album, contre celle des images
+    std::map<std::wstring, double> expected;
+    for (ImageId id = 0; id < catalog.Size(); ++id) expected[TopFolder(rootPath, catalog.FullPath(id))] += 1.0 / catalog.Size();
+    TreeSampler sampler(rootPath, seed);
+    std::map<std::wstring, size_t> observed;
+    start = std::chrono::steady_clock::now();
+    size_t picked = 0;
+    InstantPick pick;
+    for (; picked < picks && sampler.Pick(pick); ++picked) ++observed[TopFolder(rootPath, pick.path)];
+    double picksMs = Milliseconds(start);
+    RandomSelector uniform(seed);
+    std::map<std::wstring, size_t> uniformObserved;
+    for (size_t i = 0; i < picked; ++i) ++uniformObserved[TopFolder(rootPath, catalog.FullPath(uniform.Pick(catalog)))];
+    double distance = TotalVariation(expected, observed, picked);
+    double noise = TotalVariation(expected, uniformObserved, picked);
+    std::printf("%zu picks: %.2f us each, %zu folders read; album distance %.3f (uniform sampling noise %.3f)\n",
+        picked, picksMs * 1000 / std::max<size_t>(1, picked), sampler.DirectoriesRead(), distance, noise);
+    if (picked < picks) ++failures;
+
+    if (!keep) fs::remove_all(root);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+// Zoom et deplacement sur une tres grande image (ImagePyramid, TileLoader). Un JPEG de
+// --size est ecrit ligne par ligne, puis une vue de --view est ajustee a l'image, zoomee
+// par pas de 2 jusqu'au 1:1 au centre et deplacee vers la droite puis vers le bas, a
+// raison d'un pas toutes les --pace-ms. Pour chaque phase : temps avant que toutes les
+// tuiles visibles soient pretes (0 si le prefetch les avait deja decodees) et part des pas
+// sans attente. Verifie aussi que des tuiles decodees par des passes differentes sont
+// identiques, et que la memoire maximale du processus reste loin de l'image complete.
+//
+//   PyramidBench [--size=WxH] [--view=WxH] [--cache-mb=N] [--prefetch=N] [--pans=N]
+//                [--pace-ms=X] [--keep]
+
+#include "BenchCommon.h"
+#include "ImagePyramid.h"
+#include "PathString.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+#include <jpeglib.h>
+#endif
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Memoire maximale du processus, en Mo ; 0 si inconnue
+    double PeakMemoryMb() {
+#ifdef _WIN32
+        return 0.0;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+        return usage.ru_maxrss / 1024.0;
+#endif
+    }
+
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+    // Ecrit ligne par ligne : l'image complete n'est jamais en memoire
+    bool WriteLargeJpeg(const fs::path& path, int width, int height) {
+        FILE* file = std::fopen(path.string().c_str(), "wb");
+        if (!file) return false;
+        jpeg_compress_struct info;
+        jpeg_error_mgr error;
+        info.err = jpeg_std_error(&error);
+        jpeg_create_compress(&info);
+        jpeg_stdio_dest(&info, file);
+        info.image_width = (JDIMENSION)width;
+        info.image_height = (JDIMENSION)height;
+        info.input_components = 3;
+        info.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&info);
+        jpeg_set_quality(&info, 85, TRUE);
+        jpeg_start_compress(&info, TRUE);
+        std::vector<uint8_t> row((size_t)width * 3);
+        while (info.next_scanline < info.image_height) {
+            int y = (int)info.next_scanline;
+            for (int x = 0; x < width; ++x) {
+                uint8_t* pixel = &row[(size_t)x * 3];
+                pixel[0] = (uint8_t)(x * 255 / width);
+                pixel[1] = (uint8_t)(y * 255 / height);
+                pixel[2] = (uint8_t)((((x >> 6) ^ (y >> 6)) & 1) ? 200 : 60);
+            }
+            JSAMPROW pointer = row.data();
+            jpeg_write_scanlines(&info, &pointer, 1);
+        }
+        jpeg_finish_compress(&info);
+        jpeg_destroy_compress(&info);
+        return std::fclose(file) == 0;
+    }
+#endif
+
+    // Vue de l'ecran sur l'image : `scale` pixels d'ecran par pixel de l'image, centree en
+    // (centerX, centerY) en pixels de l'image
+    struct Camera {
+        double scale;
+        double centerX;
+        double centerY;
+    };
+
+    TileView ViewOf(const std::shared_ptr<const ImagePyramid>& pyramid, const Camera& camera, int viewWidth, int viewHeight) {
+        TileView view;
+        view.pyramid = pyramid;
+        view.level = pyramid->LevelForScale(camera.scale);
+        double levelScale = std::ldexp(1.0, -view.level);
+        double halfWidth = viewWidth / 2.0 / camera.scale, halfHeight = viewHeight / 2.0 / camera.scale;
+        double tile = ImagePyramid::TileSize / levelScale;
+        view.left = std::max(0, (int)std::floor((camera.centerX - halfWidth) / tile));
+        view.top = std::max(0, (int)std::floor((camera.centerY - halfHeight) / tile));
+        view.right = std::min(pyramid->TileColumns(view.level), (int)std::ceil((camera.centerX + halfWidth) / tile));
+        view.bottom = std::min(pyramid->TileRows(view.level), (int)std::ceil((camera.centerY + halfHeight) / tile));
+        return view;
+    }
+
+    bool VisibleReady(const TileCache& cache, const TileView& view) {
+        for (int y = view.top; y < view.bottom; ++y) {
+            for (int x = view.left; x < view.right; ++x) {
+                if (!cache.Contains(TileKey{ view.pyramid->Id(), view.level, x, y })) return false;
+            }
+        }
+        return true;
+    }
+
+    struct Phase {
+        const char* name;
+        int steps = 0;
+        int instant = 0;
+        double totalMs = 0;
+        double maxMs = 0;
+    };
+
+    void Step(TileLoader& loader, const TileCache& cache, TileView view, Phase& phase, double paceMs) {
+        auto start = std::chrono::steady_clock::now();
+        bool instant = VisibleReady(cache, view);
+        loader.Request(view);
+        while (!VisibleReady(cache, view)) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        double ms = instant ? 0.0 : Milliseconds(start);
+        ++phase.steps;
+        if (instant) ++phase.instant;
+        phase.totalMs += ms;
+        phase.maxMs = std::max(phase.maxMs, ms);
+        // Temps de l'utilisateur entre deux pas : le prefetch continue pendant ce temps
+        double remaining = paceMs - Milliseconds(start);
+        if (remaining > 0) std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(remaining));
+    }
+
+    bool SameTile(const DecodedImage& a, const DecodedImage& b) {
+        if (a.width != b.width || a.height != b.height) return false;
+        for (int y = 0; y < a.height; ++y) {
+            if (std::memcmp(a.pixels.data() + y * a.stride, b.pixels.data() + y * b.stride, (size_t)a.width * 4) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    int width = 16000, height = 12000;
+    int viewWidth = 1920, viewHeight = 1080;
+    size_t cacheMb = 128;
+    int prefetch = 1;
+    int pans = 24;
+    double paceMs = 50.0;
+    bool keep = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--size=", 0) == 0) std::sscanf(arg.c_str() + 7, "%dx%d", &width, &height);
+        else if (arg.rfind("--view=", 0) == 0) std::sscanf(arg.c_str() + 7, "%dx%d", &viewWidth, &viewHeight);
+        else if (arg.rfind("--cache-mb=", 0) == 0) cacheMb = std::max<size_t>(1, std::strtoull(arg.c_str() + 11, nullptr, 10));
+        else if (arg.rfind("--prefetch=", 0) == 0) prefetch = std::max(0, std::atoi(arg.c_str() + 11));
+        else if (arg.rfind("--pans=", 0) == 0) pans = std::max(1, std::atoi(arg.c_str() + 7));
+        else if (arg.rfind("--pace-ms=", 0) == 0) paceMs = std::max(0.0, std::atof(arg.c_str() + 10));
+        else if (arg == "--keep") keep = true;
+        else {
+            std::fprintf(stderr, "usage: PyramidBench [--size=WxH] [--view=WxH] [--cache-mb=N] [--prefetch=N] "
+                "[--pans=N] [--pace-ms=X] [--keep]\n");
+            return 2;
+        }
+    }
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+
+#if !defined(RANDOMPICTURE_HAVE_LIBJPEG)
+    std::printf("libjpeg not available, nothing to measure\n");
+    return 0;
+#else
+    fs::path root = fs::temp_directory_path() / "RandomPicturePyramidBench";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root, ec);
+    fs::path path = root / "panorama.jpg";
+    auto start = std::chrono::steady_clock::now();
+    if (!WriteLargeJpeg(path, width, height)) {
+        std::fprintf(stderr, "cannot write %s\n", path.string().c_str());
+        return 1;
+    }
+    double fullMb = (double)width * height * 4 / 1048576.0;
+    std::printf("generated %dx%d JPEG (%.1f MB on disk, %.0f MB decoded) in %.0f ms\n", width, height,
+        fs::file_size(path) / 1048576.0, fullMb, Milliseconds(start));
+    double baselineMb = PeakMemoryMb();
+
+    auto pyramid = std::make_shared<ImagePyramid>();
+    if (!pyramid->Open(PathToWide(path))) {
+        std::fprintf(stderr, "cannot open %s\n", path.string().c_str());
+        return 1;
+    }
+    std::printf("%d levels, %dx%d tiles at full resolution\n", pyramid->LevelCount(), pyramid->TileColumns(0), pyramid->TileRows(0));
+
+    int failures = 0;
+
+    // Tuiles decodees seules ou au milieu d'une passe plus large : memes pixels
+    {
+        int level = 0;
+        int column = pyramid->TileColumns(level) / 2, row = pyramid->TileRows(level) / 2;
+        std::shared_ptr<DecodedImage> alone, within;
+        pyramid->DecodeTiles(level, column, row, column + 1, row + 1,
+            [&](const TileKey&, std::shared_ptr<DecodedImage> tile) { alone = tile; });
+        pyramid->DecodeTiles(level, column - 1, row - 1, column + 2, row + 2, [&](const TileKey& key, std::shared_ptr<DecodedImage> tile) {
+            if (key.x == column && key.y == row) within = tile;
+        });
+        int last = pyramid->LevelCount() - 1;
+        std::shared_ptr<DecodedImage> top;
+        pyramid->DecodeTiles(last, 0, 0, 1, 1, [&](const TileKey&, std::shared_ptr<DecodedImage> tile) { top = tile; });
+        if (!alone || !within || !SameTile(*alone, *within)) {
+            std::printf("tile differs between passes\n");
+            ++failures;
+        }
+        if (!top || top->width != pyramid->LevelWidth(last) || top->height != pyramid->LevelHeight(last)) {
+            std::printf("top level has the wrong size\n");
+            ++failures;
+        }
+    }
+
+    TileCache cache(cacheMb << 20);
+    TileLoader loader;
+    loader.prefetchTiles = prefetch;
+    loader.Start(cache, nullptr);
+
+    Camera camera{ std::min((double)viewWidth / width, (double)viewHeight / height), width / 2.0, height / 2.0 };
+    Phase zoom{ "zoom" }, panRight{ "pan right" }, panDown{ "pan down" };
+    Step(loader, cache, ViewOf(pyramid, camera, viewWidth, viewHeight), zoom, paceMs);
+    while (camera.scale < 1.0) {
+        camera.scale = std::min(1.0, camera.scale * 2);
+        Step(loader, cache, ViewOf(pyramid, camera, viewWidth, viewHeight), zoom, paceMs);
+    }
+    for (int i = 0; i < pans; ++i) {
+        camera.centerX = std::min<double>(width, camera.centerX + viewWidth / 8.0);
+        TileView view = ViewOf(pyramid, camera, viewWidth, viewHeight);
+        view.panX = 1;
+        Step(loader, cache, view, panRight, paceMs);
+    }
+    for (int i = 0; i < pans; ++i) {
+        camera.centerY = std::min<double>(height, camera.centerY + viewHeight / 8.0);
+        TileView view = ViewOf(pyramid, camera, viewWidth, viewHeight);
+        view.panY = 1;
+        Step(loader, cache, view, panDown, paceMs);
+    }
+    loader.WaitIdle();
+    TileLoader::Stats stats = loader.GetStats();
+    loader.Cancel();
+
+    std::printf("%-10s %6s %8s %12s %10s\n", "phase", "steps", "instant", "avg wait ms", "max ms");
+    for (const Phase* phase : { &zoom, &panRight, &panDown }) {
+        std::printf("%-10s %6d %7d%% %12.1f %10.1f\n", phase->name, phase->steps, phase->instant * 100 / std::max(1, phase->steps),
+            phase->totalMs / std::max(1, phase->steps), phase->maxMs);
+    }
+    std::printf("tiles decoded %zu (%zu prefetched) in %zu passes, %.1f ms/tile\n", stats.tiles, stats.prefetched,
+        stats.passes, stats.tiles ? stats.decodeMs / stats.tiles : 0.0);
+    TileCache::Stats cacheStats = cache.GetStats();
+    std::printf("cache %.1f MB in %zu tiles (budget %zu MB), %llu evictions\n", cacheStats.bytes / 1048576.0,
+        cacheStats.entries, cacheMb, (unsigned long long)cacheStats.evictions);
+
+    double peakMb = PeakMemoryMb();
+    if (peakMb > 0) {
+        std::printf("peak memory %.0f MB (%.0f MB before opening), full image %.0f MB\n", peakMb, baselineMb, fullMb);
+        // Cache, fichier projete et une passe : rien qui grandisse avec la surface de l'image
+        double bound = baselineMb + cacheMb + fs::file_size(path) / 1048576.0 + 64;
+        if (peakMb > bound) {
+            std::printf("peak memory above %.0f MB\n", bound);
+            ++failures;
+        }
+    }
+    if (panRight.instant + panDown.instant == 0) {
+        std::printf("no pan step was served by the prefetch\n");
+        ++failures;
+    }
+
+    if (!keep) fs::remove_all(root, ec);
+    return failures == 0 ? 0 : 1;
+#endif
+}
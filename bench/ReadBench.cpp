@@ -0,0 +1,227 @@
+// Debit de lecture des fichiers que consomment les decodeurs (FileReader) : projection en
+// memoire, lecture par blocs de ReadBlockSize, puis lecture d'avance (ReadAhead) pendant
+// qu'un consommateur travaille sur chaque fichier, comme le decodage. Le debit est donne
+// en octets/s pour chaque dossier, avec le type de support detecte (local, reseau,
+// amovible) ; pour comparer, passer un dossier par support.
+//
+//   ReadBench [--files=N] [--size=MB] [--work-ms=X] [--budget-mb=N] [--threads=N]
+//             [--iterations=N] [--warm] [--keep] [dossiers...]
+//
+// Sans dossier, --files fichiers de --size Mo sont ecrits dans le dossier temporaire.
+// Sous Linux, les fichiers sont retires du cache avant chaque passe (sauf --warm) ; sous
+// Windows les mesures sont faites cache chaud.
+
+#include "BenchCommon.h"
+#include "FileReader.h"
+#include "PathString.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool GenerateFiles(const fs::path& root, size_t files, size_t bytes) {
+        fs::create_directories(root);
+        std::vector<uint8_t> data(bytes);
+        uint32_t state = 0x12345678;
+        for (size_t i = 0; i < files; ++i) {
+            for (auto& value : data) {
+                state = state * 1664525u + 1013904223u;
+                value = (uint8_t)(state >> 24);
+            }
+            std::ofstream out(root / ("photo_" + std::to_string(i) + ".jpg"), std::ios::binary | std::ios::trunc);
+            out.write((const char*)data.data(), (std::streamsize)data.size());
+            if (!out) return false;
+        }
+        return true;
+    }
+
+    // Retire le fichier du cache du systeme ; false si ce n'est pas possible ici
+    bool DropFromCache(const std::wstring& path) {
+#ifdef _WIN32
+        (void)path;
+        return false;
+#else
+        int fd = open(WideToPath(path).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(fd);
+        return dropped;
+#endif
+    }
+
+    // Ce que fait un decodeur du contenu : tout lire, puis calculer
+    uint64_t Consume(const FileData& file, double workMs) {
+        uint64_t sum = 0;
+        const uint8_t* data = file.Data();
+        for (size_t i = 0; i < file.Size(); i += 64) sum += data[i];
+        if (workMs > 0) {
+            auto start = std::chrono::steady_clock::now();
+            while (Milliseconds(start) < workMs) {
+            }
+        }
+        return sum;
+    }
+
+    struct Pass {
+        double ms = 0;
+        uint64_t bytes = 0;
+        uint64_t checksum = 0;
+        ReadAhead::Stats stats;
+    };
+
+    Pass ReadDirect(const std::vector<std::wstring>& paths, FileReadMode mode, double workMs) {
+        Pass pass;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& path : paths) {
+            FileData file;
+            if (!file.Open(path, mode)) continue;
+            pass.bytes += file.Size();
+            pass.checksum += Consume(file, workMs);
+        }
+        pass.ms = Milliseconds(start);
+        return pass;
+    }
+
+    Pass ReadAheadOf(const std::vector<std::wstring>& paths, size_t threads, uint64_t budget, double workMs) {
+        Pass pass;
+        auto start = std::chrono::steady_clock::now();
+        ReadAhead readAhead(threads, budget);
+        readAhead.Request(paths);
+        for (const auto& path : paths) {
+            FileData file;
+            if (!readAhead.Take(path, file)) continue;
+            pass.bytes += file.Size();
+            pass.checksum += Consume(file, workMs);
+        }
+        pass.ms = Milliseconds(start);
+        pass.stats = readAhead.GetStats();
+        return pass;
+    }
+
+    double MegabytesPerSecond(const Pass& pass) {
+        return pass.ms > 0 ? pass.bytes / (pass.ms / 1000.0) / 1048576.0 : 0.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t files = 64;
+    size_t sizeMb = 4;
+    double workMs = 5.0;
+    uint64_t budgetMb = DefaultReadAheadBytes >> 20;
+    size_t threads = 2;
+    int iterations = 3;
+    bool warm = false;
+    bool keep = false;
+    std::vector<std::string> folders;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--files=", 0) == 0) files = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--size=", 0) == 0) sizeMb = std::max<size_t>(1, std::strtoull(arg.c_str() + 7, nullptr, 10));
+        else if (arg.rfind("--work-ms=", 0) == 0) workMs = std::max(0.0, std::atof(arg.c_str() + 10));
+        else if (arg.rfind("--budget-mb=", 0) == 0) budgetMb = std::max<uint64_t>(1, std::strtoull(arg.c_str() + 12, nullptr, 10));
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::max<size_t>(1, std::strtoull(arg.c_str() + 10, nullptr, 10));
+        else if (arg.rfind("--iterations=", 0) == 0) iterations = std::max(1, std::atoi(arg.c_str() + 13));
+        else if (arg == "--warm") warm = true;
+        else if (arg == "--keep") keep = true;
+        else if (arg.rfind("--", 0) != 0) folders.push_back(arg);
+        else {
+            std::fprintf(stderr, "usage: ReadBench [--files=N] [--size=MB] [--work-ms=X] [--budget-mb=N] [--threads=N] "
+                "[--iterations=N] [--warm] [--keep] [dossiers...]\n");
+            return 2;
+        }
+    }
+
+    fs::path generatedRoot;
+    if (folders.empty()) {
+        generatedRoot = fs::temp_directory_path() / "RandomPictureReadBench";
+        std::error_code ec;
+        fs::remove_all(generatedRoot, ec);
+        auto start = std::chrono::steady_clock::now();
+        if (!GenerateFiles(generatedRoot, files, sizeMb << 20)) {
+            std::fprintf(stderr, "cannot write %s\n", generatedRoot.string().c_str());
+            return 1;
+        }
+        std::printf("generated %zu files of %zu MB in %s (%.0f ms)\n",
+            files, sizeMb, generatedRoot.string().c_str(), Milliseconds(start));
+        folders.push_back(generatedRoot.string());
+    }
+
+    uint64_t budget = budgetMb << 20;
+    int failures = 0;
+    std::printf("%-28s %-10s %-11s %10s %10s\n", "folder", "storage", "mode", "ms", "MB/s");
+    for (const auto& folder : folders) {
+        std::vector<std::wstring> paths;
+        uint64_t largest = 0;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(fs::path(folder), ec)) {
+            if (!entry.is_regular_file(ec)) continue;
+            paths.push_back(PathToWide(entry.path()));
+            largest = std::max<uint64_t>(largest, entry.file_size(ec));
+        }
+        std::sort(paths.begin(), paths.end());
+        if (paths.empty()) {
+            std::printf("%s: no files\n", folder.c_str());
+            ++failures;
+            continue;
+        }
+
+        StorageKind kind = DetectStorageKind(paths.front());
+        bool cold = !warm;
+        auto prepare = [&]() {
+            if (!cold) return;
+            for (const auto& path : paths) cold = DropFromCache(path) && cold;
+        };
+
+        const char* modes[] = { "map", "stream", "read-ahead" };
+        Pass best[3];
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            for (int mode = 0; mode < 3; ++mode) {
+                prepare();
+                Pass pass = mode == 0 ? ReadDirect(paths, FileReadMode::Map, workMs)
+                    : mode == 1 ? ReadDirect(paths, FileReadMode::Stream, workMs)
+                    : ReadAheadOf(paths, threads, budget, workMs);
+                if (iteration == 0 || pass.ms < best[mode].ms) best[mode] = pass;
+            }
+        }
+
+        std::string name = folder.size() > 28 ? "..." + folder.substr(folder.size() - 25) : folder;
+        for (int mode = 0; mode < 3; ++mode) {
+            std::printf("%-28s %-10s %-11s %10.1f %10.1f\n", name.c_str(), StorageKindName(kind), modes[mode],
+                best[mode].ms, MegabytesPerSecond(best[mode]));
+        }
+        const ReadAhead::Stats& stats = best[2].stats;
+        std::printf("  %zu files, %.1f MB, %s cache, work %.1f ms/file; read-ahead: %zu ready, %zu waited, %zu read by consumer, peak %.1f MB (budget %llu MB)\n",
+            paths.size(), best[0].bytes / 1048576.0, cold ? "cold" : "warm", workMs, stats.hits, stats.waits, stats.misses,
+            stats.peakBytes / 1048576.0, (unsigned long long)budgetMb);
+
+        if (best[1].checksum != best[0].checksum || best[2].checksum != best[0].checksum ||
+            best[1].bytes != best[0].bytes || best[2].bytes != best[0].bytes) {
+            std::printf("  modes read different contents\n");
+            ++failures;
+        }
+        if (stats.peakBytes > std::max(budget, largest)) {
+            std::printf("  read-ahead held %.1f MB, over its budget\n", stats.peakBytes / 1048576.0);
+            ++failures;
+        }
+    }
+
+    if (!generatedRoot.empty() && !keep) {
+        std::error_code ec;
+        fs::remove_all(generatedRoot, ec);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+// Debit du redimensionnement (Resampler) sur des images de 24 a 100 megapixels reduites
+// aux tailles de fenetre courantes, pour chaque filtre, jeu d'instructions et nombre de
+// threads. Verifie que tous les jeux d'instructions et le calcul par bandes donnent
+// exactement l'image du premier calcul de chaque filtre.
+//
+//   ResampleBench [--sizes=24,50,100] [--filters=box,bilinear,lanczos3]
+//                 [--simd=scalar,sse2,avx2] [--threads=N] [--iterations=N]
+
+#include "Resampler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct Size {
+        int width;
+        int height;
+    };
+
+    struct Options {
+        std::vector<int> megapixels{ 24, 50, 100 };
+        std::vector<ResampleFilter> filters{ ResampleFilter::Box, ResampleFilter::Bilinear, ResampleFilter::Lanczos3 };
+        std::vector<SimdLevel> simd{ SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2 };
+        size_t threads = 0;
+        int iterations = 3;
+    };
+
+    std::vector<std::string> SplitList(const std::string& value) {
+        std::vector<std::string> items;
+        std::stringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&arg](const char* prefix) -> const char* {
+                size_t length = std::strlen(prefix);
+                return arg.compare(0, length, prefix) == 0 ? arg.c_str() + length : nullptr;
+            };
+
+            if (const char* list = value("--sizes=")) {
+                options.megapixels.clear();
+                for (const auto& item : SplitList(list)) options.megapixels.push_back(std::atoi(item.c_str()));
+            }
+            else if (const char* list = value("--filters=")) {
+                options.filters.clear();
+                for (const auto& item : SplitList(list)) {
+                    if (item == "box") options.filters.push_back(ResampleFilter::Box);
+                    else if (item == "bilinear") options.filters.push_back(ResampleFilter::Bilinear);
+                    else if (item == "lanczos3") options.filters.push_back(ResampleFilter::Lanczos3);
+                    else return false;
+                }
+            }
+            else if (const char* list = value("--simd=")) {
+                options.simd.clear();
+                for (const auto& item : SplitList(list)) {
+                    if (item == "scalar") options.simd.push_back(SimdLevel::Scalar);
+                    else if (item == "sse2") options.simd.push_back(SimdLevel::Sse2);
+                    else if (item == "avx2") options.simd.push_back(SimdLevel::Avx2);
+                    else return false;
+                }
+            }
+            else if (const char* count = value("--threads=")) {
+                options.threads = (size_t)std::atoi(count);
+            }
+            else if (const char* count = value("--iterations=")) {
+                options.iterations = std::max(1, std::atoi(count));
+            }
+            else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Format 3:2 d'un appareil photo pour le nombre de megapixels demande
+    Size SourceSize(int megapixels) {
+        int height = (int)std::lround(std::sqrt(megapixels * 1e6 / 1.5));
+        return Size{ height * 3 / 2, height };
+    }
+
+    Size FitSize(Size source, Size window) {
+        double scale = std::min((double)window.width / source.width, (double)window.height / source.height);
+        return Size{ std::max(1, (int)(source.width * scale)), std::max(1, (int)(source.height * scale)) };
+    }
+
+    // Degrade avec du bruit : evite qu'un contenu uniforme favorise un noyau
+    std::vector<uint8_t> MakeSource(Size size) {
+        std::vector<uint8_t> pixels((size_t)size.width * size.height * 4);
+        uint32_t state = 12345;
+        for (int y = 0; y < size.height; ++y) {
+            uint8_t* row = pixels.data() + (size_t)y * size.width * 4;
+            for (int x = 0; x < size.width; ++x) {
+                state = state * 1664525u + 1013904223u;
+                uint8_t noise = (uint8_t)(state >> 27);
+                row[x * 4 + 0] = (uint8_t)(x * 255 / size.width + noise);
+                row[x * 4 + 1] = (uint8_t)(y * 255 / size.height + noise);
+                row[x * 4 + 2] = (uint8_t)((x ^ y) + noise);
+                row[x * 4 + 3] = 255;
+            }
+        }
+        return pixels;
+    }
+
+    // Plus grand ecart entre deux canaux des deux images
+    int MaxDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+        int difference = 0;
+        for (size_t i = 0; i < a.size(); ++i) difference = std::max(difference, std::abs(a[i] - b[i]));
+        return difference;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: ResampleBench [--sizes=24,50,100] [--filters=box,bilinear,lanczos3]\n"
+            "                     [--simd=scalar,sse2,avx2] [--threads=N] [--iterations=N]\n");
+        return 2;
+    }
+
+    ThreadPool pool(options.threads);
+    const Size windows[] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 } };
+
+    std::printf("simd detected: %s, pool threads: %zu\n", SimdLevelName(DetectSimdLevel()), pool.ThreadCount());
+    std::printf("%-11s %-10s %-9s %-7s %7s %10s %10s\n",
+        "source", "target", "filter", "simd", "threads", "best ms", "src MP/s");
+
+    int failures = 0;
+    for (int megapixels : options.megapixels) {
+        Size source = SourceSize(megapixels);
+        std::vector<uint8_t> sourcePixels = MakeSource(source);
+        ConstImageView sourceView(sourcePixels.data(), source.width, source.height, (ptrdiff_t)source.width * 4);
+
+        for (Size window : windows) {
+            Size target = FitSize(source, window);
+            std::vector<uint8_t> targetPixels((size_t)target.width * target.height * 4);
+            ImageView targetView{ targetPixels.data(), target.width, target.height, (ptrdiff_t)target.width * 4 };
+
+            for (ResampleFilter filter : options.filters) {
+                std::vector<uint8_t> reference;
+                const char* referenceName = nullptr;
+                for (SimdLevel simd : options.simd) {
+                    if (simd > DetectSimdLevel()) continue;
+                    for (ThreadPool* threadPool : { (ThreadPool*)nullptr, &pool }) {
+                        ResampleOptions resample;
+                        resample.filter = filter;
+                        resample.simd = simd;
+                        resample.pool = threadPool;
+
+                        double best = 1e30;
+                        bool resampled = true;
+                        for (int i = 0; i < options.iterations; ++i) {
+                            auto start = std::chrono::steady_clock::now();
+                            resampled = ResampleImage(sourceView, targetView, resample) && resampled;
+                            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                            best = std::min(best, elapsed.count());
+                        }
+
+                        char sourceLabel[32], targetLabel[32];
+                        std::snprintf(sourceLabel, sizeof(sourceLabel), "%dx%d", source.width, source.height);
+                        std::snprintf(targetLabel, sizeof(targetLabel), "%dx%d", target.width, target.height);
+                        std::printf("%-11s %-10s %-9s %-7s %7zu %10.1f %10.1f\n",
+                            sourceLabel, targetLabel, ResampleFilterName(filter), SimdLevelName(simd),
+                            threadPool ? pool.ThreadCount() + 1 : (size_t)1, best,
+                            (double)source.width * source.height / 1e6 / (best / 1000.0));
+
+                        if (!resampled) {
+                            std::printf("  resampling failed\n");
+                            ++failures;
+                        }
+                        else if (!referenceName) {
+                            reference = targetPixels;
+                            referenceName = SimdLevelName(simd);
+                        }
+                        else if (targetPixels != reference) {
+                            std::printf("  differs from %s (max difference %d)\n", referenceName, MaxDifference(targetPixels, reference));
+                            ++failures;
+                        }
+                        std::fflush(stdout);
+                    }
+                }
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
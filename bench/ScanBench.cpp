@@ -0,0 +1,319 @@
+// Cout de la sonde des entetes (ProbeListings) ajoute au parcours d'un dossier.
+// Mesure le parcours seul puis le parcours suivi de la sonde, et verifie que les fichiers
+// tronques ou mal nommes sont ecartes et que les dimensions lues sont les bonnes.
+// Mesure aussi un depot de fichiers et de dossiers melanges (ImageScanner a plusieurs
+// racines, comme un glisser-deposer) et verifie que rien n'est compte deux fois.
+//
+//   ScanBench [--files=10000] [--threads=N] [--iterations=N] [--keep] [dossier]
+//
+// Sans dossier, une arborescence de JPEG, PNG et BMP synthetiques (dont un sur dix
+// invalide) est ecrite dans le dossier temporaire. Les mesures sont faites cache chaud.
+
+#include "BenchCommon.h"
+#include "DirectoryWalker.h"
+#include "ImageProbe.h"
+#include "ImageScanner.h"
+#include "PathString.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t FolderSize = 200;
+
+    void PutBe16(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    void PutBe32(std::vector<uint8_t>& out, uint32_t value) {
+        PutBe16(out, value >> 16);
+        PutBe16(out, value & 0xFFFF);
+    }
+
+    void PutLe32(uint8_t* out, uint32_t value) {
+        std::memcpy(out, &value, 4);
+    }
+
+    // Structure d'un JPEG d'appareil photo : segment EXIF de quelques Ko avant les
+    // dimensions, puis des donnees compressees factices (la sonde ne les decode pas)
+    std::vector<uint8_t> MakeJpeg(uint32_t width, uint32_t height) {
+        std::vector<uint8_t> out = { 0xFF, 0xD8, 0xFF, 0xE1 };
+        PutBe16(out, 2 + 6000);
+        const char exif[] = "Exif\0\0";
+        out.insert(out.end(), exif, exif + 6);
+        out.resize(out.size() + 6000 - 6, 0x20);
+        out.insert(out.end(), { 0xFF, 0xC0 });
+        PutBe16(out, 17);
+        out.push_back(8);
+        PutBe16(out, height);
+        PutBe16(out, width);
+        out.insert(out.end(), { 3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 });
+        out.insert(out.end(), { 0xFF, 0xDA });
+        PutBe16(out, 12);
+        out.insert(out.end(), { 3, 1, 0, 2, 0x11, 3, 0x11, 0, 63, 0 });
+        out.resize(out.size() + 10000, 0x55);
+        out.insert(out.end(), { 0xFF, 0xD9 });
+        return out;
+    }
+
+    std::vector<uint8_t> MakePng(uint32_t width, uint32_t height) {
+        std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        PutBe32(out, 13);
+        out.insert(out.end(), { 'I', 'H', 'D', 'R' });
+        PutBe32(out, width);
+        PutBe32(out, height);
+        out.insert(out.end(), { 8, 6, 0, 0, 0, 0, 0, 0, 0 });
+        PutBe32(out, 12000);
+        out.insert(out.end(), { 'I', 'D', 'A', 'T' });
+        out.resize(out.size() + 12000 + 4, 0x55);
+        PutBe32(out, 0);
+        out.insert(out.end(), { 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82 });
+        return out;
+    }
+
+    std::vector<uint8_t> MakeBmp(uint32_t width, uint32_t height) {
+        uint32_t rowBytes = (width * 3 + 3) & ~3u;
+        std::vector<uint8_t> out(54 + (size_t)rowBytes * height, 0x55);
+        std::memset(out.data(), 0, 54);
+        out[0] = 'B';
+        out[1] = 'M';
+        PutLe32(&out[2], (uint32_t)out.size());
+        PutLe32(&out[10], 54);
+        PutLe32(&out[14], 40);
+        PutLe32(&out[18], width);
+        PutLe32(&out[22], height);
+        out[26] = 1;
+        out[28] = 24;
+        return out;
+    }
+
+    bool WriteBytes(const fs::path& path, const uint8_t* data, size_t size) {
+        FILE* file = std::fopen(path.string().c_str(), "wb");
+        if (!file) return false;
+        bool ok = std::fwrite(data, 1, size, file) == size;
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // Dimensions attendues du fichier `index` : elles varient pour verifier la lecture
+    uint32_t ExpectedWidth(size_t index) { return 640 + (uint32_t)(index % 97) * 16; }
+    uint32_t ExpectedHeight(size_t index) { return 480 + (uint32_t)(index % 89) * 8; }
+
+    // Retourne le nombre de fichiers invalides ecrits
+    size_t GenerateTree(const fs::path& root, size_t files) {
+        size_t broken = 0;
+        std::vector<uint8_t> data;
+        for (size_t i = 0; i < files; ++i) {
+            fs::path folder = root / ("album" + std::to_string(i / FolderSize));
+            if (i % FolderSize == 0) fs::create_directories(folder);
+
+            uint32_t width = ExpectedWidth(i), height = ExpectedHeight(i);
+            std::string stem = "IMG_" + std::to_string(i);
+            std::string name;
+            switch (i % 3) {
+            case 0: data = MakeJpeg(width, height); name = stem + ".jpg"; break;
+            case 1: data = MakePng(width, height); name = stem + ".png"; break;
+            default: data = MakeBmp(width / 8, height / 8); name = stem + ".bmp"; break;
+            }
+
+            // Un fichier sur dix est invalide : copie interrompue ou texte renomme
+            if (i % 10 == 9) {
+                ++broken;
+                if (i % 20 == 9) {
+                    data.resize(data.size() / 3);
+                }
+                else {
+                    const char text[] = "<html>not an image</html>\n";
+                    data.assign(text, text + sizeof(text) - 1);
+                }
+            }
+            if (!WriteBytes(folder / name, data.data(), data.size())) return SIZE_MAX;
+        }
+        return broken;
+    }
+
+    // Depot d'un album sur deux en dossier, des autres fichier par fichier, plus des doublons :
+    // le premier album en double et quelques fichiers d'un album deja depose
+    std::vector<std::wstring> DropRoots(const fs::path& root) {
+        std::vector<std::wstring> roots;
+        std::vector<fs::path> albums;
+        for (const auto& entry : fs::directory_iterator(root)) albums.push_back(entry.path());
+        std::sort(albums.begin(), albums.end());
+        for (size_t i = 0; i < albums.size(); ++i) {
+            if (i % 2 == 0) {
+                roots.push_back(PathToWide(albums[i]));
+                continue;
+            }
+            for (const auto& entry : fs::directory_iterator(albums[i])) roots.push_back(PathToWide(entry.path()));
+        }
+        if (!albums.empty()) {
+            roots.push_back(PathToWide(albums[0]));
+            size_t duplicated = 0;
+            for (const auto& entry : fs::directory_iterator(albums[0])) {
+                if (duplicated++ == 10) break;
+                roots.push_back(PathToWide(entry.path()));
+            }
+        }
+        return roots;
+    }
+
+    // Scan complet de `roots` ; nombre d'images gardees
+    size_t IngestDrop(const std::vector<std::wstring>& roots, size_t threads) {
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool notified = false;
+        ImageScanner scanner;
+        scanner.useLibraryIndex = false;
+        scanner.threadCount = threads;
+        scanner.Start(roots, [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            notified = true;
+            changed.notify_one();
+        });
+
+        ImageCatalog catalog;
+        std::vector<std::wstring> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return notified; });
+                notified = false;
+            }
+            scanner.TakeBatch(batch);
+            if (scanner.TakeCatalog(catalog)) break;
+        }
+        return catalog.Size() - catalog.ExcludedCount();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t files = 10000;
+    size_t threads = 0;
+    int iterations = 3;
+    bool keep = false;
+    std::string folder;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--files=", 0) == 0) files = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::strtoull(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--iterations=", 0) == 0) iterations = std::max(1, std::atoi(arg.c_str() + 13));
+        else if (arg == "--keep") keep = true;
+        else if (arg.rfind("--", 0) != 0 && folder.empty()) folder = arg;
+        else {
+            std::fprintf(stderr, "usage: ScanBench [--files=N] [--threads=N] [--iterations=N] [--keep] [dossier]\n");
+            return 2;
+        }
+    }
+
+    fs::path root;
+    size_t expectedBroken = SIZE_MAX;
+    bool generated = folder.empty();
+    if (generated) {
+        root = fs::temp_directory_path() / "RandomPictureScanBench";
+        std::error_code ec;
+        fs::remove_all(root, ec);
+        auto start = std::chrono::steady_clock::now();
+        expectedBroken = GenerateTree(root, files);
+        if (expectedBroken == SIZE_MAX) {
+            std::fprintf(stderr, "cannot write %s\n", root.string().c_str());
+            return 1;
+        }
+        std::printf("generated %zu files (%zu invalid) in %s (%.0f ms)\n",
+            files, expectedBroken, root.string().c_str(), Milliseconds(start));
+    }
+    else {
+        root = fs::path(folder);
+    }
+    std::wstring rootPath = PathToWide(root);
+
+    // Premier parcours pour charger les dossiers et les entetes en cache
+    WalkResult warm = Walk(rootPath, threads);
+    ProbeListings(warm.directories, threads);
+
+    double bestWalk = 1e300, bestProbe = 1e300;
+    size_t found = 0, rejected = 0, wrongSize = 0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        auto start = std::chrono::steady_clock::now();
+        WalkResult walked = Walk(rootPath, threads);
+        bestWalk = std::min(bestWalk, Milliseconds(start));
+
+        start = std::chrono::steady_clock::now();
+        WalkResult probed = Walk(rootPath, threads);
+        found = 0;
+        for (const auto& directory : probed.directories) found += directory.files.size();
+        rejected = ProbeListings(probed.directories, threads);
+        bestProbe = std::min(bestProbe, Milliseconds(start));
+
+        wrongSize = 0;
+        if (generated) {
+            for (const auto& directory : probed.directories) {
+                for (const auto& file : directory.files) {
+                    if (file.rejected) continue;
+                    size_t index = std::wcstoull(file.name.c_str() + 4, nullptr, 10);
+                    uint32_t width = ExpectedWidth(index), height = ExpectedHeight(index);
+                    if (file.name.size() > 4 && file.name.compare(file.name.size() - 4, 4, L".bmp") == 0) {
+                        width /= 8;
+                        height /= 8;
+                    }
+                    if (file.width != width || file.height != height) ++wrongSize;
+                }
+            }
+        }
+    }
+
+    std::vector<std::wstring> dropRoots;
+    double bestDrop = 1e300;
+    size_t dropped = 0;
+    if (generated) {
+        dropRoots = DropRoots(root);
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            auto start = std::chrono::steady_clock::now();
+            dropped = IngestDrop(dropRoots, threads);
+            bestDrop = std::min(bestDrop, Milliseconds(start));
+        }
+    }
+
+    double added = bestProbe - bestWalk;
+    std::printf("%-14s %10s %12s\n", "stage", "ms", "us/file");
+    std::printf("%-14s %10.1f %12.2f\n", "walk", bestWalk, bestWalk * 1000.0 / std::max<size_t>(1, found));
+    std::printf("%-14s %10.1f %12.2f\n", "walk + probe", bestProbe, bestProbe * 1000.0 / std::max<size_t>(1, found));
+    std::printf("%-14s %10.1f %12.2f  (+%.0f%%)\n", "probe cost", added, added * 1000.0 / std::max<size_t>(1, found),
+        bestWalk > 0 ? added * 100.0 / bestWalk : 0.0);
+    if (generated) {
+        std::printf("%-14s %10.1f %12.2f  (%zu roots)\n", "drop ingest", bestDrop, bestDrop * 1000.0 / std::max<size_t>(1, dropped),
+            dropRoots.size());
+    }
+    std::printf("files %zu, rejected %zu\n", found, rejected);
+
+    int failures = 0;
+    if (generated) {
+        if (rejected != expectedBroken) {
+            std::printf("expected %zu rejected files\n", expectedBroken);
+            ++failures;
+        }
+        if (dropped != found - expectedBroken) {
+            std::printf("drop kept %zu images, expected %zu\n", dropped, found - expectedBroken);
+            ++failures;
+        }
+        if (wrongSize > 0) {
+            std::printf("%zu files with wrong dimensions\n", wrongSize);
+            ++failures;
+        }
+        if (!keep) {
+            std::error_code ec;
+            fs::remove_all(root, ec);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
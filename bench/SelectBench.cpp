@@ -0,0 +1,169 @@
+// Debit du tirage des images (RandomSelector) sur un catalogue synthetique, pour chaque
+// mode, compare a l'ancien tirage (std::random_device et std::mt19937 a chaque appel).
+// Verifie aussi que le sac ne repete aucune image pendant un tour. Mesure enfin les modes
+// ponderes pendant un scan : le catalogue grandit par lots, avec un tirage par lot.
+//
+//   SelectBench [--files=10000000] [--folder-size=1000] [--picks=N] [--seed=N]
+
+#include "ImageCatalog.h"
+#include "RandomSelector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    // Catalogue de `files` images reparties en dossiers de taille variable, dates etalees
+    // sur cinq ans
+    ImageCatalog MakeCatalog(size_t files, size_t folderSize) {
+        ImageCatalog catalog;
+        catalog.Reserve(files, files * 12);
+        const int64_t year = std::chrono::duration_cast<std::filesystem::file_time_type::duration>(
+            std::chrono::hours(24 * 365)).count();
+        uint32_t state = 24681357;
+        uint32_t directory = 0;
+        size_t remaining = 0;
+        wchar_t name[32];
+        for (size_t i = 0; i < files; ++i) {
+            if (remaining == 0) {
+                state = state * 1664525u + 1013904223u;
+                remaining = 1 + (state >> 8) % (folderSize * 2);
+                directory = catalog.AddDirectory(L"/photos/" + std::to_wstring(catalog.DirectoryCount()));
+            }
+            --remaining;
+            state = state * 1664525u + 1013904223u;
+            std::swprintf(name, 32, L"IMG_%08zu.jpg", i);
+            catalog.Add(directory, name, 5 * year + (int64_t)((double)(state >> 1) / 2147483648.0 * 5 * year));
+        }
+        return catalog;
+    }
+
+    ImageId LegacyPick(const ImageCatalog& images) {
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<ImageId> distrib(0, (ImageId)images.Size() - 1);
+        ImageId id;
+        do {
+            id = distrib(gen);
+        } while (images.IsExcluded(id));
+        return id;
+    }
+
+    template <typename Pick>
+    double PicksPerSecond(size_t picks, uint64_t& checksum, Pick pick) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < picks; ++i) checksum += pick();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return picks / elapsed.count();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t files = 10000000;
+    size_t folderSize = 1000;
+    size_t picks = 0;
+    uint64_t seed = 42;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--files=", 0) == 0) files = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--folder-size=", 0) == 0) folderSize = std::max<size_t>(1, std::strtoull(arg.c_str() + 14, nullptr, 10));
+        else if (arg.rfind("--picks=", 0) == 0) picks = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else {
+            std::fprintf(stderr, "usage: SelectBench [--files=N] [--folder-size=N] [--picks=N] [--seed=N]\n");
+            return 2;
+        }
+    }
+    if (picks == 0) picks = files;
+
+    auto start = std::chrono::steady_clock::now();
+    ImageCatalog catalog = MakeCatalog(files, folderSize);
+    std::chrono::duration<double, std::milli> built = std::chrono::steady_clock::now() - start;
+    std::printf("catalog: %zu files in %zu folders (%.0f ms)\n", catalog.Size(), catalog.DirectoryCount(), built.count());
+    std::printf("%-10s %12s %14s %12s\n", "mode", "setup ms", "picks/s", "ns/pick");
+
+    int failures = 0;
+    uint64_t checksum = 0;
+    {
+        size_t legacyPicks = std::min<size_t>(picks, 200000);
+        double rate = PicksPerSecond(legacyPicks, checksum, [&catalog]() { return LegacyPick(catalog); });
+        std::printf("%-10s %12s %14.0f %12.1f\n", "legacy", "-", rate, 1e9 / rate);
+    }
+
+    for (SelectionMode mode : { SelectionMode::Uniform, SelectionMode::ShuffleBag,
+        SelectionMode::BalancedFolders, SelectionMode::RecentFirst }) {
+        RandomSelector selector(seed);
+        selector.SetMode(mode);
+
+        // Premier tirage a part : remplissage du sac ou construction de la table des alias
+        auto setupStart = std::chrono::steady_clock::now();
+        ImageId first = selector.Pick(catalog);
+        std::chrono::duration<double, std::milli> setup = std::chrono::steady_clock::now() - setupStart;
+
+        std::vector<bool> seen;
+        bool repeated = false;
+        if (mode == SelectionMode::ShuffleBag) {
+            seen.assign(catalog.Size(), false);
+            seen[first] = true;
+        }
+        // Le sac est mesure sur un seul tour, sans repetition possible
+        size_t count = (mode == SelectionMode::ShuffleBag ? std::min(picks, catalog.Size()) : picks) - 1;
+        double rate = PicksPerSecond(count, checksum, [&]() {
+            ImageId id = selector.Pick(catalog);
+            if (!seen.empty()) {
+                repeated |= seen[id];
+                seen[id] = true;
+            }
+            return id;
+        });
+        if (repeated) {
+            std::printf("%-10s repeated an image before the bag was empty\n", SelectionModeName(mode));
+            ++failures;
+        }
+        std::printf("%-10s %12.1f %14.0f %12.1f\n", SelectionModeName(mode), setup.count(), rate, 1e9 / rate);
+    }
+
+    // Scan en cours : lots de ScanBatch images (comme ImageScanner) et un tirage par lot. Le
+    // temps est celui des tirages seuls ; sans table differee il croit comme le carre du
+    // nombre d'images.
+    const size_t ScanBatch = 512;
+    size_t scanned = std::min<size_t>(catalog.Size(), 1000000);
+    std::printf("%-10s %12s %14s %12s\n", "scan", "images", "pick ms", "us/batch");
+    for (SelectionMode mode : { SelectionMode::BalancedFolders, SelectionMode::RecentFirst }) {
+        RandomSelector selector(seed);
+        selector.SetMode(mode);
+        ImageCatalog growing;
+        std::vector<uint32_t> directories(catalog.DirectoryCount(), UINT32_MAX);
+        std::chrono::duration<double, std::milli> picking{ 0 };
+        size_t batches = 0;
+        bool invalid = false;
+        for (size_t next = 0; next < scanned; ++batches) {
+            for (size_t end = std::min(scanned, next + ScanBatch); next < end; ++next) {
+                ImageId id = (ImageId)next;
+                uint32_t& directory = directories[catalog.DirectoryOf(id)];
+                if (directory == UINT32_MAX) directory = growing.AddDirectory(catalog.DirectoryPath(catalog.DirectoryOf(id)));
+                growing.Add(directory, catalog.FileName(id), catalog.ModifiedTime(id));
+            }
+            auto pickStart = std::chrono::steady_clock::now();
+            ImageId id = selector.Pick(growing);
+            picking += std::chrono::steady_clock::now() - pickStart;
+            invalid |= id >= growing.Size() || growing.IsExcluded(id);
+            checksum += id;
+        }
+        if (invalid) {
+            std::printf("%-10s picked an image outside the catalog during the scan\n", SelectionModeName(mode));
+            ++failures;
+        }
+        std::printf("%-10s %12zu %14.1f %12.1f\n", SelectionModeName(mode), scanned, picking.count(),
+            picking.count() * 1000.0 / std::max<size_t>(1, batches));
+    }
+
+    std::printf("checksum %llu\n", (unsigned long long)checksum);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+// Generateur de charge local pour le serveur d'images (ImageServer) : demarre le serveur
+// dans le processus sur un dossier synthetique, puis des clients en boucle fermee envoient
+// des requetes HTTP/1.1 sur des connexions gardees ouvertes, en TCP et en socket Unix.
+// Mesure les requetes par seconde et la latence, et verifie chaque reponse (statut,
+// Content-Length, X-Image-Id).
+//
+//   ServeBench [--images=N] [--size=WxH] [--connections=N] [--requests=N] [--threads=N]
+//              [--min-rps=N] [--keep]
+//
+// Scenarios : /random (fichier original par sendfile), /random?w=320&h=240 (image reduite,
+// servie depuis le cache une fois chaque image vue) et /stats (sans fichier ni image).
+
+#include "BenchCommon.h"
+#include "ImageScanner.h"
+#include "ImageServer.h"
+#include "PathString.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Connexion cliente bloquante ; `port` 0 : socket Unix `unixPath`
+    int Connect(uint16_t port, const std::string& unixPath) {
+        if (port == 0) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, unixPath.c_str(), std::min(unixPath.size() + 1, sizeof(address.sun_path) - 1));
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Lit une reponse complete ; false si elle est invalide ou incomplete
+    bool ReadResponse(int fd, std::vector<char>& buffer, size_t& bodyBytes) {
+        size_t filled = 0;
+        size_t headEnd = 0;
+        for (;;) {
+            if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+            ssize_t received = recv(fd, buffer.data() + filled, buffer.size() - filled, 0);
+            if (received <= 0) return false;
+            filled += (size_t)received;
+            for (size_t i = filled >= (size_t)received + 3 ? filled - received - 3 : 0; i + 3 < filled; ++i) {
+                if (std::memcmp(buffer.data() + i, "\r\n\r\n", 4) == 0) {
+                    headEnd = i + 4;
+                    break;
+                }
+            }
+            if (headEnd) break;
+        }
+
+        std::string head(buffer.data(), headEnd);
+        if (head.rfind("HTTP/1.1 200 ", 0) != 0) return false;
+        size_t lengthAt = head.find("Content-Length: ");
+        if (lengthAt == std::string::npos) return false;
+        size_t length = std::strtoull(head.c_str() + lengthAt + 16, nullptr, 10);
+        bool isImage = head.find("Content-Type: image/") != std::string::npos;
+        if (isImage && (head.find("X-Image-Id: ") == std::string::npos || length == 0)) return false;
+
+        // Le corps est lu puis jete ; pas de requetes en avance, donc rien apres lui
+        size_t have = filled - headEnd;
+        while (have < length) {
+            ssize_t received = recv(fd, buffer.data(), std::min(buffer.size(), length - have), 0);
+            if (received <= 0) return false;
+            have += (size_t)received;
+        }
+        bodyBytes = length;
+        return have == length;
+    }
+
+    struct LoadResult {
+        double seconds = 0;
+        size_t requests = 0;
+        size_t errors = 0;
+        uint64_t bytes = 0;
+        std::vector<double> latencies;
+    };
+
+    // `connections` clients en parallele, chacun envoie `requests` requetes l'une apres l'autre
+    LoadResult RunLoad(uint16_t port, const std::string& unixPath, const std::string& target,
+        size_t connections, size_t requests) {
+        std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        std::vector<LoadResult> results(connections);
+        std::atomic<size_t> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::vector<std::thread> clients;
+        for (size_t c = 0; c < connections; ++c) {
+            clients.emplace_back([&, c]() {
+                LoadResult& result = results[c];
+                result.latencies.reserve(requests);
+                int fd = Connect(port, unixPath);
+                ++ready;
+                while (!go) std::this_thread::yield();
+                if (fd < 0) {
+                    result.errors = requests;
+                    return;
+                }
+                std::vector<char> buffer(65536);
+                for (size_t i = 0; i < requests; ++i) {
+                    auto start = std::chrono::steady_clock::now();
+                    size_t bodyBytes = 0;
+                    bool ok = send(fd, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size() &&
+                        ReadResponse(fd, buffer, bodyBytes);
+                    result.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                    if (!ok) {
+                        result.errors += requests - i;
+                        break;
+                    }
+                    ++result.requests;
+                    result.bytes += bodyBytes;
+                }
+                close(fd);
+            });
+        }
+        while (ready < connections) std::this_thread::yield();
+        auto start = std::chrono::steady_clock::now();
+        go = true;
+        for (auto& client : clients) client.join();
+
+        LoadResult total;
+        total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (LoadResult& result : results) {
+            total.requests += result.requests;
+            total.errors += result.errors;
+            total.bytes += result.bytes;
+            total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+        }
+        std::sort(total.latencies.begin(), total.latencies.end());
+        return total;
+    }
+
+    double Percentile(const std::vector<double>& sorted, double fraction) {
+        if (sorted.empty()) return 0;
+        return sorted[std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t imageCount = 200;
+    int width = 1024, height = 768;
+    size_t connections = 16;
+    size_t requests = 2000;
+    size_t threads = 0;
+    double minRps = 1000;
+    bool keep = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--images=", 0) == 0) imageCount = std::max<size_t>(1, std::strtoull(arg.c_str() + 9, nullptr, 10));
+        else if (arg.rfind("--size=", 0) == 0) std::sscanf(arg.c_str() + 7, "%dx%d", &width, &height);
+        else if (arg.rfind("--connections=", 0) == 0) connections = std::max<size_t>(1, std::strtoull(arg.c_str() + 14, nullptr, 10));
+        else if (arg.rfind("--requests=", 0) == 0) requests = std::max<size_t>(1, std::strtoull(arg.c_str() + 11, nullptr, 10));
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::strtoull(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--min-rps=", 0) == 0) minRps = std::strtod(arg.c_str() + 10, nullptr);
+        else if (arg == "--keep") keep = true;
+        else {
+            std::fprintf(stderr, "usage: ServeBench [--images=N] [--size=WxH] [--connections=N] [--requests=N]\n"
+                "                  [--threads=N] [--min-rps=N] [--keep]\n");
+            return 2;
+        }
+    }
+
+    fs::path root = fs::temp_directory_path() / "RandomPictureServeBench";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    for (size_t i = 0; i < imageCount; ++i) {
+        std::vector<uint8_t> rgb = MakeRgb(width, height, (uint32_t)i);
+        std::string stem = "IMG_" + std::to_string(i);
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+        bool written = WriteJpeg(root / (stem + ".jpg"), rgb, width, height);
+#else
+        bool written = WriteBmp(root / (stem + ".bmp"), rgb, width, height);
+#endif
+        if (!written) {
+            std::fprintf(stderr, "cannot write %s\n", root.string().c_str());
+            return 1;
+        }
+    }
+
+    ImageServerOptions options;
+    options.port = 0;
+    options.threadCount = threads;
+    options.seed = 1;
+    ImageServer server;
+    if (!server.Start(GetImageFiles(PathToWide(root)), options)) {
+        std::fprintf(stderr, "server did not start\n");
+        return 1;
+    }
+    std::string unixPath = (root / "serve.sock").string();
+    ImageServerOptions unixOptions = options;
+    unixOptions.unixSocket = unixPath;
+    ImageServer unixServer;
+    if (!unixServer.Start(GetImageFiles(PathToWide(root)), unixOptions)) {
+        std::fprintf(stderr, "unix socket server did not start\n");
+        return 1;
+    }
+
+    std::printf("%zu images %dx%d, %zu connections x %zu requests\n", imageCount, width, height, connections, requests);
+    std::printf("%-22s %-5s %10s %9s %9s %9s %9s %7s\n", "scenario", "via", "req/s", "MB/s", "p50 us", "p99 us", "max us", "errors");
+    int failures = 0;
+    double slowest = 1e30;
+    struct Scenario {
+        const char* target;
+        bool unixSocket;
+    };
+    const Scenario scenarios[] = {
+        { "/stats", false },
+        { "/random", false },
+        { "/random", true },
+        { "/random?w=320&h=240", false },
+        { "/random?w=320&h=240", true },
+    };
+    for (const Scenario& scenario : scenarios) {
+        LoadResult result = RunLoad(scenario.unixSocket ? 0 : server.Port(), unixPath, scenario.target, connections, requests);
+        double rps = result.requests / result.seconds;
+        std::printf("%-22s %-5s %10.0f %9.1f %9.1f %9.1f %9.1f %7zu\n", scenario.target, scenario.unixSocket ? "unix" : "tcp",
+            rps, result.bytes / result.seconds / 1048576.0, Percentile(result.latencies, 0.5),
+            Percentile(result.latencies, 0.99), result.latencies.empty() ? 0 : result.latencies.back(), result.errors);
+        if (result.errors > 0) ++failures;
+        slowest = std::min(slowest, rps);
+    }
+
+    ImageServerStats stats = server.GetStats();
+    std::printf("tcp server: %llu requests, %llu originals, %llu scaled (%llu from cache), %llu errors\n",
+        (unsigned long long)stats.requests, (unsigned long long)stats.originals, (unsigned long long)stats.scaled,
+        (unsigned long long)stats.scaledCacheHits, (unsigned long long)stats.errors);
+    if (stats.errors > 0) ++failures;
+    if (slowest < minRps) {
+        std::printf("slowest scenario %.0f req/s, below %.0f\n", slowest, minRps);
+        ++failures;
+    }
+
+    server.Stop();
+    unixServer.Stop();
+    if (!keep) fs::remove_all(root);
+    return failures == 0 ? 0 : 1;
+}
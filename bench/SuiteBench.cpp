@@ -0,0 +1,465 @@
+// Suite de mesures sans interface, de bout en bout : parcours, sonde, catalogue, index,
+// tirage, historique, decodage et mise a l'echelle, sur des arborescences synthetiques de
+// tailles et de formes differentes. Le resultat est ecrit en JSON pour etre compare d'une
+// version a l'autre ; le resume lisible va sur stderr.
+//
+//   SuiteBench [--files=1000,10000] [--shapes=1x16,3x6] [--threads=N] [--iterations=N]
+//              [--picks=N] [--samples=N] [--window=WxH] [--out=fichier.json] [--keep]
+//
+// --shapes donne la profondeur et le nombre de sous-dossiers par dossier (3x6 : 216
+// dossiers feuilles). Les fichiers sont des liens physiques vers quelques vraies images
+// JPEG et PNG (BMP sans libjpeg ni libpng), ce qui permet d'aller jusqu'a plusieurs
+// millions de fichiers sans remplir le disque. Les mesures sont faites cache chaud.
+
+#include "BenchCommon.h"
+#include "DirectoryWalker.h"
+#include "HistoryRing.h"
+#include "ImageCatalog.h"
+#include "ImageDecoder.h"
+#include "ImageProbe.h"
+#include "ImageScanner.h"
+#include "LibraryIndex.h"
+#include "PathString.h"
+#include "RandomSelector.h"
+#include "Resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Au-dela, l'ancien parcours mono-thread (ScanDirectoryRecursive) n'est pas mesure
+    constexpr size_t LegacyScanLimit = 200000;
+
+    struct TreeShape {
+        size_t depth;
+        size_t fanout;
+    };
+
+    struct Metric {
+        std::string name;
+        double value;
+    };
+
+    struct Stage {
+        std::string name;
+        std::vector<Metric> metrics;
+    };
+
+    struct TreeReport {
+        size_t files = 0;
+        TreeShape shape{};
+        size_t directories = 0;
+        std::vector<Stage> stages;
+    };
+
+    double Nanoseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    // Petites images de reference : JPEG 640x480 et 1024x768, PNG 480x360
+    std::vector<fs::path> WritePayloads(const fs::path& directory) {
+        std::vector<fs::path> payloads;
+        fs::create_directories(directory);
+        for (uint32_t i = 0; i < 12; ++i) {
+            int width = i < 4 ? 640 : i < 8 ? 1024 : 480;
+            int height = width * 3 / 4;
+            std::vector<uint8_t> rgb = MakeRgb(width, height, i);
+            std::string stem = "payload" + std::to_string(i);
+            fs::path path;
+            bool written = false;
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+            if (i < 8) {
+                path = directory / (stem + ".jpg");
+                written = WriteJpeg(path, rgb, width, height);
+            }
+#endif
+#if defined(RANDOMPICTURE_HAVE_LIBPNG)
+            if (i >= 8) {
+                path = directory / (stem + ".png");
+                written = WritePng(path, rgb, width, height);
+            }
+#endif
+            if (path.empty()) {
+                path = directory / (stem + ".bmp");
+                written = WriteBmp(path, rgb, width, height);
+            }
+            if (!written) return {};
+            payloads.push_back(path);
+        }
+        return payloads;
+    }
+
+    // Arbre complet de `shape.depth` niveaux ; les fichiers sont repartis en tourniquet sur
+    // les dossiers feuilles. Retourne le nombre de dossiers, 0 en cas d'erreur.
+    size_t GenerateTree(const fs::path& root, size_t files, TreeShape shape, const std::vector<fs::path>& payloads) {
+        std::vector<fs::path> leaves = { root };
+        size_t directories = 1;
+        for (size_t level = 0; level < shape.depth; ++level) {
+            std::vector<fs::path> next;
+            next.reserve(leaves.size() * shape.fanout);
+            for (const auto& parent : leaves) {
+                for (size_t child = 0; child < shape.fanout; ++child) {
+                    next.push_back(parent / ("dir" + std::to_string(child)));
+                }
+            }
+            leaves = std::move(next);
+            directories += leaves.size();
+        }
+        for (const auto& leaf : leaves) fs::create_directories(leaf);
+
+        bool canLink = true;
+        for (size_t i = 0; i < files; ++i) {
+            const fs::path& payload = payloads[i % payloads.size()];
+            fs::path target = leaves[i % leaves.size()] / ("IMG_" + std::to_string(i) + payload.extension().string());
+            std::error_code ec;
+            if (canLink) {
+                fs::create_hard_link(payload, target, ec);
+                // Systeme de fichiers sans liens physiques : copies
+                if (ec) canLink = false;
+            }
+            if (!canLink && !fs::copy_file(payload, target, ec)) return 0;
+        }
+        return directories;
+    }
+
+    // Meilleur et median de `iterations` executions completes de `run`, debit sur le meilleur
+    template <typename Run>
+    Stage MeasureRuns(const char* name, int iterations, size_t items, Run run) {
+        std::vector<double> times;
+        for (int i = 0; i < iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            times.push_back(Milliseconds(start));
+        }
+        std::sort(times.begin(), times.end());
+        double best = times.front();
+        return Stage{ name, {
+            { "iterations", (double)iterations },
+            { "best_ms", best },
+            { "median_ms", times[times.size() / 2] },
+            { "items_per_second", best > 0 ? items * 1000.0 / best : 0.0 },
+        } };
+    }
+
+    // Percentiles de latences individuelles (en ns, lecture de l'horloge comprise)
+    Stage LatencyStage(const char* name, std::vector<double>& samples) {
+        Stage stage{ name, {} };
+        if (samples.empty()) return stage;
+        double total = 0.0;
+        for (double sample : samples) total += sample;
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, (size_t)(p * (samples.size() - 1) + 0.5))];
+        };
+        stage.metrics = {
+            { "count", (double)samples.size() },
+            { "ops_per_second", total > 0 ? samples.size() * 1e9 / total : 0.0 },
+            { "p50_ns", percentile(0.50) },
+            { "p90_ns", percentile(0.90) },
+            { "p99_ns", percentile(0.99) },
+            { "p999_ns", percentile(0.999) },
+            { "max_ns", samples.back() },
+        };
+        return stage;
+    }
+
+    const Metric* FindMetric(const Stage& stage, const char* name) {
+        for (const auto& metric : stage.metrics) {
+            if (metric.name == name) return &metric;
+        }
+        return nullptr;
+    }
+
+    std::string JsonString(const std::string& text) {
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            if ((unsigned char)c < 0x20) continue;
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    void WriteJson(FILE* out, const std::vector<TreeReport>& reports, size_t threads) {
+        std::fprintf(out, "{\n  \"benchmark\": \"SuiteBench\",\n");
+        std::fprintf(out, "  \"simd\": %s,\n", JsonString(SimdLevelName(DetectSimdLevel())).c_str());
+        std::fprintf(out, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+        std::fprintf(out, "  \"walker_threads\": %zu,\n", threads ? threads : DefaultWalkerThreadCount());
+        std::fprintf(out, "  \"trees\": [");
+        for (size_t t = 0; t < reports.size(); ++t) {
+            const TreeReport& report = reports[t];
+            std::fprintf(out, "%s\n    {\n", t ? "," : "");
+            std::fprintf(out, "      \"files\": %zu,\n      \"depth\": %zu,\n      \"fanout\": %zu,\n      \"directories\": %zu,\n",
+                report.files, report.shape.depth, report.shape.fanout, report.directories);
+            std::fprintf(out, "      \"stages\": {");
+            for (size_t s = 0; s < report.stages.size(); ++s) {
+                const Stage& stage = report.stages[s];
+                std::fprintf(out, "%s\n        %s: {", s ? "," : "", JsonString(stage.name).c_str());
+                for (size_t m = 0; m < stage.metrics.size(); ++m) {
+                    double value = stage.metrics[m].value;
+                    std::fprintf(out, "%s %s: %.*f", m ? "," : "", JsonString(stage.metrics[m].name).c_str(),
+                        value == std::floor(value) ? 0 : 3, std::isfinite(value) ? value : 0.0);
+                }
+                std::fprintf(out, " }");
+            }
+            std::fprintf(out, "\n      }\n    }");
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+
+    // Resume d'une etape sur une ligne
+    void PrintStage(const Stage& stage) {
+        const Metric* best = FindMetric(stage, "best_ms");
+        const Metric* rate = FindMetric(stage, "items_per_second");
+        const Metric* p50 = FindMetric(stage, "p50_ns");
+        const Metric* p99 = FindMetric(stage, "p99_ns");
+        if (best && rate) {
+            std::fprintf(stderr, "  %-18s %12.1f ms %14.0f /s\n", stage.name.c_str(), best->value, rate->value);
+        }
+        else if (p50 && p99) {
+            std::fprintf(stderr, "  %-18s %12.0f ns p50 %10.0f ns p99\n", stage.name.c_str(), p50->value, p99->value);
+        }
+    }
+
+    template <typename Value, typename Parse>
+    std::vector<Value> ParseList(const char* text, Parse parse) {
+        std::vector<Value> values;
+        std::string list = text;
+        size_t begin = 0;
+        while (begin <= list.size()) {
+            size_t end = list.find(',', begin);
+            if (end == std::string::npos) end = list.size();
+            Value value;
+            if (end > begin && parse(list.substr(begin, end - begin), value)) values.push_back(value);
+            begin = end + 1;
+        }
+        return values;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> fileCounts = { 1000, 10000 };
+    std::vector<TreeShape> shapes = { { 1, 16 }, { 3, 6 } };
+    size_t threads = 0;
+    int iterations = 3;
+    size_t picks = 200000;
+    size_t samples = 48;
+    int windowWidth = 1920, windowHeight = 1080;
+    bool keep = false;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--files=", 0) == 0) {
+            fileCounts = ParseList<size_t>(arg.c_str() + 8, [](const std::string& text, size_t& value) {
+                value = std::strtoull(text.c_str(), nullptr, 10);
+                return value > 0;
+            });
+        }
+        else if (arg.rfind("--shapes=", 0) == 0) {
+            shapes = ParseList<TreeShape>(arg.c_str() + 9, [](const std::string& text, TreeShape& value) {
+                return std::sscanf(text.c_str(), "%zux%zu", &value.depth, &value.fanout) == 2 && value.fanout > 0;
+            });
+        }
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::strtoull(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--iterations=", 0) == 0) iterations = std::max(1, std::atoi(arg.c_str() + 13));
+        else if (arg.rfind("--picks=", 0) == 0) picks = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--samples=", 0) == 0) samples = std::max<size_t>(1, std::strtoull(arg.c_str() + 10, nullptr, 10));
+        else if (arg.rfind("--window=", 0) == 0) std::sscanf(arg.c_str() + 9, "%dx%d", &windowWidth, &windowHeight);
+        else if (arg.rfind("--out=", 0) == 0) outPath = arg.substr(6);
+        else if (arg == "--keep") keep = true;
+        else {
+            std::fprintf(stderr, "usage: SuiteBench [--files=N,N...] [--shapes=DxF,DxF...] [--threads=N] [--iterations=N]\n"
+                "                  [--picks=N] [--samples=N] [--window=WxH] [--out=fichier.json] [--keep]\n");
+            return 2;
+        }
+    }
+    if (fileCounts.empty() || shapes.empty() || windowWidth <= 0 || windowHeight <= 0) {
+        std::fprintf(stderr, "nothing to measure\n");
+        return 2;
+    }
+
+    fs::path base = fs::temp_directory_path() / "RandomPictureSuiteBench";
+    std::error_code ec;
+    fs::remove_all(base, ec);
+    std::vector<fs::path> payloads = WritePayloads(base / "payloads");
+    if (payloads.empty()) {
+        std::fprintf(stderr, "cannot write %s\n", base.string().c_str());
+        return 1;
+    }
+
+    int failures = 0;
+    std::vector<TreeReport> reports;
+    for (size_t files : fileCounts) {
+        for (TreeShape shape : shapes) {
+            TreeReport report;
+            report.files = files;
+            report.shape = shape;
+            fs::path root = base / ("tree_" + std::to_string(files) + "_" + std::to_string(shape.depth) + "x" +
+                std::to_string(shape.fanout));
+            std::wstring rootPath = PathToWide(root);
+
+            auto start = std::chrono::steady_clock::now();
+            report.directories = GenerateTree(root, files, shape, payloads);
+            if (report.directories == 0) {
+                std::fprintf(stderr, "cannot write %s\n", root.string().c_str());
+                return 1;
+            }
+            double generateMs = Milliseconds(start);
+            report.stages.push_back(Stage{ "generate", { { "ms", generateMs } } });
+            std::fprintf(stderr, "%zu files, depth %zu, fan-out %zu (%zu folders), generated in %.0f ms\n",
+                files, shape.depth, shape.fanout, report.directories, generateMs);
+
+            // Premier parcours pour charger les dossiers et les entetes en cache
+            WalkResult walked = Walk(rootPath, threads);
+            size_t found = 0;
+            for (const auto& directory : walked.directories) found += directory.files.size();
+            if (found != files) {
+                std::fprintf(stderr, "  walk found %zu files\n", found);
+                ++failures;
+            }
+
+            report.stages.push_back(MeasureRuns("walk", iterations, files, [&]() {
+                walked = Walk(rootPath, threads);
+            }));
+            if (files <= LegacyScanLimit) {
+                report.stages.push_back(MeasureRuns("scan_legacy", iterations, files, [&]() {
+                    std::vector<std::wstring> images;
+                    ScanDirectoryRecursive(rootPath, images);
+                }));
+            }
+
+            std::vector<WalkDirectoryInfo> probed;
+            size_t rejected = 0;
+            report.stages.push_back(MeasureRuns("probe", iterations, files, [&]() {
+                probed = walked.directories;
+                rejected = ProbeListings(probed, threads);
+            }));
+            if (rejected != 0) {
+                std::fprintf(stderr, "  probe rejected %zu valid files\n", rejected);
+                ++failures;
+            }
+
+            ImageCatalog catalog;
+            report.stages.push_back(MeasureRuns("catalog", iterations, files, [&]() {
+                std::vector<WalkDirectoryInfo> listings = probed;
+                catalog = BuildCatalog(listings);
+            }));
+
+            fs::path indexPath = base / "suite.rpindex";
+            std::wstring indexWide = PathToWide(indexPath);
+            report.stages.push_back(MeasureRuns("index_save", iterations, files, [&]() {
+                if (!SaveLibraryIndex(indexWide, rootPath, probed)) ++failures;
+            }));
+            report.stages.push_back(MeasureRuns("index_load", iterations, files, [&]() {
+                LibraryIndex index;
+                ImageCatalog loaded;
+                if (!index.Open(indexWide, rootPath)) {
+                    ++failures;
+                    return;
+                }
+                LoadCatalogFromIndex(index, loaded);
+                if (loaded.Size() != catalog.Size()) ++failures;
+            }));
+            fs::remove(indexPath, ec);
+
+            // Tirages : chaque appel est chronometre ; le premier (table des poids) a part
+            const SelectionMode modes[] = { SelectionMode::Uniform, SelectionMode::ShuffleBag,
+                SelectionMode::BalancedFolders, SelectionMode::RecentFirst };
+            HistoryRing history(1000);
+            std::vector<double> pushTimes, navigationTimes;
+            for (SelectionMode mode : modes) {
+                RandomSelector selector(42);
+                selector.SetMode(mode);
+                auto setupStart = std::chrono::steady_clock::now();
+                ImageId first = selector.Pick(catalog);
+                double setupMs = Milliseconds(setupStart);
+                std::vector<double> times;
+                times.reserve(picks);
+                for (size_t i = 0; i < picks; ++i) {
+                    auto pickStart = std::chrono::steady_clock::now();
+                    ImageId id = selector.Pick(catalog);
+                    auto pickEnd = std::chrono::steady_clock::now();
+                    times.push_back(Nanoseconds(pickStart, pickEnd));
+
+                    // Historique : ajout de chaque image, et un retour arriere sur seize
+                    auto pushStart = std::chrono::steady_clock::now();
+                    history.Push(id);
+                    auto pushEnd = std::chrono::steady_clock::now();
+                    pushTimes.push_back(Nanoseconds(pushStart, pushEnd));
+                    if (i % 16 == 15) {
+                        auto backStart = std::chrono::steady_clock::now();
+                        history.Back();
+                        auto backEnd = std::chrono::steady_clock::now();
+                        navigationTimes.push_back(Nanoseconds(backStart, backEnd));
+                    }
+                }
+                if (first == InvalidImageId) ++failures;
+                Stage stage = LatencyStage((std::string("select_") + SelectionModeName(mode)).c_str(), times);
+                stage.metrics.push_back(Metric{ "setup_ms", setupMs });
+                report.stages.push_back(std::move(stage));
+            }
+            report.stages.push_back(LatencyStage("history_push", pushTimes));
+            report.stages.push_back(LatencyStage("history_back", navigationTimes));
+
+            // Decodage et mise a l'echelle pour la fenetre d'un echantillon de fichiers
+            std::vector<double> decodeTimes, scaleTimes;
+            std::vector<uint8_t> window;
+            Xoshiro256 random(7);
+            for (size_t i = 0; i < samples; ++i) {
+                ImageId id = (ImageId)random.Below((uint32_t)catalog.Size());
+                DecodedImage image;
+                auto decodeStart = std::chrono::steady_clock::now();
+                bool decoded = DecodeImageFile(catalog.FullPath(id), windowWidth, windowHeight, image);
+                auto decodeEnd = std::chrono::steady_clock::now();
+                if (!decoded) {
+                    ++failures;
+                    continue;
+                }
+                decodeTimes.push_back(Nanoseconds(decodeStart, decodeEnd));
+
+                double scale = std::min((double)windowWidth / image.width, (double)windowHeight / image.height);
+                int width = std::max(1, (int)(image.width * scale));
+                int height = std::max(1, (int)(image.height * scale));
+                window.resize((size_t)width * height * 4);
+                ImageView destination{ window.data(), width, height, (ptrdiff_t)width * 4 };
+                auto scaleStart = std::chrono::steady_clock::now();
+                bool scaled = ResampleImage(image.View(), destination, ResampleOptions());
+                auto scaleEnd = std::chrono::steady_clock::now();
+                if (!scaled) ++failures;
+                scaleTimes.push_back(Nanoseconds(scaleStart, scaleEnd));
+            }
+            report.stages.push_back(LatencyStage("decode", decodeTimes));
+            report.stages.push_back(LatencyStage("scale", scaleTimes));
+
+            for (const auto& stage : report.stages) PrintStage(stage);
+            reports.push_back(std::move(report));
+            if (!keep) fs::remove_all(root, ec);
+        }
+    }
+    if (!keep) fs::remove_all(base, ec);
+
+    FILE* out = stdout;
+    if (!outPath.empty()) {
+        out = std::fopen(outPath.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", outPath.c_str());
+            return 1;
+        }
+    }
+    WriteJson(out, reports, threads);
+    if (out != stdout) std::fclose(out);
+
+    if (failures > 0) std::fprintf(stderr, "%d checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,280 @@
+// Grille de miniatures (ThumbnailAtlas, ThumbnailGenerator) : calcul des miniatures de
+// photos synthetiques sur le pool, puis relance sur l'atlas deja rempli, reouverture du
+// fichier et verification des pixels conserves. Ensuite l'atlas est rempli jusqu'a
+// --entries miniatures et une grille de --view est parcourue de haut en bas comme un
+// defilement rapide : chaque image recherche les cases visibles et les copie dans une
+// image de la taille de la vue (ce que fait SetDIBitsToDevice dans la fenetre). Le temps
+// par image est compare a celui d'un rafraichissement a 60 Hz. Enfin un quart des cases
+// est rendu (fichiers modifies) et doit etre repris sans agrandir le fichier.
+//
+//   ThumbBench [--files=N] [--size=WxH] [--entries=N] [--view=WxH] [--rows=N] [--threads=N]
+//              [--budget-ms=X] [--keep]
+
+#include "BenchCommon.h"
+#include "PathString.h"
+#include "ThumbnailAtlas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool ParseSize(const char* text, int& width, int& height) {
+        return std::sscanf(text, "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+    }
+
+    uint64_t Checksum(const Thumbnail& thumbnail) {
+        uint64_t sum = 1469598103934665603ull;
+        for (ptrdiff_t i = 0; i < ThumbnailAtlas::ThumbnailStride * ThumbnailAtlas::ThumbnailSize; ++i) {
+            sum = (sum ^ thumbnail.pixels[i]) * 1099511628211ull;
+        }
+        return sum;
+    }
+
+    // Miniature synthetique, pour remplir l'atlas sans decoder
+    void MakeThumbnail(DecodedImage& image, uint32_t seed) {
+        image.Allocate(ThumbnailAtlas::ThumbnailSize, ThumbnailAtlas::ThumbnailSize * 3 / 4);
+        for (int y = 0; y < image.height; ++y) {
+            uint8_t* row = image.Row(y);
+            for (int x = 0; x < image.width; ++x) {
+                row[x * 4 + 0] = (uint8_t)(seed * 37 + x);
+                row[x * 4 + 1] = (uint8_t)(seed * 11 + y);
+                row[x * 4 + 2] = (uint8_t)(seed >> 3);
+                row[x * 4 + 3] = 255;
+            }
+        }
+    }
+
+    struct FrameStats {
+        size_t frames = 0;
+        double meanMs = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+        size_t missing = 0;
+    };
+
+    // Defilement de haut en bas, `rows` lignes par image
+    FrameStats Scroll(const ThumbnailAtlas& atlas, const std::vector<uint64_t>& keys, int viewWidth, int viewHeight,
+        int rows, std::vector<uint8_t>& frame) {
+        const ptrdiff_t frameStride = ((ptrdiff_t)viewWidth * 3 + 3) & ~(ptrdiff_t)3;
+        frame.assign((size_t)frameStride * viewHeight, 0);
+        std::vector<double> times;
+        FrameStats stats;
+        ThumbnailGridLayout layout = LayoutThumbnailGrid(viewWidth, viewHeight, keys.size(), 0);
+        for (int64_t scroll = 0;; scroll += (int64_t)rows * layout.cell) {
+            auto start = std::chrono::steady_clock::now();
+            layout = LayoutThumbnailGrid(viewWidth, viewHeight, keys.size(), scroll);
+            std::fill(frame.begin(), frame.end(), ThumbnailAtlas::Background);
+            for (size_t i = layout.first; i < layout.last; ++i) {
+                Thumbnail thumbnail;
+                if (!atlas.Find(keys[i], thumbnail)) {
+                    ++stats.missing;
+                    continue;
+                }
+                // Copie coupee aux bords de la vue
+                size_t row = (i - layout.first) / layout.columns;
+                int x = layout.left + (int)((i - layout.first) % layout.columns) * layout.cell;
+                int y = layout.top + (int)row * layout.cell;
+                int width = std::min(ThumbnailAtlas::ThumbnailSize, viewWidth - x);
+                for (int line = std::max(0, -y); line < ThumbnailAtlas::ThumbnailSize && y + line < viewHeight; ++line) {
+                    std::memcpy(&frame[(size_t)((y + line) * frameStride + x * 3)],
+                        thumbnail.pixels + line * ThumbnailAtlas::ThumbnailStride, (size_t)width * 3);
+                }
+            }
+            times.push_back(Milliseconds(start));
+            if (scroll >= layout.maxScroll) break;
+        }
+        std::sort(times.begin(), times.end());
+        stats.frames = times.size();
+        for (double time : times) stats.meanMs += time;
+        stats.meanMs /= (double)times.size();
+        stats.p99Ms = times[std::min(times.size() - 1, times.size() * 99 / 100)];
+        stats.maxMs = times.back();
+        return stats;
+    }
+
+    void PrintFrames(const char* label, const FrameStats& stats, double budgetMs) {
+        std::printf("%s: %zu frames, %.3f ms mean, %.3f ms p99, %.3f ms max (budget %.1f ms)%s\n", label, stats.frames,
+            stats.meanMs, stats.p99Ms, stats.maxMs, budgetMs, stats.missing ? " - missing thumbnails" : "");
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t files = 200;
+    int imageWidth = 1600, imageHeight = 1200;
+    size_t entries = 100000;
+    int viewWidth = 1280, viewHeight = 800;
+    int rows = 3;
+    size_t threads = 0;
+    double budgetMs = 1000.0 / 60.0;
+    bool keep = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--files=", 0) == 0) files = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--size=", 0) == 0 && ParseSize(arg.c_str() + 7, imageWidth, imageHeight)) {}
+        else if (arg.rfind("--entries=", 0) == 0) entries = std::strtoull(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--view=", 0) == 0 && ParseSize(arg.c_str() + 7, viewWidth, viewHeight)) {}
+        else if (arg.rfind("--rows=", 0) == 0) rows = std::max(1, std::atoi(arg.c_str() + 7));
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::strtoull(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--budget-ms=", 0) == 0) budgetMs = std::atof(arg.c_str() + 12);
+        else if (arg == "--keep") keep = true;
+        else {
+            std::fprintf(stderr, "usage: ThumbBench [--files=N] [--size=WxH] [--entries=N] [--view=WxH] [--rows=N]"
+                " [--threads=N] [--budget-ms=X] [--keep]\n");
+            return 2;
+        }
+    }
+    entries = std::max(entries, files);
+
+    fs::path root = fs::temp_directory_path() / "RandomPictureThumbBench";
+    fs::remove_all(root);
+    fs::create_directories(root / "photos");
+    std::wstring atlasPath = PathToWide(root / "library.rpthumb");
+
+    std::vector<ThumbnailJob> jobs;
+    for (size_t i = 0; i < files; ++i) {
+        std::vector<uint8_t> rgb = MakeRgb(imageWidth, imageHeight, (uint32_t)i);
+#if defined(RANDOMPICTURE_HAVE_LIBJPEG)
+        fs::path path = root / "photos" / ("IMG_" + std::to_string(i) + ".jpg");
+        bool written = WriteJpeg(path, rgb, imageWidth, imageHeight);
+#else
+        fs::path path = root / "photos" / ("IMG_" + std::to_string(i) + ".bmp");
+        bool written = WriteBmp(path, rgb, imageWidth, imageHeight);
+#endif
+        if (!written) {
+            std::fprintf(stderr, "cannot write %s\n", path.string().c_str());
+            return 1;
+        }
+        std::wstring wide = PathToWide(path);
+        jobs.push_back(ThumbnailJob{ FileKey(wide, 0), wide });
+    }
+
+    int failures = 0;
+    ThumbnailAtlas atlas;
+    if (!atlas.Open(atlasPath)) {
+        std::fprintf(stderr, "cannot open %s\n", root.string().c_str());
+        return 1;
+    }
+
+    // Premier affichage : toutes les miniatures a calculer
+    ThumbnailGenerator generator;
+    generator.threadCount = threads;
+    generator.Start(atlas, nullptr);
+    auto start = std::chrono::steady_clock::now();
+    generator.Request(jobs);
+    generator.WaitIdle();
+    double coldMs = Milliseconds(start);
+    ThumbnailGenerator::Stats stats = generator.GetStats();
+    std::printf("%zu photos %dx%d: %zu thumbnails in %.0f ms, %.0f thumbnails/s\n", files, imageWidth, imageHeight,
+        stats.generated, coldMs, stats.generated * 1000.0 / std::max(coldMs, 1e-3));
+    if (stats.generated != files || stats.failed != 0 || atlas.Count() != files) {
+        std::printf("expected %zu thumbnails, %zu generated, %zu failed\n", files, stats.generated, stats.failed);
+        ++failures;
+    }
+
+    // Meme demande sur l'atlas rempli : rien a calculer
+    start = std::chrono::steady_clock::now();
+    generator.Request(jobs);
+    generator.WaitIdle();
+    double warmMs = Milliseconds(start);
+    std::printf("same request on a warm atlas: %.2f ms, %zu generated\n", warmMs, generator.GetStats().generated - stats.generated);
+    if (generator.GetStats().generated != stats.generated) ++failures;
+
+    // Les pixels survivent a la fermeture
+    std::vector<uint64_t> checksums;
+    for (const ThumbnailJob& job : jobs) {
+        Thumbnail thumbnail;
+        checksums.push_back(atlas.Find(job.key, thumbnail) ? Checksum(thumbnail) : 0);
+    }
+    generator.Cancel();
+
+    // Remplissage jusqu'a `entries` cases, sans decodage
+    std::vector<uint64_t> keys;
+    for (const ThumbnailJob& job : jobs) keys.push_back(job.key);
+    DecodedImage synthetic;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = files; i < entries; ++i) {
+        MakeThumbnail(synthetic, (uint32_t)i);
+        keys.push_back(FileKey(L"synthetic/" + std::to_wstring(i), 0));
+        if (!atlas.Store(keys.back(), synthetic)) {
+            std::printf("cannot store thumbnail %zu\n", i);
+            ++failures;
+            break;
+        }
+    }
+    double fillMs = Milliseconds(start);
+    std::printf("%zu more thumbnails stored in %.0f ms (%.1f us each), atlas %.0f MB\n", entries - files, fillMs,
+        fillMs * 1000 / std::max<size_t>(1, entries - files), atlas.FileBytes() / 1048576.0);
+    atlas.Close();
+
+    start = std::chrono::steady_clock::now();
+    if (!atlas.Open(atlasPath)) {
+        std::printf("cannot reopen the atlas\n");
+        return 1;
+    }
+    double openMs = Milliseconds(start);
+    std::printf("reopen: %zu thumbnails in %.1f ms\n", atlas.Count(), openMs);
+    if (atlas.Count() != entries) ++failures;
+    size_t changed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        Thumbnail thumbnail;
+        if (!atlas.Find(jobs[i].key, thumbnail) || Checksum(thumbnail) != checksums[i]) ++changed;
+    }
+    if (changed > 0) {
+        std::printf("%zu thumbnails differ after reopening\n", changed);
+        ++failures;
+    }
+
+    // Premier parcours : pages pas encore touchees dans ce processus ; second : atlas chaud
+    std::vector<uint8_t> frame;
+    std::printf("grid %dx%d over %zu entries, %d rows per frame\n", viewWidth, viewHeight, keys.size(), rows);
+    FrameStats first = Scroll(atlas, keys, viewWidth, viewHeight, rows, frame);
+    PrintFrames("first pass", first, budgetMs);
+    FrameStats warm = Scroll(atlas, keys, viewWidth, viewHeight, rows, frame);
+    PrintFrames("warm pass", warm, budgetMs);
+    if (first.missing || warm.missing || warm.p99Ms > budgetMs) ++failures;
+
+    // Un quart des fichiers modifies : leurs cases sont rendues puis reprises par les
+    // nouvelles miniatures, sans agrandir le fichier, et le restent apres reouverture
+    size_t edited = keys.size() / 4;
+    std::unordered_set<uint64_t> live(keys.begin() + edited, keys.end());
+    uint64_t bytesBefore = atlas.FileBytes();
+    size_t released = atlas.ReleaseUnused(live);
+    for (size_t i = 0; i < edited; ++i) {
+        MakeThumbnail(synthetic, (uint32_t)i);
+        keys[i] = FileKey(L"edited/" + std::to_wstring(i), 1);
+        if (!atlas.Store(keys[i], synthetic)) {
+            std::printf("cannot store edited thumbnail %zu\n", i);
+            ++failures;
+            break;
+        }
+    }
+    atlas.Close();
+    if (!atlas.Open(atlasPath)) {
+        std::printf("cannot reopen the atlas\n");
+        return 1;
+    }
+    std::printf("%zu slots released and reused: atlas %.0f MB, %.0f MB before\n", released,
+        atlas.FileBytes() / 1048576.0, bytesBefore / 1048576.0);
+    size_t lost = 0;
+    for (uint64_t key : keys) lost += atlas.Contains(key) ? 0 : 1;
+    if (released != edited || atlas.FileBytes() != bytesBefore || atlas.Count() != entries || lost > 0) {
+        std::printf("%zu of %zu slots released, %zu thumbnails missing\n", released, edited, lost);
+        ++failures;
+    }
+
+    atlas.Close();
+    if (!keep) fs::remove_all(root);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+// Cout d'une TraceSpan, trace desactivee puis activee, sur un et plusieurs threads, et
+// coherence des evenements lus pendant que les threads ecrivent (aucune case a moitie
+// ecrite, au plus un anneau plein par thread). Ecrit aussi une trace Chrome d'exemple.
+//
+//   TraceBench [--spans=N] [--threads=N] [--out=trace.json]
+
+#include "PathString.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Travail minimal dans la portee, pour que la boucle ne soit pas supprimee
+    std::atomic<uint64_t> g_sink{ 0 };
+
+    // Temps par span, ramene au temps CPU quand il y a plus de threads que de coeurs
+    double NanosecondsPerSpan(size_t spans, size_t threads) {
+        auto run = [spans]() {
+            uint64_t local = 0;
+            for (size_t i = 0; i < spans; ++i) {
+                TraceSpan span(TraceStage::Decode);
+                local += i;
+            }
+            g_sink += local;
+        };
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t) workers.emplace_back(run);
+        run();
+        for (auto& worker : workers) worker.join();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        size_t cores = std::max<size_t>(1, std::min<size_t>(threads, std::thread::hardware_concurrency()));
+        return elapsed.count() * cores / ((double)spans * threads);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t spans = 10000000;
+    size_t threads = 4;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--spans=", 0) == 0) spans = std::max<size_t>(1, std::strtoull(arg.c_str() + 8, nullptr, 10));
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::max<size_t>(1, std::strtoull(arg.c_str() + 10, nullptr, 10));
+        else if (arg.rfind("--out=", 0) == 0) outPath = arg.substr(6);
+        else {
+            std::fprintf(stderr, "usage: TraceBench [--spans=N] [--threads=N] [--out=trace.json]\n");
+            return 2;
+        }
+    }
+
+    // Une span active lit deux fois l'horloge : c'est l'essentiel de son cout
+    size_t reads = std::max<size_t>(1, spans / 10);
+    auto clockStart = std::chrono::steady_clock::now();
+    int64_t clockSum = 0;
+    for (size_t i = 0; i < reads; ++i) clockSum += TraceNow();
+    std::chrono::duration<double, std::nano> clockElapsed = std::chrono::steady_clock::now() - clockStart;
+    g_sink += (uint64_t)clockSum;
+    std::printf("clock read: %.2f ns\n", clockElapsed.count() / reads);
+
+    std::printf("%-10s %8s %12s\n", "trace", "threads", "ns/span");
+    for (bool enabled : { false, true }) {
+        SetTraceEnabled(enabled);
+        for (size_t count : { (size_t)1, threads }) {
+            std::printf("%-10s %8zu %12.2f\n", enabled ? "on" : "off", count, NanosecondsPerSpan(spans, count));
+        }
+    }
+
+    // Lectures pendant les ecritures : chaque thread enregistre des evenements dont la duree
+    // se deduit de la date, une case lue a moitie ecrite ne respecterait pas la relation
+    int failures = 0;
+    std::atomic<bool> stop{ false };
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < threads; ++t) {
+        writers.emplace_back([&stop]() {
+            for (int64_t i = 1; !stop; ++i) RecordTrace(TraceStage::Scale, i, i * 3);
+        });
+    }
+    size_t collections = 0, torn = 0, largest = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500)) {
+        std::vector<TraceEvent> events = CollectTraceEvents();
+        ++collections;
+        largest = std::max(largest, events.size());
+        for (const TraceEvent& event : events) {
+            if (event.stage == TraceStage::Scale && event.duration != event.start * 3) ++torn;
+        }
+    }
+    stop = true;
+    for (auto& writer : writers) writer.join();
+    std::printf("%zu collections during writes, up to %zu events, %zu inconsistent\n", collections, largest, torn);
+    if (torn > 0) ++failures;
+
+    // Un anneau par thread en vie ou termine ; les anneaux des threads termines sont repris
+    SetTraceEnabled(true);
+    for (int i = 0; i < 8; ++i) {
+        TraceSpan span(TraceStage::Paint);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    size_t ringLimit = (threads + 1) * 4096;
+    size_t collected = CollectTraceEvents().size();
+    if (collected > ringLimit) {
+        std::printf("%zu events kept, more than %zu\n", collected, ringLimit);
+        ++failures;
+    }
+
+    fs::path path = outPath.empty() ? fs::temp_directory_path() / "RandomPictureTraceBench.json" : fs::path(outPath);
+    int64_t written = WriteChromeTrace(PathToWide(path));
+    std::printf("%lld events written to %s\n", (long long)written, path.string().c_str());
+    if (written <= 0) ++failures;
+    if (outPath.empty()) {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+    return failures == 0 ? 0 : 1;
+}